@@ -750,8 +750,8 @@ int main(int argc, char *argv[])
 	if (0 == emcioCommand ||	// bad command pointer
 	    0 == emcioCommand->type ||	// bad command type
 	    emcioCommand->serial_number == emcioStatus.echo_serial_number) {	// command already finished
-	    /* wait until next cycle */
-	    esleep(emc_io_cycle_time);
+	    /* wait until next cycle, or a new command */
+	    emcioCommandBuffer->wait_for_write(emc_io_cycle_time);
 	    /* and repeat */
 	    continue;
 	}
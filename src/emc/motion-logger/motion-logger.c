@@ -289,6 +289,56 @@ void log_print(const char *fmt, ...) {
 }
 
 
+// logs a line or circle the way its own SET_LINE or SET_CIRCLE would be
+static void log_segment(const emcmot_segment_t *seg) {
+    if (!seg->circle) {
+        log_print(
+            "SET_LINE x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f, id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
+            seg->pos.tran.x, seg->pos.tran.y, seg->pos.tran.z,
+            seg->pos.a, seg->pos.b, seg->pos.c,
+            seg->pos.u, seg->pos.v, seg->pos.w,
+            seg->id, seg->motion_type,
+            seg->vel, seg->ini_maxvel,
+            seg->acc, seg->turn
+        );
+        return;
+    }
+    log_print("SET_CIRCLE:\n");
+    log_print(
+        "    pos: x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
+        seg->pos.tran.x, seg->pos.tran.y, seg->pos.tran.z,
+        seg->pos.a, seg->pos.b, seg->pos.c,
+        seg->pos.u, seg->pos.v, seg->pos.w
+    );
+    log_print("    center: x=%.6f, y=%.6f, z=%.6f\n", seg->center.x, seg->center.y, seg->center.z);
+    log_print("    normal: x=%.6f, y=%.6f, z=%.6f\n", seg->normal.x, seg->normal.y, seg->normal.z);
+    log_print("    id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
+        seg->id, seg->motion_type,
+        seg->vel, seg->ini_maxvel,
+        seg->acc, seg->turn
+    );
+}
+
+
+// the move of a SET_LINE or SET_CIRCLE command, for log_segment()
+static void log_command_segment(int circle) {
+    emcmot_segment_t seg;
+
+    seg.circle = circle;
+    seg.pos = c->pos;
+    seg.center = c->center;
+    seg.normal = c->normal;
+    seg.turn = c->turn;
+    seg.motion_type = c->motion_type;
+    seg.vel = c->vel;
+    seg.ini_maxvel = c->ini_maxvel;
+    seg.acc = c->acc;
+    seg.id = c->id;
+    seg.spindle = c->spindle;
+    log_segment(&seg);
+}
+
+
 int main(int argc, char* argv[]) {
     if (argc == 1) {
         logfile = stdout;
@@ -468,34 +518,21 @@ int main(int argc, char* argv[]) {
                 break;
 
             case EMCMOT_SET_LINE:
-                log_print(
-                    "SET_LINE x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f, id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
-                    c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
-                    c->pos.a, c->pos.b, c->pos.c,
-                    c->pos.u, c->pos.v, c->pos.w,
-                    c->id, c->motion_type,
-                    c->vel, c->ini_maxvel,
-                    c->acc, c->turn
-                );
+                log_command_segment(0);
                 break;
 
             case EMCMOT_SET_CIRCLE:
-                log_print("SET_CIRCLE:\n");
-                log_print(
-                    "    pos: x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
-                    c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
-                    c->pos.a, c->pos.b, c->pos.c,
-                    c->pos.u, c->pos.v, c->pos.w
-                );
-                log_print("    center: x=%.6f, y=%.6f, z=%.6f\n", c->center.x, c->center.y, c->center.z);
-                log_print("    normal: x=%.6f, y=%.6f, z=%.6f\n", c->normal.x, c->normal.y, c->normal.z);
-                log_print("    id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f, turn=%d\n",
-                    c->id, c->motion_type,
-                    c->vel, c->ini_maxvel,
-                    c->acc, c->turn
-                );
+                log_command_segment(1);
                 break;
 
+            case EMCMOT_SET_SEGMENTS: {
+                int n;
+                for (n = 0; n < c->num_segments; n++) {
+                    log_segment(&c->segments[n]);
+                }
+                break;
+            }
+
             case EMCMOT_SET_TELEOP_VECTOR:
                 log_print("SET_TELEOP_VECTOR\n");
                 break;
@@ -399,6 +399,166 @@ STATIC int is_feed_type(int motion_type)
     }
 }
 
+/* copies the move of a SET_LINE or SET_CIRCLE command to seg */
+STATIC void command_segment(emcmot_segment_t *seg, int circle)
+{
+    seg->circle = circle;
+    seg->pos = emcmotCommand->pos;
+    seg->center = emcmotCommand->center;
+    seg->normal = emcmotCommand->normal;
+    seg->turn = emcmotCommand->turn;
+    seg->motion_type = emcmotCommand->motion_type;
+    seg->vel = emcmotCommand->vel;
+    seg->ini_maxvel = emcmotCommand->ini_maxvel;
+    seg->acc = emcmotCommand->acc;
+    seg->id = emcmotCommand->id;
+    seg->spindle = emcmotCommand->spindle;
+}
+
+/* appends a linear move to emcmotDebug->coord_tp. Returns 0, or -1 after
+   setting emcmotStatus->commandStatus if it can't. */
+STATIC int queue_line(emcmot_segment_t const *seg)
+{
+    char issue_atspeed = 0;
+
+    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+	reportError(_("need to be enabled, in coord mode for linear move"));
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    } else if (!inRange(seg->pos, seg->id, "Linear")) {
+	reportError(_("invalid params in linear command"));
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+	tpAbort(&emcmotDebug->coord_tp);
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    } else if (!limits_ok()) {
+	reportError(_("can't do linear move with limits exceeded"));
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+	tpAbort(&emcmotDebug->coord_tp);
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    }
+
+    if(emcmotStatus->atspeed_next_feed && is_feed_type(seg->motion_type) ) {
+	issue_atspeed = 1;
+	emcmotStatus->atspeed_next_feed = 0;
+    }
+    if(!is_feed_type(seg->motion_type) &&
+	    emcmotStatus->spindle_status[seg->spindle].css_factor) {
+	emcmotStatus->atspeed_next_feed = 1;
+    }
+
+    /* append it to the emcmotDebug->coord_tp */
+    tpSetId(&emcmotDebug->coord_tp, seg->id);
+    int res_addline = tpAddLine(&emcmotDebug->coord_tp, seg->pos, seg->motion_type,
+                            seg->vel, seg->ini_maxvel,
+                            seg->acc, emcmotStatus->enables_new, issue_atspeed,
+                            seg->turn);
+    //KLUDGE ignore zero length line
+    if (res_addline < 0) {
+        reportError(_("can't add linear move at line %d, error code %d"),
+                seg->id, res_addline);
+        emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+        tpAbort(&emcmotDebug->coord_tp);
+        SET_MOTION_ERROR_FLAG(1);
+        return -1;
+    } else if (res_addline != 0) {
+        //TODO make this hand-shake more explicit
+        //KLUDGE Non fatal error, need to restore state so that the next
+        //line properly handles at_speed
+        if (issue_atspeed) {
+            emcmotStatus->atspeed_next_feed = 1;
+        }
+    } else {
+	SET_MOTION_ERROR_FLAG(0);
+	/* set flag that indicates all joints need rehoming, if any
+	   joint is moved in joint mode, for machines with no forward
+	   kins */
+	rehomeAll = 1;
+    }
+    return 0;
+}
+
+/* appends a circular move to emcmotDebug->coord_tp. Returns 0, or -1
+   after setting emcmotStatus->commandStatus if it can't. */
+STATIC int queue_circle(emcmot_segment_t const *seg)
+{
+    char issue_atspeed = 0;
+
+    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+	reportError(_("need to be enabled, in coord mode for circular move"));
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    } else if (!inRange(seg->pos, seg->id, "Circular")) {
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+	tpAbort(&emcmotDebug->coord_tp);
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    } else if (!limits_ok()) {
+	reportError(_("can't do circular move with limits exceeded"));
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+	tpAbort(&emcmotDebug->coord_tp);
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    }
+    if(emcmotStatus->atspeed_next_feed) {
+        issue_atspeed = 1;
+        emcmotStatus->atspeed_next_feed = 0;
+    }
+    /* append it to the emcmotDebug->coord_tp */
+    tpSetId(&emcmotDebug->coord_tp, seg->id);
+    int res_addcircle = tpAddCircle(&emcmotDebug->coord_tp, seg->pos,
+                        seg->center, seg->normal,
+                        seg->turn, seg->motion_type,
+                        seg->vel, seg->ini_maxvel,
+                        seg->acc, emcmotStatus->enables_new, issue_atspeed);
+    if (res_addcircle < 0) {
+        reportError(_("can't add circular move at line %d, error code %d"),
+                seg->id, res_addcircle);
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+	tpAbort(&emcmotDebug->coord_tp);
+	SET_MOTION_ERROR_FLAG(1);
+	return -1;
+    } else if (res_addcircle != 0) {
+        //FIXME! This is a band-aid for a single issue, but there may be
+        //other consequences of non-fatal errors from AddXXX functions. We
+        //either need to fix the root cause (subtle position error after
+        //homing), or have a full restore here.
+        if (issue_atspeed) {
+            emcmotStatus->atspeed_next_feed = 1;
+        }
+    } else {
+	SET_MOTION_ERROR_FLAG(0);
+	/* set flag that indicates all joints need rehoming, if any
+	   joint is moved in joint mode, for machines with no forward
+	   kins */
+	rehomeAll = 1;
+    }
+    return 0;
+}
+
+/* moves of the EMCMOT_SET_SEGMENTS command being queued. One goes to
+   emcmotDebug->coord_tp each servo cycle, like the SET_LINE and
+   SET_CIRCLE commands they stand for, and the command is only echoed
+   once they are all queued, or one failed. Until then the sender waits,
+   so its next status read sees the whole batch in the queue. */
+static emcmot_segment_t pendingSegments[EMCMOT_MAX_SEGMENTS];
+static int pendingNext, pendingCount;
+
+/* queues the next pending move, dropping the rest if it fails. Returns
+   non-zero while there are more. */
+STATIC int queue_pending_segment(void)
+{
+    emcmot_segment_t const *seg = &pendingSegments[pendingNext++];
+
+    if (0 != (seg->circle ? queue_circle(seg) : queue_line(seg))) {
+	pendingNext = pendingCount;
+    }
+    return pendingNext < pendingCount;
+}
+
 /*
   emcmotCommandHandler() is called each main cycle to read the
   shared memory buffer
@@ -411,15 +571,26 @@ void emcmotCommandHandler(void *arg, long period)
     emcmot_axis_t *axis;
     double tmp1;
     emcmot_comp_entry_t *comp_entry;
-    char issue_atspeed = 0;
     int abort = 0;
     char* emsg;
+    emcmot_segment_t segment;
 
     /* check for split read */
     if (emcmotCommand->head != emcmotCommand->tail) {
 	emcmotDebug->split++;
 	return;			/* not really an error */
     }
+    if (pendingNext < pendingCount) {
+	/* carry on with the EMCMOT_SET_SEGMENTS command */
+	emcmotStatus->head++;
+	emcmotDebug->head++;
+	if (!queue_pending_segment()) {
+	    emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+	}
+	emcmotStatus->tail = emcmotStatus->head;
+	emcmotDebug->tail = emcmotDebug->head;
+	return;
+    }
     if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
 	/* increment head count-- we'll be modifying emcmotStatus */
 	emcmotStatus->head++;
@@ -1070,117 +1241,37 @@ void emcmotCommandHandler(void *arg, long period)
 	    /* emcmotDebug->coord_tp up a linear move */
 	    /* requires motion enabled, coordinated mode, not on limits */
 	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_LINE");
-	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
-		reportError(_("need to be enabled, in coord mode for linear move"));
-		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
-		SET_MOTION_ERROR_FLAG(1);
-		break;
-	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Linear")) {
-		reportError(_("invalid params in linear command"));
-		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
-		tpAbort(&emcmotDebug->coord_tp);
-		SET_MOTION_ERROR_FLAG(1);
-		break;
-	    } else if (!limits_ok()) {
-		reportError(_("can't do linear move with limits exceeded"));
-		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
-		tpAbort(&emcmotDebug->coord_tp);
-		SET_MOTION_ERROR_FLAG(1);
-		break;
-	    }
-
-		if(emcmotStatus->atspeed_next_feed && is_feed_type(emcmotCommand->motion_type) ) {
-			issue_atspeed = 1;
-			emcmotStatus->atspeed_next_feed = 0;
-		}
-		if(!is_feed_type(emcmotCommand->motion_type) &&
-				emcmotStatus->spindle_status[emcmotCommand->spindle].css_factor) {
-			emcmotStatus->atspeed_next_feed = 1;
-		}
-
-	    /* append it to the emcmotDebug->coord_tp */
-	    tpSetId(&emcmotDebug->coord_tp, emcmotCommand->id);
-        int res_addline = tpAddLine(&emcmotDebug->coord_tp, emcmotCommand->pos, emcmotCommand->motion_type, 
-                                emcmotCommand->vel, emcmotCommand->ini_maxvel, 
-                                emcmotCommand->acc, emcmotStatus->enables_new, issue_atspeed,
-                                emcmotCommand->turn);
-        //KLUDGE ignore zero length line
-        if (res_addline < 0) {
-            reportError(_("can't add linear move at line %d, error code %d"),
-                    emcmotCommand->id, res_addline);
-            emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
-            tpAbort(&emcmotDebug->coord_tp);
-            SET_MOTION_ERROR_FLAG(1);
-            break;
-        } else if (res_addline != 0) {
-            //TODO make this hand-shake more explicit
-            //KLUDGE Non fatal error, need to restore state so that the next
-            //line properly handles at_speed
-            if (issue_atspeed) {
-                emcmotStatus->atspeed_next_feed = 1;
-            }
-        } else {
-		SET_MOTION_ERROR_FLAG(0);
-		/* set flag that indicates all joints need rehoming, if any
-		   joint is moved in joint mode, for machines with no forward
-		   kins */
-		rehomeAll = 1;
-	    }
+	    command_segment(&segment, 0);
+	    queue_line(&segment);
 	    break;
 
 	case EMCMOT_SET_CIRCLE:
 	    /* emcmotDebug->coord_tp up a circular move */
 	    /* requires coordinated mode, enable on, not on limits */
 	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_CIRCLE");
-	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
-		reportError(_("need to be enabled, in coord mode for circular move"));
-		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
-		SET_MOTION_ERROR_FLAG(1);
-		break;
-	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Circular")) {
-		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
-		tpAbort(&emcmotDebug->coord_tp);
-		SET_MOTION_ERROR_FLAG(1);
-		break;
-	    } else if (!limits_ok()) {
-		reportError(_("can't do circular move with limits exceeded"));
+	    command_segment(&segment, 1);
+	    queue_circle(&segment);
+	    break;
+
+	case EMCMOT_SET_SEGMENTS:
+	    /* the lines and circles of several SET_LINE and SET_CIRCLE
+	       commands. The first is queued now and the rest in the next
+	       servo cycles, one each; stops at the first that fails, like
+	       those commands would have. Not echoed until then. */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_SEGMENTS");
+	    if (emcmotCommand->num_segments <= 0 ||
+		emcmotCommand->num_segments > EMCMOT_MAX_SEGMENTS) {
 		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
-		tpAbort(&emcmotDebug->coord_tp);
-		SET_MOTION_ERROR_FLAG(1);
 		break;
 	    }
-            if(emcmotStatus->atspeed_next_feed) {
-                issue_atspeed = 1;
-                emcmotStatus->atspeed_next_feed = 0;
-            }
-	    /* append it to the emcmotDebug->coord_tp */
-	    tpSetId(&emcmotDebug->coord_tp, emcmotCommand->id);
-	    int res_addcircle = tpAddCircle(&emcmotDebug->coord_tp, emcmotCommand->pos,
-                            emcmotCommand->center, emcmotCommand->normal,
-                            emcmotCommand->turn, emcmotCommand->motion_type,
-                            emcmotCommand->vel, emcmotCommand->ini_maxvel,
-                            emcmotCommand->acc, emcmotStatus->enables_new, issue_atspeed);
-        if (res_addcircle < 0) {
-            reportError(_("can't add circular move at line %d, error code %d"),
-                    emcmotCommand->id, res_addcircle);
-		emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
-		tpAbort(&emcmotDebug->coord_tp);
-		SET_MOTION_ERROR_FLAG(1);
-		break;
-        } else if (res_addcircle != 0) {
-            //FIXME! This is a band-aid for a single issue, but there may be
-            //other consequences of non-fatal errors from AddXXX functions. We
-            //either need to fix the root cause (subtle position error after
-            //homing), or have a full restore here.
-            if (issue_atspeed) {
-                emcmotStatus->atspeed_next_feed = 1;
-            }
-        } else {
-		SET_MOTION_ERROR_FLAG(0);
-		/* set flag that indicates all joints need rehoming, if any
-		   joint is moved in joint mode, for machines with no forward
-		   kins */
-		rehomeAll = 1;
+	    for (n = 0; n < emcmotCommand->num_segments; n++) {
+		pendingSegments[n] = emcmotCommand->segments[n];
+	    }
+	    pendingNext = 0;
+	    pendingCount = emcmotCommand->num_segments;
+	    if (queue_pending_segment()) {
+		/* not echoed yet */
+		emcmotStatus->commandNumEcho--;
 	    }
 	    break;
 
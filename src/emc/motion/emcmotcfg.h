@@ -33,6 +33,11 @@
 #endif
 
 #define EMCMOT_ERROR_NUM 32	/* how many errors we can queue */
+
+/* most moves sent in one EMCMOT_SET_SEGMENTS command. The planner may add
+   a blend arc for each, so keep twice this below the margin tcqFull()
+   leaves, and a batch sent while the queue is not full always fits. */
+#define EMCMOT_MAX_SEGMENTS 8
 #define EMCMOT_ERROR_LEN 1024	/* how long error string can be */
 
 /*
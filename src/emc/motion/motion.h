@@ -124,6 +124,7 @@ extern "C" {
 
 	EMCMOT_SET_LINE,	/* queue up a linear move */
 	EMCMOT_SET_CIRCLE,	/* queue up a circular move */
+	EMCMOT_SET_SEGMENTS,	/* queue up several lines and circles */
 	EMCMOT_SET_TELEOP_VECTOR,	/* Move at a given velocity but in
 					   world cartesian coordinates, not
 					   in joint space like EMCMOT_JOG_* */
@@ -207,6 +208,22 @@ extern "C" {
        COMMAND STRUCTURE
 *********************************/
 
+/* One line or circle of an EMCMOT_SET_SEGMENTS command, with the fields
+   EMCMOT_SET_LINE and EMCMOT_SET_CIRCLE take from the command. */
+    typedef struct emcmot_segment_t {
+	int circle;		/* non-zero for a circle, else a line */
+	EmcPose pos;		/* endpoint */
+	PmCartesian center;	/* center for circle */
+	PmCartesian normal;	/* normal vec for circle */
+	int turn;		/* turns for circle or which rotary to unlock for a line */
+	int motion_type;	/* traverse, feed, arc, or toolchange */
+	double vel;		/* max velocity */
+	double ini_maxvel;	/* max velocity allowed by the ini file */
+	double acc;		/* max acceleration */
+	int id;			/* id for motion */
+	int spindle;		/* spindle for at-speed checks */
+    } emcmot_segment_t;
+
 /* This is the command structure.  There is one of these in shared
    memory, and all commands from higher level code come thru it.
 */
@@ -262,6 +279,8 @@ extern "C" {
 	char    direction;      /* CANON_DIRECTION flag for spindle orient */
 	double  timeout;        /* of wait for spindle orient to complete */
 	unsigned char wait_for_spindle_at_speed; // EMCMOT_SPINDLE_ON now carries this, for next feed move
+	int num_segments;	/* moves in segments, for EMCMOT_SET_SEGMENTS */
+	emcmot_segment_t segments[EMCMOT_MAX_SEGMENTS];
 	unsigned char tail;	/* flag count for mutex detect */
         int arcBlendOptDepth;
         int arcBlendEnable;
@@ -46,6 +46,11 @@ static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
 static emcmot_struct_t *emcmotStruct = 0;
 
+/* lines and circles waiting to go out in one EMCMOT_SET_SEGMENTS */
+static emcmot_command_t segmentCommand;
+/* first error writing them, for usrmotFlushSegments() to return */
+static int segmentError = EMCMOT_COMM_OK;
+
 /* usrmotIniLoad() loads params (SHMEM_KEY, COMM_TIMEOUT)
    from named ini file */
 int usrmotIniLoad(const char *filename)
@@ -71,8 +76,79 @@ int usrmotIniLoad(const char *filename)
     return 0;
 }
 
-/* writes command from c */
+static int writeEmcmotCommand(emcmot_command_t * c);
+
+/* writes the queued segments, if any. An error is kept for
+   usrmotFlushSegments(), not returned to whatever command they are
+   written ahead of. */
+static void writeSegments(void)
+{
+    int n = segmentCommand.num_segments;
+    int retval;
+
+    if (n == 0) {
+	return;
+    }
+    segmentCommand.command = EMCMOT_SET_SEGMENTS;
+    segmentCommand.id = segmentCommand.segments[n - 1].id;
+    retval = writeEmcmotCommand(&segmentCommand);
+    segmentCommand.num_segments = 0;
+    if (retval != EMCMOT_COMM_OK) {
+	rcs_print("USRMOT: ERROR: moves %d to %d failed\n",
+	    segmentCommand.segments[0].id, segmentCommand.id);
+	if (segmentError == EMCMOT_COMM_OK) {
+	    segmentError = retval;
+	}
+    }
+}
+
+/* writes command from c, after any queued segments */
 int usrmotWriteEmcmotCommand(emcmot_command_t * c)
+{
+    writeSegments();
+    return writeEmcmotCommand(c);
+}
+
+/* queues the SET_LINE or SET_CIRCLE command in c */
+int usrmotQueueSegment(emcmot_command_t * c)
+{
+    emcmot_segment_t *seg;
+
+    if (!MOTION_ID_VALID(c->id)) {
+        rcs_print("USRMOT: ERROR: invalid motion id: %d\n",c->id);
+	return EMCMOT_COMM_INVALID_MOTION_ID;
+    }
+    if (segmentCommand.num_segments >= EMCMOT_MAX_SEGMENTS) {
+	writeSegments();
+    }
+    seg = &segmentCommand.segments[segmentCommand.num_segments++];
+    seg->circle = c->command == EMCMOT_SET_CIRCLE;
+    seg->pos = c->pos;
+    seg->center = c->center;
+    seg->normal = c->normal;
+    seg->turn = c->turn;
+    seg->motion_type = c->motion_type;
+    seg->vel = c->vel;
+    seg->ini_maxvel = c->ini_maxvel;
+    seg->acc = c->acc;
+    seg->id = c->id;
+    seg->spindle = c->spindle;
+    return EMCMOT_COMM_OK;
+}
+
+/* writes the queued segments, if any, and returns the first error
+   writing segments since the last call */
+int usrmotFlushSegments(void)
+{
+    int retval;
+
+    writeSegments();
+    retval = segmentError;
+    segmentError = EMCMOT_COMM_OK;
+    return retval;
+}
+
+static int writeEmcmotCommand(emcmot_command_t * c)
 {
     emcmot_status_t s;
     static int commandNum = 0;
@@ -210,6 +286,16 @@ int usrmotReadEmcmotError(char *e)
     return 0;
 }
 
+/* checks for an error without taking it */
+int usrmotEmcmotErrorPending(void)
+{
+    /* check to see if ptr still around */
+    if (emcmotError == 0) {
+	return 0;
+    }
+    return emcmotError->num > 0;
+}
+
 /*
  htostr()
 
@@ -685,6 +771,8 @@ int usrmotExit(void)
     emcmotCommand = 0;
     emcmotStatus = 0;
     emcmotError = 0;
+    segmentCommand.num_segments = 0;
+    segmentError = EMCMOT_COMM_OK;
 /*! \todo Another #if 0 */
 #if 0
 /*! \todo FIXME - comp structs no longer in shmem */
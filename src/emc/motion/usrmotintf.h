@@ -45,6 +45,10 @@ extern "C" {
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotError(char *e);
 
+/* usrmotEmcmotErrorPending() returns non-zero if the emcmot controller
+   has queued an error string that was not read yet */
+    extern int usrmotEmcmotErrorPending(void);
+
 /* usrmotPrintEmcmotStatus() prints the status in s, using which
    arg to select sub-prints */
     extern void usrmotPrintEmcmotStatus(emcmot_status_t *s, int which);
@@ -70,6 +74,15 @@ extern "C" {
    Return values are as per the #defines above */
     extern int usrmotWriteEmcmotCommand(emcmot_command_t * c);
 
+/* usrmotQueueSegment() queues the line or circle of an EMCMOT_SET_LINE
+   or EMCMOT_SET_CIRCLE command, to go out with others in one
+   EMCMOT_SET_SEGMENTS command. They are written when
+   EMCMOT_MAX_SEGMENTS are queued, before any other command, and by
+   usrmotFlushSegments(). An error writing them is not returned by the
+   call that wrote them, but by the next usrmotFlushSegments(). */
+    extern int usrmotQueueSegment(emcmot_command_t * c);
+    extern int usrmotFlushSegments(void);
+
 /* usrmotInit() initializes communication with the emcmot process */
     extern int usrmotInit(const char *name);
 
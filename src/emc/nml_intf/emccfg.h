@@ -30,6 +30,13 @@ extern "C" {
 /* cycle time for emctask, in seconds */
 #define DEFAULT_EMC_TASK_CYCLE_TIME 0.100
 
+/* longest time emctask goes without a cycle while idle, in seconds */
+#define DEFAULT_EMC_TASK_IDLE_CYCLE_TIME 0.500
+
+/* longest time emctask leaves changed feedback unreported while idle, in
+   seconds, if [DISPLAY] CYCLE_TIME does not say how often to */
+#define DEFAULT_EMC_TASK_FEEDBACK_CYCLE_TIME 0.100
+
 /* cycle time for emctio, in seconds */
 #define DEFAULT_EMC_IO_CYCLE_TIME 0.100
 
@@ -17,20 +17,40 @@
 
 
 #include <string.h>		/* memcpy() */
+#include <stdlib.h>		/* malloc(), free() */
+#include <stddef.h>		/* offsetof() */
 
-#include "rcs.hh"		// LinkedList
+#include "rcs.hh"		// NMLmsg
 #include "interpl.hh"		// these decls
 #include "emc.hh"
 #include "emcglb.h"
-#include "linklist.hh"
 #include "nmlmsg.hh"            /* class NMLmsg */
 #include "rcs_print.hh"
 
+/* nodes in the ring start at multiples of this */
+#define INTERP_LIST_ALIGN 16
+
+/* bytes allocated for the ring by the first append */
+#define INTERP_LIST_INITIAL_SIZE 65536
+
 NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
+/* bytes a node holding a command of size bytes takes in the ring */
+static long node_size(long size)
+{
+    long n = offsetof(NML_INTERP_LIST_NODE, command) + size;
+
+    return (n + INTERP_LIST_ALIGN - 1) & ~((long) INTERP_LIST_ALIGN - 1);
+}
+
 NML_INTERP_LIST::NML_INTERP_LIST()
 {
-    linked_list_ptr = new LinkedList;
+    ring = NULL;
+    ring_size = 0;
+    head = 0;
+    tail = 0;
+    wrap = 0;
+    list_size = 0;
 
     next_line_number = 0;
     line_number = 0;
@@ -38,10 +58,53 @@ NML_INTERP_LIST::NML_INTERP_LIST()
 
 NML_INTERP_LIST::~NML_INTERP_LIST()
 {
-    if (NULL != linked_list_ptr) {
-	delete linked_list_ptr;
-	linked_list_ptr = NULL;
+    if (NULL != ring) {
+	free(ring);
+	ring = NULL;
+    }
+}
+
+NML_INTERP_LIST_NODE *NML_INTERP_LIST::node_at(long offset)
+{
+    return (NML_INTERP_LIST_NODE *) (ring + offset);
+}
+
+/* Moves the nodes, in order, to the start of a ring with room for at
+   least need more bytes after them. */
+int NML_INTERP_LIST::grow(long need)
+{
+    long size = ring_size > 0 ? ring_size * 2 : INTERP_LIST_INITIAL_SIZE;
+    while (size < ring_size + need) {
+	size *= 2;
+    }
+    char *bigger = (char *) malloc(size);
+    if (NULL == bigger) {
+	rcs_print_error
+	    ("NML_INTERP_LIST::append : can't allocate %ld bytes.\n", size);
+	return -1;
+    }
+
+    int wrapped = tail < head;
+    long offset = head;
+    long used = 0;
+    for (int i = 0; i < list_size; i++) {
+	if (wrapped && offset == wrap) {
+	    offset = 0;
+	}
+	NML_INTERP_LIST_NODE *node = node_at(offset);
+	long len = node_size(((NMLmsg *) node->command.commandbuf)->size);
+	memcpy(bigger + used, node, len);
+	offset += len;
+	used += len;
     }
+
+    free(ring);
+    ring = bigger;
+    ring_size = size;
+    head = 0;
+    tail = used;
+    wrap = size;
+    return 0;
 }
 
 int NML_INTERP_LIST::append(NMLmsg & nml_msg)
@@ -82,39 +145,42 @@ int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 	    ("NML_INTERP_LIST::append : command size is invalid.");
 	return -1;
     }
-#ifdef DEBUG_INTERPL
-    if (sizeof(temp_node) < MAX_NML_COMMAND_SIZE + 4 ||
-	sizeof(temp_node) > MAX_NML_COMMAND_SIZE + 16 ||
-	((void *) &temp_node.line_number) >
-	((void *) &temp_node.command.commandbuf)) {
-	rcs_print_error
-	    ("NML_INTERP_LIST::append : assumptions about NML_INTERP_LIST_NODE have been violated.");
-	return -1;
-    }
-#endif
 
-    if (NULL == linked_list_ptr) {
-	return -1;
+    // find room for the node: after the last one, else at the start of
+    // the ring if the first one is further on, else in a bigger ring
+    long need = node_size(nml_msg_ptr->size);
+    if (0 == list_size) {
+	head = 0;
+	tail = 0;
+    }
+    if (tail >= head) {
+	if (ring_size - tail < need) {
+	    if (head > need) {
+		wrap = tail;
+		tail = 0;
+	    } else if (0 != grow(need)) {
+		return -1;
+	    }
+	}
+    } else if (head - tail <= need) {
+	if (0 != grow(need)) {
+	    return -1;
+	}
     }
+
     // fill in the NML_INTERP_LIST_NODE
-    temp_node.line_number = next_line_number;
-    memcpy(temp_node.command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
-
-    // stick it on the list
-    linked_list_ptr->store_at_tail(&temp_node,
-				   nml_msg_ptr->size +
-				   sizeof(temp_node.line_number) +
-				   sizeof(temp_node.dummy) + 32 + (32 -
-								   nml_msg_ptr->
-								   size %
-								   32), 1);
+    NML_INTERP_LIST_NODE *node = node_at(tail);
+    node->line_number = next_line_number;
+    memcpy(node->command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
+    tail += need;
+    list_size++;
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
 	rcs_print
 	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d\n",
              this,
 	     nml_msg_ptr->size, emc_symbol_lookup(nml_msg_ptr->type),
-	     linked_list_ptr->list_size, temp_node.line_number);
+	     list_size, node->line_number);
     }
 
     return 0;
@@ -125,22 +191,26 @@ NMLmsg *NML_INTERP_LIST::get()
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
 
-    if (NULL == linked_list_ptr) {
+    if (0 == list_size) {
 	line_number = 0;
 	return NULL;
     }
+    if (tail < head && head == wrap) {
+	head = 0;
+    }
+    node_ptr = node_at(head);
+    ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
 
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
+    // copy it out, so the ring can take new nodes in its place
+    got_node.line_number = node_ptr->line_number;
+    memcpy(got_node.command.commandbuf, ret, ret->size);
+    head += node_size(ret->size);
+    list_size--;
 
-    if (NULL == node_ptr) {
-	line_number = 0;
-	return NULL;
-    }
     // save line number of this one, for use by get_line_number
-    line_number = node_ptr->line_number;
+    line_number = got_node.line_number;
 
-    // get it off the front
-    ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+    ret = (NMLmsg *) ((char *) got_node.command.commandbuf);
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
         rcs_print(
@@ -148,7 +218,7 @@ NMLmsg *NML_INTERP_LIST::get()
             this,
             ret->size,
             emc_symbol_lookup(ret->type),
-            linked_list_ptr->list_size
+            list_size
         );
     }
 
@@ -157,45 +227,40 @@ NMLmsg *NML_INTERP_LIST::get()
 
 void NML_INTERP_LIST::clear()
 {
-    if (NULL != linked_list_ptr) {
-        if (emc_debug & EMC_DEBUG_INTERP_LIST) {
-            rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, linked_list_ptr->list_size);
-        }
-
-	linked_list_ptr->delete_members();
+    if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+	rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, list_size);
     }
+
+    list_size = 0;
+    head = 0;
+    tail = 0;
 }
 
 void NML_INTERP_LIST::print()
 {
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
-    int line_number;
-
-    if (NULL == linked_list_ptr) {
-	return;
-    }
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_head();
-
-    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",linked_list_ptr->list_size);
-    while (NULL != node_ptr) {
-	line_number = node_ptr->line_number;
+    int wrapped = tail < head;
+    long offset = head;
+
+    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",list_size);
+    for (int i = 0; i < list_size; i++) {
+	if (wrapped && offset == wrap) {
+	    offset = 0;
+	}
+	node_ptr = node_at(offset);
 	ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
 	rcs_print("--> type=%s,  line_number=%d\n",
 		  emc_symbol_lookup((int)ret->type),
-		  line_number);
-	node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_next();
+		  node_ptr->line_number);
+	offset += node_size(ret->size);
     }
     rcs_print("\n");
 }
 
 int NML_INTERP_LIST::len()
 {
-    if (NULL == linked_list_ptr) {
-	return 0;
-    }
-
-    return ((int) linked_list_ptr->list_size);
+    return list_size;
 }
 
 int NML_INTERP_LIST::get_line_number()
@@ -60,9 +60,21 @@ class NML_INTERP_LIST {
     int len();
 
   private:
-    class LinkedList * linked_list_ptr;
-    NML_INTERP_LIST_NODE temp_node;	// filled in and put on the list
-    int next_line_number;	// line number used to fill temp_node
+    NML_INTERP_LIST_NODE *node_at(long offset);
+    int grow(long need);
+
+    // The nodes are kept back to back in a ring that is only reallocated
+    // when it is full, so appending and getting commands does not
+    // allocate memory. get() copies the command out, so it stays valid
+    // until the next get() even if the list is cleared or grows.
+    char *ring;
+    long ring_size;		// bytes allocated for ring
+    long head;			// offset of the node get() returns next
+    long tail;			// offset append() writes the next node at
+    long wrap;			// the nodes from head end here, then go on at 0
+    int list_size;		// number of nodes in the ring
+    NML_INTERP_LIST_NODE got_node;	// copy of the node from get()
+    int next_line_number;	// line number used for appended nodes
     int line_number;		// line number of node from get()
 };
 
@@ -17,6 +17,7 @@
  */
 #include <stdlib.h>
 #include <boost/noncopyable.hpp>
+#include "interp_return.hh"
 
 /* Size of certain arrays */
 #define ACTIVE_G_CODES 16
@@ -54,6 +55,7 @@ public:
     virtual void active_settings(double active_settings[ACTIVE_SETTINGS]) = 0;
     virtual void set_loglevel(int level) = 0;
     virtual void set_loop_on_main_m99(bool state) = 0;
+    virtual int restore_checkpoint(int line) { return INTERP_OK; }
 };
 
 InterpBase *interp_from_shlib(const char *shlib);
@@ -0,0 +1,269 @@
+/********************************************************************
+* Description: interp_cache.cc
+*
+*   Cache of the lines of loops and subroutines.
+*
+*   Every iteration of an O-word loop, and every call of a subroutine,
+*   seeks back in its file and reads the same lines again. Lines read
+*   a second time are kept, by file and offset, after close_and_downcase(),
+*   so that later reads of them skip the file and the scanning. Lines
+*   whose items can be read without side effects, that is without
+*   parameters and semicolon comments, also keep the block read_items()
+*   made of them, so only enhance_block() and check_items() run again.
+*   Other lines keep the programs their expressions were compiled to,
+*   see interp_expr.cc, and the slots of the parameters they set.
+*
+*   A file is recognized by its device and inode, and its lines are
+*   dropped when its size or modification time changed. That is only
+*   checked after a seek or when another file is read, so editing a
+*   file while the interpreter reads through it is not noticed.
+*
+*   Also kept is an index of the subroutine files find_ngc_file() looks
+*   for in the PROGRAM_PREFIX and SUBROUTINE_PATH directories, with the
+*   offset of the 'o<name> sub' line of each once it was found. Unlike
+*   the offsets of control_save_offset(), these outlive a reset, so the
+*   first call of a library subroutine neither searches the directories
+*   nor reads through its file again. The index is built again when the
+*   modification time of one of the directories changed, that is when a
+*   file was added, removed or renamed, and the offset of a file is
+*   dropped when the file changed.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+// Returns the cache entry of the file inport reads, after dropping its
+// lines if the file changed since they were kept, or NULL if the file
+// can not be told apart from others.
+cached_file *Interp::cache_file_for(FILE *inport)
+{
+    struct stat st;
+
+    if (fstat(fileno(inport), &st) != 0 || !S_ISREG(st.st_mode))
+	return NULL;
+
+    cached_file &cf = _setup.line_cache[std::make_pair(st.st_dev, st.st_ino)];
+    if (cf.size != st.st_size || cf.mtime != st.st_mtim.tv_sec ||
+	cf.mtime_nsec != st.st_mtim.tv_nsec) {
+	_setup.cached_lines -= cf.lines.size();
+	cf.lines.clear();
+	cf.read_end = 0;
+	cf.size = st.st_size;
+	cf.mtime = st.st_mtim.tv_sec;
+	cf.mtime_nsec = st.st_mtim.tv_nsec;
+    }
+    return &cf;
+}
+
+// Returns the line at offset of the file inport reads, with inport moved
+// past it, or NULL if it is not cached.
+cached_line *Interp::find_cached_line(FILE *inport, long offset)
+{
+    if (inport != _setup.cache_fp || offset != _setup.cache_next) {
+	// a seek, or another file
+	_setup.cache_file = cache_file_for(inport);
+	_setup.cache_fp = inport;
+    }
+    _setup.cache_next = -1;
+    if (_setup.cache_file == NULL)
+	return NULL;
+
+    cached_line_map::iterator it = _setup.cache_file->lines.find(offset);
+    if (it == _setup.cache_file->lines.end())
+	return NULL;
+    cached_line *cl = &it->second;
+    text_seek(inport, cl->next);
+    _setup.cache_next = cl->next;
+    return cl;
+}
+
+// Notes that the line at offset was read from inport, and keeps it if
+// it was read before. Returns its entry, or NULL if it is not kept.
+cached_line *Interp::cache_line(FILE *inport, long offset,
+				const char *raw_line, const char *line)
+{
+    long next = text_tell(inport);
+    cached_file *cf = _setup.cache_file;
+
+    _setup.cache_fp = inport;
+    _setup.cache_next = next;
+    if (cf == NULL || next < 0)
+	return NULL;
+    if (offset >= cf->read_end) {
+	cf->read_end = next;
+	return NULL;
+    }
+    if (_setup.cached_lines >= MAX_CACHED_LINES)
+	return NULL;
+
+    cached_line &cl = cf->lines[offset];
+    cl.raw_text = raw_line;
+    cl.text = line;
+    cl.next = next;
+    cl.constant = (strchr(line, '#') == NULL) && (strchr(line, ';') == NULL);
+    cl.parsed = false;
+    cl.exprs.clear();
+    cl.names.clear();
+    _setup.cached_lines++;
+    return &cl;
+}
+
+// Does what init_block() and read_items() do, taking the block from the
+// cache if the line was read into it in the same state before.
+int Interp::read_cached_items(block_pointer block, char *line,
+			      setup_pointer settings)
+{
+    cached_line *cl = settings->cached;
+    bool in_call = (settings->call_level > 0);
+
+    if (cl != NULL && cl->parsed && settings->skipping_o == 0 &&
+	cl->lathe_diameter_mode == (bool) settings->lathe_diameter_mode &&
+	cl->in_call == in_call) {
+	// keep what belongs to the block rather than the line
+	long offset = block->offset;
+	int saved_line_number = block->saved_line_number;
+	int phase = block->phase;
+
+	*block = cl->items;
+	block->offset = offset;
+	block->saved_line_number = saved_line_number;
+	block->phase = phase;
+	return INTERP_OK;
+    }
+
+    CHP(init_block(block));
+    CHP(read_items(block, line, settings->parameters));
+
+    // o-words, m98 and m99 change the control state while being read
+    if (cl != NULL && cl->constant && settings->skipping_o == 0 &&
+	block->o_type == O_none) {
+	cl->items = *block;
+	cl->parsed = true;
+	cl->lathe_diameter_mode = settings->lathe_diameter_mode;
+	cl->in_call = in_call;
+    }
+    return INTERP_OK;
+}
+
+void Interp::clear_line_cache()
+{
+    _setup.line_cache.clear();
+    _setup.cache_file = NULL;
+    _setup.cached = NULL;
+    _setup.cache_fp = NULL;
+    _setup.cache_next = -1;
+    _setup.cached_lines = 0;
+}
+
+// The directories find_ngc_file() looks in before the wizard tree, in
+// the order it looks in them.
+static void sub_search_path(setup_pointer settings,
+			    std::vector<const char *> &dirs)
+{
+    dirs.push_back(settings->program_prefix);
+    for (int dct = 0; dct < MAX_SUB_DIRS; dct++)
+	if (settings->subroutines[dct])
+	    dirs.push_back(settings->subroutines[dct]);
+}
+
+// Whether the subroutine index is of the search path as it is now.
+bool Interp::sub_index_current()
+{
+    std::vector<const char *> dirs;
+    struct stat st;
+
+    sub_search_path(&_setup, dirs);
+    if (dirs.size() != _setup.sub_dirs.size())
+	return false;
+    for (size_t n = 0; n < dirs.size(); n++) {
+	sub_dir &sd = _setup.sub_dirs[n];
+	if (sd.path != dirs[n])
+	    return false;
+	if (stat(*dirs[n] ? dirs[n] : "/", &st) != 0) {
+	    if (sd.mtime != -1)
+		return false;
+	} else if (sd.mtime != st.st_mtim.tv_sec ||
+		   sd.mtime_nsec != st.st_mtim.tv_nsec) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Indexes the .ngc files of the search path, keeping the first one of
+// each name like find_ngc_file() does.
+void Interp::build_sub_index()
+{
+    std::vector<const char *> dirs;
+    struct stat st;
+
+    _setup.sub_files.clear();
+    _setup.sub_dirs.clear();
+    sub_search_path(&_setup, dirs);
+    for (size_t n = 0; n < dirs.size(); n++) {
+	const char *dir = *dirs[n] ? dirs[n] : "/";
+	sub_dir sd;
+
+	// stamped before reading it, so a file added meanwhile is noticed
+	sd.path = dirs[n];
+	sd.mtime = -1;
+	sd.mtime_nsec = 0;
+	if (stat(dir, &st) == 0) {
+	    sd.mtime = st.st_mtim.tv_sec;
+	    sd.mtime_nsec = st.st_mtim.tv_nsec;
+	}
+	_setup.sub_dirs.push_back(sd);
+
+	DIR *aDir = opendir(dir);
+	struct dirent *aFile;
+
+	if (aDir == NULL)
+	    continue;
+	while ((aFile = readdir(aDir))) {
+	    size_t len = strlen(aFile->d_name);
+
+	    if (len <= 4 || strcmp(aFile->d_name + len - 4, ".ngc") != 0)
+		continue;
+	    std::string name(aFile->d_name, len - 4);
+	    if (_setup.sub_files.count(name))
+		continue;
+
+	    sub_file sf;
+	    sf.path = sd.path + "/" + aFile->d_name;
+	    if (stat(sf.path.c_str(), &st) != 0 || S_ISDIR(st.st_mode))
+		continue;
+	    sf.size = st.st_size;
+	    sf.mtime = st.st_mtim.tv_sec;
+	    sf.mtime_nsec = st.st_mtim.tv_nsec;
+	    sf.offset = -1;
+	    sf.sequence_number = 0;
+	    _setup.sub_files[name] = sf;
+	}
+	closedir(aDir);
+    }
+    logOword("indexed %zu subroutine files", _setup.sub_files.size());
+}
+
+// Returns the index entry of the subroutine file basename if it is the
+// file at path, or NULL.
+sub_file *Interp::indexed_sub_file(const char *basename, const char *path)
+{
+    sub_file_map::iterator it = _setup.sub_files.find(basename);
+
+    if (it == _setup.sub_files.end() || it->second.path != path)
+	return NULL;
+    return &it->second;
+}
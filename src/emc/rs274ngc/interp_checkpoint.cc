@@ -0,0 +1,423 @@
+/********************************************************************
+* Description: interp_checkpoint.cc
+*
+*   Checkpoints for running a program from a line.
+*
+*   To run a program from a line, task reads and executes every line
+*   before it, throwing away what they do, so that the interpreter is in
+*   the state the line is run in. With [RS274NGC]CHECKPOINT_INTERVAL set,
+*   the interpreter keeps that state every so many lines of the main
+*   program while it runs, and restore_checkpoint() puts it back and
+*   moves reading to the line after it, so only the lines from there on
+*   are read again.
+*
+*   A checkpoint holds the modes, the tool changed to, the positions of
+*   loops and branches of the main program, its named parameters, and
+*   the numbered parameters the lines before it set or changed, along
+*   with those of G92 and the coordinate system in use, which are modes.
+*   Those are put over the parameters as they are when it is restored,
+*   and the offsets are taken from them, so offsets set since, by
+*   touching off for instance, are kept where the program does not set
+*   them. It is only taken at the main program, so there is no call or
+*   remap in progress, and not while cutter compensation or constant
+*   surface speed is on, whose state is not all in _setup.
+*
+*   Only the checkpoints of the program open are kept, those of its last
+*   run from the start. They are kept across runs until the file changes
+*   or another is opened. Past MAX_CHECKPOINTS, or MAX_CHECKPOINT_BYTES
+*   of memory, every other one is dropped and the interval doubled for
+*   the rest of the run. Restoring one assumes the lines before it do
+*   what they did when it was taken, so a program which branches on
+*   probing or inputs is run from it the way it went then.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+#include "units.h"
+
+// named parameters which are not values of the program
+#define PA_COMPUTED (PA_READONLY | PA_USE_LOOKUP | PA_FROM_INI | PA_PYTHON)
+
+// Whether a parameter follows the tool and the position rather than
+// the lines run.
+static bool tool_parameter(int index)
+{
+    return (index >= 5400) && (index <= 5428);
+}
+
+// Whether a parameter holds the G92 offset or the coordinate system in
+// use, which are modes, and so kept whether or not they changed.
+static bool mode_parameter(int index)
+{
+    return (index >= 5210) && (index <= 5220);
+}
+
+// About the memory of the entries of a map, with their tree nodes.
+template <class M> static size_t map_bytes(const M &m)
+{
+    return m.size() * (sizeof(typename M::value_type) + 4 * sizeof(void *));
+}
+
+// Keeps the state of the interpreter in cp, with the parameters set or
+// changed since the start of the run of cf.
+void Interp::save_checkpoint(checkpoint *cp, checkpoint_file *cf)
+{
+    setup_pointer settings = &_setup;
+
+    cp->offset = text_tell(settings->file_pointer);
+    cp->sequence_number = settings->sequence_number;
+    cp->parameters.clear();
+    for (int n = 0; n < RS274NGC_MAX_PARAMETERS; n++)
+	if (mode_parameter(n) || cf->parameters_set[n] ||
+	    ((settings->parameters[n] != cf->parameters[n]) && !tool_parameter(n)))
+	    cp->parameters.push_back(std::make_pair(n, settings->parameters[n]));
+    cp->named_params.clear();
+    for (parameter_map_iterator pi = settings->sub_context[0].named_params.begin();
+	 pi != settings->sub_context[0].named_params.end(); pi++)
+	if (!(pi->second.attr & PA_COMPUTED))
+	    cp->named_params.insert(*pi);
+    cp->offset_map = settings->offset_map;
+    cp->executed_if = settings->executed_if;
+
+    write_g_codes((block_pointer) NULL, settings);
+    write_m_codes((block_pointer) NULL, settings);
+    memcpy(cp->g_codes, settings->active_g_codes, sizeof(cp->g_codes));
+    memcpy(cp->m_codes, settings->active_m_codes, sizeof(cp->m_codes));
+
+    cp->current[0] = settings->current_x;
+    cp->current[1] = settings->current_y;
+    cp->current[2] = settings->current_z;
+    cp->current[3] = settings->AA_current;
+    cp->current[4] = settings->BB_current;
+    cp->current[5] = settings->CC_current;
+    cp->current[6] = settings->u_current;
+    cp->current[7] = settings->v_current;
+    cp->current[8] = settings->w_current;
+    cp->current_pocket = settings->current_pocket;
+    cp->selected_pocket = settings->selected_pocket;
+    cp->selected_tool = settings->selected_tool;
+    cp->tool_offset = settings->tool_offset;
+    cp->motion_tolerance = settings->motion_tolerance;
+    cp->naivecam_tolerance = settings->naivecam_tolerance;
+
+    cp->motion_mode = settings->motion_mode;
+    cp->cycle_cc = settings->cycle_cc;
+    cp->cycle_i = settings->cycle_i;
+    cp->cycle_j = settings->cycle_j;
+    cp->cycle_k = settings->cycle_k;
+    cp->cycle_l = settings->cycle_l;
+    cp->cycle_p = settings->cycle_p;
+    cp->cycle_q = settings->cycle_q;
+    cp->cycle_r = settings->cycle_r;
+    cp->cycle_il = settings->cycle_il;
+    cp->cycle_il_flag = settings->cycle_il_flag;
+    cp->feed_rate = settings->feed_rate;
+    memcpy(cp->speed, settings->speed, sizeof(cp->speed));
+
+    cp->bytes = sizeof(*cp) + 4 * sizeof(void *) +
+	cp->parameters.capacity() * sizeof(cp->parameters[0]) +
+	map_bytes(cp->named_params) + map_bytes(cp->offset_map);
+}
+
+// Drops every other checkpoint of cf and doubles the interval, to take
+// no more than MAX_CHECKPOINTS and MAX_CHECKPOINT_BYTES.
+static void thin_checkpoints(checkpoint_file *cf)
+{
+    checkpoint_map::iterator it = cf->checkpoints.begin();
+
+    while (it != cf->checkpoints.end()) {
+	if (++it == cf->checkpoints.end())
+	    break;
+	cf->bytes -= it->second.bytes;
+	cf->checkpoints.erase(it++);
+    }
+    cf->interval *= 2;
+}
+
+// Drops the checkpoints, unless they are those of the program just
+// opened. Called by open().
+void Interp::open_checkpoints()
+{
+    checkpoint_file &cf = _setup.checkpoints;
+    struct stat st;
+
+    if (cf.checkpoints.empty())
+	return;
+    if (fstat(fileno(_setup.file_pointer), &st) == 0 &&
+	(st.st_dev == cf.dev) && (st.st_ino == cf.ino))
+	return;
+    cf = checkpoint_file();
+}
+
+// Takes a checkpoint after the line read last if one is due. Called
+// before a line of the program file is read.
+void Interp::take_checkpoint()
+{
+    setup_pointer settings = &_setup;
+    struct stat st;
+
+    if ((settings->call_level != 0) || (settings->remap_level != 0) ||
+	settings->skipping_o || settings->skipping_to_sub ||
+	settings->defining_sub)
+	return;
+
+    if (settings->checkpoint_reached < 0) {
+	// the start of a run, which drops the checkpoints of the last one
+	settings->checkpoint_reached = settings->sequence_number;
+	if (fstat(fileno(settings->file_pointer), &st) != 0 ||
+	    !S_ISREG(st.st_mode))
+	    return;
+	checkpoint_file &cf = settings->checkpoints;
+	cf = checkpoint_file();
+	cf.dev = st.st_dev;
+	cf.ino = st.st_ino;
+	cf.size = st.st_size;
+	cf.mtime = st.st_mtim.tv_sec;
+	cf.mtime_nsec = st.st_mtim.tv_nsec;
+	cf.parameters.assign(settings->parameters,
+			     settings->parameters + RS274NGC_MAX_PARAMETERS);
+	cf.parameters_set.assign(RS274NGC_MAX_PARAMETERS, false);
+	cf.interval = settings->checkpoint_interval;
+	settings->checkpoint_run = &cf;
+	return;
+    }
+
+    checkpoint_file *cf = settings->checkpoint_run;
+    int line = settings->sequence_number;
+
+    // only the first time a line is reached, not when a loop goes back
+    if ((cf == NULL) || (line <= settings->checkpoint_reached))
+	return;
+    settings->checkpoint_reached = line;
+    if (line - cf->interval <
+	(cf->checkpoints.empty() ? 0 : cf->checkpoints.rbegin()->first))
+	return;
+    if (settings->cutter_comp_side || settings->toolchange_flag ||
+	settings->probe_flag || settings->input_flag)
+	return;
+    for (int s = 0; s < settings->num_spindles; s++)
+	if (settings->spindle_mode[s] == CONSTANT_SURFACE)
+	    return;
+    checkpoint *cp = &cf->checkpoints[line];
+    save_checkpoint(cp, cf);
+    cf->bytes += cp->bytes;
+    if ((cf->checkpoints.size() > MAX_CHECKPOINTS) ||
+	(cf->bytes > MAX_CHECKPOINT_BYTES))
+	thin_checkpoints(cf);
+}
+
+/*! Interp::restore_checkpoint
+
+Returned Value: int
+   If restoring the modes fails, this returns an error code.
+   Otherwise, it returns INTERP_OK.
+
+Side effects:
+   If the program just opened has a checkpoint before line, the
+   interpreter is put in the state of the last one, and reading goes on
+   with the line after it.
+
+Called By: external programs
+
+Task runs the lines up to line, and synchs after the one before it, so
+the checkpoint used is one at least two lines before line. The canonical
+commands made are those of running through the lines, which task throws
+away.
+
+*/
+
+int Interp::restore_checkpoint(int line)
+{
+    setup_pointer settings = &_setup;
+    double *pars = settings->parameters;
+    struct stat st;
+    char buf[LINELEN];
+    int k;
+
+    // only before the program is read
+    if ((settings->file_pointer == NULL) ||
+	(settings->checkpoint_reached >= 0) || (settings->call_level != 0))
+	return INTERP_OK;
+    checkpoint_file *cf = &settings->checkpoints;
+    if (cf->checkpoints.empty() ||
+	fstat(fileno(settings->file_pointer), &st) != 0)
+	return INTERP_OK;
+    if ((cf->dev != st.st_dev) || (cf->ino != st.st_ino) ||
+	(cf->size != st.st_size) || (cf->mtime != st.st_mtim.tv_sec) ||
+	(cf->mtime_nsec != st.st_mtim.tv_nsec)) {
+	*cf = checkpoint_file();
+	return INTERP_OK;
+    }
+    checkpoint_map::iterator it = cf->checkpoints.upper_bound(line - 2);
+    if (it == cf->checkpoints.begin())
+	return INTERP_OK;
+    checkpoint *cp = &(--it)->second;
+
+    logDebug("restore_checkpoint: %s from line %d for line %d",
+	     settings->filename, cp->sequence_number, line);
+
+    // G20/G21 first, so the rest is restored in the units of the
+    // checkpoint, as restore_settings() does
+    write_g_codes((block_pointer) NULL, settings);
+    if (settings->active_g_codes[5] != cp->g_codes[5]) {
+	snprintf(buf, sizeof(buf), "G%d", cp->g_codes[5] / 10);
+	CHKS(execute(buf) != INTERP_OK,
+	     _("restore_checkpoint: '%s' failed"), buf);
+    }
+
+    // the modes which need no more than their code, the others below
+    int g_codes[ACTIVE_G_CODES];
+    std::string cmd;
+
+    write_g_codes((block_pointer) NULL, settings);
+    write_m_codes((block_pointer) NULL, settings);
+    memcpy(g_codes, cp->g_codes, sizeof(g_codes));
+    g_codes[8] = settings->active_g_codes[8];
+    g_codes[9] = settings->active_g_codes[9];
+    g_codes[11] = settings->active_g_codes[11];
+    gen_m_codes((int *) settings->active_m_codes, cp->m_codes, cmd);
+    gen_g_codes((int *) settings->active_g_codes, g_codes, cmd);
+    // one command per line
+    for (size_t start = 0, end; start < cmd.size(); start = end + 1) {
+	end = cmd.find('\n', start);
+	if (end == std::string::npos)
+	    end = cmd.size();
+	if (end == start)
+	    continue;
+	std::string line = cmd.substr(start, end - start);
+	CHKS(execute(line.c_str()) != INTERP_OK,
+	     _("restore_checkpoint: '%s' failed"), line.c_str());
+    }
+    CHP(convert_control_mode(cp->g_codes[11], cp->motion_tolerance,
+			     cp->naivecam_tolerance, settings));
+    settings->motion_tolerance = cp->motion_tolerance;
+    settings->naivecam_tolerance = cp->naivecam_tolerance;
+
+    for (size_t n = 0; n < cp->parameters.size(); n++)
+	pars[cp->parameters[n].first] = cp->parameters[n].second;
+    for (parameter_map_iterator pi = cp->named_params.begin();
+	 pi != cp->named_params.end(); pi++)
+	settings->sub_context[0].named_params[pi->first] = pi->second;
+
+    // the offsets, as Interp::init() takes them from the parameters
+    settings->origin_index = (int) (pars[5220] + 0.0001);
+    k = (5200 + (settings->origin_index * 20));
+    settings->origin_offset_x = USER_TO_PROGRAM_LEN(pars[k + 1]);
+    settings->origin_offset_y = USER_TO_PROGRAM_LEN(pars[k + 2]);
+    settings->origin_offset_z = USER_TO_PROGRAM_LEN(pars[k + 3]);
+    settings->AA_origin_offset = USER_TO_PROGRAM_ANG(pars[k + 4]);
+    settings->BB_origin_offset = USER_TO_PROGRAM_ANG(pars[k + 5]);
+    settings->CC_origin_offset = USER_TO_PROGRAM_ANG(pars[k + 6]);
+    settings->u_origin_offset = USER_TO_PROGRAM_LEN(pars[k + 7]);
+    settings->v_origin_offset = USER_TO_PROGRAM_LEN(pars[k + 8]);
+    settings->w_origin_offset = USER_TO_PROGRAM_LEN(pars[k + 9]);
+    settings->rotation_xy = pars[k + 10];
+
+    if (pars[5210]) {
+	settings->axis_offset_x = USER_TO_PROGRAM_LEN(pars[5211]);
+	settings->axis_offset_y = USER_TO_PROGRAM_LEN(pars[5212]);
+	settings->axis_offset_z = USER_TO_PROGRAM_LEN(pars[5213]);
+	settings->AA_axis_offset = USER_TO_PROGRAM_ANG(pars[5214]);
+	settings->BB_axis_offset = USER_TO_PROGRAM_ANG(pars[5215]);
+	settings->CC_axis_offset = USER_TO_PROGRAM_ANG(pars[5216]);
+	settings->u_axis_offset = USER_TO_PROGRAM_LEN(pars[5217]);
+	settings->v_axis_offset = USER_TO_PROGRAM_LEN(pars[5218]);
+	settings->w_axis_offset = USER_TO_PROGRAM_LEN(pars[5219]);
+    } else {
+	settings->axis_offset_x = 0.0;
+	settings->axis_offset_y = 0.0;
+	settings->axis_offset_z = 0.0;
+	settings->AA_axis_offset = 0.0;
+	settings->BB_axis_offset = 0.0;
+	settings->CC_axis_offset = 0.0;
+	settings->u_axis_offset = 0.0;
+	settings->v_axis_offset = 0.0;
+	settings->w_axis_offset = 0.0;
+    }
+
+    SET_G5X_OFFSET(settings->origin_index,
+                   settings->origin_offset_x,
+                   settings->origin_offset_y,
+                   settings->origin_offset_z,
+                   settings->AA_origin_offset,
+                   settings->BB_origin_offset,
+                   settings->CC_origin_offset,
+                   settings->u_origin_offset,
+                   settings->v_origin_offset,
+                   settings->w_origin_offset);
+
+    SET_G92_OFFSET(settings->axis_offset_x,
+                   settings->axis_offset_y,
+                   settings->axis_offset_z,
+                   settings->AA_axis_offset,
+                   settings->BB_axis_offset,
+                   settings->CC_axis_offset,
+                   settings->u_axis_offset,
+                   settings->v_axis_offset,
+                   settings->w_axis_offset);
+
+    SET_XY_ROTATION(settings->rotation_xy);
+
+    // the tool of the last M6 and T before it. What is in the spindle,
+    // and its parameters, are those of the machine, as after running
+    // through the lines.
+    settings->current_pocket = cp->current_pocket;
+    settings->selected_pocket = cp->selected_pocket;
+    settings->selected_tool = cp->selected_tool;
+    USE_TOOL_LENGTH_OFFSET(cp->tool_offset);
+    settings->tool_offset = cp->tool_offset;
+
+    // after G93, which clears it
+    settings->feed_rate = cp->feed_rate;
+    SET_FEED_RATE(settings->feed_rate);
+    for (int s = 0; s < settings->num_spindles; s++) {
+	settings->speed[s] = cp->speed[s];
+	SET_SPINDLE_SPEED(s, settings->speed[s]);
+    }
+
+    settings->current_x = cp->current[0];
+    settings->current_y = cp->current[1];
+    settings->current_z = cp->current[2];
+    settings->AA_current = cp->current[3];
+    settings->BB_current = cp->current[4];
+    settings->CC_current = cp->current[5];
+    settings->u_current = cp->current[6];
+    settings->v_current = cp->current[7];
+    settings->w_current = cp->current[8];
+    settings->motion_mode = cp->motion_mode;
+    settings->cycle_cc = cp->cycle_cc;
+    settings->cycle_i = cp->cycle_i;
+    settings->cycle_j = cp->cycle_j;
+    settings->cycle_k = cp->cycle_k;
+    settings->cycle_l = cp->cycle_l;
+    settings->cycle_p = cp->cycle_p;
+    settings->cycle_q = cp->cycle_q;
+    settings->cycle_r = cp->cycle_r;
+    settings->cycle_il = cp->cycle_il;
+    settings->cycle_il_flag = cp->cycle_il_flag;
+    settings->offset_map = cp->offset_map;
+    settings->executed_if = cp->executed_if;
+
+    // a run from a checkpoint keeps those of the run from the start
+    text_seek(settings->file_pointer, cp->offset);
+    settings->sequence_number = cp->sequence_number;
+    settings->checkpoint_run = NULL;
+    settings->checkpoint_reached = cp->sequence_number;
+
+    write_g_codes((block_pointer) NULL, settings);
+    write_m_codes((block_pointer) NULL, settings);
+    write_settings(settings);
+    return INTERP_OK;
+}
@@ -1576,6 +1576,8 @@ int Interp::convert_control_mode(int g_code,     //!< g_code being executed (G_6
 	    SET_NAIVECAM_TOLERANCE(0);
 	}
     settings->control_mode = CANON_CONTINUOUS;
+    settings->motion_tolerance = tolerance;
+    settings->naivecam_tolerance = naivecam_tolerance;
   } else 
     ERS(NCE_BUG_CODE_NOT_G61_G61_1_OR_G64);
   return INTERP_OK;
@@ -4002,6 +4004,17 @@ int Interp::convert_setup(block_pointer block,   //!< pointer to a block of RS27
   } else
     w = USER_TO_PROGRAM_LEN(parameters[5209 + (p_int * 20)]);
 
+  if (settings->checkpoint_run) {      /* see interp_checkpoint.cc */
+    std::vector<bool> &set = settings->checkpoint_run->parameters_set;
+    bool flags[] = {block->x_flag, block->y_flag, block->z_flag,
+                    block->a_flag, block->b_flag, block->c_flag,
+                    block->u_flag, block->v_flag, block->w_flag,
+                    block->r_flag};
+    for (int n = 0; n < 10; n++)
+      if (flags[n])
+        set[5201 + n + (p_int * 20)] = true;
+  }
+
   if (p_int == settings->origin_index) {        /* system is currently used */
 
     rotate(&settings->current_x, &settings->current_y, settings->rotation_xy);
@@ -4366,13 +4379,15 @@ int Interp::convert_stop(block_pointer block,    //!< pointer to a block of RS27
     if (_setup.percent_flag && _setup.file_pointer) {
       line = _setup.linetext;
       for (;;) {                /* check for ending percent sign and comment if missing */
-        if (fgets(line, LINELEN, _setup.file_pointer) == NULL) {
+        if (text_gets(line, LINELEN, _setup.file_pointer) == NULL) {
+          int err = text_error(_setup.file_pointer);
+          CHKS(err != 0, NCE_FILE_READ_ERROR, _setup.filename, strerror(err));
           enqueue_COMMENT("interpreter: percent sign missing from end of file");
           break;
         }
         length = strlen(line);
         if (length == (LINELEN - 1)) {       // line is too long. need to finish reading the line
-          for (; fgetc(_setup.file_pointer) != '\n' && !feof(_setup.file_pointer););
+          text_skip_line(_setup.file_pointer);
           continue;
         }
         for (index = (length - 1);      // index set on last char
@@ -42,7 +42,7 @@ Returned value: int
 Side effects: The value of left is set to the result of applying
   the operation to left and right.
 
-Called by: read_real_expression
+Called by: execute_expression
 
 This just calls either execute_binary1 or execute_binary2.
 
@@ -72,7 +72,7 @@ Returned Value: int
 Side effects:
    The result from performing the operation is put into what left points at.
 
-Called by: read_real_expression.
+Called by: execute_binary.
 
 This executes the operations: DIVIDED_BY, MODULO, POWER, TIMES.
 
@@ -119,7 +119,7 @@ Returned Value: int
 Side effects:
    The result from performing the operation is put into what left points at.
 
-Called by: read_real_expression.
+Called by: execute_binary.
 
 This executes the operations: AND2, EXCLUSIVE_OR, MINUS,
 NON_EXCLUSIVE_OR, PLUS. The RS274/NGC manual [NCMS] does not say what
@@ -344,7 +344,7 @@ Side effects:
    The result from performing the operation on the value in double_ptr
    is put into what double_ptr points at.
 
-Called by: read_unary.
+Called by: execute_expression.
 
 This executes the operations: ABS, ACOS, ASIN, COS, EXP, FIX, FUP, LN
 ROUND, SIN, SQRT, TAN
@@ -378,7 +378,7 @@ int Interp::execute_unary(double *double_ptr,    //!< pointer to the operand
     break;
   case EXISTS:
     // do nothing here
-    // result for the EXISTS function is set by Interp:read_unary()
+    // result for the EXISTS function is set by Interp::execute_expression()
     break;
   case EXP:
     *double_ptr = exp(*double_ptr);
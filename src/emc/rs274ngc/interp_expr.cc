@@ -0,0 +1,510 @@
+/********************************************************************
+* Description: interp_expr.cc
+*
+*   Compiled expressions.
+*
+*   Real values which are not plain numbers, that is expressions,
+*   parameters, unary functions and signed values, are compiled into
+*   a short program for a stack machine, which is then run. The program
+*   is the value in postfix order, with the binary operations in the
+*   order the precedence rules of read_real_expression() give. A
+*   parameter with a constant number is bound to that number, and a
+*   named parameter to a slot holding its stored name, when compiled.
+*
+*   Programs compiled from a cached line are kept with it, by their
+*   position on the line, so reading the line again only runs them.
+*
+*   Errors in the syntax are found when compiling, others when running,
+*   so an expression with both reports the syntax error first.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+// What read_integer_value() accepts as an integer.
+static bool integer_value(double value, int *integer_ptr)
+{
+    *integer_ptr = (int) floor(value);
+    if ((value - *integer_ptr) > 0.9999)
+	*integer_ptr = (int) ceil(value);
+    else if ((value - *integer_ptr) > 0.0001)
+	return false;
+    return true;
+}
+
+int Interp::emit_expr(expr_program *prog, int op, int arg, double value)
+{
+    CHKS((prog->length >= MAX_EXPR_LENGTH), NCE_COMMAND_TOO_LONG);
+    expr_insn *insn = &prog->code[prog->length++];
+    insn->op = op;
+    insn->arg = arg;
+    insn->value = value;
+    return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_real_value
+
+Returned Value: int
+   If one of the following functions returns an error code,
+   this returns that code.
+      compile_real_expression
+      compile_parameter
+      compile_unary
+      read_real_number
+   If no characters are found before the end of the line this
+   returns NCE_NO_CHARACTERS_FOUND_IN_READING_REAL_VALUE.
+   Otherwise, this returns INTERP_OK.
+
+Side effects:
+   The program for the value is added to prog.
+   The counter is reset to point to the first character after the
+   characters which make up the value.
+
+Called by:
+   read_compiled_value
+   compile_parameter
+   compile_real_expression
+
+This is read_real_value for compiled expressions. Like read_real_value,
+it has every value, except a number, checked for being not a number or
+infinity once it is computed.
+
+*/
+
+int Interp::compile_real_value(char *line,      //!< string: line of RS274/NGC code being processed
+                               int *counter,    //!< pointer to a counter for position on the line
+                               expr_program *prog)      //!< program to add the value to
+{
+  char c, c1;
+  double value;
+  int last;
+
+  c = line[*counter];
+  CHKS((c == 0), NCE_NO_CHARACTERS_FOUND_IN_READING_REAL_VALUE);
+
+  c1 = line[*counter+1];
+
+  if (c == '[')
+    CHP(compile_real_expression(line, counter, prog));
+  else if (c == '#')
+    CHP(compile_parameter(line, counter, prog, false));
+  else if (c == '+' && c1 && !isdigit(c1) && c1 != '.')
+  {
+    (*counter)++;
+    CHP(compile_real_value(line, counter, prog));
+  }
+  else if (c == '-' && c1 && !isdigit(c1) && c1 != '.')
+  {
+    (*counter)++;
+    CHP(compile_real_value(line, counter, prog));
+    CHP(emit_expr(prog, EXPR_NEGATE, 0, 0.0));
+  }
+  else if ((c >= 'a') && (c <= 'z'))
+    CHP(compile_unary(line, counter, prog));
+  else
+  {
+    // a number that fits on a line is finite
+    CHP(read_real_number(line, counter, &value));
+    CHP(emit_expr(prog, EXPR_NUMBER, 0, value));
+  }
+
+  // numbers, tests for existence and negated values need no check
+  last = prog->code[prog->length - 1].op;
+  if ((last != EXPR_NUMBER) && (last != EXPR_EXISTS_INDEXED) &&
+      (last != EXPR_EXISTS_NAMED) && (last != EXPR_NEGATE) &&
+      (last != EXPR_CHECK))
+    CHP(emit_expr(prog, EXPR_CHECK, 0, 0.0));
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_real_expression
+
+Returned Value: int
+   If any of the following functions returns an error code,
+   this returns that code:
+     compile_real_value
+     read_operation
+   If any of the following errors occur, this returns the error shown.
+   Otherwise, it returns INTERP_OK.
+   1. The first character is not [:
+      NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED
+
+Side effects:
+   The program for the expression is added to prog.
+   The counter is reset to point to the first character after the
+   closing right bracket.
+
+Called by:
+   read_compiled_value
+   compile_real_value
+   compile_unary
+
+This uses the operator stack of the stack-based read_real_expression,
+but emits each operation where that would have executed it. As every
+value has been emitted by then, the program applies the operations to
+the same values in the same order.
+
+*/
+
+#define MAX_STACK 7
+
+int Interp::compile_real_expression(char *line, //!< string: line of RS274/NGC code being processed
+                                    int *counter,       //!< pointer to a counter for position on the line
+                                    expr_program *prog) //!< program to add the expression to
+{
+  int operators[MAX_STACK];
+  int stack_index;
+
+  CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+  *counter = (*counter + 1);
+  CHP(compile_real_value(line, counter, prog));
+  CHP(read_operation(line, counter, operators));
+  stack_index = 1;
+  for (; operators[0] != RIGHT_BRACKET;) {
+    CHP(compile_real_value(line, counter, prog));
+    CHP(read_operation(line, counter, operators + stack_index));
+    if (precedence(operators[stack_index]) >
+        precedence(operators[stack_index - 1]))
+      stack_index++;
+    else {                      /* precedence of latest operator is <= previous precedence */
+
+      for (; precedence(operators[stack_index]) <=
+           precedence(operators[stack_index - 1]);) {
+        CHP(emit_expr(prog, EXPR_BINARY, operators[stack_index - 1], 0.0));
+        operators[stack_index - 1] = operators[stack_index];
+        if ((stack_index > 1) &&
+            (precedence(operators[stack_index - 1]) <=
+             precedence(operators[stack_index - 2])))
+          stack_index--;
+        else
+          break;
+      }
+    }
+  }
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_parameter
+
+Returned Value: int
+   If compile_real_value or read_name returns an error code, this
+   returns that code.
+   If any of the following errors occur, this returns the error code shown.
+   Otherwise, this returns INTERP_OK.
+   1. The first character read is not # :
+      NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED
+   2. A constant parameter number is not an integer:
+      NCE_NON_INTEGER_VALUE_FOR_INTEGER
+   3. A constant parameter number is out of bounds:
+      NCE_PARAMETER_NUMBER_OUT_OF_RANGE
+
+Side effects:
+   The program for the parameter value, or for whether the parameter
+   exists, is added to prog.
+   The counter is reset to point to the first character after the
+   characters which make up the parameter.
+
+Called by:
+   compile_real_value
+   compile_unary
+
+See read_parameter_setting for the forms of parameters. When the
+parameter number is a number, the parameter is bound to it here;
+when it is computed, the number is checked when the program is run.
+Named parameters are bound to their slot.
+
+*/
+
+int Interp::compile_parameter(char *line,       //!< string: line of RS274/NGC code being processed
+                              int *counter,     //!< pointer to a counter for position on the line
+                              expr_program *prog,       //!< program to add the parameter to
+                              bool check_exists)        //!< test for existence, not value
+{
+  char nameBuf[LINELEN+1];
+  int start;
+  int index;
+
+  CHKS((line[*counter] != '#'), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
+  *counter = (*counter + 1);
+
+  // named parameters look like '<letter...>' or '<_.....>'
+  if (line[*counter] == '<') {
+    CHP(read_name(line, counter, nameBuf));
+    CHP(emit_expr(prog, check_exists ? EXPR_EXISTS_NAMED : EXPR_NAMED,
+                  named_slot(nameBuf), 0.0));
+    return INTERP_OK;
+  }
+
+  start = prog->length;
+  CHP(compile_real_value(line, counter, prog));
+  if ((prog->length == start + 1) && (prog->code[start].op == EXPR_NUMBER)) {
+    CHKS(!integer_value(prog->code[start].value, &index),
+        NCE_NON_INTEGER_VALUE_FOR_INTEGER);
+    prog->length = start;
+    if (check_exists) {
+      CHP(emit_expr(prog, EXPR_NUMBER, 0,
+                    (index >= 1) && (index < RS274NGC_MAX_PARAMETERS)));
+      return INTERP_OK;
+    }
+    CHKS(((index < 1) || (index >= RS274NGC_MAX_PARAMETERS)),
+        NCE_PARAMETER_NUMBER_OUT_OF_RANGE);
+    CHP(emit_expr(prog, EXPR_PARAMETER, index, 0.0));
+  } else
+    CHP(emit_expr(prog, check_exists ? EXPR_EXISTS_INDEXED : EXPR_INDEXED,
+                  0, 0.0));
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! compile_unary
+
+Returned Value: int
+   If any of the following functions returns an error code,
+   this returns that code.
+     compile_parameter
+     compile_real_expression
+     read_operation_unary
+   If any of the following errors occur, this returns the error code shown.
+   Otherwise, it returns INTERP_OK.
+   1. the name of the unary operation is not followed by a left bracket:
+      NCE_LEFT_BRACKET_MISSING_AFTER_UNARY_OPERATION_NAME
+   2. the first argument of atan is not followed by a slash:
+      NCE_SLASH_MISSING_AFTER_FIRST_ATAN_ARGUMENT
+   3. the slash after the first argument of atan is not followed by a
+      left bracket: NCE_LEFT_BRACKET_MISSING_AFTER_SLASH_WITH_ATAN
+   4. the argument of exists is not a bracketed parameter
+
+Side effects:
+   The program for the unary operation is added to prog.
+   The counter is reset to point to the first character after the
+   characters which make up the operation and its arguments.
+
+Called by:  compile_real_value
+
+The atan operation is followed by two arguments, atan[y]/[x], and the
+exists operation by a parameter in brackets, exists[#<name>].
+
+*/
+
+int Interp::compile_unary(char *line,   //!< string: line of RS274/NGC code being processed
+                          int *counter, //!< pointer to a counter for position on the line
+                          expr_program *prog)   //!< program to add the operation to
+{
+  int operation;
+
+  CHP(read_operation_unary(line, counter, &operation));
+  CHKS((line[*counter] != '['),
+      NCE_LEFT_BRACKET_MISSING_AFTER_UNARY_OPERATION_NAME);
+
+  if (operation == EXISTS)
+  {
+      *counter = (*counter + 1);
+      CHKS((line[*counter] != '#'), _("Expected # reading parameter"));
+      CHP(compile_parameter(line, counter, prog, true));
+      CHKS((line[*counter] != ']'), _("Expected ] reading bracketed parameter"));
+      *counter = (*counter + 1);
+      return INTERP_OK;
+  }
+
+  CHP(compile_real_expression(line, counter, prog));
+
+  if (operation == ATAN) {
+    CHKS((line[*counter] != '/'), NCE_SLASH_MISSING_AFTER_FIRST_ATAN_ARGUMENT);
+    *counter = (*counter + 1);
+    CHKS((line[*counter] != '['),
+        NCE_LEFT_BRACKET_MISSING_AFTER_SLASH_WITH_ATAN);
+    CHP(compile_real_expression(line, counter, prog));
+    CHP(emit_expr(prog, EXPR_ATAN, 0, 0.0));
+  } else
+    CHP(emit_expr(prog, EXPR_UNARY, operation, 0.0));
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! execute_expression
+
+Returned Value: int
+   If execute_binary, execute_unary or find_named_slot returns an
+   error code, this returns that code.
+   If any of the following errors occur, this returns the error code shown.
+   Otherwise, it returns INTERP_OK.
+   1. A computed parameter number is not an integer:
+      NCE_NON_INTEGER_VALUE_FOR_INTEGER
+   2. A computed parameter number is out of bounds:
+      NCE_PARAMETER_NUMBER_OUT_OF_RANGE
+   3. A position parameter is read with cutter radius compensation on
+   4. A named parameter is not defined, outside a subroutine definition
+   5. A value is not a number or is infinite
+
+Side effects:
+   The value computed by the program is put into what value points at.
+
+Called by:  read_compiled_value
+
+*/
+
+int Interp::execute_expression(const expr_insn *code,   //!< program to run
+                               int length,      //!< number of instructions in it
+                               double *value,   //!< pointer to the value computed
+                               double *parameters)      //!< array of system parameters
+{
+  double stack[MAX_EXPR_LENGTH];
+  double *top = stack - 1;
+  const expr_insn *insn;
+  const char *name;
+  double unused;
+  int index;
+  int exists;
+
+  for (insn = code; insn < code + length; insn++) {
+    switch (insn->op) {
+    case EXPR_NUMBER:
+      *++top = insn->value;
+      break;
+    case EXPR_PARAMETER:
+      CHKS(((insn->arg >= 5420) && (insn->arg <= 5428) && (_setup.cutter_comp_side)),
+           _("Cannot read current position with cutter radius compensation on"));
+      *++top = parameters[insn->arg];
+      break;
+    case EXPR_INDEXED:
+      CHKS(!integer_value(*top, &index), NCE_NON_INTEGER_VALUE_FOR_INTEGER);
+      CHKS(((index < 1) || (index >= RS274NGC_MAX_PARAMETERS)),
+          NCE_PARAMETER_NUMBER_OUT_OF_RANGE);
+      CHKS(((index >= 5420) && (index <= 5428) && (_setup.cutter_comp_side)),
+           _("Cannot read current position with cutter radius compensation on"));
+      *top = parameters[index];
+      break;
+    case EXPR_NAMED:
+      name = _setup.slot_names[insn->arg];
+      top++;
+      CHP(find_named_slot(insn->arg, &exists, top));
+      // do not require named parameters to be defined during a
+      // subroutine definition:
+      if (!exists && !_setup.defining_sub) {
+	logNP("execute_expression: referencing undefined named parameter '%s' level=%d",
+	      name, (name[0] == '_') ? 0 : _setup.call_level);
+	ERS(_("Named parameter #<%s> not defined"), name);
+      }
+      break;
+    case EXPR_EXISTS_INDEXED:
+      CHKS(!integer_value(*top, &index), NCE_NON_INTEGER_VALUE_FOR_INTEGER);
+      *top = (index >= 1) && (index < RS274NGC_MAX_PARAMETERS);
+      break;
+    case EXPR_EXISTS_NAMED:
+      CHP(find_named_slot(insn->arg, &exists, &unused));
+      *++top = exists ? 1.0 : 0.0;
+      break;
+    case EXPR_NEGATE:
+      *top = -*top;
+      break;
+    case EXPR_UNARY:
+      CHP(execute_unary(top, insn->arg));
+      break;
+    case EXPR_BINARY:
+      top--;
+      CHP(execute_binary(top, insn->arg, top + 1));
+      break;
+    case EXPR_ATAN:
+      top--;
+      *top = atan2(top[0], top[1]);   /* value in radians */
+      *top = ((*top * 180.0) / M_PIl);   /* convert to degrees */
+      break;
+    case EXPR_CHECK:
+      CHKS(std::isnan(*top),
+          _("Calculation resulted in 'not a number'"));
+      CHKS(std::isinf(*top),
+          _("Calculation resulted in 'infinity'"));
+      break;
+    default:
+      ERS(NCE_BUG_UNKNOWN_OPERATION);
+    }
+  }
+  *value = *top;
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
+/*! read_compiled_value
+
+Returned Value: int
+   If compile_real_value, compile_real_expression or execute_expression
+   returns an error code, this returns that code.
+   Otherwise, it returns INTERP_OK.
+
+Side effects:
+   The value read from the line is put into what double_ptr points at.
+   The counter is reset to point to the first character after the
+   characters which make up the value.
+
+Called by:
+   read_real_expression
+   read_real_value
+
+This reads a real value, or with checked false a bare expression as
+read_real_expression does, by running its program. When the line was
+read from the line cache, the program is taken from the cached line,
+or kept with it once compiled.
+
+*/
+
+int Interp::read_compiled_value(char *line,     //!< string: line of RS274/NGC code being processed
+                                int *counter,   //!< pointer to a counter for position on the line
+                                double *double_ptr,     //!< pointer to double to be read
+                                double *parameters,     //!< array of system parameters
+                                bool checked)   //!< a real value rather than an expression
+{
+  cached_line *cl = (line == _setup.blocktext) ? _setup.cached : NULL;
+  expr_program prog;
+  int start = *counter;
+
+  if (cl != NULL) {
+    for (size_t n = 0; n < cl->exprs.size(); n++) {
+      cached_expr *ce = &cl->exprs[n];
+      if ((ce->start == start) && (ce->checked == checked)) {
+        *counter = ce->end;
+        CHP(execute_expression(&ce->code[0], ce->code.size(), double_ptr,
+                               parameters));
+        return INTERP_OK;
+      }
+    }
+  }
+
+  prog.length = 0;
+  if (checked)
+    CHP(compile_real_value(line, counter, &prog));
+  else
+    CHP(compile_real_expression(line, counter, &prog));
+
+  if (cl != NULL) {
+    cl->exprs.push_back(cached_expr());
+    cached_expr &ce = cl->exprs.back();
+    ce.start = start;
+    ce.end = *counter;
+    ce.checked = checked;
+    ce.code.assign(prog.code, prog.code + prog.length);
+  }
+  CHP(execute_expression(prog.code, prog.length, double_ptr, parameters));
+  return INTERP_OK;
+}
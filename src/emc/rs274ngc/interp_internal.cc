@@ -336,8 +336,7 @@ int Interp::parse_line(char *line,       //!< array holding a line of RS274 code
                       block_pointer block,      //!< pointer to a block to be filled     
                       setup_pointer settings)   //!< pointer to machine settings         
 {
-  CHP(init_block(block));
-  CHP(read_items(block, line, settings->parameters));
+  CHP(read_cached_items(block, line, settings));
 
   if(settings->skipping_o == 0)
   {
@@ -358,7 +357,7 @@ Returned Value: int
 
 Side Effects: None
 
-Called by: read_real_expression
+Called by: compile_real_expression
 
 To add additional levels of operator precedence, edit this function.
 
@@ -19,7 +19,10 @@
 #include <stdio.h>
 #include <set>
 #include <map>
+#include <string>
+#include <vector>
 #include <bitset>
+#include <sys/types.h>
 #include "canon.hh"
 #include "emcpos.h"
 #include "libintl.h"
@@ -531,7 +534,24 @@ typedef struct parameter_value_struct {
 } parameter_value;
 
 typedef parameter_value *parameter_pointer;
-typedef std::map<const char *, parameter_value, nocase_cmp> parameter_map;
+
+// the named parameters of a frame, counting the calls which may remove
+// entries, so that pointers to entries can be checked (see slot_param())
+class parameter_map : public std::map<const char *, parameter_value, nocase_cmp> {
+    typedef std::map<const char *, parameter_value, nocase_cmp> base;
+public:
+    parameter_map() : removals(0) {}
+    parameter_map(const parameter_map &other) : base(other), removals(0) {}
+    parameter_map &operator=(const parameter_map &other) {
+        removals++;
+        base::operator=(other);
+        return *this;
+    }
+    size_type erase(const key_type &key) { removals++; return base::erase(key); }
+    iterator erase(iterator it) { removals++; return base::erase(it); }
+    void clear() { removals++; base::clear(); }
+    unsigned removals;
+};
 typedef parameter_map::iterator parameter_map_iterator;
 
 #define PA_READONLY	1
@@ -571,6 +591,8 @@ typedef struct context_struct {
     int m98_loop_counter;      // loop counter for Fanuc-style sub calls
     double saved_params[INTERP_SUB_PARAMS];
     parameter_map named_params;
+    std::vector<parameter_pointer> named_slots; // entries of named_params, by slot
+    unsigned named_slots_removals;      // named_params.removals they are valid for
     unsigned char context_status;		// see CONTEXT_ defines below
     int saved_g_codes[ACTIVE_G_CODES];  // array of active G codes
     int saved_m_codes[ACTIVE_M_CODES];  // array of active M codes
@@ -598,6 +620,149 @@ typedef struct offset_struct {
 typedef std::map<const char *, offset, nocase_cmp> offset_map_type;
 typedef std::map<const char *, offset, nocase_cmp>::iterator offset_map_iterator;
 
+// instructions of compiled expressions, see interp_expr.cc
+enum expr_opcode {
+    EXPR_NUMBER,                // push value
+    EXPR_PARAMETER,             // push parameter arg
+    EXPR_INDEXED,               // replace the index on top by its parameter
+    EXPR_NAMED,                 // push named parameter in slot arg
+    EXPR_EXISTS_INDEXED,        // replace the index on top by 1 if valid
+    EXPR_EXISTS_NAMED,          // push 1 if named parameter in slot arg exists
+    EXPR_NEGATE,
+    EXPR_UNARY,                 // apply unary operation arg to top
+    EXPR_BINARY,                // apply binary operation arg to top two
+    EXPR_ATAN,                  // atan of the top two
+    EXPR_CHECK,                 // fail if top is not a number or infinite
+};
+
+typedef struct expr_insn_struct {
+  int op;                     // enum expr_opcode
+  int arg;
+  double value;
+} expr_insn;
+
+// every character of a line makes at most two instructions
+#define MAX_EXPR_LENGTH (2 * LINELEN)
+
+typedef struct expr_program_struct {
+  expr_insn code[MAX_EXPR_LENGTH];
+  int length;
+} expr_program;
+
+// an expression compiled from a cached line
+typedef struct cached_expr_struct {
+  int start;                  // position on the line
+  int end;                    // position following it
+  bool checked;               // read as a real value, not a bare expression
+  std::vector<expr_insn> code;
+} cached_expr;
+
+// a parameter name read from a line
+typedef struct cached_name_struct {
+  int start;                  // position of the '<'
+  int end;                    // position following the '>'
+  int slot;
+} cached_name;
+
+// most lines of loops and subroutines kept, see interp_cache.cc
+#define MAX_CACHED_LINES 8192
+
+// a line of a file that was read more than once
+typedef struct cached_line_struct {
+  std::string raw_text;       // as read, trailing space removed
+  std::string text;           // after close_and_downcase()
+  long next;                  // offset of the following line
+  bool constant;              // reading its items has no side effects
+  bool parsed;                // items holds what read_items() made of it
+  bool lathe_diameter_mode;   // the state it was read in
+  bool in_call;
+  block items;
+  std::vector<cached_expr> exprs;
+  std::vector<cached_name> names;
+} cached_line;
+
+typedef std::map<long, cached_line> cached_line_map;
+
+// the cached lines of a file, and the file they are valid for
+typedef struct cached_file_struct {
+  off_t size;
+  time_t mtime;
+  long mtime_nsec;
+  long read_end;              // lines starting before this were read before
+  cached_line_map lines;      // by offset
+} cached_file;
+
+typedef std::map<std::pair<dev_t, ino_t>, cached_file> cached_file_map;
+
+// bytes of a program file read at a time, see interp_text.cc
+#define TEXT_WINDOW 65536
+
+// a file of the subroutine search path, see interp_cache.cc
+typedef struct sub_file_struct {
+  std::string path;
+  off_t size;
+  time_t mtime;
+  long mtime_nsec;
+  long offset;                // of its 'o<name> sub' line, or -1
+  int sequence_number;        // of the line before it
+} sub_file;
+
+typedef std::map<std::string, sub_file> sub_file_map;
+
+// a directory of the subroutine search path, as it was indexed
+typedef struct sub_dir_struct {
+  std::string path;
+  time_t mtime;               // -1 if it did not exist
+  long mtime_nsec;
+} sub_dir;
+
+// most checkpoints kept of the program, and about the most memory
+// they take, see interp_checkpoint.cc
+#define MAX_CHECKPOINTS 1000
+#define MAX_CHECKPOINT_BYTES (16 * 1024 * 1024)
+
+// the state of the interpreter after a line of the main program
+typedef struct checkpoint_struct {
+  long offset;                // of the following line
+  int sequence_number;
+  std::vector<std::pair<int, double> > parameters; // set or changed in the run
+  parameter_map named_params; // of the main program
+  offset_map_type offset_map;
+  int executed_if;
+  int g_codes[ACTIVE_G_CODES];
+  int m_codes[ACTIVE_M_CODES];
+  double current[9];          // x y z a b c u v w
+  int current_pocket;
+  int selected_pocket;
+  int selected_tool;
+  EmcPose tool_offset;
+  double motion_tolerance;
+  double naivecam_tolerance;
+  int motion_mode;
+  double cycle_cc, cycle_i, cycle_j, cycle_k, cycle_p, cycle_q, cycle_r;
+  double cycle_il;
+  int cycle_l, cycle_il_flag;
+  double feed_rate;
+  double speed[EMCMOT_MAX_SPINDLES];
+  size_t bytes;               // about the memory it takes
+} checkpoint;
+
+typedef std::map<int, checkpoint> checkpoint_map;
+
+// the checkpoints of the last run of the program from its start
+typedef struct checkpoint_file_struct {
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  long mtime_nsec;
+  std::vector<double> parameters; // at the start
+  std::vector<bool> parameters_set; // by the lines run
+  checkpoint_map checkpoints; // by sequence number
+  int interval;               // lines between them
+  size_t bytes;               // about the memory they take
+} checkpoint_file;
+
 /*
 
 The current_x, current_y, and current_z are the location of the tool
@@ -653,6 +818,8 @@ struct setup
 
   char blocktext[LINELEN];   // linetext downcased, white space gone
   CANON_MOTION_MODE control_mode;       // exact path or cutting mode
+  double motion_tolerance;      // P of G64, or -1
+  double naivecam_tolerance;    // Q of G64, or -1
   int current_pocket;             // carousel slot number of current tool
   double current_x;             // current X-axis position
   double current_y;             // current Y-axis position
@@ -695,7 +862,7 @@ struct setup
   int parameter_numbers[MAX_NAMED_PARAMETERS];    // parameter number buffer
   double parameter_values[MAX_NAMED_PARAMETERS];  // parameter value buffer
   int named_parameter_occurrence;
-  const char *named_parameters[MAX_NAMED_PARAMETERS];
+  int named_parameters[MAX_NAMED_PARAMETERS];     // slots
   double named_parameter_values[MAX_NAMED_PARAMETERS];
   bool percent_flag;          // true means first line was percent sign
   CANON_PLANE plane;            // active plane, XY-, YZ-, or XZ-plane
@@ -745,6 +912,27 @@ struct setup
   int call_state;                  //  enum call_states - inidicate Py handler reexecution
   offset_map_type offset_map;      // store label x name, file, line
 
+  cached_file_map line_cache;      // lines of loops and subs, by file
+  cached_file *cache_file;         // entry of the file being read
+  cached_line *cached;             // entry of the line read last, or NULL
+  FILE *cache_fp;                  // where the line read last ended
+  long cache_next;
+  int cached_lines;                // in all files
+  FILE *text_fp;                   // file read through text_window
+  long text_pos;                   // where reading it continues
+  long text_start;                 // offset in it of text_window
+  long text_fill;                  // bytes read into text_window
+  int text_errno;                  // of the last read of it, or 0
+  char text_window[TEXT_WINDOW];
+  sub_file_map sub_files;          // subroutine files, by name
+  std::vector<sub_dir> sub_dirs;   // the directories they were found in
+  std::vector<const char *> slot_names;     // named parameters, by slot
+  std::map<const char *, int> name_slots;   // slots, by stored name
+  int checkpoint_interval;         // lines between checkpoints, 0 for none
+  checkpoint_file checkpoints;     // of the program open
+  checkpoint_file *checkpoint_run; // of the file being run, or NULL
+  int checkpoint_reached;          // last line of the run, -1 before it
+
   bool adaptive_feed;              // adaptive feed is enabled
   bool feed_hold;                  // feed hold is enabled
   int loggingLevel;                  // 0 means logging is off
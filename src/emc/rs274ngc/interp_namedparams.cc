@@ -96,84 +96,6 @@ enum predefined_named_parameters {
     NP_TASK,
 };
 
-/****************************************************************************/
-
-/*! read_named_parameter
-
-Returned Value: int
-   If read_integer_value returns an error code, this returns that code.
-   If any of the following errors occur, this returns the error code shown.
-   Otherwise, this returns INTERP_OK.
-   1. The first character read is not a <:
-      NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED
-   2. The named parameter string is not terminated by >:
-      NCE_NAMED_PARAMETER_NOT_TERSINATED
-   3. The named parameter has not been defined before use:
-      NCE_NAMED_PARAMETER_NOT_DEFINED
-
-Side effects:
-   The value of the given parameter is put into what double_ptr points at.
-   The counter is reset to point to the first character after the
-   characters which make up the value.
-
-Called by:  read_parameter
-
-This attempts to read the value of a parameter out of the line,
-starting at the index given by the counter.
-
-According to the RS274/NGC manual [NCMS, p. 62], the characters following
-# may be any "parameter expression". Thus, the following are legal
-and mean the same thing (the value of the parameter whose number is
-stored in parameter 2):
-  ##2
-  #[#2]
-
-
-ADDED by K. Lerman
-Named parameters are now supported.
-#<_abcd> is a parameter with name "abcd" of global scope
-#<abce> is a named parameter of local scope.
-
-*/
-
-int Interp::read_named_parameter(
-				 char *line,   //!< string: line of RS274/NGC code being processed
-				 int *counter, //!< pointer to a counter for position on the line
-				 double *double_ptr,   //!< pointer to double to be read
-				 double *parameters,   //!< array of system parameters
-				 bool check_exists)    //!< test for existence, not value
-{
-    static char name[] = "read_named_parameter";
-    char paramNameBuf[LINELEN+1];
-    int exists;
-    double value;
-    parameter_map_iterator pi;
-
-    CHKS((line[*counter] != '<'),
-	 NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
-    CHP(read_name(line, counter, paramNameBuf));
-
-    CHP(find_named_param(paramNameBuf, &exists, &value));
-    if (check_exists) {
-	*double_ptr = exists ? 1.0 : 0.0;
-	return INTERP_OK;
-    }
-    if (exists) {
-	*double_ptr = value;
-	return INTERP_OK;
-    } else {
-        // do not require named parameters to be defined during a 
-        // subroutine definition:
-        if (_setup.defining_sub)
-            return INTERP_OK;
-
-	logNP("%s: referencing undefined named parameter '%s' level=%d",
-	      name, paramNameBuf, (paramNameBuf[0] == '_') ? 0 : _setup.call_level);
-	ERS(_("Named parameter #<%s> not defined"), paramNameBuf);
-    }
-    return INTERP_OK;
-}
-
 // if the variable is of the form '_ini[section]name', then treat it as
 // an inifile  variable. Lookup section/name and cache the value
 // as global and read-only.
@@ -352,7 +274,17 @@ int Interp::find_named_param(
       *value = 0.0;
       *status = 0;
   } else {
-      parameter_pointer pv = &pi->second;
+      CHP(named_param_value(nameBuf, &pi->second, status, value));
+  }
+  return INTERP_OK;
+}
+
+// The value of the named parameter nameBuf, which has the entry pv.
+int Interp::named_param_value(const char *nameBuf,
+			      parameter_pointer pv,
+			      int *status,
+			      double *value)
+{
       if (pv->attr & PA_UNSET)
 	  logNP("warning: referencing unset variable '%s'",nameBuf);
       if (pv->attr & PA_USE_LOOKUP) {
@@ -399,7 +331,6 @@ int Interp::find_named_param(
 	  *value = pv->value;
 	  *status = 1;
       }
-  }
   return INTERP_OK;
 }
 
@@ -421,8 +352,19 @@ int Interp::store_named_param(setup_pointer settings,
   if (pi == frame->named_params.end()) {
       ERS(_("Internal error: Could not assign #<%s>"), nameBuf);
   } else {
-      parameter_pointer pv = &pi->second;
+      CHP(store_named_value(nameBuf, level, &pi->second, value,
+			    override_readonly));
+  }
+  return INTERP_OK;
+}
 
+// Sets the entry pv of the named parameter nameBuf at level to value.
+int Interp::store_named_value(const char *nameBuf,
+			      int level,
+			      parameter_pointer pv,
+			      double value,
+			      int override_readonly)
+{
       CHKS(((pv->attr & PA_GLOBAL)  && level),
 	   "BUG: variable '%s' marked global, but assigned at level %d", nameBuf, level);
 
@@ -434,7 +376,6 @@ int Interp::store_named_param(setup_pointer settings,
 	  logNP("store_named_parameter: level[%d] %s value=%lf",
 		level, nameBuf, value);
       }
-  }
   return INTERP_OK;
 }
 
@@ -472,6 +413,86 @@ int Interp::add_named_param(
 }
 
 
+// Named parameters are also known by a slot, a number given to each
+// name when it is first read, so that reading and assigning them needs
+// no string comparisons. Each frame keeps the entries of its named_params
+// found by slot, which stay valid until an entry is removed. Globals are
+// the entries of frame 0.
+
+// Returns the slot of the named parameter called name.
+int Interp::named_slot(const char *name)
+{
+    const char *stored = strstore(name);
+    std::map<const char *, int>::iterator it = _setup.name_slots.find(stored);
+
+    if (it != _setup.name_slots.end())
+	return it->second;
+    _setup.slot_names.push_back(stored);
+    return _setup.name_slots[stored] = _setup.slot_names.size() - 1;
+}
+
+// Returns the entry of the named parameter in slot in the frame it is
+// visible in, or NULL if it has none.
+parameter_pointer Interp::slot_param(int slot)
+{
+    const char *name = _setup.slot_names[slot];
+    context_pointer frame =
+	&_setup.sub_context[(name[0] == '_') ? 0 : _setup.call_level];
+    parameter_map_iterator pi;
+
+    if (frame->named_slots_removals != frame->named_params.removals) {
+	frame->named_slots.clear();
+	frame->named_slots_removals = frame->named_params.removals;
+    }
+    if (((size_t) slot < frame->named_slots.size()) &&
+	(frame->named_slots[slot] != NULL))
+	return frame->named_slots[slot];
+
+    pi = frame->named_params.find(name);
+    if (pi == frame->named_params.end())
+	return NULL;
+    if ((size_t) slot >= frame->named_slots.size())
+	frame->named_slots.resize(slot + 1, NULL);
+    frame->named_slots[slot] = &pi->second;
+    return &pi->second;
+}
+
+// find_named_param() by slot
+int Interp::find_named_slot(int slot, int *status, double *value)
+{
+    parameter_pointer pv = slot_param(slot);
+
+    if (pv == NULL) // ini and HAL parameters, or none
+	return find_named_param(_setup.slot_names[slot], status, value);
+    CHP(named_param_value(_setup.slot_names[slot], pv, status, value));
+    return INTERP_OK;
+}
+
+// store_named_param() by slot
+int Interp::store_named_slot(int slot, double value)
+{
+    const char *name = _setup.slot_names[slot];
+    parameter_pointer pv = slot_param(slot);
+
+    if (pv == NULL)
+	ERS(_("Internal error: Could not assign #<%s>"), name);
+    CHP(store_named_value(name, (name[0] == '_') ? 0 : _setup.call_level,
+			  pv, value, 0));
+    return INTERP_OK;
+}
+
+// add_named_param() by slot
+int Interp::add_named_slot(int slot)
+{
+    parameter_pointer pv = slot_param(slot);
+
+    // add_named_param() also reads values that are computed
+    if (pv != NULL && !(pv->attr & (PA_USE_LOOKUP | PA_PYTHON)))
+	return INTERP_OK;
+    CHP(add_named_param(_setup.slot_names[slot]));
+    return INTERP_OK;
+}
+
 int Interp::free_named_parameters(context_pointer frame)
 {
     frame->named_params.clear();
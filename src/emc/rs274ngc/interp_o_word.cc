@@ -119,6 +119,15 @@ int Interp::control_save_offset(block_pointer block,        /* pointer to a bloc
     // the proper value
     new_offset.sequence_number = settings->sequence_number - 1;
     settings->offset_map[block->o_name] = new_offset;
+
+    if (settings->skipping_to_sub) {
+	// found by reading through its file; keep it for after a reset
+	sub_file *sf = indexed_sub_file(block->o_name, settings->filename);
+	if (sf) {
+	    sf->offset = new_offset.offset;
+	    sf->sequence_number = new_offset.sequence_number;
+	}
+    }
     return INTERP_OK;
 }
 
@@ -228,7 +237,7 @@ int Interp::execute_call(setup_pointer settings,
 	    // reopen it on return.
 	    previous_frame->position = -1;
 	else
-	    previous_frame->position = ftell(settings->file_pointer);
+	    previous_frame->position = text_tell(settings->file_pointer);
 	previous_frame->filename = strstore(settings->filename);
 	previous_frame->sequence_number = settings->sequence_number;
 	logOword("saving return location[cl=%d]: %s:%d offset=%ld", 
@@ -460,7 +469,7 @@ int Interp::execute_return(setup_pointer settings, context_pointer current_frame
 		}
 		//!!!KL must open the new file, if changed
 		if (0 != strcmp(settings->filename, previous_frame->filename))  {
-		    fclose(settings->file_pointer);
+		    text_close(settings->file_pointer);
 		    settings->file_pointer = fopen(previous_frame->filename, "r");
 		    if (settings->file_pointer == NULL)  {
 			ERS(NCE_CANNOT_REOPEN_FILE, 
@@ -469,7 +478,7 @@ int Interp::execute_return(setup_pointer settings, context_pointer current_frame
 		    }
 		    strcpy(settings->filename, previous_frame->filename);
 		}
-		fseek(settings->file_pointer, previous_frame->position, SEEK_SET);
+		text_seek(settings->file_pointer, previous_frame->position);
 		settings->sequence_number = previous_frame->sequence_number;
 		logOword("endsub/return: %s:%d pos=%ld", 
 			 settings->filename,previous_frame->sequence_number,
@@ -520,7 +529,7 @@ void Interp::loop_to_beginning(setup_pointer settings)
 	     settings->filename);
 
     // scroll back to beginning of file/first block
-    fseek(settings->file_pointer, 0, SEEK_SET);
+    text_seek(settings->file_pointer, 0);
     settings->sequence_number = 0;
 }
 
@@ -561,7 +570,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	    settings->sequence_number = 0;
             strncpy(settings->filename, op->filename, sizeof(settings->filename));
             if (settings->filename[sizeof(settings->filename)-1] != '\0') {
-                fclose(settings->file_pointer);
+                text_close(settings->file_pointer);
                 logOword("filename too long: %s", op->filename);
                 ERS(NCE_UNABLE_TO_OPEN_FILE, op->filename);
             }
@@ -569,7 +578,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	    if (newFP) {
 		// close the old file...
 		if (settings->file_pointer) // only close if it was open
-		    fclose(settings->file_pointer);
+		    text_close(settings->file_pointer);
 		settings->file_pointer = newFP;
 	    } else {
 		logOword("Unable to open file: %s", settings->filename);
@@ -577,8 +586,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	    }
 	}
 	if (settings->file_pointer) { // only seek if it was open
-	    fseek(settings->file_pointer,
-		  op->offset, SEEK_SET);
+	    text_seek(settings->file_pointer, op->offset);
 	}
 	settings->sequence_number = op->sequence_number;
 	return INTERP_OK;
@@ -591,13 +599,20 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 
 	// close the old file...
 	if (settings->file_pointer)
-	    fclose(settings->file_pointer);
+	    text_close(settings->file_pointer);
 	settings->file_pointer = newFP;
         strncpy(settings->filename, newFileName, sizeof(settings->filename));
         if (settings->filename[sizeof(settings->filename)-1] != '\0') {
             logOword("new filename '%s' is too long (max len %zu)\n", newFileName, sizeof(settings->filename)-1);
             settings->filename[sizeof(settings->filename)-1] = '\0'; // oh well, truncate the filename
         }
+
+	// go straight to the sub if it was found in this file before
+	sub_file *sf = indexed_sub_file(block->o_name, settings->filename);
+	if (sf && sf->offset >= 0) {
+	    text_seek(newFP, sf->offset);
+	    settings->sequence_number = sf->sequence_number;
+	}
     } else {
 	char *dirname = getcwd(NULL, 0);
 	logOword("fopen: |%s| failed CWD:|%s|", newFileName,
@@ -86,58 +86,6 @@ int Interp::read_a(char *line,   //!< string: line of RS274/NGC code being proce
 }
 
 
-/****************************************************************************/
-
-/*! read_atan
-
-Returned Value: int
-   If read_real_expression returns an error code, this returns that code.
-   If any of the following errors occur, this returns the error code shown.
-   Otherwise, it returns INTERP_OK.
-   1. The first character to read is not a slash:
-      NCE_SLASH_MISSING_AFTER_FIRST_ATAN_ARGUMENT
-   2. The second character to read is not a left bracket:
-      NCE_LEFT_BRACKET_MISSING_AFTER_SLASH_WITH_ATAN
-
-Side effects:
-   The computed value is put into what double_ptr points at.
-   The counter is reset to point to the first character after the
-   characters which make up the value.
-
-Called by:
-   read_unary
-
-When this function is called, the characters "atan" and the first
-argument have already been read, and the value of the first argument
-is stored in double_ptr.  This function attempts to read a slash and
-the second argument to the atan function, starting at the index given
-by the counter and then to compute the value of the atan operation
-applied to the two arguments.  The computed value is inserted into
-what double_ptr points at.
-
-The computed value is in the range from -180 degrees to +180 degrees.
-The range is not specified in the RS274/NGC manual [NCMS, page 51],
-although using degrees (not radians) is specified.
-
-*/
-
-int Interp::read_atan(char *line,        //!< string: line of RS274/NGC code being processed
-                     int *counter,      //!< pointer to a counter for position on line     
-                     double *double_ptr,        //!< pointer to double to be read                  
-                     double *parameters)        //!< array of system parameters                    
-{
-  double argument2;
-
-  CHKS((line[*counter] != '/'), NCE_SLASH_MISSING_AFTER_FIRST_ATAN_ARGUMENT);
-  *counter = (*counter + 1);
-  CHKS((line[*counter] != '['),
-      NCE_LEFT_BRACKET_MISSING_AFTER_SLASH_WITH_ATAN);
-  CHP(read_real_expression(line, counter, &argument2, parameters));
-  *double_ptr = atan2(*double_ptr, argument2);  /* value in radians */
-  *double_ptr = ((*double_ptr * 180.0) / M_PIl);   /* convert to degrees */
-  return INTERP_OK;
-}
-
 /****************************************************************************/
 
 /*! read_b
@@ -763,7 +711,6 @@ Called by:
    read_l
    read_h
    read_m
-   read_parameter
    read_parameter_setting
    read_t
 
@@ -1231,7 +1178,7 @@ Side effects:
    at.  The counter is reset to point to the first character after the
    operation.
 
-Called by: read_real_expression
+Called by: compile_real_expression
 
 This expects to be reading a binary operation (+, -, /, *, **, and,
 mod, or, xor) or a right bracket (]). If one of these is found, the
@@ -1378,7 +1325,7 @@ Side effects:
    characters which make up the operation name.
 
 Called by:
-   read_unary
+   compile_unary
 
 This attempts to read the name of a unary operation out of the line,
 starting at the index given by the counter. Known operations are:
@@ -1970,109 +1917,41 @@ int Interp::read_name(
   return INTERP_OK;
 }
 
-
-
-
-/****************************************************************************/
-
-/*! read_parameter
-
-Returned Value: int
-   If read_integer_value returns an error code, this returns that code.
-   If any of the following errors occur, this returns the error code shown.
-   Otherwise, this returns INTERP_OK.
-   1. The first character read is not # :
-      NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED
-   2. The parameter number is out of bounds:
-      NCE_PARAMETER_NUMBER_OUT_OF_RANGE
-
-Side effects:
-   The value of the given parameter is put into what double_ptr points at.
-   The counter is reset to point to the first character after the
-   characters which make up the value.
-
-Called by:  read_real_value
-
-This attempts to read the value of a parameter out of the line,
-starting at the index given by the counter.
-
-According to the RS274/NGC manual [NCMS, p. 62], the characters following
-# may be any "parameter expression". Thus, the following are legal
-and mean the same thing (the value of the parameter whose number is
-stored in parameter 2):
-  ##2
-  #[#2]
-
-Parameter setting is done in parallel, not sequentially. For example
-if #1 is 5 before the line "#1=10 #2=#1" is read, then after the line
-is is executed, #1 is 10 and #2 is 5. If parameter setting were done
-sequentially, the value of #2 would be 10 after the line was executed.
-
-ADDED by K. Lerman
-Named parameters are now supported.
-#[abcd] is a parameter with name "abcd"
-#[#2] is NOT a named parameter.
-When a [ is seen after a #, if the next char is not a #, it is a named
-parameter.
-
-*/
-
-int Interp::read_parameter(
+// read_name() giving the slot of the name, which is kept with the line
+// if it is cached, see named_slot()
+int Interp::read_name_slot(
     char *line,   //!< string: line of RS274/NGC code being processed
-    int *counter, //!< pointer to a counter for position on the line 
-    double *double_ptr,   //!< pointer to double to be read                  
-    double *parameters,   //!< array of system parameters
-    bool check_exists)    //!< test for existence, not value
+    int *counter, //!< pointer to a counter for position on the line
+    int *slot)    //!< pointer to the slot to be read
 {
-  int index;
-
-  CHKS((line[*counter] != '#'), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
-
-  *counter = (*counter + 1);
-
-  // named parameters look like '<letter...>' or '<_.....>'
-  if(line[*counter] == '<')
-  {
-      //_setup.stack_index = 0; -- reminder of variable we need
-      // find the matching string (if any) -- or create it
-      // then get the value and store it
-      CHP(read_named_parameter(line, counter, double_ptr, parameters,
-	      check_exists));
-  }
-  else
-  {
-      CHP(read_integer_value(line, counter, &index, parameters));
-      if(check_exists)
-      {
-	  *double_ptr = index >= 1 && index < RS274NGC_MAX_PARAMETERS;
-	  return INTERP_OK;
+  char nameBuf[LINELEN+1];
+  cached_line *cl = (line == _setup.blocktext) ? _setup.cached : NULL;
+  cached_name entry;
+
+  if (cl != NULL) {
+      for (size_t n = 0; n < cl->names.size(); n++) {
+          if (cl->names[n].start == *counter) {
+              *slot = cl->names[n].slot;
+              *counter = cl->names[n].end;
+              return INTERP_OK;
+          }
       }
-      CHKS(((index < 1) || (index >= RS274NGC_MAX_PARAMETERS)),
-          NCE_PARAMETER_NUMBER_OUT_OF_RANGE);
-      CHKS(((index >= 5420) && (index <= 5428) && (_setup.cutter_comp_side)),
-           _("Cannot read current position with cutter radius compensation on"));
-      *double_ptr = parameters[index];
   }
-  return INTERP_OK;
-}
 
-int Interp::read_bracketed_parameter(
-    char *line,   //!< string: line of RS274/NGC code being processed
-    int *counter, //!< pointer to a counter for position on the line
-    double *double_ptr,   //!< pointer to double to be read
-    double *parameters,   //!< array of system parameters
-    bool check_exists)    //!< test for existence, not value
-{
-  CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
-  *counter = (*counter + 1);
-  CHKS((line[*counter] != '#'), _("Expected # reading parameter"));
-  CHP(read_parameter(line, counter, double_ptr, parameters, check_exists));
-  CHKS((line[*counter] != ']'), _("Expected ] reading bracketed parameter"));
-  *counter = (*counter + 1);
+  entry.start = *counter;
+  CHP(read_name(line, counter, nameBuf));
+  *slot = named_slot(nameBuf);
+  if (cl != NULL) {
+      entry.end = *counter;
+      entry.slot = *slot;
+      cl->names.push_back(entry);
+  }
   return INTERP_OK;
 }
 
 
+
+
 /****************************************************************************/
 
 /*! read_parameter_setting
@@ -2136,7 +2015,7 @@ integer) followed by = followed by a real value (number or
 expression).
 
 Note that # also starts a bunch of characters which represent a parameter
-to be evaluated. That situation is handled by read_parameter.
+to be evaluated. That situation is handled by compile_parameter.
 
 */
 
@@ -2146,11 +2025,9 @@ int Interp::read_parameter_setting(
     block_pointer block,  //!< pointer to a block being filled from the line 
     double *parameters)   //!< array of system parameters
 {
-  static char name[] = "read_parameter_setting";
   int index;
+  int slot;
   double value;
-  char *param;
-  const char *dup;
 
   CHKS((line[*counter] != '#'), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
   *counter = (*counter + 1);
@@ -2158,7 +2035,7 @@ int Interp::read_parameter_setting(
   // named parameters look like '<letter...>' or '<_letter.....>'
   if(line[*counter] == '<')
   {
-      CHP(read_named_parameter_setting(line, counter, &param, parameters));
+      CHP(read_named_parameter_setting(line, counter, &slot, parameters));
 
       CHKS((line[*counter] != '='),
           NCE_EQUAL_SIGN_MISSING_IN_PARAMETER_SETTING);
@@ -2166,20 +2043,11 @@ int Interp::read_parameter_setting(
       CHP(read_real_value(line, counter, &value, parameters));
 
       logDebug("setting up named param[%d]:|%s| value:%lf",
-               _setup.named_parameter_occurrence, param, value);
-
-      dup = strstore(param); // no more need to free this
-      if(dup == 0)
-      {
-          ERS(NCE_OUT_OF_MEMORY);
-      }
-      logDebug("%s |%s|", name,  dup);
-      _setup.named_parameters[_setup.named_parameter_occurrence] = dup;
+               _setup.named_parameter_occurrence, _setup.slot_names[slot], value);
 
+      _setup.named_parameters[_setup.named_parameter_occurrence] = slot;
       _setup.named_parameter_values[_setup.named_parameter_occurrence] = value;
       _setup.named_parameter_occurrence++;
-      logDebug("done setting up named param[%d]:|%s| value:%lf",
-               _setup.named_parameter_occurrence, param, value);
   }
   else
   {
@@ -2215,8 +2083,8 @@ Returned Value: int
 
 Side effects:
    counter is reset to the character following the end of the parameter
-   setting. The parameter whose index follows "#" is set to the
-   real value following "=".
+   name. The parameter is added if it does not exist, and its slot is
+   returned in slot.
 
 Called by: read_parameter_setting
 
@@ -2261,34 +2129,25 @@ integer) followed by = followed by a real value (number or
 expression).
 
 Note that # also starts a bunch of characters which represent a parameter
-to be evaluated. That situation is handled by read_parameter.
+to be evaluated. That situation is handled by compile_parameter.
 
 */
 
 int Interp::read_named_parameter_setting(
     char *line,   //!< string: line of RS274/NGC code being processed
     int *counter, //!< pointer to a counter for position on the line 
-    char **param,  //!< pointer to the char * to be returned 
+    int *slot,    //!< pointer to the slot to be returned
     double *parameters)   //!< array of system parameters
 {
   static char name[] = "read_named_parameter_setting";
-  int status;
-  static char paramNameBuf[LINELEN+1];
-
-  *param = paramNameBuf;
 
   logDebug("entered %s", name);
   CHKS((line[*counter] != '<'),
       NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
 
-  status=read_name(line, counter, paramNameBuf);
-  CHP(status);
-
-  logDebug("%s: returned(%d) from read_name:|%s|", name, status, paramNameBuf);
-
-  status = add_named_param(paramNameBuf);
-  CHP(status);
-  logDebug("%s: returned(%d) from add_named_param:|%s|", name, status, paramNameBuf);
+  CHP(read_name_slot(line, counter, slot));
+  CHP(add_named_slot(*slot));
+  logDebug("%s: added slot %d:|%s|", name, *slot, _setup.slot_names[*slot]);
 
   // the rest of the work is done in read_parameter_setting
 
@@ -2402,9 +2261,7 @@ int Interp::read_r(char *line,   //!< string: line of RS274 code being processed
 Returned Value: int
    If any of the following functions returns an error code,
    this returns that code.
-     read_real_value
-     read_operation
-     execute_binary
+     read_compiled_value
    If any of the following errors occur, this returns the error shown.
    Otherwise, it returns INTERP_OK.
    1. The first character is not [ :
@@ -2416,9 +2273,7 @@ Side effects:
    expression.
 
 Called by:
- read_atan
- read_real_value
- read_unary
+ read_o
 
 Example 1: [2 - 3 * 4 / 5] means [2 - [[3 * 4] / 5]] and equals -0.4.
 
@@ -2579,110 +2434,18 @@ expression is: [9+8*7/6+5-4*3**2+1]. It may be rewritten as:
 The manual provides that operations of the same precedence should be
 processed left to right.
 
-The first version of this function is commented out. It is suitable
-for when there are only two precendence levels. It is an improvement
-over the version used in interpreters before 2000, but not as general
-as the second version given here.
-
-The first version of this function reads the first value and the first
-operation in the expression. Then it calls either read_rest_bop1 or
-read_rest_bop2 according to whether the first operation is a bop1 or a
-bop2.  Read_rest_bop1 resets the next_operation to either a right
-bracket or a bop2. If it is reset to a bop2, read_rest_bop2 is called
-when read_rest_bop1 returns.
-
-*/
-
-#ifdef UNDEFINED
-int Interp::read_real_expression(char *line,     //!< string: line of RS274/NGC code being processed
-                                int *counter,   //!< pointer to a counter for position on the line 
-                                double *value,  //!< pointer to double to be read                  
-                                double *parameters)     //!< array of system parameters                    
-{
-  static char name[] = "read_real_expression";
-  int next_operation;
-  int status;
-
-  CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
-  *counter = (*counter + 1);
-  CHP(read_real_value(line, counter, value, parameters));
-  CHP(read_operation(line, counter, &next_operation));
-  if (next_operation == RIGHT_BRACKET); /* nothing to do */
-  else if (next_operation < AND2) {     /* next operation is a bop1, times-like */
-    CHP(read_rest_bop1(line, counter, value, &next_operation, parameters));
-    if (next_operation == RIGHT_BRACKET);       /* next_operation has been reset */
-    else                        /* next_operation is now a bop2, plus-like */
-      CHP(read_rest_bop2(line, counter, value, next_operation, parameters));
-  } else                        /* next operation is a bop2, plus-like */
-    CHP(read_rest_bop2(line, counter, value, next_operation, parameters));
-  return INTERP_OK;
-}
-#endif
-
-/****************************************************************************/
-
-/*! read_real_expression
-
-The following version is stack-based and fully general. It is the
-classical stack-based version with left-to-right evaluation of
-operations of the same precedence. Separate stacks are used for
-operations and values, and the stacks are made with arrays
-rather than lists, but those are implementation details. Pushing
-and popping are implemented by increasing or decreasing the
-stack index.
-
-Additional levels of precedence may be defined easily by changing the
-precedence function. The size of MAX_STACK should always be at least
-as large as the number of precedence levels used. We are currently
-using four precedence levels (for right-bracket, plus-like operations,
-times-like operations, and power).
-
-N.B.: We are now using six levels (right-bracket, logical operations,
-relational operations, plus-like operations, times-like operations, and
-power).
+This compiles the expression with compile_real_expression, or takes
+it from the line cache, and runs it with execute_expression.
 
 */
 
-#define MAX_STACK 7
-
 int Interp::read_real_expression(char *line,     //!< string: line of RS274/NGC code being processed
                                 int *counter,   //!< pointer to a counter for position on the line 
                                 double *value,  //!< pointer to double to be computed              
                                 double *parameters)     //!< array of system parameters                    
 {
-  double values[MAX_STACK];
-  int operators[MAX_STACK];
-  int stack_index;
-
   CHKS((line[*counter] != '['), NCE_BUG_FUNCTION_SHOULD_NOT_HAVE_BEEN_CALLED);
-  *counter = (*counter + 1);
-  CHP(read_real_value(line, counter, values, parameters));
-  CHP(read_operation(line, counter, operators));
-  stack_index = 1;
-  for (; operators[0] != RIGHT_BRACKET;) {
-    CHP(read_real_value(line, counter, values + stack_index, parameters));
-    CHP(read_operation(line, counter, operators + stack_index));
-    if (precedence(operators[stack_index]) >
-        precedence(operators[stack_index - 1]))
-      stack_index++;
-    else {                      /* precedence of latest operator is <= previous precedence */
-
-      for (; precedence(operators[stack_index]) <=
-           precedence(operators[stack_index - 1]);) {
-        CHP(execute_binary((values + stack_index - 1),
-                           operators[stack_index - 1],
-                           (values + stack_index)));
-        operators[stack_index - 1] = operators[stack_index];
-        if ((stack_index > 1) &&
-            (precedence(operators[stack_index - 1]) <=
-             precedence(operators[stack_index - 2])))
-          stack_index--;
-        else
-          break;
-      }
-    }
-  }
-  *value = values[0];
+  CHP(read_compiled_value(line, counter, value, parameters, false));
   return INTERP_OK;
 }
 
@@ -2755,9 +2518,7 @@ int Interp::read_real_number(char *line, //!< string: line of RS274/NGC code bei
 Returned Value: int
    If one of the following functions returns an error code,
    this returns that code.
-      read_real_expression
-      read_parameter
-      read_unary
+      read_compiled_value
       read_real_number
    If no characters are found before the end of the line this
    returns NCE_NO_CHARACTERS_FOUND_IN_READING_REAL_VALUE.
@@ -2790,8 +2551,9 @@ Called by:
 
 This attempts to read a real value out of the line, starting at the
 index given by the counter. The value may be a number, a parameter
-value, a unary function, or an expression. It calls one of four
-other readers, depending upon the first character.
+value, a unary function, or an expression. Numbers are read with
+read_real_number, anything else is compiled and run by
+read_compiled_value.
 
 */
 
@@ -2807,149 +2569,20 @@ int Interp::read_real_value(char *line,  //!< string: line of RS274/NGC code bei
 
   c1 = line[*counter+1];
 
-  if (c == '[')
-    CHP(read_real_expression(line, counter, double_ptr, parameters));
-  else if (c == '#')
-  {
-    CHP(read_parameter(line, counter, double_ptr, parameters, false));
-  }
-  else if (c == '+' && c1 && !isdigit(c1) && c1 != '.')
-  {
-    (*counter)++;
-    CHP(read_real_value(line, counter, double_ptr, parameters));
-  }
-  else if (c == '-' && c1 && !isdigit(c1) && c1 != '.')
-  {
-    (*counter)++;
-    CHP(read_real_value(line, counter, double_ptr, parameters));
-    *double_ptr = -*double_ptr;
-  }
-  else if ((c >= 'a') && (c <= 'z'))
-    CHP(read_unary(line, counter, double_ptr, parameters));
+  if ((c == '[') || (c == '#') || ((c >= 'a') && (c <= 'z')) ||
+      ((c == '+' || c == '-') && c1 && !isdigit(c1) && c1 != '.'))
+    CHP(read_compiled_value(line, counter, double_ptr, parameters, true));
   else
+  {
     CHP(read_real_number(line, counter, double_ptr));
-
-  CHKS(std::isnan(*double_ptr),
-          _("Calculation resulted in 'not a number'"));
-  CHKS(std::isinf(*double_ptr),
-          _("Calculation resulted in 'infinity'"));
-
-  return INTERP_OK;
-}
-
-/****************************************************************************/
-
-/*! read_rest_bop1
-
-Returned Value: int
-  If any of the following functions returns an error code,
-  this returns that code.
-     execute_binary1
-     read_real_value
-     read_operation
-  Otherwise, it returns INTERP_OK.
-
-Side effects:
-   The value argument is set to the value of the expression.
-   The counter is reset to point to the first character after the real
-   expression.
-
-Called by:
-  read_real_expression
-  read_rest_bop2
-
-The value argument has a value in it when this is called. This repeatedly
-gets the next_value and the next_operation, performs the last_operation
-on the value and the next_value and resets the last_operation to the
-next_operation. Observe that both the value and the last_operation
-are passed back to the caller.
-
-This is commented out since it is not used in the uncommented version
-of read_real_expression. It has been tested.
-
-*/
-
-#ifdef UNDEFINED
-int Interp::read_rest_bop1(char *line,   //!< string: line of RS274/NGC code being processed
-                          int *counter, //!< pointer to a counter for position on the line 
-                          double *value,        //!< pointer to double to be calculated            
-                          int *last_operation,  //!< last operation read, reset to next operation  
-                          double *parameters)   //!< array of system parameters                    
-{
-  static char name[] = "read_rest_bop1";
-  double next_value;
-  int next_operation;
-  int status;
-
-  for (;;) {
-    CHP(read_real_value(line, counter, &next_value, parameters));
-    CHP(read_operation(line, counter, &next_operation));
-    CHP(execute_binary1(value, *last_operation, &next_value));
-    *last_operation = next_operation;
-    if (next_operation >= AND2) /* next op is a bop2 or right bracket */
-      break;
+    CHKS(std::isnan(*double_ptr),
+            _("Calculation resulted in 'not a number'"));
+    CHKS(std::isinf(*double_ptr),
+            _("Calculation resulted in 'infinity'"));
   }
-  return INTERP_OK;
-}
-#endif
-
-/****************************************************************************/
-
-/*! read_rest_bop2
-
-Returned Value: int
-  If any of the following functions returns an error code,
-  this returns that code.
-     execute_binary2
-     read_real_value
-     read_operation
-     read_rest_bop1
-  Otherwise, it returns INTERP_OK.
-
-Side effects:
-   The value argument is set to the value of the expression.
-   The counter is reset to point to the first character after the real
-   expression.
 
-Called by:  read_real_expression
-
-The value argument has a value in it when this is called. This repeatedly
-gets the next_value and the next_operation, performs the last_operation
-on the value and the next_value and resets the last_operation to the
-next_operation. If the next_operation is ever a bop1 read_rest_bop1 is
-called to set the next_value.
-
-This is commented out since it is not used in the uncommented version
-of read_real_expression. It has been tested.
-
-*/
-
-#ifdef UNDEFINED
-int Interp::read_rest_bop2(char *line,   //!< string: line of RS274/NGC code being processed
-                          int *counter, //!< pointer to a counter for position on the line 
-                          double *value,        //!< pointer to double to be calculated            
-                          int last_operation,   //!< last operation read                           
-                          double *parameters)   //!< array of system parameters                    
-{
-  static char name[] = "read_rest_bop2";
-  double next_value;
-  int next_operation;
-  int status;
-
-  for (;; last_operation = next_operation) {
-    CHP(read_real_value(line, counter, &next_value, parameters));
-    CHP(read_operation(line, counter, &next_operation));
-    if (next_operation < AND2) {        /* next operation is a bop1 */
-      CHP(read_rest_bop1(line, counter, &next_value,
-                         &next_operation, parameters));
-    }
-    CHP(execute_binary2(value, last_operation, &next_value));
-    if (next_operation == RIGHT_BRACKET)
-      break;
-  }
   return INTERP_OK;
 }
-#endif
 
 /****************************************************************************/
 
@@ -3121,37 +2754,49 @@ int Interp::read_text(
 {
   int index;
 
+  _setup.cached = NULL;
   if (command == NULL) {
-    if (fgets(raw_line, LINELEN, inport) == NULL) {
-      if(_setup.skipping_to_sub)
-      {
-        ERS(_("EOF in file:%s seeking o-word: o<%s> from line: %d"),
-                 _setup.filename,
-                 _setup.skipping_to_sub,
-                 _setup.skipping_start);
-      }
-      if (_setup.percent_flag)
-      {
-        ERS(NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN);
+    long offset = text_tell(inport);
+    cached_line *cl = find_cached_line(inport, offset);
+    if (cl != NULL) {
+      _setup.sequence_number++;
+      strcpy(raw_line, cl->raw_text.c_str());
+      strcpy(line, cl->text.c_str());
+      _setup.cached = cl;
+    } else {
+      if (text_gets(raw_line, LINELEN, inport) == NULL) {
+        int err = text_error(inport);
+        CHKS(err != 0, NCE_FILE_READ_ERROR, _setup.filename, strerror(err));
+        if(_setup.skipping_to_sub)
+        {
+          ERS(_("EOF in file:%s seeking o-word: o<%s> from line: %d"),
+                   _setup.filename,
+                   _setup.skipping_to_sub,
+                   _setup.skipping_start);
+        }
+        if (_setup.percent_flag)
+        {
+          ERS(NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN);
+        }
+        else
+        {
+          ERS(NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN_OR_PROGRAM_END);
+        }
       }
-      else
-      {
-        ERS(NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN_OR_PROGRAM_END);
+      _setup.sequence_number++;   /* moved from version1, was outside if */
+      if (strlen(raw_line) == (LINELEN - 1)) { // line is too long. need to finish reading the line to recover
+        text_skip_line(inport);
+        ERS(NCE_COMMAND_TOO_LONG);
       }
-    }
-    _setup.sequence_number++;   /* moved from version1, was outside if */
-    if (strlen(raw_line) == (LINELEN - 1)) { // line is too long. need to finish reading the line to recover
-      for (; fgetc(inport) != '\n' && !feof(inport) ;) {
+      for (index = (strlen(raw_line) - 1);        // index set on last char
+           (index >= 0) && (isspace(raw_line[index]));
+           index--) { // remove space at end of raw_line, especially CR & LF
+        raw_line[index] = 0;
       }
-      ERS(NCE_COMMAND_TOO_LONG);
-    }
-    for (index = (strlen(raw_line) - 1);        // index set on last char
-         (index >= 0) && (isspace(raw_line[index]));
-         index--) { // remove space at end of raw_line, especially CR & LF
-      raw_line[index] = 0;
+      strcpy(line, raw_line);
+      CHP(close_and_downcase(line));
+      _setup.cached = cache_line(inport, offset, raw_line, line);
     }
-    strcpy(line, raw_line);
-    CHP(close_and_downcase(line));
     if ((line[0] == '%') && (line[1] == 0) && (_setup.percent_flag)) {
         FINISH();
         return INTERP_ENDFILE;
@@ -3173,61 +2818,6 @@ int Interp::read_text(
   return INTERP_OK;
 }
 
-/****************************************************************************/
-
-/*! read_unary
-
-Returned Value: int
-   If any of the following functions returns an error code,
-   this returns that code.
-     execute_unary
-     read_atan
-     read_operation_unary
-     read_real_expression
-   If any of the following errors occur, this returns the error code shown.
-   Otherwise, it returns INTERP_OK.
-   1. the name of the unary operation is not followed by a left bracket:
-      NCE_LEFT_BRACKET_MISSING_AFTER_UNARY_OPERATION_NAME
-
-Side effects:
-   The value read from the line is put into what double_ptr points at.
-   The counter is reset to point to the first character after the
-   characters which make up the value.
-
-Called by:  read_real_value
-
-This attempts to read the value of a unary operation out of the line,
-starting at the index given by the counter. The atan operation is
-handled specially because it is followed by two arguments.
-
-*/
-
-int Interp::read_unary(char *line,       //!< string: line of RS274/NGC code being processed
-                      int *counter,     //!< pointer to a counter for position on the line 
-                      double *double_ptr,       //!< pointer to double to be read                  
-                      double *parameters)       //!< array of system parameters                    
-{
-  int operation;
-
-  CHP(read_operation_unary(line, counter, &operation));
-  CHKS((line[*counter] != '['),
-      NCE_LEFT_BRACKET_MISSING_AFTER_UNARY_OPERATION_NAME);
-
-  if (operation == EXISTS)
-  {
-      CHP(read_bracketed_parameter(line, counter, double_ptr, parameters, true));
-      return INTERP_OK;
-  }
-
-  CHP(read_real_expression(line, counter, double_ptr, parameters));
-
-  if (operation == ATAN)
-    CHP(read_atan(line, counter, double_ptr, parameters));
-  else
-    CHP(execute_unary(double_ptr, operation));
-  return INTERP_OK;
-}
-
 int Interp::read_u(char *line,   //!< string: line of RS274/NGC code being processed
                   int *counter, //!< pointer to a counter for position on the line 
                   block_pointer block,  //!< pointer to a block being filled from the line 
@@ -62,6 +62,8 @@ setup::setup() :
     remap_level(0),
     blocktext{},
     control_mode(0),
+    motion_tolerance(-1),
+    naivecam_tolerance(-1),
     current_pocket(0),
 
     current_x (0.0),
@@ -151,6 +153,21 @@ setup::setup() :
     call_level(0),
     sub_context{},
     call_state(0),
+    cache_file(NULL),
+    cached(NULL),
+    cache_fp(NULL),
+    cache_next(-1),
+    cached_lines(0),
+    text_fp(NULL),
+    text_pos(0),
+    text_start(0),
+    text_fill(0),
+    text_errno(0),
+    text_window{},
+    checkpoint_interval(0),
+    checkpoints(),
+    checkpoint_run(NULL),
+    checkpoint_reached(-1),
     adaptive_feed(0),
     feed_hold(0),
     loggingLevel(0),
@@ -0,0 +1,172 @@
+/********************************************************************
+* Description: interp_text.cc
+*
+*   Reading the lines of program files.
+*
+*   Program files are read with pread() into a window of the file the
+*   interpreter keeps, rather than with fgets() on their FILE. Where
+*   reading continues is kept with the window, so finding the offset of
+*   a line and going back to it, which loops, calls and returns do all
+*   the time, are plain assignments, and a line is found in the window
+*   with memchr(). Large files are read sequentially, a window at a time,
+*   and a seek only reads the window it lands in.
+*
+*   Only the file read last is read through the window. Its FILE is not
+*   moved while that is so, and is closed with text_close(). Files that
+*   are not regular files are read with stdio.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+// Reads fp through the window from now on, unless it can not be.
+// Returns whether it is.
+bool Interp::text_bind(FILE *fp)
+{
+    struct stat st;
+
+    if (fp == _setup.text_fp)
+	return true;
+    if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode))
+	return false;
+    _setup.text_fp = fp;
+    _setup.text_pos = ftell(fp);
+    _setup.text_start = 0;
+    _setup.text_fill = 0;
+    _setup.text_errno = 0;
+    return true;
+}
+
+// Reads the window holding the position reading continues at. Returns
+// false at the end of the file, or if it can not be read, with
+// text_errno set.
+bool Interp::text_fill()
+{
+    ssize_t n;
+
+    do {
+	n = pread(fileno(_setup.text_fp), _setup.text_window,
+		  TEXT_WINDOW, _setup.text_pos);
+    } while (n < 0 && errno == EINTR);
+    _setup.text_start = _setup.text_pos;
+    _setup.text_fill = (n > 0) ? n : 0;
+    _setup.text_errno = (n < 0) ? errno : 0;
+    return (n > 0);
+}
+
+// fgets()
+char *Interp::text_gets(char *buf, int size, FILE *fp)
+{
+    int n = 0;
+
+    if (!text_bind(fp))
+	return fgets(buf, size, fp);
+
+    while (n < size - 1) {
+	long end = _setup.text_start + _setup.text_fill;
+
+	if (_setup.text_pos < _setup.text_start || _setup.text_pos >= end) {
+	    if (!text_fill())
+		break;
+	    end = _setup.text_start + _setup.text_fill;
+	}
+	const char *p = _setup.text_window + (_setup.text_pos - _setup.text_start);
+	long len = end - _setup.text_pos;
+	if (len > size - 1 - n)
+	    len = size - 1 - n;
+	const char *nl = (const char *) memchr(p, '\n', len);
+	if (nl)
+	    len = nl - p + 1;
+	memcpy(buf + n, p, len);
+	n += len;
+	_setup.text_pos += len;
+	if (nl)
+	    break;
+    }
+    if (n == 0)
+	return NULL;
+    buf[n] = 0;
+    return buf;
+}
+
+// Skips the rest of the line, like reading up to a newline with fgetc().
+void Interp::text_skip_line(FILE *fp)
+{
+    if (!text_bind(fp)) {
+	for (; fgetc(fp) != '\n' && !feof(fp);) {
+	}
+	return;
+    }
+    for (;;) {
+	long end = _setup.text_start + _setup.text_fill;
+
+	if (_setup.text_pos < _setup.text_start || _setup.text_pos >= end) {
+	    if (!text_fill())
+		return;
+	    end = _setup.text_start + _setup.text_fill;
+	}
+	const char *p = _setup.text_window + (_setup.text_pos - _setup.text_start);
+	const char *nl = (const char *) memchr(p, '\n', end - _setup.text_pos);
+	if (nl) {
+	    _setup.text_pos += nl - p + 1;
+	    return;
+	}
+	_setup.text_pos = end;
+    }
+}
+
+// ferror(), as the errno of the read that failed. Tells a NULL from
+// text_gets() that is an error from the end of the file.
+int Interp::text_error(FILE *fp)
+{
+    if (fp == _setup.text_fp)
+	return _setup.text_errno;
+    if (!ferror(fp))
+	return 0;
+    return errno ? errno : EIO;
+}
+
+// ftell()
+long Interp::text_tell(FILE *fp)
+{
+    if (fp == _setup.text_fp)
+	return _setup.text_pos;
+    return ftell(fp);
+}
+
+// fseek() to offset
+void Interp::text_seek(FILE *fp, long offset)
+{
+    if (fp == _setup.text_fp)
+	_setup.text_pos = offset;
+    else
+	fseek(fp, offset, SEEK_SET);
+}
+
+// fclose(). The next file opened may get the same FILE, so the line
+// cache must not take it for this one.
+void Interp::text_close(FILE *fp)
+{
+    if (fp == _setup.text_fp)
+	_setup.text_fp = NULL;
+    if (fp == _setup.cache_fp) {
+	_setup.cache_file = NULL;
+	_setup.cache_fp = NULL;
+	_setup.cache_next = -1;
+    }
+    fclose(fp);
+}
@@ -116,6 +116,9 @@ public:
  int line() { return sequence_number(); }
  int call_level();
 
+// resume the program just opened at the checkpoint nearest before line
+ int restore_checkpoint(int line);
+
  char *command(char *buf, size_t len) { line_text(buf, len); return buf; }
 
  char *file(char *buf, size_t len) { file_name(buf, len); return buf; }
@@ -131,6 +134,15 @@ public:
  int find_named_param(const char *nameBuf, int *status, double *value);
  int store_named_param(setup_pointer settings,const char *nameBuf, double value, int override_readonly = 0);
  int add_named_param(const char *nameBuf, int attr = 0);
+ int named_param_value(const char *nameBuf, parameter_pointer pv,
+                       int *status, double *value);
+ int store_named_value(const char *nameBuf, int level, parameter_pointer pv,
+                       double value, int override_readonly);
+ int named_slot(const char *name);
+ parameter_pointer slot_param(int slot);
+ int find_named_slot(int slot, int *status, double *value);
+ int store_named_slot(int slot, double value);
+ int add_named_slot(int slot);
  int fetch_ini_param( const char *nameBuf, int *status, double *value);
  int fetch_hal_param( const char *nameBuf, int *status, double *value);
 
@@ -397,8 +409,6 @@ public:
  int _read(const char *command);
  int read_a(char *line, int *counter, block_pointer block,
                   double *parameters);
- int read_atan(char *line, int *counter, double *double_ptr,
-                     double *parameters);
  int read_atsign(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_b(char *line, int *counter, block_pointer block,
@@ -460,16 +470,11 @@ int read_dollar(char *line, int *counter, block_pointer block,
  int gen_g_codes(int *current, int *saved, std::string &cmd);
  int gen_m_codes(int *current, int *saved, std::string &cmd);
  int read_name(char *line, int *counter, char *nameBuf);
- int read_named_parameter(char *line, int *counter, double *double_ptr,
-                          double *parameters, bool check_exists);
- int read_parameter(char *line, int *counter, double *double_ptr,
-                          double *parameters, bool check_exists);
+ int read_name_slot(char *line, int *counter, int *slot);
  int read_parameter_setting(char *line, int *counter,
                                   block_pointer block, double *parameters);
- int read_bracketed_parameter(char *line, int *counter, double *double_ptr,
-                          double *parameters, bool check_exists);
  int read_named_parameter_setting(char *line, int *counter,
-                                  char **param, double *parameters);
+                                  int *slot, double *parameters);
  int read_q(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_r(char *line, int *counter, block_pointer block,
@@ -479,14 +484,43 @@ int read_dollar(char *line, int *counter, block_pointer block,
  int read_real_number(char *line, int *counter, double *double_ptr);
  int read_real_value(char *line, int *counter, double *double_ptr,
                            double *parameters);
+ int read_compiled_value(char *line, int *counter, double *double_ptr,
+                         double *parameters, bool checked);
+ int compile_real_value(char *line, int *counter, expr_program *prog);
+ int compile_real_expression(char *line, int *counter, expr_program *prog);
+ int compile_parameter(char *line, int *counter, expr_program *prog,
+                       bool check_exists);
+ int compile_unary(char *line, int *counter, expr_program *prog);
+ int emit_expr(expr_program *prog, int op, int arg, double value);
+ int execute_expression(const expr_insn *code, int length, double *value,
+                        double *parameters);
  int read_s(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_t(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_text(const char *command, FILE * inport, char *raw_line,
                      char *line, int *length);
- int read_unary(char *line, int *counter, double *double_ptr,
-                      double *parameters);
+ cached_file *cache_file_for(FILE *inport);
+ cached_line *find_cached_line(FILE *inport, long offset);
+ cached_line *cache_line(FILE *inport, long offset, const char *raw_line,
+                         const char *line);
+ int read_cached_items(block_pointer block, char *line,
+                       setup_pointer settings);
+ void clear_line_cache();
+ bool text_bind(FILE *fp);
+ bool text_fill();
+ char *text_gets(char *buf, int size, FILE *fp);
+ void text_skip_line(FILE *fp);
+ int text_error(FILE *fp);
+ long text_tell(FILE *fp);
+ void text_seek(FILE *fp, long offset);
+ void text_close(FILE *fp);
+ bool sub_index_current();
+ void build_sub_index();
+ sub_file *indexed_sub_file(const char *basename, const char *path);
+ void save_checkpoint(checkpoint *cp, checkpoint_file *cf);
+ void take_checkpoint();
+ void open_checkpoints();
  int read_u(char *line, int *counter, block_pointer block,
                   double *parameters);
  int read_v(char *line, int *counter, block_pointer block,
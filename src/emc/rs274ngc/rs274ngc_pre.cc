@@ -243,10 +243,11 @@ int Interp::close()
     }
 
   if (_setup.file_pointer != NULL) {
-    fclose(_setup.file_pointer);
+    text_close(_setup.file_pointer);
     _setup.file_pointer = NULL;
     _setup.percent_flag = false;
   }
+  clear_line_cache();
   reset();
 
   return INTERP_OK;
@@ -354,6 +355,8 @@ int Interp::_execute(const char *command)
   {  // copy parameter settings from parameter buffer into parameter table
     _setup.parameters[_setup.parameter_numbers[n]]
           = _setup.parameter_values[n];
+    if (_setup.checkpoint_run)
+      _setup.checkpoint_run->parameters_set[_setup.parameter_numbers[n]] = true;
   }
 
   // logDebug("_setup.named_parameter_occurrence = %d",
@@ -361,9 +364,9 @@ int Interp::_execute(const char *command)
   for (n = 0; n < _setup.named_parameter_occurrence; n++)
   {  // copy parameter settings from parameter buffer into parameter table
 
-      logDebug("storing param:|%s|", _setup.named_parameters[n]);
-      CHP(store_named_param(&_setup, _setup.named_parameters[n],
-                          _setup.named_parameter_values[n]));
+      logDebug("storing param:|%s|", _setup.slot_names[_setup.named_parameters[n]]);
+      CHP(store_named_slot(_setup.named_parameters[n],
+                           _setup.named_parameter_values[n]));
   }
   _setup.named_parameter_occurrence = 0;
 
@@ -975,6 +978,7 @@ int Interp::init()
           {
               logDebug("SUBROUTINE_PATH not found");
           }
+          build_sub_index();
           // subroutine to execute on aborts - for instance to retract
           // toolchange HAL pins
           if (NULL != (inistring = inifile.Find("ON_ABORT_COMMAND", "RS274NGC"))) {
@@ -1041,6 +1045,12 @@ int Interp::init()
 	  logDebug("init:  DISABLE_FANUC_STYLE_SUB = %d",
 		   _setup.disable_fanuc_style_sub);
 
+	  // lines of the main program between checkpoints, see
+	  // interp_checkpoint.cc
+	  inifile.Find(&_setup.checkpoint_interval,
+		       "CHECKPOINT_INTERVAL",
+		       "RS274NGC");
+
           // close it
           inifile.Close();
       }
@@ -1383,11 +1393,14 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
   CHKS((_setup.file_pointer == NULL), NCE_UNABLE_TO_OPEN_FILE, filename);
   line = _setup.linetext;
   for (index = -1; index == -1;) {      /* skip blank lines */
-    CHKS((fgets(line, LINELEN, _setup.file_pointer) ==
-         NULL), NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN);
+    if (text_gets(line, LINELEN, _setup.file_pointer) == NULL) {
+      int err = text_error(_setup.file_pointer);
+      CHKS(err != 0, NCE_FILE_READ_ERROR, filename, strerror(err));
+      ERS(NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN);
+    }
     length = strlen(line);
     if (length == (LINELEN - 1)) {   // line is too long. need to finish reading the line to recover
-      for (; fgetc(_setup.file_pointer) != '\n' && !feof(_setup.file_pointer););
+      text_skip_line(_setup.file_pointer);
       ERS(NCE_COMMAND_TOO_LONG);
     }
     for (index = (length - 1);  // index set on last char
@@ -1400,16 +1413,19 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
       _setup.sequence_number = 1;       // We have already read the first line
       // and we are not going back to it.
     } else {
-      fseek(_setup.file_pointer, 0, SEEK_SET);
+      text_seek(_setup.file_pointer, 0);
       _setup.percent_flag = false;
       _setup.sequence_number = 0;       // Going back to line 0
     }
   } else {
-    fseek(_setup.file_pointer, 0, SEEK_SET);
+    text_seek(_setup.file_pointer, 0);
     _setup.percent_flag = false;
     _setup.sequence_number = 0; // Going back to line 0
   }
   strcpy(_setup.filename, filename);
+  _setup.checkpoint_run = NULL;
+  _setup.checkpoint_reached = -1;
+  open_checkpoints();
   reset();
   return INTERP_OK;
 }
@@ -1592,9 +1608,12 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
   _setup.parameters[5427] = _setup.v_current;
   _setup.parameters[5428] = _setup.w_current;
 
+  if ((command == NULL) && (_setup.checkpoint_interval > 0))
+      take_checkpoint();
+
   if(_setup.file_pointer)
   {
-      EXECUTING_BLOCK(_setup).offset = ftell(_setup.file_pointer);
+      EXECUTING_BLOCK(_setup).offset = text_tell(_setup.file_pointer);
   }
 
   read_status =
@@ -1679,13 +1698,13 @@ int Interp::unwind_call(int status, const char *file, int line, const char *func
 	// needed to make sure this works in rs274 -n 0 (continue on error) mode
 	if (sub->filename && sub->filename[0]) {
 	    if(0 != strcmp(_setup.filename, sub->filename)) {
-		fclose(_setup.file_pointer);
+		text_close(_setup.file_pointer);
 		_setup.file_pointer = fopen(sub->filename, "r");
 		logDebug("unwind_call: reopening '%s' at %ld",
 			 sub->filename, sub->position);
 		strcpy(_setup.filename, sub->filename);
 	    }
-	    fseek(_setup.file_pointer, sub->position, SEEK_SET);
+	    text_seek(_setup.file_pointer, sub->position);
 	}
 	_setup.sequence_number = sub->sequence_number;
 	logDebug("unwind_call: setting sequence number=%d from frame %d",
@@ -2529,12 +2548,42 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
     // find subroutine by search: program_prefix, subroutines, wizard_root
     // use first file found
 
+    // the program_prefix and subroutines places are indexed
+    newFP = NULL;
+    bool indexed = false;
+    if (strchr(basename, '/') == NULL) {
+	if (!sub_index_current())
+	    build_sub_index();
+	sub_file_map::iterator it = settings->sub_files.find(basename);
+	if (it == settings->sub_files.end()) {
+	    indexed = true;
+	} else {
+	    sub_file &sf = it->second;
+	    struct stat st;
+
+	    strcpy(newFileName, sf.path.c_str());
+	    newFP = fopen(newFileName, "r");
+	    if (newFP && fstat(fileno(newFP), &st) == 0) {
+		indexed = true;
+		if (sf.size != st.st_size || sf.mtime != st.st_mtim.tv_sec ||
+		    sf.mtime_nsec != st.st_mtim.tv_nsec) {
+		    sf.size = st.st_size;
+		    sf.mtime = st.st_mtim.tv_sec;
+		    sf.mtime_nsec = st.st_mtim.tv_nsec;
+		    sf.offset = -1;
+		}
+	    }
+	}
+    }
+
     // first look in the program_prefix place
-    sprintf(newFileName, "%s/%s", settings->program_prefix, tmpFileName);
-    newFP = fopen(newFileName, "r");
+    if (!newFP && !indexed) {
+	sprintf(newFileName, "%s/%s", settings->program_prefix, tmpFileName);
+	newFP = fopen(newFileName, "r");
+    }
 
     // then look in the subroutines place
-    if (!newFP) {
+    if (!newFP && !indexed) {
 	for (dct = 0; dct < MAX_SUB_DIRS; dct++) {
 	    if (!settings->subroutines[dct])
 		continue;
@@ -2577,7 +2626,8 @@ const char *strstore(const char *s)
 
 context_struct::context_struct()
 : position(0), sequence_number(0), filename(""), subName(""),
-  m98_loop_counter(-1), context_status(0), call_type(0)
+  m98_loop_counter(-1), named_slots_removals(0), context_status(0),
+  call_type(0)
 {
     memset(saved_params, 0, sizeof(saved_params));
     memset(saved_g_codes, 0, sizeof(saved_g_codes));
@@ -80,6 +80,7 @@
 #define NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN _("File ended with no percent sign")
 #define NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN_OR_PROGRAM_END _("File ended with no percent sign or program end")
 #define NCE_FILE_NAME_TOO_LONG _("File name too long")
+#define NCE_FILE_READ_ERROR _("Error reading file <%s>: %s")
 #define NCE_G_CODE_OUT_OF_RANGE _("G code out of range")
 #define NCE_I_WORD_GIVEN_FOR_ARC_IN_YZ_PLANE _("I word given for arc in yz plane")
 #define NCE_I_WORD_MISSING_WITH_G87 _("I word missing with g87")
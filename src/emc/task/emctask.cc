@@ -637,6 +637,20 @@ int emcTaskPlanReset()
     return retval;
 }
 
+int emcTaskPlanRestoreCheckpoint(int line)
+{
+    int retval = interp.restore_checkpoint(line);
+    if (retval > INTERP_MIN_ERROR) {
+	print_interp_error(retval);
+    }
+
+    if (emc_debug & EMC_DEBUG_INTERP) {
+        rcs_print("emcTaskPlanRestoreCheckpoint(%d) returned %d\n", line, retval);
+    }
+
+    return retval;
+}
+
 int emcTaskPlanLine()
 {
     int retval = interp.line();
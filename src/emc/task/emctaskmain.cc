@@ -67,12 +67,14 @@ fpu_control_t __fpu_control = _FPU_IEEE & ~(_FPU_MASK_IM | _FPU_MASK_ZM | _FPU_M
 #endif
 
 #include "rcs.hh"		// NML classes, nmlErrorFormat()
+#include "nml.hh"		// nmlWaitAny()
 #include "emc.hh"		// EMC NML
 #include "emc_nml.hh"
 #include "canon.hh"		// CANON_TOOL_TABLE stuff
 #include "inifile.hh"		// INIFILE
 #include "interpl.hh"		// NML_INTERP_LIST, interp_list
 #include "emcglb.h"		// EMC_INIFILE,NMLFILE, EMC_TASK_CYCLE_TIME
+#include "emccfg.h"		// DEFAULT_EMC_TASK_IDLE_CYCLE_TIME
 #include "interp_return.hh"	// public interpreter return values
 #include "interp_internal.hh"	// interpreter private definitions
 #include "rcs_print.hh"
@@ -106,8 +108,24 @@ static RCS_CMD_MSG *emcCommand = 0;
 // global EMC status
 EMC_STAT *emcStatus = 0;
 
-// timer stuff
-static RCS_TIMER *timer = 0;
+// what was last written to emcStatusBuffer, see emcTaskWriteStatus()
+static EMC_STAT *emcStatusWritten = 0;
+static double emcStatusWriteTime = 0.0;
+
+// when the next cycle is due, and when the last one was run, see
+// emcTaskWait()
+static double taskNextCycle = 0.0;
+static double taskLastCycle = 0.0;
+
+// how long task runs no cycle at all while it is idle, from the ini file
+// [TASK] IDLE_CYCLE_TIME
+static double emc_task_idle_cycle_time = DEFAULT_EMC_TASK_IDLE_CYCLE_TIME;
+
+// how long task leaves changed feedback unreported while it is idle, the
+// period at which user interfaces poll, from the ini file [DISPLAY]
+// CYCLE_TIME
+static double emc_task_feedback_cycle_time =
+    DEFAULT_EMC_TASK_FEEDBACK_CYCLE_TIME;
 
 // flag signifying that ini file [TASK] CYCLE_TIME is <= 0.0, so
 // we should not delay at all between cycles. This means also that
@@ -127,6 +145,9 @@ static double EMC_TASK_CYCLE_TIME_ORIG = 0.0;
 // delay counter
 static double taskExecDelayTimeout = 0.0;
 
+// moves issued in this cycle, see emcTaskExecuteMore()
+static int taskCycleMoves = 0;
+
 // emcTaskIssueCommand issues command immediately
 static int emcTaskIssueCommand(NMLmsg * cmd);
 
@@ -501,6 +522,9 @@ void readahead_reading(void)
 
 		if (interp_list.len() <= emc_task_interp_max_len) {
                     int count = 0;
+                    // leave time in the cycle to send what was read to motion
+                    double read_until = emcTaskNoDelay ? DBL_MAX :
+                        etime() + emc_task_cycle_time / 2;
 interpret_again:
 		    if (emcTaskPlanIsWait()) {
 			// delay reading of next line until all is done
@@ -624,7 +648,12 @@ interpret_again:
                             if (count++ < emc_task_interp_max_len
                                     && emcStatus->task.interpState == EMC_TASK_INTERP_READING
                                     && interp_list.len() <= emc_task_interp_max_len * 2/3) {
-                                goto interpret_again;
+                                if (etime() < read_until) {
+                                    goto interpret_again;
+                                }
+                                // out of time, read on in the next cycle
+                                // without waiting for it
+                                emcTaskEager = 1;
                             }
 
 			}	// else read was OK, so execute
@@ -1820,6 +1849,7 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
 	emcTrajLinearMoveMsg = (EMC_TRAJ_LINEAR_MOVE *) cmd;
+	taskCycleMoves++;
         retval = emcTrajLinearMove(emcTrajLinearMoveMsg->end,
                                    emcTrajLinearMoveMsg->type, emcTrajLinearMoveMsg->vel,
                                    emcTrajLinearMoveMsg->ini_maxvel, emcTrajLinearMoveMsg->acc,
@@ -1828,6 +1858,7 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	emcTrajCircularMoveMsg = (EMC_TRAJ_CIRCULAR_MOVE *) cmd;
+	taskCycleMoves++;
         retval = emcTrajCircularMove(emcTrajCircularMoveMsg->end,
                 emcTrajCircularMoveMsg->center, emcTrajCircularMoveMsg->normal,
                 emcTrajCircularMoveMsg->turn, emcTrajCircularMoveMsg->type,
@@ -2281,6 +2312,15 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 	}
 	run_msg = (EMC_TASK_PLAN_RUN *) cmd;
 	programStartLine = run_msg->line;
+	if (programStartLine > 0) {
+	    // what restoring does is thrown away like the lines skipped
+	    retval = emcTaskPlanRestoreCheckpoint(programStartLine);
+	    interp_list.clear();
+	    if (retval > INTERP_MIN_ERROR) {
+		retval = -1;
+		break;
+	    }
+	}
 	emcStatus->task.interpState = EMC_TASK_INTERP_READING;
 	emcStatus->task.task_paused = 0;
 	retval = 0;
@@ -2960,10 +3000,6 @@ static int emctask_startup()
 	rcs_print_error("can't get emcError buffer\n");
 	return -1;
     }
-    // get the timer
-    if (!emcTaskNoDelay) {
-	timer = new RCS_TIMER(emc_task_cycle_time, "", "");
-    }
     // initialize the subsystems
 
     // IO first
@@ -3089,11 +3125,6 @@ static int emctask_shutdown(void)
 	emcMotionHalt();
 	emcIoHalt();
     }
-    // delete the timer
-    if (0 != timer) {
-	delete timer;
-	timer = 0;
-    }
     // delete the NML channels
 
     if (0 != emcErrorBuffer) {
@@ -3117,6 +3148,11 @@ static int emctask_shutdown(void)
 	delete emcStatus;
 	emcStatus = 0;
     }
+
+    if (0 != emcStatusWritten) {
+	delete emcStatusWritten;
+	emcStatusWritten = 0;
+    }
     return 0;
 }
 
@@ -3220,6 +3256,26 @@ static int iniLoad(const char *filename)
 		  filename, emc_task_cycle_time);
     }
 
+    if (NULL != (inistring = inifile.Find("IDLE_CYCLE_TIME", "TASK"))) {
+	if (1 != sscanf(inistring, "%lf", &emc_task_idle_cycle_time)) {
+	    emc_task_idle_cycle_time = DEFAULT_EMC_TASK_IDLE_CYCLE_TIME;
+	    rcs_print
+		("invalid [TASK] IDLE_CYCLE_TIME in %s (%s); using default %f\n",
+		 filename, inistring, emc_task_idle_cycle_time);
+	}
+    }
+
+    // seconds for most user interfaces, milliseconds for gscreen and
+    // gmoccapy
+    if (NULL != (inistring = inifile.Find("CYCLE_TIME", "DISPLAY"))) {
+	double display_cycle_time;
+	if (1 == sscanf(inistring, "%lf", &display_cycle_time) &&
+	    display_cycle_time > 0.0) {
+	    emc_task_feedback_cycle_time = display_cycle_time >= 1.0 ?
+		display_cycle_time / 1000.0 : display_cycle_time;
+	}
+    }
+
 
     if (NULL != (inistring = inifile.Find("NO_FORCE_HOMING", "TRAJ"))) {
 	if (1 == sscanf(inistring, "%d", &no_force_homing)) {
@@ -3256,6 +3312,152 @@ static int iniLoad(const char *filename)
     return 0;
 }
 
+/*
+  emcTaskExecuteMore() returns non-zero if emcTaskExecute() should run
+  again in this cycle, because it is issuing a run of moves. They go to
+  motion together when the status is next updated; at most
+  EMCMOT_MAX_SEGMENTS per cycle, which fit in the queue even though its
+  status is not updated between them. Getting the next command and its
+  preconditions only depend on the command, so running ahead of the
+  status is fine until something other than a move comes up.
+  */
+static int emcTaskExecuteMore(void)
+{
+    if (taskCycleMoves == 0 || taskCycleMoves >= EMCMOT_MAX_SEGMENTS ||
+	stepping || emcStatus->motion.traj.queueFull) {
+	return 0;
+    }
+    switch (emcStatus->task.execState) {
+    case EMC_TASK_EXEC_DONE:
+	break;
+    case EMC_TASK_EXEC_WAITING_FOR_IO:
+	if (emcStatus->io.status != RCS_DONE) {
+	    return 0;
+	}
+	break;
+    default:
+	return 0;
+    }
+    if (0 == emcTaskCommand) {
+	return interp_list.len() > 0;
+    }
+    return emcTaskCommand->type == EMC_TRAJ_LINEAR_MOVE_TYPE ||
+	emcTaskCommand->type == EMC_TRAJ_CIRCULAR_MOVE_TYPE;
+}
+
+/*
+  emcTaskSectionChanged() compares a section of emcStatus with the same
+  section of emcStatusWritten, and copies it over if it differs.
+  */
+static int emcTaskSectionChanged(void *section, size_t size)
+{
+    char *written = (char *) emcStatusWritten +
+	((char *) section - (char *) emcStatus);
+
+    if (0 == memcmp(written, section, size)) {
+	return 0;
+    }
+    memcpy(written, section, size);
+    return 1;
+}
+
+/*
+  emcTaskWriteStatus() writes emcStatus to the status buffer if it
+  changed since it was last written, section by section, so readers
+  peeking it only see a new message when there is something new. The
+  heartbeats change every cycle and are left out, but the status is
+  still written every emc_task_idle_cycle_time to show they go on.
+  */
+static int emcTaskWriteStatus(void)
+{
+    int changed = 0;
+    double now = etime();
+
+    emcStatusWritten->task.heartbeat = emcStatus->task.heartbeat;
+    emcStatusWritten->motion.heartbeat = emcStatus->motion.heartbeat;
+    emcStatusWritten->io.heartbeat = emcStatus->io.heartbeat;
+    // the RCS_STAT_MSG members, up to the task section
+    changed |= emcTaskSectionChanged(emcStatus,
+	(char *) &emcStatus->task - (char *) emcStatus);
+    changed |= emcTaskSectionChanged(&emcStatus->task,
+	sizeof(emcStatus->task));
+    changed |= emcTaskSectionChanged(&emcStatus->motion,
+	sizeof(emcStatus->motion));
+    changed |= emcTaskSectionChanged(&emcStatus->io, sizeof(emcStatus->io));
+    changed |= emcTaskSectionChanged(&emcStatus->debug,
+	sizeof(emcStatus->debug));
+
+    if (!changed && now < emcStatusWriteTime + emc_task_idle_cycle_time) {
+	return 0;
+    }
+    emcStatusWriteTime = now;
+    return emcStatusBuffer->write(emcStatus);
+}
+
+/*
+  emcTaskWait() waits until the next cycle is due. A new command, or a
+  status write by iocontrol, starts a cycle at once; motion can not wake
+  task, so otherwise a cycle is run every emc_task_cycle_time. When idle,
+  cycles are only run if the motion status changed, and at least every
+  emc_task_idle_cycle_time. Feedback that changes on its own, like a
+  jittering encoder, runs one at most every emc_task_feedback_cycle_time,
+  which still keeps the positions user interfaces show current. Task is
+  not idle while commands are queued, as a queued command makes no new
+  notify once the one before it is read. Returns non-zero if any cycle
+  was skipped.
+  */
+static int emcTaskWait(int idle)
+{
+    NML *channels[2];
+    int n = 0;
+    int skipped = 0;
+    double now = etime();
+    double idle_end = now + emc_task_idle_cycle_time;
+    double feedback_end = taskLastCycle + emc_task_feedback_cycle_time;
+
+    if (idle && emcCommandBuffer->get_queue_length() > 0) {
+	idle = 0;
+    }
+
+    channels[n++] = emcCommandBuffer;
+    if (0 != (channels[n] = emcIoStatusChannel())) {
+	n++;
+    }
+    for (;;) {
+	if (now < taskNextCycle) {
+	    if (nmlWaitAny(channels, n, taskNextCycle - now) >= 0) {
+		taskLastCycle = etime();
+		return skipped;
+	    }
+	    now = etime();
+	    if (now < taskNextCycle) {
+		// woken early without a write, the channels have no notify
+		continue;
+	    }
+	}
+	taskNextCycle += emc_task_cycle_time;
+	if (taskNextCycle < now) {
+	    // overran, don't try to catch up
+	    taskNextCycle = now + emc_task_cycle_time;
+	}
+	if (!idle || now >= idle_end) {
+	    taskLastCycle = now;
+	    return skipped;
+	}
+	switch (emcMotionChanged()) {
+	case EMC_MOTION_FEEDBACK_CHANGED:
+	    if (now < feedback_end) {
+		break;
+	    }
+	    // fall through
+	case EMC_MOTION_CHANGED:
+	    taskLastCycle = now;
+	    return skipped;
+	}
+	skipped = 1;
+    }
+}
+
 /*
   syntax: a.out {-d -ini <inifile>} {-nml <nmlfile>} {-shm <key>}
   */
@@ -3314,6 +3516,7 @@ int main(int argc, char *argv[])
     // get our status data structure
     // moved up from emc_startup so we can expose it in Python right away
     emcStatus = new EMC_STAT;
+    emcStatusWritten = new EMC_STAT;
 
     // get the Python plugin going
 
@@ -3374,9 +3577,13 @@ int main(int argc, char *argv[])
 	if (0 != emcTaskPlan()) {
 	    taskPlanError = 1;
 	}
-	if (0 != emcTaskExecute()) {
-	    taskExecuteError = 1;
-	}
+	taskCycleMoves = 0;
+	do {
+	    if (0 != emcTaskExecute()) {
+		taskExecuteError = 1;
+		break;
+	    }
+	} while (emcTaskExecuteMore());
 	// update subordinate status
 
 	emcIoUpdate(&emcStatus->io);
@@ -3539,7 +3746,7 @@ int main(int argc, char *argv[])
 	// since emcStatus was passed to the WM init functions, it
 	// will be updated in the _update() functions above. There's
 	// no need to call the individual functions on all WM items.
-	emcStatusBuffer->write(emcStatus);
+	emcTaskWriteStatus();
 
 	// wait on timer cycle, if specified, or calculate actual
 	// interval if ini file says to run full out via
@@ -3561,8 +3768,9 @@ int main(int argc, char *argv[])
 
 	if ((emcTaskNoDelay) || (emcTaskEager)) {
 	    emcTaskEager = 0;
-	} else {
-	    timer->wait();
+	} else if (emcTaskWait(emcStatus->status == RCS_DONE)) {
+	    // time spent idle is not a latency excursion
+	    startTime = etime();
 	}
     }
     // end of while (! done)
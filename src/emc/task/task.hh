@@ -49,6 +49,8 @@ int emcTaskPlanPause();
 int emcTaskPlanResume();
 int emcTaskPlanClose();
 int emcTaskPlanReset();
+// Skips reading the lines before line a checkpoint of the program covers
+int emcTaskPlanRestoreCheckpoint(int line);
 
 int emcTaskPlanLine();
 int emcTaskPlanLevel();
@@ -56,5 +58,11 @@ int emcTaskPlanCommand(char *cmd);
 
 int emcTaskUpdate(EMC_TASK_STAT * stat);
 
+// Whether the motion status may have changed since emcMotionUpdate()
+enum { EMC_MOTION_CHANGED = 1, EMC_MOTION_FEEDBACK_CHANGED = 2 };
+int emcMotionChanged();
+// The toolSts channel, or 0 if IO is not done through iocontrol
+NML *emcIoStatusChannel();
+
 #endif
 
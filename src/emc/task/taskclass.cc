@@ -298,6 +298,7 @@ int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
 					   frontangle,  backangle,  orientation); }
 int emcToolSetNumber(int number) { return task_methods->emcToolSetNumber(number); }
 int emcIoUpdate(EMC_IO_STAT * stat) { return task_methods->emcIoUpdate(stat); }
+NML *emcIoStatusChannel() { return emcIoStatusBuffer; }
 int emcIoPluginCall(EMC_IO_PLUGIN_CALL *call_msg) { return task_methods->emcIoPluginCall(call_msg->len,
 											   call_msg->call); }
 static const char *instance_name = "task_instance";
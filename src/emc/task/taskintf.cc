@@ -32,6 +32,7 @@
 #include "inijoint.hh"
 #include "initraj.hh"
 #include "inihal.hh"
+#include "task.hh"		// emcMotionChanged()
 
 value_inihal_data old_inihal_data;
 
@@ -870,6 +871,16 @@ static emcmot_debug_t emcmotDebug;
 static char errorString[EMCMOT_ERROR_LEN];
 static int new_config = 0;
 
+/*
+  the emcmot status and the configuration the EMC_MOTION_STAT sections
+  were last built from by emcMotionUpdate(), which only rebuilds the
+  sections whose part of them changed since
+ */
+static emcmot_status_t builtStatus;
+static struct TrajConfig_t builtTrajConfig;
+static struct JointConfig_t builtJointConfig[EMCMOT_MAX_JOINTS];
+static int motionStatBuilt = 0;
+
 /*! \todo FIXME - debugging - uncomment the following line to log changes in
    JOINT_FLAG */
 // #define WATCH_FLAGS 1
@@ -1383,7 +1394,8 @@ int emcTrajLinearMove(EmcPose end, int type, double vel, double ini_maxvel, doub
     emcmotCommand.acc = acc;
     emcmotCommand.turn = indexrotary;
 
-    return usrmotWriteEmcmotCommand(&emcmotCommand);
+    // goes out with the next moves, see emcMotionUpdate()
+    return usrmotQueueSegment(&emcmotCommand);
 }
 
 int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
@@ -1420,7 +1432,7 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     emcmotCommand.ini_maxvel = ini_maxvel;
     emcmotCommand.acc = acc;
 
-    return usrmotWriteEmcmotCommand(&emcmotCommand);
+    return usrmotQueueSegment(&emcmotCommand);
 }
 
 int emcTrajClearProbeTrippedFlag()
@@ -1897,11 +1909,17 @@ int emcSpindleUpdate(EMC_SPINDLE_STAT stat[], int num_spindles){
 
 int emcMotionUpdate(EMC_MOTION_STAT * stat)
 {
-    int r1, r2, r3, r4;
+    int r1 = 0, r2 = 0, r3 = 0, r4 = 0;
+    int all;
     int joint;
     int error;
     int exec;
     int dio, aio;
+    int flushed;
+
+    // send the moves queued since the last update, so that the status
+    // read below includes them
+    flushed = usrmotFlushSegments();
 
     // read the emcmot status
     if (0 != usrmotReadEmcmotStatus(&emcmotStatus)) {
@@ -1934,26 +1952,63 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
     localMotionCommandType = emcmotStatus.commandEcho;	/*! \todo FIXME-- not NML one! */
     localMotionEchoSerialNumber = emcmotStatus.commandNumEcho;
 
-    r3 = emcTrajUpdate(&stat->traj);
-    r1 = emcJointUpdate(&stat->joint[0], stat->traj.joints);
-    r2 = emcAxisUpdate(&stat->axis[0], stat->traj.axis_mask);
-    r3 = emcTrajUpdate(&stat->traj);
-    r4 = emcSpindleUpdate(&stat->spindle[0], stat->traj.spindles);
+    // The traj section depends on most of the status, and everything on
+    // the configuration. The joints, axes and spindles only need to be
+    // built again if their own status did, which while the machine
+    // stands still is not every cycle.
+    struct TrajConfig_t trajConfig;
+    memcpy(&trajConfig, &TrajConfig, sizeof(trajConfig));
+    // set for every move, but not part of the stat
+    trajConfig.MotionId = builtTrajConfig.MotionId;
+    all = !motionStatBuilt || new_config ||
+	memcmp(&trajConfig, &builtTrajConfig, sizeof(trajConfig)) ||
+	memcmp(JointConfig, builtJointConfig, sizeof(JointConfig));
+    builtStatus.head = emcmotStatus.head;
+    builtStatus.tail = emcmotStatus.tail;
+    builtStatus.heartbeat = emcmotStatus.heartbeat;
+    builtStatus.commandEcho = emcmotStatus.commandEcho;
+    builtStatus.commandNumEcho = emcmotStatus.commandNumEcho;
+    if (all || memcmp(&builtStatus, &emcmotStatus, sizeof(builtStatus))) {
+	r3 = emcTrajUpdate(&stat->traj);
+	if (all || emcmotStatus.overrideLimitMask != builtStatus.overrideLimitMask ||
+	    memcmp(emcmotStatus.joint_status, builtStatus.joint_status,
+		sizeof(emcmotStatus.joint_status))) {
+	    r1 = emcJointUpdate(&stat->joint[0], stat->traj.joints);
+	}
+	if (all || memcmp(emcmotStatus.axis_status, builtStatus.axis_status,
+		sizeof(emcmotStatus.axis_status))) {
+	    r2 = emcAxisUpdate(&stat->axis[0], stat->traj.axis_mask);
+	}
+	r3 = emcTrajUpdate(&stat->traj);
+	if (all || emcmotStatus.enables_new != builtStatus.enables_new ||
+	    emcmotStatus.enables_queued != builtStatus.enables_queued ||
+	    emcmotStatus.motionFlag != builtStatus.motionFlag ||
+	    memcmp(emcmotStatus.spindle_status, builtStatus.spindle_status,
+		sizeof(emcmotStatus.spindle_status))) {
+	    r4 = emcSpindleUpdate(&stat->spindle[0], stat->traj.spindles);
+	}
+
+	for (dio = 0; dio < EMCMOT_MAX_DIO; dio++) {
+	    stat->synch_di[dio] = emcmotStatus.synch_di[dio];
+	    stat->synch_do[dio] = emcmotStatus.synch_do[dio];
+	}
+
+	for (aio = 0; aio < EMCMOT_MAX_AIO; aio++) {
+	    stat->analog_input[aio] = emcmotStatus.analog_input[aio];
+	    stat->analog_output[aio] = emcmotStatus.analog_output[aio];
+	}
+
+	// only skip the next time if this went through
+	motionStatBuilt = (r1 == 0 && r2 == 0 && r3 == 0 && r4 == 0);
+	memcpy(&builtStatus, &emcmotStatus, sizeof(builtStatus));
+	memcpy(&builtTrajConfig, &TrajConfig, sizeof(builtTrajConfig));
+	memcpy(builtJointConfig, JointConfig, sizeof(JointConfig));
+    }
     stat->heartbeat = localMotionHeartbeat;
     stat->command_type = localMotionCommandType;
     stat->echo_serial_number = localMotionEchoSerialNumber;
     stat->debug = emcmotConfig.debug;
 
-    for (dio = 0; dio < EMCMOT_MAX_DIO; dio++) {
-	stat->synch_di[dio] = emcmotStatus.synch_di[dio];
-	stat->synch_do[dio] = emcmotStatus.synch_do[dio];
-    }
-
-    for (aio = 0; aio < EMCMOT_MAX_AIO; aio++) {
-	stat->analog_input[aio] = emcmotStatus.analog_input[aio];
-	stat->analog_output[aio] = emcmotStatus.analog_output[aio];
-    }
-
     // set the status flag
     error = 0;
     exec = 0;
@@ -1975,7 +2030,7 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
 	exec = 1;
     }
 
-    if (error) {
+    if (error || flushed != EMCMOT_COMM_OK) {
 	stat->status = RCS_ERROR;
     } else if (exec) {
 	stat->status = RCS_EXEC;
@@ -1985,6 +2040,74 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
     return (r1 == 0 && r2 == 0 && r3 == 0 && r4 == 0) ? 0 : -1;
 }
 
+// Returns EMC_MOTION_CHANGED if the emcmot status may have changed since
+// the last emcMotionUpdate() in anything task acts on, or if it has an
+// error to report, EMC_MOTION_FEEDBACK_CHANGED if only the feedback,
+// following errors or analog inputs did, which may jitter every cycle,
+// or 0. Cheaper than emcMotionUpdate(), so task can poll it while it has
+// nothing to do.
+int emcMotionChanged()
+{
+    static emcmot_status_t s;
+    int n;
+
+#define CHANGED(field) \
+    (0 != memcmp(&s.field, &emcmotStatus.field, sizeof(s.field)))
+
+    if (usrmotEmcmotErrorPending()) {
+	return EMC_MOTION_CHANGED;
+    }
+    if (0 != usrmotReadEmcmotStatus(&s)) {
+	return EMC_MOTION_CHANGED;
+    }
+    if (CHANGED(commandEcho) || CHANGED(commandNumEcho) ||
+	CHANGED(commandStatus) || CHANGED(feed_scale) ||
+	CHANGED(rapid_scale) || CHANGED(enables_new) ||
+	CHANGED(enables_queued) || CHANGED(motion_state) ||
+	CHANGED(motionFlag) || CHANGED(carte_pos_cmd) ||
+	CHANGED(homing_active) || CHANGED(homingSequenceState) ||
+	CHANGED(spindleSync) || CHANGED(on_soft_limit) ||
+	CHANGED(probeVal) || CHANGED(probeTripped) || CHANGED(probing) ||
+	CHANGED(probedPos) || CHANGED(synch_di) || CHANGED(synch_do) ||
+	CHANGED(config_num) || CHANGED(id) || CHANGED(depth) ||
+	CHANGED(activeDepth) || CHANGED(queueFull) || CHANGED(paused) ||
+	CHANGED(overrideLimitMask) || CHANGED(motionType) ||
+	CHANGED(tcqlen) || CHANGED(tool_offset) ||
+	CHANGED(external_offsets_applied) || CHANGED(eoffset_pose) ||
+	CHANGED(analog_output)) {
+	return EMC_MOTION_CHANGED;
+    }
+    for (n = 0; n < EMCMOT_MAX_JOINTS; n++) {
+	if (CHANGED(joint_status[n].flag) || CHANGED(joint_status[n].pos_cmd)) {
+	    return EMC_MOTION_CHANGED;
+	}
+    }
+    for (n = 0; n < EMCMOT_MAX_SPINDLES; n++) {
+	if (CHANGED(spindle_status[n].speed) ||
+	    CHANGED(spindle_status[n].scale) ||
+	    CHANGED(spindle_status[n].direction) ||
+	    CHANGED(spindle_status[n].brake) ||
+	    CHANGED(spindle_status[n].locked) ||
+	    CHANGED(spindle_status[n].orient_fault) ||
+	    CHANGED(spindle_status[n].orient_state) ||
+	    CHANGED(spindle_status[n].at_speed) ||
+	    CHANGED(spindle_status[n].fault)) {
+	    return EMC_MOTION_CHANGED;
+	}
+    }
+    if (CHANGED(carte_pos_fb) || CHANGED(analog_input)) {
+	return EMC_MOTION_FEEDBACK_CHANGED;
+    }
+    for (n = 0; n < EMCMOT_MAX_JOINTS; n++) {
+	if (CHANGED(joint_status[n].pos_fb) ||
+	    CHANGED(joint_status[n].ferror)) {
+	    return EMC_MOTION_FEEDBACK_CHANGED;
+	}
+    }
+    return 0;
+#undef CHANGED
+}
+
 int emcSetupArcBlends(int arcBlendEnable,
         int arcBlendFallbackEnable,
         int arcBlendOptDepth,
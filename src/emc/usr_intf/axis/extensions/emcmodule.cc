@@ -205,15 +205,23 @@ static PyTypeObject Ini_Type = {
 };
 
 #define EMC_COMMAND_TIMEOUT 5.0  // how long to wait until timeout
-#define EMC_COMMAND_DELAY   0.01 // how long to sleep between checks
+#define EMC_COMMAND_DELAY   0.01 // longest wait for a status update between checks
+
+// The newest status, whether or not it was seen before: task only writes
+// the status when it changed. NULL if there is none yet or on error.
+static EMC_STAT *peekStatus(RCS_STAT_CHANNEL *c) {
+    if(c->peek() < 0) return NULL;
+    EMC_STAT *stat = static_cast<EMC_STAT*>(c->get_address());
+    return stat->type == EMC_STAT_TYPE ? stat : NULL;
+}
 
 static int emcWaitCommandComplete(pyCommandChannel *s, double timeout) {
     double start = etime();
 
     do {
         double now = etime();
-        if(s->s->peek() == EMC_STAT_TYPE) {
-           EMC_STAT *stat = (EMC_STAT*)s->s->get_address();
+        EMC_STAT *stat = peekStatus(s->s);
+        if(stat) {
            int serial_diff = stat->echo_serial_number - s->serial;
            if (serial_diff > 0) {
                 return RCS_DONE;
@@ -223,7 +231,7 @@ static int emcWaitCommandComplete(pyCommandChannel *s, double timeout) {
                 return stat->status;
            }
         }
-        esleep(fmin(timeout - (now - start), EMC_COMMAND_DELAY));
+        s->s->wait_for_write(fmax(0, fmin(timeout - (now - start), EMC_COMMAND_DELAY)));
     } while (etime() - start < timeout);
     return -1;
 }
@@ -236,13 +244,14 @@ static int emcSendCommand(pyCommandChannel *s, RCS_CMD_MSG & cmd) {
 
     double start = etime();
     while (etime() - start < EMC_COMMAND_TIMEOUT) {
-        EMC_STAT *stat = (EMC_STAT*)s->s->get_address();
-        int serial_diff = stat->echo_serial_number - s->serial;
-        if(s->s->peek() == EMC_STAT_TYPE &&
-           serial_diff >= 0) {
+        EMC_STAT *stat = peekStatus(s->s);
+        if(stat) {
+            int serial_diff = stat->echo_serial_number - s->serial;
+            if(serial_diff >= 0) {
                 return 0;
-           }
-        esleep(EMC_COMMAND_DELAY);
+            }
+        }
+        s->s->wait_for_write(EMC_COMMAND_DELAY);
     }
     return -1;
 }
@@ -283,9 +292,19 @@ static bool check_stat(RCS_STAT_CHANNEL *emcStatusBuffer) {
 
 static PyObject *poll(pyStatChannel *s, PyObject *o) {
     if(!check_stat(s->c)) return NULL;
-    if(s->c->peek() == EMC_STAT_TYPE) {
-        EMC_STAT *emcStatus = static_cast<EMC_STAT*>(s->c->get_address());
-        memcpy(&s->status, emcStatus, sizeof(EMC_STAT));
+    // copy straight out of a zerocopy buffer; if task reused the slot
+    // while we copied, copy again from wherever the status now is, new
+    // or not, until a copy was made without interference
+    if(s->c->peek_view() == EMC_STAT_TYPE) {
+        while(1) {
+            EMC_STAT *emcStatus = static_cast<EMC_STAT*>(s->c->get_view());
+            memcpy(&s->status, emcStatus, sizeof(EMC_STAT));
+            if(s->c->view_valid()) break;
+            if(s->c->peek_view() < 0) {
+                PyErr_Format( error, "emcStatusBuffer read failed err=%d", s->c->error_type);
+                return NULL;
+            }
+        }
     }
     Py_INCREF(Py_None);
     return Py_None;
@@ -1929,8 +1948,8 @@ static PyObject *Logger_start(pyPositionLogger *s, PyObject *o) {
             s->lpts = 0;
             s->clear = 0;
         }
-        if(s->st->c->valid() && s->st->c->peek() == EMC_STAT_TYPE) {
-            EMC_STAT *status = static_cast<EMC_STAT*>(s->st->c->get_address());
+        EMC_STAT *status;
+        if(s->st->c->valid() && (status = peekStatus(s->st->c))) {
             int colornum = 2;
             colornum = status->motion.traj.motion_type;
             if(colornum < 0 || colornum > NUMCOLORS) colornum = 0;
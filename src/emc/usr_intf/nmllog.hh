@@ -0,0 +1,47 @@
+/********************************************************************
+* Description: nmllog.hh
+*   Layout of the NML message logs written by nmlrecord and read by
+*   nmlreplay.
+*
+*   A log is an NML_LOG_HEADER, the names of its channels, then one
+*   NML_LOG_RECORD per message followed by the message packed with
+*   NML::msg2bin(). Everything is in host byte order.
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+#ifndef NMLLOG_HH
+#define NMLLOG_HH
+
+#include <stdint.h>
+
+#define NML_LOG_MAGIC 0x474C4D4E	/* "NMLG" */
+#define NML_LOG_VERSION 1
+#define NML_LOG_MAX_CHANNELS 16
+#define NML_LOG_NAME_LEN 32
+
+struct NML_LOG_HEADER {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_channels;
+    uint32_t pad;
+    double start_time;		/* etime() when recording started */
+    /* followed by num_channels names of NML_LOG_NAME_LEN bytes */
+};
+
+struct NML_LOG_RECORD {
+    uint16_t channel;		/* index into the channel names */
+    uint16_t pad;
+    uint32_t type;		/* NMLTYPE of the message */
+    uint32_t size;		/* bytes of packed message that follow */
+    uint32_t pad2;
+    uint64_t ns;		/* since start_time */
+    uint64_t write_id;		/* of the message in its buffer */
+};
+
+#endif
@@ -0,0 +1,236 @@
+/********************************************************************
+* Description: nmlrecord.cc
+*   Records the messages written to a set of NML buffers, with the
+*   time each was seen, to a log that nmlreplay can play back.
+*
+*   Buffers with "tap" on their buffer line are copied from the ring of
+*   the last messages written to them, so no message is missed even if
+*   its readers take it at once. Other buffers are only peeked, so
+*   recording never takes commands away from their readers or changes
+*   what write_if_read() does; messages that come and go between two
+*   peeks are counted from the gaps in the write ids. Both are reported
+*   at the end.
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include <stdio.h>		// fopen(), fwrite()
+#include <stdlib.h>		// exit(), strtod()
+#include <string.h>		// strncpy(), memset()
+#include <unistd.h>		// getopt()
+#include <signal.h>
+
+#include "nml.hh"		// NML, nmlWaitAny()
+#include "nmlmsg.hh"		// NMLmsg
+#include "cms.hh"		// CMS
+#include "emc.hh"		// emcFormat()
+#include "emcglb.h"		// emc_nmlfile
+#include "cms_stats.hh"		// cms_stats_now()
+#include "cms_tap.hh"		// cms_tap_get()
+#include "timer.hh"		// etime()
+#include "nmllog.hh"
+
+/* Longest wait for a write. Queued buffers without tap are also peeked
+   this often, since a reader taking the head of a queue does not wake
+   us. */
+#define NMLRECORD_POLL_INTERVAL 0.01
+
+static int done = 0;
+
+static void quit(int sig)
+{
+    done = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+	"Usage: %s [-n NMLFILE] [-p PROCESS] [-t SECONDS] LOGFILE [BUFFER ...]\n"
+	"  -n NMLFILE  the NML configuration, default %s\n"
+	"  -p PROCESS  the process name in NMLFILE, default nmlrecord\n"
+	"  -t SECONDS  stop after this long\n"
+	"The default buffers are emcCommand emcStatus emcError toolCmd.\n",
+	prog, emc_nmlfile);
+    exit(1);
+}
+
+/* Packs msg with the format functions of channel and appends it to the
+   log. */
+static void write_record(FILE * log, NML * channel, int index, NMLmsg * msg,
+    const CMS_TAP_SLOT * info, unsigned long long start_ns)
+{
+    long size = 0;
+    const void *data = channel->msg2bin(msg, &size);
+    if (NULL == data) {
+	fprintf(stderr, "nmlrecord: can't pack message %ld from %s\n",
+	    (long) msg->type, channel->cms->BufferName);
+	return;
+    }
+    NML_LOG_RECORD record;
+    memset(&record, 0, sizeof(record));
+    record.channel = index;
+    record.type = msg->type;
+    record.size = size;
+    record.ns = info->ns > start_ns ? info->ns - start_ns : 0;
+    record.write_id = info->write_id;
+    if (fwrite(&record, sizeof(record), 1, log) != 1
+	|| fwrite(data, size, 1, log) != 1) {
+	perror("nmlrecord");
+	done = 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const char *default_buffers[] = {
+	"emcCommand", "emcStatus", "emcError", "toolCmd"
+    };
+    const char *prog = argv[0];
+    const char *process = "nmlrecord";
+    double duration = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:t:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    strncpy(emc_nmlfile, optarg, LINELEN - 1);
+	    break;
+	case 'p':
+	    process = optarg;
+	    break;
+	case 't':
+	    duration = strtod(optarg, NULL);
+	    if (duration <= 0) {
+		usage(prog);
+	    }
+	    break;
+	default:
+	    usage(prog);
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1) {
+	usage(prog);
+    }
+    const char *logname = argv[0];
+    const char **buffers = (const char **) argv + 1;
+    int num_channels = argc - 1;
+    if (num_channels == 0) {
+	buffers = default_buffers;
+	num_channels = sizeof(default_buffers) / sizeof(default_buffers[0]);
+    }
+    if (num_channels > NML_LOG_MAX_CHANNELS) {
+	fprintf(stderr, "nmlrecord: at most %d buffers can be recorded\n",
+	    NML_LOG_MAX_CHANNELS);
+	exit(1);
+    }
+
+    NML *channels[NML_LOG_MAX_CHANNELS];
+    CMS_TAP *tap[NML_LOG_MAX_CHANNELS];
+    unsigned long long tap_pos[NML_LOG_MAX_CHANNELS];
+    NMLmsg *tap_msg[NML_LOG_MAX_CHANNELS];
+    unsigned long long last_id[NML_LOG_MAX_CHANNELS];
+    unsigned long long recorded[NML_LOG_MAX_CHANNELS];
+    unsigned long long missed[NML_LOG_MAX_CHANNELS];
+    int i;
+
+    for (i = 0; i < num_channels; i++) {
+	channels[i] = new NML(emcFormat, buffers[i], process, emc_nmlfile);
+	if (!channels[i]->valid()) {
+	    fprintf(stderr, "nmlrecord: can't open %s\n", buffers[i]);
+	    exit(1);
+	}
+	tap[i] = NULL;
+	tap_msg[i] = NULL;
+	last_id[i] = 0;
+	recorded[i] = 0;
+	missed[i] = 0;
+    }
+
+    FILE *log = fopen(logname, "wb");
+    if (NULL == log) {
+	perror(logname);
+	exit(1);
+    }
+    NML_LOG_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.magic = NML_LOG_MAGIC;
+    header.version = NML_LOG_VERSION;
+    header.num_channels = num_channels;
+    header.start_time = etime();
+    fwrite(&header, sizeof(header), 1, log);
+    for (i = 0; i < num_channels; i++) {
+	char name[NML_LOG_NAME_LEN];
+	memset(name, 0, sizeof(name));
+	strncpy(name, buffers[i], sizeof(name) - 1);
+	fwrite(name, sizeof(name), 1, log);
+    }
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    unsigned long long start_ns = cms_stats_now();
+    for (i = 0; i < num_channels; i++) {
+	tap[i] = channels[i]->cms->get_tap();
+	if (NULL != tap[i]) {
+	    tap_pos[i] = tap[i]->next;
+	    tap_msg[i] = (NMLmsg *) malloc(channels[i]->cms->size);
+	}
+    }
+    while (!done) {
+	nmlWaitAny(channels, num_channels, NMLRECORD_POLL_INTERVAL);
+	for (i = 0; i < num_channels && !done; i++) {
+	    CMS_TAP_SLOT info;
+	    if (NULL != tap[i]) {
+		/* Any access marks the writes so far as seen by
+		   nmlWaitAny(), so do one before emptying the ring. */
+		channels[i]->get_msg_count();
+		while (!done && cms_tap_get(tap[i], &tap_pos[i], tap_msg[i],
+			channels[i]->cms->size, &info, &missed[i]) > 0) {
+		    write_record(log, channels[i], i, tap_msg[i], &info,
+			start_ns);
+		    recorded[i]++;
+		}
+		continue;
+	    }
+	    if (channels[i]->peek() <= 0) {
+		continue;
+	    }
+	    info.write_id = channels[i]->cms->header.write_id;
+	    info.ns = cms_stats_now();
+	    if (info.write_id == last_id[i]) {
+		/* the head of a queue that has not been read yet */
+		continue;
+	    }
+	    if (last_id[i] != 0 && info.write_id > last_id[i] + 1) {
+		missed[i] += info.write_id - last_id[i] - 1;
+	    }
+	    last_id[i] = info.write_id;
+	    write_record(log, channels[i], i, channels[i]->get_address(),
+		&info, start_ns);
+	    recorded[i]++;
+	}
+	if (duration > 0 && cms_stats_now() - start_ns >= duration * 1e9) {
+	    break;
+	}
+    }
+    fclose(log);
+
+    for (i = 0; i < num_channels; i++) {
+	fprintf(stderr, "nmlrecord: %s: %llu messages", buffers[i],
+	    recorded[i]);
+	if (missed[i] > 0) {
+	    fprintf(stderr, ", %llu missed", missed[i]);
+	}
+	fprintf(stderr, "\n");
+	free(tap_msg[i]);
+	delete channels[i];
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+/********************************************************************
+* Description: nmlreplay.cc
+*   Plays back a log recorded by nmlrecord, writing the messages of
+*   some of its buffers to a running system at the speed they were
+*   recorded at or as fast as they are taken, or lists the log.
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include <stdio.h>		// fopen(), fread()
+#include <stdlib.h>		// exit(), realloc()
+#include <string.h>		// strcmp(), strncpy()
+#include <unistd.h>		// getopt()
+#include <signal.h>
+
+#include "nml.hh"		// NML
+#include "cms.hh"		// CMS
+#include "emc.hh"		// emcFormat(), emcSymbolLookup()
+#include "emcglb.h"		// emc_nmlfile
+#include "timer.hh"		// etime(), esleep()
+#include "nmllog.hh"
+
+/* How often a full queue, or with -f an unread buffer, is retried. */
+#define NMLREPLAY_RETRY_INTERVAL 0.001
+
+static int done = 0;
+
+static void quit(int sig)
+{
+    done = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+	"Usage: %s [-n NMLFILE] [-p PROCESS] [-f] [-l] LOGFILE [BUFFER ...]\n"
+	"  -n NMLFILE  the NML configuration, default %s\n"
+	"  -p PROCESS  the process name in NMLFILE, default nmlrecord\n"
+	"  -f          write each message as soon as the last one was taken\n"
+	"  -l          list the messages in the log instead\n"
+	"The default buffer is emcCommand.\n", prog, emc_nmlfile);
+    exit(1);
+}
+
+static int selected(const char *name, int argc, char **argv)
+{
+    if (argc <= 0) {
+	return !strcmp(name, "emcCommand");
+    }
+    for (int i = 0; i < argc; i++) {
+	if (!strcmp(name, argv[i])) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/* Writes msg once the last message written to channel has been taken:
+   for queued buffers when there is room in the queue, otherwise when the
+   buffer was read, unless nothing was written to it yet. */
+static int write_when_taken(NML * channel, NMLmsg * msg, int first)
+{
+    while (!done) {
+	if (channel->cms->queuing_enabled) {
+	    if (channel->write(msg) == 0) {
+		return 0;
+	    }
+	    if (channel->error_type != NML_QUEUE_FULL_ERROR) {
+		return -1;
+	    }
+	} else if (first || channel->check_if_read() > 0) {
+	    return channel->write(msg);
+	}
+	esleep(NMLREPLAY_RETRY_INTERVAL);
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *prog = argv[0];
+    const char *process = "nmlrecord";
+    int fast = 0, list = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:fl")) != -1) {
+	switch (opt) {
+	case 'n':
+	    strncpy(emc_nmlfile, optarg, LINELEN - 1);
+	    break;
+	case 'p':
+	    process = optarg;
+	    break;
+	case 'f':
+	    fast = 1;
+	    break;
+	case 'l':
+	    list = 1;
+	    break;
+	default:
+	    usage(prog);
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1) {
+	usage(prog);
+    }
+    const char *logname = argv[0];
+    argc--;
+    argv++;
+
+    FILE *log = fopen(logname, "rb");
+    if (NULL == log) {
+	perror(logname);
+	exit(1);
+    }
+    NML_LOG_HEADER header;
+    if (fread(&header, sizeof(header), 1, log) != 1
+	|| header.magic != NML_LOG_MAGIC) {
+	fprintf(stderr, "nmlreplay: %s is not an NML log\n", logname);
+	exit(1);
+    }
+    if (header.version != NML_LOG_VERSION
+	|| header.num_channels > NML_LOG_MAX_CHANNELS) {
+	fprintf(stderr, "nmlreplay: %s has an unknown version\n", logname);
+	exit(1);
+    }
+
+    char names[NML_LOG_MAX_CHANNELS][NML_LOG_NAME_LEN];
+    NML *channels[NML_LOG_MAX_CHANNELS];
+    unsigned long written[NML_LOG_MAX_CHANNELS];
+    unsigned int i;
+
+    for (i = 0; i < header.num_channels; i++) {
+	if (fread(names[i], NML_LOG_NAME_LEN, 1, log) != 1) {
+	    fprintf(stderr, "nmlreplay: %s is truncated\n", logname);
+	    exit(1);
+	}
+	names[i][NML_LOG_NAME_LEN - 1] = 0;
+	channels[i] = NULL;
+	written[i] = 0;
+	if (list || !selected(names[i], argc, argv)) {
+	    continue;
+	}
+	channels[i] = new NML(emcFormat, names[i], process, emc_nmlfile);
+	if (!channels[i]->valid()) {
+	    fprintf(stderr, "nmlreplay: can't open %s\n", names[i]);
+	    exit(1);
+	}
+    }
+    cms_print_queue_full_messages = 0;
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    NML_LOG_RECORD record;
+    void *data = NULL;
+    long data_size = 0;
+    double start = 0;
+    unsigned long long first_ns = 0;
+    int first = 1;
+    while (!done && fread(&record, sizeof(record), 1, log) == 1) {
+	if (record.size > data_size) {
+	    data = realloc(data, record.size);
+	    data_size = record.size;
+	}
+	if (record.channel >= header.num_channels
+	    || fread(data, record.size, 1, log) != 1) {
+	    fprintf(stderr, "nmlreplay: %s is truncated\n", logname);
+	    break;
+	}
+	if (list) {
+	    if (argc > 0 && !selected(names[record.channel], argc, argv)) {
+		continue;
+	    }
+	    const char *symbol = emcSymbolLookup(record.type);
+	    printf("%12.6f %-16s %8llu %6u %s\n", record.ns * 1e-9,
+		names[record.channel], (unsigned long long) record.write_id,
+		record.size, symbol ? symbol : "?");
+	    continue;
+	}
+	NML *channel = channels[record.channel];
+	if (NULL == channel) {
+	    continue;
+	}
+
+	if (first) {
+	    start = etime();
+	    first_ns = record.ns;
+	    first = 0;
+	} else if (!fast) {
+	    double wait = start + (record.ns - first_ns) * 1e-9 - etime();
+	    if (wait > 0) {
+		esleep(wait);
+	    }
+	}
+	NMLmsg *msg = channel->bin2msg(data, record.size);
+	if (NULL == msg) {
+	    fprintf(stderr,
+		"nmlreplay: can't unpack message %u of %s, was the log recorded with other message definitions?\n",
+		record.type, names[record.channel]);
+	    break;
+	}
+	int ret = (fast || channel->cms->queuing_enabled) ?
+	    write_when_taken(channel, msg, written[record.channel] == 0) :
+	    channel->write(msg);
+	if (ret != 0 && !done) {
+	    fprintf(stderr, "nmlreplay: can't write to %s\n",
+		names[record.channel]);
+	    break;
+	}
+	written[record.channel]++;
+    }
+    fclose(log);
+    free(data);
+
+    for (i = 0; i < header.num_channels; i++) {
+	if (NULL != channels[i]) {
+	    fprintf(stderr, "nmlreplay: %s: %lu messages\n", names[i],
+		written[i]);
+	    delete channels[i];
+	}
+    }
+    if (!list && !first && fast) {
+	fprintf(stderr, "nmlreplay: took %.3f s\n", etime() - start);
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+/********************************************************************
+* Description: nmlstat.cc
+*   Shows the latency and throughput statistics of the NML buffers
+*   that have "stats" on their buffer line.
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include <stdio.h>		// printf()
+#include <stdlib.h>		// exit(), strtod()
+#include <string.h>		// strcmp(), memcpy()
+#include <unistd.h>		// getopt()
+#include <signal.h>
+
+#include "cms_stats.hh"		// CMS_STATS_PAGE
+#include "shm.hh"		// RCS_SHAREDMEM
+#include "rcs_print.hh"		// set_rcs_print_destination()
+#include "timer.hh"		// esleep()
+
+static int done = 0;
+
+static void quit(int sig)
+{
+    done = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+	"Usage: %s [-z] [-H] [-i SECONDS] [BUFFER ...]\n"
+	"  -z          zero the statistics\n"
+	"  -H          print the latency histograms\n"
+	"  -i SECONDS  print the statistics of each interval\n", prog);
+    exit(1);
+}
+
+static const char *fmt_time(double ns, char *buf)
+{
+    if (ns < 1e4) {
+	sprintf(buf, "%.1fus", ns * 1e-3);
+    } else if (ns < 1e6) {
+	sprintf(buf, "%.0fus", ns * 1e-3);
+    } else if (ns < 1e9) {
+	sprintf(buf, "%.1fms", ns * 1e-6);
+    } else {
+	sprintf(buf, "%.2fs", ns * 1e-9);
+    }
+    return buf;
+}
+
+/* Upper bound of the histogram bucket holding the given fraction of the
+   latencies, in ns. */
+static double percentile(const unsigned long long *hist,
+    unsigned long long count, double fraction)
+{
+    unsigned long long seen = 0;
+    int i;
+
+    for (i = 0; i < CMS_STATS_BUCKETS - 1; i++) {
+	seen += hist[i];
+	if (seen >= fraction * count) {
+	    break;
+	}
+    }
+    return (1ULL << i) * 1000.0;
+}
+
+static int selected(const char *name, int argc, char **argv)
+{
+    if (argc <= 0) {
+	return 1;
+    }
+    for (int i = 0; i < argc; i++) {
+	if (!strcmp(name, argv[i])) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/* Prints the difference between now and then, which is zero the first
+   time round. */
+static void print_channel(const CMS_STATS_CHANNEL * now,
+    const CMS_STATS_CHANNEL * then, double seconds, int histogram)
+{
+    unsigned long long hist[CMS_STATS_BUCKETS];
+    char b1[16], b2[16], b3[16], b4[16], b5[16], b6[16];
+    int i;
+
+#define DIFF(f) (now->f - then->f)
+    for (i = 0; i < CMS_STATS_BUCKETS; i++) {
+	hist[i] = DIFF(latency_hist[i]);
+    }
+    unsigned long long lat = DIFF(latency_count);
+    unsigned long long enc = DIFF(encode_count);
+    unsigned long long dec = DIFF(decode_count);
+    if (seconds <= 0) {
+	seconds = 1e-9;
+    }
+    printf("%-16.16s %8.1f %8.1f %9.1f %5llu %8s %8s %8s %8s %8s %8s\n",
+	now->name, DIFF(writes) / seconds, DIFF(reads) / seconds,
+	(DIFF(write_bytes) + DIFF(read_bytes)) / seconds / 1024,
+	now->queue_max,
+	lat ? fmt_time((double) DIFF(latency_sum_ns) / lat, b1) : "-",
+	lat ? fmt_time(percentile(hist, lat, 0.5), b2) : "-",
+	lat ? fmt_time(percentile(hist, lat, 0.99), b3) : "-",
+	now->latency_count ? fmt_time(now->latency_max_ns, b4) : "-",
+	enc ? fmt_time((double) DIFF(encode_sum_ns) / enc, b5) : "-",
+	dec ? fmt_time((double) DIFF(decode_sum_ns) / dec, b6) : "-");
+    if (histogram && lat) {
+	for (i = 0; i < CMS_STATS_BUCKETS; i++) {
+	    if (hist[i] == 0) {
+		continue;
+	    }
+	    if (i == 0) {
+		printf("    %21s", "< 1us");
+	    } else if (i == CMS_STATS_BUCKETS - 1) {
+		printf("    >= %18s",
+		    fmt_time((1ULL << (i - 1)) * 1e3, b1));
+	    } else {
+		printf("    %10s - %8s",
+		    fmt_time((1ULL << (i - 1)) * 1e3, b1),
+		    fmt_time((1ULL << i) * 1e3, b2));
+	    }
+	    printf(" %10llu %5.1f%%\n", hist[i], 100.0 * hist[i] / lat);
+	}
+    }
+#undef DIFF
+}
+
+int main(int argc, char **argv)
+{
+    int zero = 0, histogram = 0;
+    double interval = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "zHi:")) != -1) {
+	switch (opt) {
+	case 'z':
+	    zero = 1;
+	    break;
+	case 'H':
+	    histogram = 1;
+	    break;
+	case 'i':
+	    interval = strtod(optarg, NULL);
+	    if (interval <= 0) {
+		usage(argv[0]);
+	    }
+	    break;
+	default:
+	    usage(argv[0]);
+	}
+    }
+    argc -= optind;
+    argv += optind;
+
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    RCS_SHAREDMEM shm(CMS_STATS_KEY, sizeof(CMS_STATS_PAGE),
+	RCS_SHAREDMEM_NOCREATE);
+    set_rcs_print_destination(RCS_PRINT_TO_STDERR);
+    if (NULL == shm.addr) {
+	fprintf(stderr, "nmlstat: no NML buffers with stats are open\n");
+	exit(1);
+    }
+    CMS_STATS_PAGE *page = (CMS_STATS_PAGE *) shm.addr;
+    if (page->magic != CMS_STATS_MAGIC
+	|| page->version != CMS_STATS_VERSION
+	|| page->num_channels != CMS_STATS_CHANNELS) {
+	fprintf(stderr,
+	    "nmlstat: the stats page has an incompatible version\n");
+	exit(1);
+    }
+
+    static CMS_STATS_CHANNEL last[CMS_STATS_CHANNELS];
+    static CMS_STATS_CHANNEL zeroed;
+    int i;
+
+    if (zero) {
+	for (i = 0; i < CMS_STATS_CHANNELS; i++) {
+	    CMS_STATS_CHANNEL *c = &page->channel[i];
+	    if (c->state == 2 && selected(c->name, argc, argv)) {
+		cms_stats_zero(c);
+	    }
+	}
+	return 0;
+    }
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    static unsigned long long last_ns[CMS_STATS_CHANNELS];
+    memcpy(last, (void *) page->channel, sizeof(last));
+    for (i = 0; i < CMS_STATS_CHANNELS; i++) {
+	last_ns[i] = cms_stats_now();
+    }
+    while (!done) {
+	if (interval > 0) {
+	    esleep(interval);
+	    if (done) {
+		break;
+	    }
+	}
+	unsigned long long now_ns = cms_stats_now();
+	printf("%-16s %8s %8s %9s %5s %8s %8s %8s %8s %8s %8s\n",
+	    "BUFFER", "WRITES/s", "READS/s", "KBYTES/s", "QMAX",
+	    "LATENCY", "P50", "P99", "MAX", "ENCODE", "DECODE");
+	for (i = 0; i < CMS_STATS_CHANNELS; i++) {
+	    CMS_STATS_CHANNEL c;
+	    memcpy(&c, (void *) &page->channel[i], sizeof(c));
+	    if (c.state != 2 || !selected(c.name, argc, argv)) {
+		continue;
+	    }
+	    if (interval > 0) {
+		if (c.start_ns != last[i].start_ns) {
+		    /* zeroed during the interval */
+		    memcpy(&last[i], &zeroed, sizeof(zeroed));
+		    last_ns[i] = c.start_ns;
+		}
+		print_channel(&c, &last[i], (now_ns - last_ns[i]) * 1e-9,
+		    histogram);
+		memcpy(&last[i], &c, sizeof(c));
+		last_ns[i] = now_ns;
+	    } else {
+		print_channel(&c, &zeroed, (now_ns - c.start_ns) * 1e-9,
+		    histogram);
+	    }
+	}
+	if (interval <= 0) {
+	    break;
+	}
+	printf("\n");
+	fflush(stdout);
+    }
+    return 0;
+}
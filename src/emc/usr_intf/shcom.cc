@@ -93,8 +93,11 @@ int emcTaskNmlGet()
 	emcStatusBuffer =
 	    new RCS_STAT_CHANNEL(emcFormat, "emcStatus", "xemc",
 				 emc_nmlfile);
+	// task writes the status only when it changed, so what is in the
+	// buffer may be old but is still current
 	if (!emcStatusBuffer->valid()
-	    || EMC_STAT_TYPE != emcStatusBuffer->peek()) {
+	    || emcStatusBuffer->peek() < 0
+	    || EMC_STAT_TYPE != emcStatusBuffer->get_address()->type) {
 	    delete emcStatusBuffer;
 	    emcStatusBuffer = 0;
 	    emcStatus = 0;
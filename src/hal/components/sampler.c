@@ -22,6 +22,11 @@
 
     loadrt sampler depth=100 cfg=uffb
 
+    Each sampler may have several readers (readers=N, default 1).
+    Every reader gets its own fifo, and so its own complete copy of
+    the sampled data; start halsampler with '-r N' to attach to
+    reader N.
+
 
 */
 
@@ -68,6 +73,8 @@ static char *cfg[MAX_SAMPLERS];	/* config string, no default */
 RTAPI_MP_ARRAY_STRING(cfg,MAX_SAMPLERS,"config string");
 static int depth[MAX_SAMPLERS];	/* depth of fifo, default 0 */
 RTAPI_MP_ARRAY_INT(depth,MAX_SAMPLERS,"fifo depth");
+static int readers[MAX_SAMPLERS];	/* number of fifos, default 1 */
+RTAPI_MP_ARRAY_INT(readers,MAX_SAMPLERS,"number of independent readers");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -76,7 +83,8 @@ RTAPI_MP_ARRAY_INT(depth,MAX_SAMPLERS,"fifo depth");
 /* this structure contains the HAL shared memory data for one sampler */
 
 typedef struct {
-    hal_stream_t fifo;		/* pointer to user/RT fifo */
+    hal_stream_t fifo[MAX_SAMPLER_READERS];	/* user/RT fifo per reader */
+    int num_readers;
     hal_s32_t *curr_depth;	/* pin: current fifo depth */
     hal_bit_t *full;		/* pin: overrun flag */
     hal_bit_t *enable;		/* pin: enable sampling */
@@ -104,7 +112,7 @@ static void sample(void *arg, long period);
 
 int rtapi_app_main(void)
 {
-    int n, retval;
+    int n, r, retval;
 
     comp_id = hal_init("sampler");
     if (comp_id < 0) {
@@ -115,13 +123,28 @@ int rtapi_app_main(void)
     samplers = hal_malloc(MAX_SAMPLERS * sizeof(sampler_t));
     /* validate config info */
     for ( n = 0 ; n < MAX_SAMPLERS ; n++ ) {
-	if (( cfg[n] == NULL ) || ( *cfg == '\0' ) || ( depth[n] <= 0 )) {
+	if (( cfg[n] == NULL ) || ( *cfg[n] == '\0' ) || ( depth[n] <= 0 )) {
 	    break;
 	}
-	retval = hal_stream_create(&samplers[n].fifo, comp_id, SAMPLER_SHMEM_KEY+n, depth[n], cfg[n]);
-	if(retval < 0) {
+	if ( readers[n] <= 0 ) {
+	    readers[n] = 1;
+	}
+	if ( readers[n] > MAX_SAMPLER_READERS ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SAMPLER: ERROR: at most %d readers per sampler\n",
+		MAX_SAMPLER_READERS);
+	    retval = -EINVAL;
 	    goto fail;
 	}
+	samplers[n].num_readers = 0;
+	for ( r = 0 ; r < readers[n] ; r++ ) {
+	    retval = hal_stream_create(&samplers[n].fifo[r], comp_id,
+		SAMPLER_READER_KEY(n, r), depth[n], cfg[n]);
+	    if(retval < 0) {
+		goto fail;
+	    }
+	    samplers[n].num_readers++;
+	}
 	nsamplers++;
 	retval = init_sampler(n, &samplers[n]);
     }
@@ -134,15 +157,21 @@ int rtapi_app_main(void)
     hal_ready(comp_id);
     return 0;
 fail:
-    for(n=0; n<nsamplers; n++) hal_stream_detach(&samplers[n].fifo);
+    for(n=0; n<=nsamplers && n<MAX_SAMPLERS; n++) {
+	for(r=0; r<samplers[n].num_readers; r++)
+	    hal_stream_detach(&samplers[n].fifo[r]);
+    }
     hal_exit(comp_id);
     return retval;
 }
 
 void rtapi_app_exit(void)
 {
-    int i;
-    for(i=0; i<nsamplers; i++) hal_stream_detach(&samplers[i].fifo);
+    int i, r;
+    for(i=0; i<nsamplers; i++) {
+	for(r=0; r<samplers[i].num_readers; r++)
+	    hal_stream_detach(&samplers[i].fifo[r]);
+    }
     hal_exit(comp_id);
 }
 
@@ -154,23 +183,31 @@ static void sample(void *arg, long period)
 {
     sampler_t *samp;
     pin_data_t *pptr;
-    int n;
+    int n, r, d, full, lost;
+    hal_s32_t curr_depth;
 
     /* point at sampler struct in HAL shmem */
     samp = arg;
     /* are we enabled? */
     if ( ! *(samp->enable) ) {
-	*(samp->curr_depth) = hal_stream_depth(&samp->fifo);
-	*(samp->full) = !hal_stream_writable(&samp->fifo);
+	curr_depth = 0;
+	full = 0;
+	for ( r = 0 ; r < samp->num_readers ; r++ ) {
+	    d = hal_stream_depth(&samp->fifo[r]);
+	    if ( d > curr_depth ) curr_depth = d;
+	    if ( !hal_stream_writable(&samp->fifo[r]) ) full = 1;
+	}
+	*(samp->curr_depth) = curr_depth;
+	*(samp->full) = full;
 	return;
     }
     /* point at pins in hal shmem */
     pptr = samp->pins;
     union hal_stream_data data[HAL_STREAM_MAX_PINS], *dptr=data;
     /* copy data from HAL pins to fifo */
-    int num_pins = hal_stream_element_count(&samp->fifo);
+    int num_pins = hal_stream_element_count(&samp->fifo[0]);
     for ( n = 0 ; n < num_pins ; n++ ) {
-	switch ( hal_stream_element_type(&samp->fifo, n) ) {
+	switch ( hal_stream_element_type(&samp->fifo[0], n) ) {
 	case HAL_FLOAT:
 	    dptr->f = *(pptr->hfloat);
 	    break;
@@ -193,16 +230,25 @@ static void sample(void *arg, long period)
 	dptr++;
 	pptr++;
     }
-    if ( hal_stream_write(&samp->fifo, data) < 0) {
-	/* fifo is full, data is lost */
+    /* every reader gets its own copy of the sample */
+    lost = 0;
+    curr_depth = 0;
+    for ( r = 0 ; r < samp->num_readers ; r++ ) {
+	if ( hal_stream_write(&samp->fifo[r], data) < 0) {
+	    /* fifo is full, data is lost for this reader */
+	    lost = 1;
+	    d = hal_stream_maxdepth(&samp->fifo[r]);
+	} else {
+	    d = hal_stream_depth(&samp->fifo[r]);
+	}
+	if ( d > curr_depth ) curr_depth = d;
+    }
+    if ( lost ) {
         /* log the overrun */
 	(*samp->overruns)++;
-	*(samp->full) = 1;
-	*(samp->curr_depth) = hal_stream_maxdepth(&samp->fifo);
-    } else {
-	*(samp->full) = 0;
-	*(samp->curr_depth) = hal_stream_depth(&samp->fifo);
     }
+    *(samp->full) = lost;
+    *(samp->curr_depth) = curr_depth;
 }
 
 /***********************************************************************
@@ -260,16 +306,16 @@ static int init_sampler(int num, sampler_t *str)
     pptr = str->pins;
     usefp = 0;
     /* export user specified pins (the ones that sample data) */
-    for ( n = 0 ; n < hal_stream_element_count(&str->fifo) ; n++ ) {
+    for ( n = 0 ; n < hal_stream_element_count(&str->fifo[0]) ; n++ ) {
 	rtapi_snprintf(buf, sizeof(buf), "sampler.%d.pin.%d", num, n);
-	retval = hal_pin_new(buf, hal_stream_element_type(&str->fifo, n), HAL_IN, (void **)pptr, comp_id );
+	retval = hal_pin_new(buf, hal_stream_element_type(&str->fifo[0], n), HAL_IN, (void **)pptr, comp_id );
 	if (retval != 0 ) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"SAMPLER: ERROR: pin '%s' export failed\n", buf);
 	    return -EIO;
 	}
 	/* init the pin value */
-	switch ( hal_stream_element_type(&str->fifo, n) ) {
+	switch ( hal_stream_element_type(&str->fifo[0], n) ) {
 	case HAL_FLOAT:
 	    *(pptr->hfloat) = 0.0;
 	    usefp = 1;
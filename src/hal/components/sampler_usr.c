@@ -20,11 +20,15 @@
 
     Invoking:
 
-    halsampler [-c chan_num] [-n num_samples] [-t]
+    halsampler [-c chan_num] [-r reader] [-n num_samples] [-t] [-b]
 
     'chan_num', if present, specifies the sampler channel to use.
     The default is channel zero.
 
+    'reader', if present, specifies which of the channel's fifos
+    to read (see the 'readers' parameter of sampler).  The default
+    is reader zero.
+
     'num_samples', if present, specifies the number of samples
     to be printed, after which the program will exit.  If ommitted
     it will print continuously until killed.
@@ -32,6 +36,14 @@
     '-t' tells sampler to print the sample number at the start
     of each line.
 
+    '-b' writes raw binary records instead of text: one
+    'union hal_stream_data' per pin, preceded by the 32 bit sample
+    number if '-t' is also given.  Overruns are reported on stderr.
+
+    Samples are taken from the fifo in batches of up to STREAM_BATCH,
+    so a slow terminal or disk costs one fifo update per batch rather
+    than one per sample.
+
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -69,6 +81,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
 
 #include "rtapi.h"		/* RTAPI realtime OS API */
 #include "hal.h"                /* HAL public API decls */
@@ -102,20 +116,67 @@ static void quit(int sig)
     stop = 1;
 }
 
-#define BUF_SIZE 4000
+static int print_sample(hal_stream_t *stream, union hal_stream_data *buf,
+    int num_pins)
+{
+    int n;
+
+    for ( n = 0 ; n < num_pins; n++ ) {
+	switch ( hal_stream_element_type(stream, n) ) {
+	case HAL_FLOAT:
+	    printf ( "%f ", buf[n].f);
+	    break;
+	case HAL_BIT:
+	    if ( buf[n].b ) {
+		printf ( "1 " );
+	    } else {
+		printf ( "0 " );
+	    }
+	    break;
+	case HAL_U32:
+	    printf ( "%lu ", (unsigned long)buf[n].u);
+	    break;
+	case HAL_S32:
+	    printf ( "%ld ", (long)buf[n].s);
+	    break;
+	default:
+	    /* better not happen */
+	    return -1;
+	}
+    }
+    printf ( "\n" );
+    return 0;
+}
+
+static int write_sample(union hal_stream_data *buf, int num_pins,
+    unsigned this_sample, int tag)
+{
+    uint32_t sampleno = this_sample - 1;
+
+    if ( tag && fwrite(&sampleno, sizeof(sampleno), 1, stdout) != 1 ) {
+	return -1;
+    }
+    if ( fwrite(buf, sizeof(*buf), num_pins, stdout) != (size_t)num_pins ) {
+	return -1;
+    }
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
-    int n, channel, tag;
+    int n, i, count, channel, reader, tag, binary;
     long int samples;
-    unsigned this_sample, last_sample=0;
+    unsigned last_sample=0, *sampleno = NULL;
+    union hal_stream_data *buf = NULL;
     char *cp, *cp2;
     hal_stream_t stream;
 
     /* set return code to "fail", clear it later if all goes well */
     exitval = 1;
     channel = 0;
+    reader = 0;
     tag = 0;
+    binary = 0;
     samples = -1;  /* -1 means run forever */
     /* FIXME - if I wasn't so lazy I'd learn how to use getopt() here */
     for ( n = 1 ; n < argc ; n++ ) {
@@ -134,6 +195,16 @@ int main(int argc, char **argv)
 		exit(1);
 	    }
 	    break;
+	case 'r':
+	    if (( *(++cp) == '\0' ) && ( ++n < argc )) {
+		cp = argv[n];
+	    }
+	    reader = strtol(cp, &cp2, 10);
+	    if (( *cp2 ) || ( reader < 0 ) || ( reader >= MAX_SAMPLER_READERS )) {
+		fprintf(stderr,"ERROR: invalid reader number '%s'\n", cp );
+		exit(1);
+	    }
+	    break;
 	case 'n':
 	    if (( *(++cp) == '\0' ) && ( ++n < argc )) { 
 		cp = argv[n];
@@ -147,6 +218,9 @@ int main(int argc, char **argv)
 	case 't':
 	    tag = 1;
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default:
 	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
 	    exit(1);
@@ -160,7 +234,11 @@ int main(int argc, char **argv)
 	    exit(1);
 	}
 	// make stdout be the named file
-	fd = open(argv[n], O_WRONLY | O_CREAT, 0666);
+	fd = open(argv[n], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+	    perror(argv[n]);
+	    exit(1);
+	}
 	close(1);
 	dup2(fd, 1);
     }
@@ -182,57 +260,55 @@ int main(int argc, char **argv)
 	goto out;
     }
     hal_ready(comp_id);
-    int res = hal_stream_attach(&stream, comp_id, SAMPLER_SHMEM_KEY+channel, 0);
+    int res = hal_stream_attach(&stream, comp_id,
+	SAMPLER_READER_KEY(channel, reader), 0);
     if (res < 0) {
 	errno = -res;
 	perror("hal_stream_attach");
 	goto out;
     }
     int num_pins = hal_stream_element_count(&stream);
+    buf = malloc(sizeof(*buf) * num_pins * STREAM_BATCH);
+    sampleno = malloc(sizeof(*sampleno) * STREAM_BATCH);
+    if ( buf == NULL || sampleno == NULL ) {
+	fprintf(stderr, "ERROR: out of memory\n");
+	goto out;
+    }
     while ( samples != 0 ) {
-	union hal_stream_data buf[num_pins];
 	hal_stream_wait_readable(&stream, &stop);
 	if(stop) break;
-	int res = hal_stream_read(&stream, buf, &this_sample);
-	if (res < 0) {
-	    errno = -res;
-	    perror("hal_stream_read");
-	    goto out;
-	}
-	++last_sample;
-	if ( this_sample != last_sample ) {
-	    printf ( "overrun\n");
-	    last_sample = this_sample;
-	}
-	if ( tag ) {
-	    printf ( "%d ", this_sample-1 );
+	count = STREAM_BATCH;
+	if ( samples > 0 && samples < count ) {
+	    count = samples;
 	}
-	for ( n = 0 ; n < num_pins; n++ ) {
-	    switch ( hal_stream_element_type(&stream, n) ) {
-	    case HAL_FLOAT:
-		printf ( "%f ", buf[n].f);
-		break;
-	    case HAL_BIT:
-		if ( buf[n].b ) {
-		    printf ( "1 " );
+	count = hal_stream_read_many(&stream, buf, sampleno, count);
+	for ( i = 0 ; i < count ; i++ ) {
+	    unsigned this_sample = sampleno[i];
+	    ++last_sample;
+	    if ( this_sample != last_sample ) {
+		if ( binary ) {
+		    fprintf ( stderr, "overrun\n");
 		} else {
-		    printf ( "0 " );
+		    printf ( "overrun\n");
+		}
+		last_sample = this_sample;
+	    }
+	    if ( binary ) {
+		if ( write_sample(&buf[i * num_pins], num_pins, this_sample,
+			tag) < 0 ) {
+		    goto out;
+		}
+	    } else {
+		if ( tag ) {
+		    printf ( "%d ", this_sample-1 );
+		}
+		if ( print_sample(&stream, &buf[i * num_pins], num_pins) < 0 ) {
+		    goto out;
 		}
-		break;
-	    case HAL_U32:
-		printf ( "%lu ", (unsigned long)buf[n].u);
-		break;
-	    case HAL_S32:
-		printf ( "%ld ", (long)buf[n].s);
-		break;
-	    default:
-		/* better not happen */
-		goto out;
 	    }
 	}
-	printf ( "\n" );
 	if ( samples > 0 ) {
-	    samples--;
+	    samples -= count;
 	}
     }
     /* run was succesfull */
@@ -240,6 +316,9 @@ int main(int argc, char **argv)
 
 out:
     ignore_sig = 1;
+    fflush(stdout);
+    free(buf);
+    free(sampleno);
     hal_stream_detach(&stream);
     if ( comp_id >= 0 ) {
 	hal_exit(comp_id);
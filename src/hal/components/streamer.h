@@ -10,12 +10,17 @@
 *
 ********************************************************************/
 
-#define MAX_STREAMERS		8
-#define MAX_SAMPLERS		8
-#define MAX_PINS 		20
-#define MAX_SHMEM 		128000
+#define MAX_STREAMERS		16
+#define MAX_SAMPLERS		16
+#define MAX_SAMPLER_READERS	4
 #define STREAMER_SHMEM_KEY 	0x48535430
 #define SAMPLER_SHMEM_KEY	0x48534130
+/* each reader of a sampler gets its own fifo; reader 0 uses the
+   original key so existing programs keep working */
+#define SAMPLER_READER_KEY(chan, reader) \
+	(SAMPLER_SHMEM_KEY + (chan) + ((reader) << 8))
+/* number of records moved per batch by halsampler/halstreamer */
+#define STREAM_BATCH		1024
 
 /* this struct lives in HAL shared memory */
 
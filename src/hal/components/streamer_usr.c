@@ -20,13 +20,19 @@
 
     Invoking:
 
-    halstreamer [chan_num]
+    halstreamer [-c chan_num] [-b] [filename]
 
     'chan_num', if present, specifies the streamer channel to use.
     The default is channel zero.  Since hal_stream takes its data
     from stdin, it will almost always either need to have stdin 
     redirected from a file, or have data piped into it from some
     other program.
+
+    '-b' reads raw binary records instead of text: one
+    'union hal_stream_data' per pin, as written by 'halsampler -b'
+    (without '-t').  When the input is a regular file it is mapped
+    into memory and copied straight from the mapping into the fifo;
+    otherwise it is read in batches of STREAM_BATCH records.
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -64,6 +70,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
 
 #include "rtapi.h"		/* RTAPI realtime OS API */
 #include "hal.h"                /* HAL public API decls */
@@ -99,9 +107,71 @@ static void quit(int sig)
 
 #define BUF_SIZE 4000
 
+/* copy 'count' records into the fifo, waiting for room as needed;
+   returns the number of records written before a stop request */
+static long write_records(hal_stream_t *stream, union hal_stream_data *data,
+    long count)
+{
+    int num_pins = hal_stream_element_count(stream);
+    long done = 0;
+
+    while ( done < count ) {
+	hal_stream_wait_writable(stream, &stop);
+	if ( stop ) {
+	    break;
+	}
+	long batch = count - done;
+	if ( batch > STREAM_BATCH ) {
+	    batch = STREAM_BATCH;
+	}
+	done += hal_stream_write_many(stream, data + done * num_pins, batch);
+    }
+    return done;
+}
+
+static int stream_binary(hal_stream_t *stream)
+{
+    int num_pins = hal_stream_element_count(stream);
+    size_t record = sizeof(union hal_stream_data) * num_pins;
+    struct stat st;
+
+    if ( fstat(0, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 ) {
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, 0, 0);
+	if ( map != MAP_FAILED ) {
+	    long count = st.st_size / record;
+	    madvise(map, st.st_size, MADV_SEQUENTIAL);
+	    if ( st.st_size % record ) {
+		fprintf(stderr, "WARNING: ignoring %ld trailing bytes\n",
+		    (long)(st.st_size % record));
+	    }
+	    write_records(stream, map, count);
+	    munmap(map, st.st_size);
+	    return 0;
+	}
+	/* fall back to reading */
+    }
+
+    union hal_stream_data *data = malloc(record * STREAM_BATCH);
+    if ( data == NULL ) {
+	fprintf(stderr, "ERROR: out of memory\n");
+	return -1;
+    }
+    while ( !stop ) {
+	size_t count = fread(data, record, STREAM_BATCH, stdin);
+	if ( count == 0 ) {
+	    break;
+	}
+	if ( write_records(stream, data, count) < (long)count ) {
+	    break;
+	}
+    }
+    free(data);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
-    int n, channel, line=0;
+    int n, channel, binary, line=0;
     char *cp, *cp2;
     hal_stream_t stream;
     char buf[BUF_SIZE];
@@ -110,6 +180,7 @@ int main(int argc, char **argv)
     /* set return code to "fail", clear it later if all goes well */
     exitval = 1;
     channel = 0;
+    binary = 0;
     for ( n = 1 ; n < argc ; n++ ) {
 	cp = argv[n];
 	if ( *cp != '-' ) {
@@ -126,6 +197,9 @@ int main(int argc, char **argv)
 		exit(1);
 	    }
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default:
 	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
 	    exit(1);
@@ -140,6 +214,10 @@ int main(int argc, char **argv)
 	}
 	// make stdin be the named file
 	fd = open(argv[n], O_RDONLY);
+	if (fd < 0) {
+	    perror(argv[n]);
+	    exit(1);
+	}
 	close(0);
 	dup2(fd, 0);
     }
@@ -169,6 +247,12 @@ int main(int argc, char **argv)
 	goto out;
     }
     int num_pins = hal_stream_element_count(&stream);
+    if ( binary ) {
+	if ( stream_binary(&stream) == 0 ) {
+	    exitval = 0;
+	}
+	goto out;
+    }
     while ( fgets(buf, BUF_SIZE, stdin) ) {
 	/* skip comment lines */
 	if ( buf[0] == '#' ) {
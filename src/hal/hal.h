@@ -745,7 +745,7 @@ typedef struct {
  * There may only be one reader and one writer but this is not enforced
  */
 
-#define HAL_STREAM_MAX_PINS (21)
+#define HAL_STREAM_MAX_PINS (64)
 /** create and attach a stream */
 extern int hal_stream_create(hal_stream_t *stream, int comp, int key, int depth, const char *typestring);
 /** detach and destroy an open stream */
@@ -763,6 +763,10 @@ extern hal_type_t hal_stream_element_type(hal_stream_t *stream, int idx);
 // only one reader and one writer is allowed.
 extern int hal_stream_read(hal_stream_t *stream, union hal_stream_data *buf, unsigned *sampleno);
 extern bool hal_stream_readable(hal_stream_t *stream);
+/** read up to 'count' samples into 'buf' (and their sample numbers into
+    'sampleno', if not NULL) with a single update of the fifo index;
+    returns the number of samples read */
+extern int hal_stream_read_many(hal_stream_t *stream, union hal_stream_data *buf, unsigned *sampleno, int count);
 extern int hal_stream_depth(hal_stream_t *stream);
 extern int hal_stream_maxdepth(hal_stream_t *stream);
 extern int hal_stream_num_underruns(hal_stream_t *stream);
@@ -773,6 +777,9 @@ extern void hal_stream_wait_readable(hal_stream_t *stream, sig_atomic_t *stop);
 
 extern int hal_stream_write(hal_stream_t *stream, union hal_stream_data *buf);
 extern bool hal_stream_writable(hal_stream_t *stream);
+/** write up to 'count' samples from 'buf' with a single update of the
+    fifo index; returns the number of samples written */
+extern int hal_stream_write_many(hal_stream_t *stream, union hal_stream_data *buf, int count);
 #ifdef ULAPI
 extern void hal_stream_wait_writable(hal_stream_t *stream, sig_atomic_t *stop);
 #endif
@@ -3550,7 +3550,7 @@ int hal_stream_depth(hal_stream_t *stream) {
     int out = stream->fifo->out;
     int in = stream->fifo->in;
     int result = in - out;
-    if(result < 0) result += stream->fifo->depth - 1;
+    if(result < 0) result += stream->fifo->depth;
     return result;
 }
 
@@ -3611,6 +3611,27 @@ int hal_stream_write(hal_stream_t *stream, union hal_stream_data *buf) {
     return 0;
 }
 
+int hal_stream_write_many(hal_stream_t *stream, union hal_stream_data *buf, int count) {
+    int in = hal_stream_atomic_load_in(stream),
+        out = hal_stream_atomic_load_out(stream);
+    int depth = stream->fifo->depth;
+    int num_pins = stream->fifo->num_pins;
+    int stride = num_pins + 1;
+    int space = out - in - 1, n;
+    if(space < 0) space += depth;
+    if(count > space) count = space;
+    for(n = 0; n < count; n++) {
+        union hal_stream_data *dptr = &stream->fifo->data[in * stride];
+        memcpy(dptr, buf, sizeof(union hal_stream_data) * num_pins);
+        dptr[num_pins].s = ++stream->fifo->this_sample;
+        buf += num_pins;
+        in = hal_stream_advance(stream, in);
+    }
+    /* publish the whole batch at once */
+    if(count) hal_stream_atomic_store_in(stream, in);
+    return count;
+}
+
 int hal_stream_read(hal_stream_t *stream, union hal_stream_data *buf, unsigned *this_sample) {
     if(!hal_stream_readable(stream)) {
         stream->fifo->num_underruns ++;
@@ -3627,6 +3648,27 @@ int hal_stream_read(hal_stream_t *stream, union hal_stream_data *buf, unsigned *
     return 0;
 }
 
+int hal_stream_read_many(hal_stream_t *stream, union hal_stream_data *buf, unsigned *this_sample, int count) {
+    int out = hal_stream_atomic_load_out(stream),
+        in = hal_stream_atomic_load_in(stream);
+    int depth = stream->fifo->depth;
+    int num_pins = stream->fifo->num_pins;
+    int stride = num_pins + 1;
+    int avail = in - out, n;
+    if(avail < 0) avail += depth;
+    if(count > avail) count = avail;
+    for(n = 0; n < count; n++) {
+        union hal_stream_data *dptr = &stream->fifo->data[out * stride];
+        memcpy(buf, dptr, sizeof(union hal_stream_data) * num_pins);
+        if(this_sample) this_sample[n] = dptr[num_pins].s;
+        buf += num_pins;
+        out = hal_stream_advance(stream, out);
+    }
+    /* release the whole batch at once */
+    if(count) hal_stream_atomic_store_out(stream, out);
+    return count;
+}
+
 int hal_stream_attach(hal_stream_t *stream, int comp_id, int key, const char *typestring) {
     int i;
 
@@ -3794,6 +3836,8 @@ EXPORT_SYMBOL_GPL(hal_stream_depth);
 EXPORT_SYMBOL_GPL(hal_stream_maxdepth);
 EXPORT_SYMBOL_GPL(hal_stream_write);
 EXPORT_SYMBOL_GPL(hal_stream_read);
+EXPORT_SYMBOL_GPL(hal_stream_write_many);
+EXPORT_SYMBOL_GPL(hal_stream_read_many);
 EXPORT_SYMBOL_GPL(hal_stream_attach);
 EXPORT_SYMBOL_GPL(hal_stream_detach);
 EXPORT_SYMBOL_GPL(hal_stream_element_count);
@@ -1056,13 +1056,12 @@ int do_status_cmd(char *type)
     return 0;
 }
 
+static int loadrt_finish(char *mod_name, char *args[]);
+
 int do_loadrt_cmd(char *mod_name, char *args[])
 {
-    char arg_string[MAX_CMD_LEN+1];
     int m=0, n=0, retval;
-    hal_comp_t *comp;
     char *argv[MAX_TOK+3];
-    char *cp1;
 #if defined(RTAPI_USPACE)
     argv[m++] = "-Wn";
     argv[m++] = mod_name;
@@ -1133,6 +1132,17 @@ int do_loadrt_cmd(char *mod_name, char *args[])
         , mod_name, retval );
 	return -1;
     }
+    return loadrt_finish(mod_name, args);
+}
+
+/* record the arguments of a module that was just loaded */
+static int loadrt_finish(char *mod_name, char *args[])
+{
+    char arg_string[MAX_CMD_LEN+1];
+    int n;
+    hal_comp_t *comp;
+    char *cp1;
+
     /* make the args that were passed to the module into a single string */
     n = 0;
     arg_string[0] = '\0';
@@ -1165,6 +1175,176 @@ int do_loadrt_cmd(char *mod_name, char *args[])
     return 0;
 }
 
+#if defined(RTAPI_USPACE)
+/* Consecutive loadrt commands from a file are collected here and sent to
+   rtapi_app as one 'batch' command, instead of starting one rtapi_app
+   client (and polling for the new component) per module. */
+#define MAX_LOADRT_BATCH 200	/* keeps the failing index in an exit code */
+
+static struct {
+    char *mod_name;
+    char **args;
+    int linenumber;
+} loadrt_batch[MAX_LOADRT_BATCH];
+static int loadrt_batch_len;
+
+static void loadrt_batch_free(int i)
+{
+    char **cp;
+    for ( cp = loadrt_batch[i].args ; *cp ; cp++ ) {
+	free(*cp);
+    }
+    free(loadrt_batch[i].args);
+    free(loadrt_batch[i].mod_name);
+}
+
+int halcmd_loadrt_defer(char *mod_name, char *args[], int keep_going)
+{
+    int n, errors = 0;
+    char **copy;
+
+    if ( loadrt_batch_len == MAX_LOADRT_BATCH ) {
+	errors = halcmd_loadrt_flush(keep_going);
+	if ( errors && !keep_going ) {
+	    return errors;
+	}
+    }
+    for ( n = 0 ; args[n] && args[n][0] != '\0' ; n++ ) {
+    }
+    copy = calloc(n + 1, sizeof(char *));
+    if ( copy == NULL ) {
+	halcmd_error("out of memory\n");
+	return errors + 1;
+    }
+    for ( n = 0 ; args[n] && args[n][0] != '\0' ; n++ ) {
+	copy[n] = strdup(args[n]);
+    }
+    loadrt_batch[loadrt_batch_len].mod_name = strdup(mod_name);
+    loadrt_batch[loadrt_batch_len].args = copy;
+    loadrt_batch[loadrt_batch_len].linenumber = halcmd_get_linenumber();
+    loadrt_batch_len++;
+    return errors;
+}
+
+/* whether an rtapi_app master is running, which a batch only talks to */
+static int rtapi_master_running(void)
+{
+    char *argv[] = { EMC2_BIN_DIR "/rtapi_app", "status", NULL };
+    int status, retval;
+    pid_t pid;
+
+    pid = hal_systemv_nowait(argv);
+    if ( pid < 0 ) {
+	return 0;
+    }
+    retval = waitpid(pid, &status, 0);
+    if (comp_id < 0) {
+	fprintf(stderr, "halcmd: hal_init() failed after systemv: %d\n", comp_id );
+	exit(-1);
+    }
+    hal_ready(comp_id);
+    return retval >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int halcmd_loadrt_flush(int keep_going)
+{
+    char *argv[MAX_LOADRT_BATCH * (MAX_TOK + 3) + 3];
+    char counts[MAX_LOADRT_BATCH][16];
+    int i, m = 0, n, status, first = 0, failed = -1, errors = 0;
+    int linenumber = halcmd_get_linenumber();
+    pid_t pid;
+
+    /* A lone module gains nothing from a batch.  Without a master, the
+       rtapi_app of a batch would become the master, which runs the
+       threads and never exits; so the first module starts it the way a
+       lone loadrt does, waiting for its component and not the process. */
+    while ( first < loadrt_batch_len &&
+	    (loadrt_batch_len - first == 1 || !rtapi_master_running()) ) {
+	halcmd_set_linenumber(loadrt_batch[first].linenumber);
+	if ( do_loadrt_cmd(loadrt_batch[first].mod_name,
+		loadrt_batch[first].args) != 0 ) {
+	    errors++;
+	    if ( !keep_going ) {
+		goto out;
+	    }
+	}
+	first++;
+    }
+    if ( first == loadrt_batch_len ) {
+	goto out;
+    }
+    if (hal_get_lock()&HAL_LOCK_LOAD) {
+	halcmd_error("HAL is locked, loading of modules is not permitted\n");
+	errors = 1;
+	goto out;
+    }
+
+    argv[m++] = EMC2_BIN_DIR "/rtapi_app";
+    argv[m++] = "batch";
+    for ( i = first ; i < loadrt_batch_len ; i++ ) {
+	for ( n = 0 ; loadrt_batch[i].args[n] ; n++ ) {
+	}
+	snprintf(counts[i], sizeof(counts[i]), "%d", n + 2);
+	argv[m++] = counts[i];
+	argv[m++] = "load";
+	argv[m++] = loadrt_batch[i].mod_name;
+	for ( n = 0 ; loadrt_batch[i].args[n] ; n++ ) {
+	    argv[m++] = loadrt_batch[i].args[n];
+	}
+    }
+    argv[m] = NULL;
+
+    pid = hal_systemv_nowait(argv);
+    if ( waitpid(pid, &status, 0) < 0 ) {
+	halcmd_error("waitpid(%d) failed: %s\n", pid, strerror(errno));
+	errors = 1;
+	goto out;
+    }
+    if (comp_id < 0) {
+	fprintf(stderr, "halcmd: hal_init() failed after systemv: %d\n", comp_id );
+	exit(-1);
+    }
+    hal_ready(comp_id);
+    if ( !WIFEXITED(status) ) {
+	halcmd_error("child did not exit normally\n");
+	errors = 1;
+	goto out;
+    }
+    /* rtapi_app exits with k+1 when command k failed */
+    status = WEXITSTATUS(status);
+    if ( status > 0 && status <= loadrt_batch_len - first ) {
+	failed = first + status - 1;
+    } else if ( status != 0 ) {
+	halcmd_error("rtapi_app batch failed, exit value: %d\n", status);
+	errors = 1;
+	goto out;
+    }
+
+    for ( i = first ; i < loadrt_batch_len ; i++ ) {
+	halcmd_set_linenumber(loadrt_batch[i].linenumber);
+	if ( failed < 0 || i < failed ) {
+	    errors += loadrt_finish(loadrt_batch[i].mod_name,
+		loadrt_batch[i].args) != 0;
+	} else if ( i == failed ) {
+	    halcmd_error("insmod for %s failed\n", loadrt_batch[i].mod_name);
+	    errors++;
+	} else if ( keep_going ) {
+	    /* the batch stopped early; carry on one module at a time */
+	    errors += do_loadrt_cmd(loadrt_batch[i].mod_name,
+		loadrt_batch[i].args) != 0;
+	}
+    }
+
+out:
+    halcmd_set_linenumber(linenumber);
+    for ( i = 0 ; i < loadrt_batch_len ; i++ ) {
+	loadrt_batch_free(i);
+    }
+    loadrt_batch_len = 0;
+    return errors;
+}
+#endif
+
 int do_delsig_cmd(char *mod_name)
 {
     int next, retval, retval1, n;
@@ -2712,6 +2892,489 @@ static void save_unconnected_input_pin_values(FILE *dst)
     }
 }
 
+/* Binary snapshots of the HAL state.  A snapshot is taken in a single
+   pass over the pin, signal, parameter and thread lists while holding
+   the HAL mutex, and stores raw values instead of formatted text, so
+   it is cheap enough to take many times a minute on a running
+   machine.  All formatting is left to 'diff'.
+
+   File layout (native byte order, checked by SNAPSHOT_BOM):
+     header:  magic[8], u32 version, u32 bom, s64 time (ns), u32 count
+     records: u8 kind, u8 type, u8 dir, u8 name_len, name
+              pin:    u8 link_len, link, u64 value
+              sig:    u64 value
+              param:  u64 value
+              thread: s64 period, s64 time, s64 max_time
+*/
+
+#define SNAPSHOT_MAGIC "HALSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BOM 0x01020304
+
+enum { SNAP_PIN = 1, SNAP_SIG, SNAP_PARAM, SNAP_THREAD };
+
+typedef struct {
+    int kind, type, dir;
+    char name[HAL_NAME_LEN + 1];
+    char link[HAL_NAME_LEN + 1];
+    rtapi_u64 value;		/* raw data, or thread period */
+    rtapi_s64 time, max_time;	/* thread timing */
+} snap_entry_t;
+
+typedef struct {
+    char *buf;
+    size_t len, size;
+    int count;
+    int failed;			/* set if an allocation failed */
+} snap_buf_t;
+
+static void snap_put(snap_buf_t *sb, const void *data, size_t len)
+{
+    if (sb->failed) return;
+    if (sb->len + len > sb->size) {
+	size_t size = sb->size ? sb->size * 2 : 65536;
+	char *buf;
+	while (size < sb->len + len) size *= 2;
+	buf = realloc(sb->buf, size);
+	if (!buf) {
+	    sb->failed = 1;
+	    return;
+	}
+	sb->buf = buf;
+	sb->size = size;
+    }
+    memcpy(sb->buf + sb->len, data, len);
+    sb->len += len;
+}
+
+static void snap_put_name(snap_buf_t *sb, const char *name)
+{
+    unsigned char len = strlen(name);
+    snap_put(sb, &len, 1);
+    snap_put(sb, name, len);
+}
+
+static void snap_put_head(snap_buf_t *sb, int kind, int type, int dir,
+    const char *name)
+{
+    unsigned char head[3] = { kind, type, dir };
+    snap_put(sb, head, 3);
+    snap_put_name(sb, name);
+    sb->count++;
+}
+
+static rtapi_u64 snap_raw_value(int type, void *valptr)
+{
+    switch (type) {
+    case HAL_BIT:
+	return *((hal_bit_t *) valptr) ? 1 : 0;
+    case HAL_FLOAT:
+	{
+	    union { hal_float_t f; rtapi_u64 u; } v;
+	    v.f = *((hal_float_t *) valptr);
+	    return v.u;
+	}
+    case HAL_S32:
+	return (rtapi_u64) (rtapi_s64) *((hal_s32_t *) valptr);
+    case HAL_U32:
+	return *((hal_u32_t *) valptr);
+    default:
+	return 0;
+    }
+}
+
+/* walk the HAL and append one record per object to 'sb'; the caller
+   is responsible for the header */
+static void snapshot_hal(snap_buf_t *sb, rtapi_s64 *stamp)
+{
+    int next;
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+    hal_thread_t *tptr;
+    struct timespec ts;
+    rtapi_u64 value;
+    rtapi_s64 timing[3];
+    char name[HAL_NAME_LEN + 1];
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    clock_gettime(CLOCK_REALTIME, &ts);
+    *stamp = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    for (next = hal_data->pin_list_ptr; next != 0; next = pin->next_ptr) {
+	void *dptr;
+	pin = SHMPTR(next);
+	if (pin->signal != 0) {
+	    sig = SHMPTR(pin->signal);
+	    dptr = SHMPTR(sig->data_ptr);
+	} else {
+	    sig = 0;
+	    dptr = &(pin->dummysig);
+	}
+	snap_put_head(sb, SNAP_PIN, pin->type, pin->dir, pin->name);
+	snap_put_name(sb, sig ? sig->name : "");
+	value = snap_raw_value(pin->type, dptr);
+	snap_put(sb, &value, sizeof(value));
+    }
+    for (next = hal_data->sig_list_ptr; next != 0; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	snap_put_head(sb, SNAP_SIG, sig->type, 0, sig->name);
+	value = snap_raw_value(sig->type, SHMPTR(sig->data_ptr));
+	snap_put(sb, &value, sizeof(value));
+    }
+    for (next = hal_data->param_list_ptr; next != 0; next = param->next_ptr) {
+	param = SHMPTR(next);
+	snap_put_head(sb, SNAP_PARAM, param->type, param->dir, param->name);
+	value = snap_raw_value(param->type, SHMPTR(param->data_ptr));
+	snap_put(sb, &value, sizeof(value));
+    }
+    for (next = hal_data->thread_list_ptr; next != 0; next = tptr->next_ptr) {
+	tptr = SHMPTR(next);
+	snap_put_head(sb, SNAP_THREAD, HAL_S32, 0, tptr->name);
+	timing[0] = tptr->period;
+	timing[1] = 0;
+	timing[2] = tptr->maxtime;
+	snprintf(name, sizeof(name), "%s.time", tptr->name);
+	pin = halpr_find_pin_by_name(name);
+	if (pin) {
+	    if (pin->signal != 0) {
+		sig = SHMPTR(pin->signal);
+		timing[1] = *((hal_s32_t *) SHMPTR(sig->data_ptr));
+	    } else {
+		timing[1] = pin->dummysig.s;
+	    }
+	}
+	snap_put(sb, timing, sizeof(timing));
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
+static int snapshot_take(snap_buf_t *sb)
+{
+    rtapi_u32 hdr[3] = { SNAPSHOT_VERSION, SNAPSHOT_BOM, 0 };
+    rtapi_s64 stamp;
+    rtapi_u32 count;
+    size_t start;
+
+    memset(sb, 0, sizeof(*sb));
+    snap_put(sb, SNAPSHOT_MAGIC, 8);
+    snap_put(sb, hdr, 2 * sizeof(rtapi_u32));
+    /* placeholders for time and count, filled in below */
+    start = sb->len;
+    snap_put(sb, &hdr[2], sizeof(rtapi_u32));
+    snap_put(sb, &hdr[2], sizeof(rtapi_u32));
+    snap_put(sb, &hdr[2], sizeof(rtapi_u32));
+    snapshot_hal(sb, &stamp);
+    if (sb->failed) {
+	halcmd_error("snapshot: out of memory\n");
+	return -ENOMEM;
+    }
+    count = sb->count;
+    memcpy(sb->buf + start, &stamp, sizeof(stamp));
+    memcpy(sb->buf + start + sizeof(stamp), &count, sizeof(count));
+    return 0;
+}
+
+static int snap_entry_cmp(const void *a, const void *b)
+{
+    const snap_entry_t *ea = a, *eb = b;
+    if (ea->kind != eb->kind) return ea->kind - eb->kind;
+    return strcmp(ea->name, eb->name);
+}
+
+/* decode a snapshot held in memory into a sorted array of entries */
+static int snapshot_parse(const char *what, const char *buf, size_t len,
+    snap_entry_t **entries, int *count, rtapi_s64 *stamp)
+{
+    const unsigned char *p = (const unsigned char *) buf, *end = p + len;
+    rtapi_u32 version, bom, n;
+    snap_entry_t *e = NULL;
+    int i;
+
+#define SNAP_GET(dst, size) do { \
+	if (p + (size) > end) goto corrupt; \
+	memcpy((dst), p, (size)); p += (size); \
+    } while (0)
+#define SNAP_GET_NAME(dst) do { \
+	unsigned char l; SNAP_GET(&l, 1); \
+	if (l > HAL_NAME_LEN) goto corrupt; \
+	SNAP_GET((dst), l); (dst)[l] = '\0'; \
+    } while (0)
+
+    if (len < 8 || memcmp(p, SNAPSHOT_MAGIC, 8) != 0) {
+	halcmd_error("%s is not a HAL snapshot\n", what);
+	return -EINVAL;
+    }
+    p += 8;
+    SNAP_GET(&version, sizeof(version));
+    SNAP_GET(&bom, sizeof(bom));
+    if (version != SNAPSHOT_VERSION || bom != SNAPSHOT_BOM) {
+	halcmd_error("%s: unsupported snapshot version or byte order\n",
+	    what);
+	return -EINVAL;
+    }
+    SNAP_GET(stamp, sizeof(*stamp));
+    SNAP_GET(&n, sizeof(n));
+    /* every record takes at least 5 bytes */
+    if (n > len / 5) goto corrupt;
+    e = calloc(n ? n : 1, sizeof(snap_entry_t));
+    if (e == NULL) {
+	halcmd_error("snapshot: out of memory\n");
+	return -ENOMEM;
+    }
+    for (i = 0; i < n; i++) {
+	unsigned char head[3];
+	SNAP_GET(head, 3);
+	e[i].kind = head[0];
+	e[i].type = head[1];
+	e[i].dir = head[2];
+	SNAP_GET_NAME(e[i].name);
+	switch (e[i].kind) {
+	case SNAP_PIN:
+	    SNAP_GET_NAME(e[i].link);
+	    /* fall through */
+	case SNAP_SIG:
+	case SNAP_PARAM:
+	    SNAP_GET(&e[i].value, sizeof(e[i].value));
+	    break;
+	case SNAP_THREAD:
+	    SNAP_GET(&e[i].value, sizeof(e[i].value));
+	    SNAP_GET(&e[i].time, sizeof(e[i].time));
+	    SNAP_GET(&e[i].max_time, sizeof(e[i].max_time));
+	    break;
+	default:
+	    goto corrupt;
+	}
+    }
+    qsort(e, n, sizeof(snap_entry_t), snap_entry_cmp);
+    *entries = e;
+    *count = n;
+    return 0;
+
+corrupt:
+    halcmd_error("%s: snapshot is truncated or corrupt\n", what);
+    free(e);
+    return -EINVAL;
+#undef SNAP_GET
+#undef SNAP_GET_NAME
+}
+
+static int snapshot_read(const char *filename, snap_buf_t *sb)
+{
+    FILE *src;
+    long len;
+
+    memset(sb, 0, sizeof(*sb));
+    src = fopen(filename, "rb");
+    if (src == NULL) {
+	halcmd_error("Can't open snapshot '%s': %s\n", filename,
+	    strerror(errno));
+	return -errno;
+    }
+    if (fseek(src, 0, SEEK_END) != 0 || (len = ftell(src)) < 0) {
+	halcmd_error("Can't read snapshot '%s'\n", filename);
+	fclose(src);
+	return -EIO;
+    }
+    rewind(src);
+    sb->buf = malloc(len ? len : 1);
+    if (sb->buf == NULL || fread(sb->buf, 1, len, src) != (size_t) len) {
+	halcmd_error("Can't read snapshot '%s'\n", filename);
+	free(sb->buf);
+	sb->buf = NULL;
+	fclose(src);
+	return -EIO;
+    }
+    sb->len = len;
+    fclose(src);
+    return 0;
+}
+
+static const char *snap_kind_name(int kind)
+{
+    switch (kind) {
+    case SNAP_PIN: return "pin";
+    case SNAP_SIG: return "sig";
+    case SNAP_PARAM: return "param";
+    case SNAP_THREAD: return "thread";
+    default: return "unknown";
+    }
+}
+
+static char *snap_value_str(int type, rtapi_u64 value, char *buf, size_t len)
+{
+    union { hal_float_t f; rtapi_u64 u; } v;
+
+    switch (type) {
+    case HAL_BIT:
+	snprintf(buf, len, "%s", value ? "TRUE" : "FALSE");
+	break;
+    case HAL_FLOAT:
+	v.u = value;
+	snprintf(buf, len, "%.17g", (double) v.f);
+	break;
+    case HAL_S32:
+	snprintf(buf, len, "%lld", (long long) (rtapi_s64) value);
+	break;
+    case HAL_U32:
+	snprintf(buf, len, "%llu", (unsigned long long) value);
+	break;
+    default:
+	snprintf(buf, len, "unknown_type");
+    }
+    return buf;
+}
+
+static void snap_print_entry(char prefix, snap_entry_t *e)
+{
+    char buf[32];
+
+    if (e->kind == SNAP_THREAD) {
+	halcmd_output("%c%-6s %s period %lld\n", prefix,
+	    snap_kind_name(e->kind), e->name, (long long) e->value);
+    } else {
+	halcmd_output("%c%-6s %s %s\n", prefix, snap_kind_name(e->kind),
+	    e->name, snap_value_str(e->type, e->value, buf, sizeof(buf)));
+    }
+}
+
+/* print differences between two entries with the same kind and name,
+   returns the number of differences found */
+static int snap_diff_entry(snap_entry_t *a, snap_entry_t *b)
+{
+    char buf1[32], buf2[32];
+    const char *kind = snap_kind_name(a->kind);
+    int diffs = 0;
+
+    if (a->type != b->type) {
+	halcmd_output(" %-6s %s type %s => %s\n", kind, a->name,
+	    data_type2(a->type), data_type2(b->type));
+	return 1;
+    }
+    if (a->kind == SNAP_THREAD) {
+	if (a->value != b->value) {
+	    halcmd_output(" %-6s %s period %lld => %lld\n", kind, a->name,
+		(long long) a->value, (long long) b->value);
+	    diffs++;
+	}
+	if (a->time != b->time || a->max_time != b->max_time) {
+	    halcmd_output(" %-6s %s time %lld => %lld, max-time %lld => %lld\n",
+		kind, a->name, (long long) a->time, (long long) b->time,
+		(long long) a->max_time, (long long) b->max_time);
+	    diffs++;
+	}
+	return diffs;
+    }
+    if (strcmp(a->link, b->link) != 0) {
+	halcmd_output(" %-6s %s link %s => %s\n", kind, a->name,
+	    a->link[0] ? a->link : "(none)", b->link[0] ? b->link : "(none)");
+	diffs++;
+    }
+    if (a->value != b->value) {
+	halcmd_output(" %-6s %s %s => %s\n", kind, a->name,
+	    snap_value_str(a->type, a->value, buf1, sizeof(buf1)),
+	    snap_value_str(b->type, b->value, buf2, sizeof(buf2)));
+	diffs++;
+    }
+    return diffs;
+}
+
+int do_snapshot_cmd(char *filename)
+{
+    snap_buf_t sb;
+    FILE *dst;
+    int retval;
+
+    retval = snapshot_take(&sb);
+    if (retval < 0) {
+	free(sb.buf);
+	return retval;
+    }
+    /* file I/O happens after the mutex has been released */
+    dst = fopen(filename, "wb");
+    if (dst == NULL) {
+	halcmd_error("Can't open 'snapshot' destination '%s'\n", filename);
+	free(sb.buf);
+	return -1;
+    }
+    if (fwrite(sb.buf, 1, sb.len, dst) != sb.len) {
+	halcmd_error("Can't write snapshot '%s'\n", filename);
+	retval = -EIO;
+    }
+    if (fclose(dst) != 0 && retval == 0) {
+	halcmd_error("Can't write snapshot '%s'\n", filename);
+	retval = -EIO;
+    }
+    free(sb.buf);
+    return retval;
+}
+
+int do_diff_cmd(char *file1, char *file2)
+{
+    snap_buf_t sb1, sb2;
+    snap_entry_t *e1 = NULL, *e2 = NULL;
+    rtapi_s64 t1, t2;
+    int n1 = 0, n2 = 0, i, j, c, diffs, retval;
+
+    if (file1 == NULL || *file1 == '\0') {
+	halcmd_error("diff requires at least one snapshot file\n");
+	return -EINVAL;
+    }
+    memset(&sb2, 0, sizeof(sb2));
+    retval = snapshot_read(file1, &sb1);
+    if (retval < 0) {
+	return retval;
+    }
+    if (file2 == NULL || *file2 == '\0') {
+	/* compare against the running HAL */
+	file2 = "current HAL state";
+	retval = snapshot_take(&sb2);
+    } else {
+	retval = snapshot_read(file2, &sb2);
+    }
+    if (retval == 0) {
+	retval = snapshot_parse(file1, sb1.buf, sb1.len, &e1, &n1, &t1);
+    }
+    if (retval == 0) {
+	retval = snapshot_parse(file2, sb2.buf, sb2.len, &e2, &n2, &t2);
+    }
+    free(sb1.buf);
+    free(sb2.buf);
+    if (retval < 0) {
+	free(e1);
+	return retval;
+    }
+    if (scriptmode == 0) {
+	halcmd_output("Differences (%.3f s apart):\n", (t2 - t1) * 1e-9);
+    }
+    /* both lists are sorted by kind, then name, so merge them */
+    diffs = 0;
+    i = j = 0;
+    while (i < n1 || j < n2) {
+	if (i >= n1) {
+	    c = 1;
+	} else if (j >= n2) {
+	    c = -1;
+	} else {
+	    c = snap_entry_cmp(&e1[i], &e2[j]);
+	}
+	if (c < 0) {
+	    snap_print_entry('-', &e1[i++]);
+	    diffs++;
+	} else if (c > 0) {
+	    snap_print_entry('+', &e2[j++]);
+	    diffs++;
+	} else {
+	    diffs += snap_diff_entry(&e1[i++], &e2[j++]);
+	}
+    }
+    if (scriptmode == 0) {
+	halcmd_output("%d difference%s\n", diffs, diffs == 1 ? "" : "s");
+    }
+    free(e1);
+    free(e2);
+    return 0;
+}
+
 int do_setexact_cmd() {
     int retval = 0;
     rtapi_mutex_get(&(hal_data->mutex));
@@ -2891,6 +3554,19 @@ int do_help_cmd(char *command)
         printf("  If 'type' is omitted (or type is 'all'), does the equivalent of:\n");
 	printf("  'comp', 'alias', 'sigu', 'netla', 'param', and 'thread'.\n\n");
         printf("  See the man page ($man halcmd) for save option details\n");
+    } else if (strcmp(command, "snapshot") == 0) {
+	printf("snapshot filename\n");
+	printf("  Writes the values of all pins, signals and parameters, the\n");
+	printf("  links between pins and signals, and the thread timings to\n");
+	printf("  'filename' in a compact binary form.  The state is read in\n");
+	printf("  one pass while holding the HAL lock, so it is consistent.\n");
+	printf("  Use 'diff' to compare snapshots.\n");
+    } else if (strcmp(command, "diff") == 0) {
+	printf("diff file1 [file2]\n");
+	printf("  Compares two snapshots written by 'snapshot', or a snapshot\n");
+	printf("  with the current HAL state if 'file2' is omitted.  Objects\n");
+	printf("  only in 'file1' are prefixed by '-', objects only in the\n");
+	printf("  second state by '+'.\n");
     } else if (strcmp(command, "start") == 0) {
 	printf("start\n");
 	printf("  Starts all realtime threads.\n");
@@ -2956,6 +3632,7 @@ static void print_help_commands(void)
     printf("  source              Execute commands from another .hal file\n");
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
+    printf("  snapshot, diff      Save binary HAL state / compare snapshots\n");
     printf("  start, stop         Start/stop realtime threads\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  echo, unecho        Echo commands from stdin to stderr\n");
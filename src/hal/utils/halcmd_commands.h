@@ -76,6 +76,12 @@ extern int do_source_cmd(char *type);
 extern int do_status_cmd(char *type);
 extern int do_delsig_cmd(char *mod_name);
 extern int do_loadrt_cmd(char *mod_name, char *args[]);
+#if defined(RTAPI_USPACE)
+/* queue a loadrt to be sent with others in one batch; the flush returns
+   the number of modules that failed to load */
+extern int halcmd_loadrt_defer(char *mod_name, char *args[], int keep_going);
+extern int halcmd_loadrt_flush(int keep_going);
+#endif
 extern int do_unlinkp_cmd(char *mod_name);
 extern int do_unload_cmd(char *mod_name);
 extern int do_unloadrt_cmd(char *mod_name);
@@ -83,6 +89,8 @@ extern int do_unloadusr_cmd(char *mod_name);
 extern int do_loadusr_cmd(char *args[]);
 extern int do_waitusr_cmd(char *comp_name);
 extern int do_save_cmd(char *type, char *filename);
+extern int do_snapshot_cmd(char *filename);
+extern int do_diff_cmd(char *file1, char *file2);
 extern int do_setexact_cmd(void);
 
 pid_t hal_systemv_nowait(char *const argv[]);
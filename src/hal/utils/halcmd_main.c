@@ -254,6 +254,13 @@ int main(int argc, char **argv)
         }
     } else {
         int   extend_ct = 0; // extend lines with backslash (\)
+#if defined(RTAPI_USPACE)
+        /* consecutive loadrt lines of a script file are loaded in one
+           batch; not from a pipe, whose next line may be a while coming */
+        struct stat srcstat;
+        int   batch_loadrt = fstat(fileno(srcfile), &srcstat) == 0
+                             && S_ISREG(srcstat.st_mode);
+#endif
 	/* read command line(s) from 'srcfile' */
 	while (get_input(srcfile, raw_buf, MAX_CMD_LEN)) {
 	    char *tokens[MAX_TOK+1];
@@ -300,6 +307,24 @@ int main(int argc, char **argv)
 	    if(echo_mode) {
 	        halcmd_echo("%s\n", eline);
 	    }
+#if defined(RTAPI_USPACE)
+	    if (retval == 0 && batch_loadrt
+		    && strcasecmp(tokens[0], "loadrt") == 0 && *tokens[1]) {
+		errorcount += halcmd_loadrt_defer(tokens[1], &tokens[2],
+		    keep_going);
+		if (( errorcount > 0 ) && ( keep_going == 0 )) {
+		    break;
+		}
+		continue;
+	    }
+	    /* anything else may depend on the queued modules */
+	    if (batch_loadrt && ( retval != 0 || *tokens[0] )) {
+		errorcount += halcmd_loadrt_flush(keep_going);
+		if (( errorcount > 0 ) && ( keep_going == 0 )) {
+		    break;
+		}
+	    }
+#endif
 	    if (retval == 0) {
 		/* the "quit" command is not handled by parse_line() */
 		if ( ( strcasecmp(tokens[0],"quit") == 0 ) ||
@@ -324,6 +349,11 @@ int main(int argc, char **argv)
 		break;
 	    }
 	} //while get_input()
+#if defined(RTAPI_USPACE)
+        if (( errorcount == 0 ) || keep_going ) {
+            errorcount += halcmd_loadrt_flush(keep_going);
+        }
+#endif
         extend_ct=0;
     }
     /* all done */
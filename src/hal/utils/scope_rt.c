@@ -38,6 +38,7 @@
 #include "../hal_priv.h"	/* HAL private API decls */
 #include "scope_rt.h"		/* scope related declarations */
 #include "rtapi_string.h"
+#include "rtapi_atomic.h"
 
 /* module information */
 MODULE_AUTHOR("John Kasunich");
@@ -47,6 +48,10 @@ MODULE_LICENSE("GPL");
 long num_samples = 16000;
 long shm_size;
 RTAPI_MP_LONG(num_samples, "Number of samples in the shared memory block")
+long stream_chans = SCOPE_STREAM_CHANS_DEFAULT;
+RTAPI_MP_LONG(stream_chans, "Max channels for continuous capture, 0 to disable")
+long stream_len = SCOPE_STREAM_LEN_DEFAULT;
+RTAPI_MP_LONG(stream_len, "Number of words in the continuous capture ring")
 
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
@@ -61,6 +66,7 @@ scope_shm_control_t *ctrl_shm;	/* ptr to shared mem control struct */
 
 static int comp_id;		/* component ID */
 static int shm_id;		/* shared memory ID */
+static int stream_shm_id = -1;	/* stream shared memory ID */
 static scope_rt_control_t ctrl_struct;	/* realtime control structure */
 
 /***********************************************************************
@@ -69,10 +75,14 @@ static scope_rt_control_t ctrl_struct;	/* realtime control structure */
 
 static void init_rt_control_struct(void *shmem);
 static void init_shm_control_struct(void);
+static int init_stream(void);
 
 static void sample(void *arg, long period);
 static void capture_sample(void);
 static int check_trigger(void);
+static inline void copy_data(scope_data_t *dest, void *addr, int len);
+
+static void stream(void *arg, long period);
 
 /***********************************************************************
 *                       INIT AND EXIT CODE                             *
@@ -124,6 +134,14 @@ int rtapi_app_main(void)
 	return -1;
     }
     rtapi_print_msg(RTAPI_MSG_DBG, "SCOPE_RT: installed sample function\n");
+    if (stream_chans > 0) {
+	retval = init_stream();
+	if (retval != 0) {
+	    rtapi_shmem_delete(shm_id, comp_id);
+	    hal_exit(comp_id);
+	    return -1;
+	}
+    }
     hal_ready(comp_id);
     return 0;
 }
@@ -135,6 +153,13 @@ void rtapi_app_exit(void)
 	/* need to unlink it before we release the scope shared memory */
 	hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
     }
+    if (stream_shm_id >= 0) {
+	if (ctrl_rt->stream->thread_name[0] != '\0') {
+	    hal_del_funct_from_thread("scope.stream",
+		ctrl_rt->stream->thread_name);
+	}
+	rtapi_shmem_delete(stream_shm_id, comp_id);
+    }
     rtapi_shmem_delete(shm_id, comp_id);
     hal_exit(comp_id);
 }
@@ -248,29 +273,9 @@ static void capture_sample(void)
     dest = &(ctrl_rt->buffer[ctrl_shm->curr]);
     /* loop through all channels to acquire data */
     for (n = 0; n < 16; n++) {
-	/* capture 1, 2, or 4 bytes, based on data size */
-	switch (ctrl_rt->data_len[n]) {
-	case 1:
-	    dest->d_u8 = *((unsigned char *) (ctrl_rt->data_addr[n]));
-	    dest++;
-	    break;
-	case 4:
-	    dest->d_u32 = *((unsigned long *) (ctrl_rt->data_addr[n]));
+	if (ctrl_rt->data_len[n] != 0) {
+	    copy_data(dest, ctrl_rt->data_addr[n], ctrl_rt->data_len[n]);
 	    dest++;
-	    break;
-	case 8:
-            {
-                ireal_t sample_a, sample_b;
-                do {
-                    sample_a = *((volatile ireal_t *) (ctrl_rt->data_addr[n]));
-                    sample_b = *((volatile ireal_t *) (ctrl_rt->data_addr[n]));
-                } while( sample_a != sample_b );
-                dest->d_ireal = sample_a;
-                dest++;
-            }
-	    break;
-	default:
-	    break;
 	}
     }
     /* increment sample pointer */
@@ -282,6 +287,100 @@ static void capture_sample(void)
     }
 }
 
+static inline void copy_data(scope_data_t *dest, void *addr, int len)
+{
+    /* capture 1, 4, or 8 bytes, based on data size */
+    switch (len) {
+    case 1:
+	dest->d_u8 = *((unsigned char *) addr);
+	break;
+    case 4:
+	dest->d_u32 = *((unsigned long *) addr);
+	break;
+    case 8:
+	{
+	    ireal_t sample_a, sample_b;
+	    do {
+		sample_a = *((volatile ireal_t *) addr);
+		sample_b = *((volatile ireal_t *) addr);
+	    } while( sample_a != sample_b );
+	    dest->d_ireal = sample_a;
+	}
+	break;
+    default:
+	break;
+    }
+}
+
+/* continuous capture - independent of the triggered capture above,
+   writes one slot per sample into the stream ring */
+static void stream(void *arg, long period)
+{
+    scope_stream_control_t *ctrl;
+    scope_data_t *dest;
+    unsigned int in, newin;
+    int n;
+
+    ctrl = ctrl_rt->stream;
+    ctrl->watchdog = 0;
+    switch (ctrl->state) {
+    case STREAM_INIT:
+	/* writer has filled in the channel table, check it */
+	if ((ctrl->num_chans < 1) || (ctrl->num_chans > ctrl->max_chans)
+	    || (ctrl->buf_len / (ctrl->num_chans + 1) < 2)) {
+	    ctrl->state = STREAM_IDLE;
+	    break;
+	}
+	for (n = 0; n < ctrl->num_chans; n++) {
+	    ctrl_rt->stream_addr[n] =
+		SHMPTR(ctrl_rt->stream_chan[n].data_offset);
+	}
+	ctrl->depth = ctrl->buf_len / (ctrl->num_chans + 1);
+	ctrl->sample_num = 0;
+	ctrl->overruns = 0;
+	ctrl_rt->stream_mult_cntr = 0;
+	atomic_store_explicit(&ctrl->in, 0, memory_order_release);
+	ctrl->state = STREAM_RUN;
+	break;
+    case STREAM_RUN:
+	if (++ctrl_rt->stream_mult_cntr < ctrl->mult) {
+	    /* not time to do anything yet */
+	    break;
+	}
+	ctrl_rt->stream_mult_cntr = 0;
+	ctrl->sample_num++;
+	in = atomic_load_explicit(&ctrl->in, memory_order_relaxed);
+	newin = in + 1;
+	if (newin >= ctrl->depth) {
+	    newin = 0;
+	}
+	if (newin == atomic_load_explicit(&ctrl->out, memory_order_acquire)) {
+	    /* ring is full, this sample is lost */
+	    ctrl->overruns++;
+	    break;
+	}
+	dest = ctrl_rt->stream_buf + in * (ctrl->num_chans + 1);
+	dest->d_u32 = ctrl->sample_num;
+	dest++;
+	for (n = 0; n < ctrl->num_chans; n++) {
+	    copy_data(dest, ctrl_rt->stream_addr[n],
+		ctrl_rt->stream_chan[n].data_len);
+	    dest++;
+	}
+	/* publish the slot to the reader */
+	atomic_store_explicit(&ctrl->in, newin, memory_order_release);
+	break;
+    case STREAM_IDLE:
+    case STREAM_STOP:
+	/* nothing to do, the writer owns the ring */
+	break;
+    default:
+	/* shouldn't get here - if we do, set a legal state */
+	ctrl->state = STREAM_IDLE;
+	break;
+    }
+}
+
 // TODO: type-independent way to get high bit
 // #define SIGN_BIT (~(((ireal_t)~(ireal_t)0)>>1))
 static int check_trigger(void)
@@ -425,3 +524,68 @@ static void init_shm_control_struct(void)
     ctrl_shm->mult = 1;
     ctrl_shm->state = IDLE;
 }
+
+static int init_stream(void)
+{
+    scope_stream_control_t *ctrl;
+    void *shm_base;
+    char *cp;
+    unsigned long size;
+    int retval, n, skip, chan_skip;
+
+    /* control struct, channel table and ring, each 8 byte aligned */
+    skip = (sizeof(scope_stream_control_t) + 7) & ~7;
+    chan_skip = (stream_chans * sizeof(scope_stream_chan_t) + 7) & ~7;
+    size = skip + chan_skip + stream_len * sizeof(scope_data_t);
+    stream_shm_id = rtapi_shmem_new(SCOPE_STREAM_SHM_KEY, comp_id, size);
+    if (stream_shm_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SCOPE RT: ERROR: failed to get stream shared memory (key=0x%x, size=%lu)\n",
+	    SCOPE_STREAM_SHM_KEY, size);
+	return -1;
+    }
+    retval = rtapi_shmem_getptr(stream_shm_id, &shm_base);
+    if (retval < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SCOPE: ERROR: failed to map stream shared memory\n");
+	goto fail;
+    }
+    ctrl_rt->stream_addr = hal_malloc(stream_chans * sizeof(void *));
+    if (ctrl_rt->stream_addr == NULL) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "SCOPE: ERROR: hal_malloc() failed\n");
+	goto fail;
+    }
+    /* first clear control struct to all zeros */
+    ctrl = shm_base;
+    cp = (char *) ctrl;
+    for (n = 0; n < sizeof(scope_stream_control_t); n++) {
+	cp[n] = 0;
+    }
+    ctrl->shm_size = size;
+    ctrl->max_chans = stream_chans;
+    ctrl->buf_len = stream_len;
+    ctrl->chan_offset = skip;
+    ctrl->buf_offset = skip + chan_skip;
+    ctrl->mult = 1;
+    ctrl->state = STREAM_IDLE;
+    ctrl_rt->stream = ctrl;
+    ctrl_rt->stream_chan =
+	(scope_stream_chan_t *) (((char *) shm_base) + ctrl->chan_offset);
+    ctrl_rt->stream_buf =
+	(scope_data_t *) (((char *) shm_base) + ctrl->buf_offset);
+    /* export continuous capture function */
+    retval = hal_export_funct("scope.stream", stream, NULL, 0, 0, comp_id);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SCOPE_RT: ERROR: stream funct export failed\n");
+	goto fail;
+    }
+    rtapi_print_msg(RTAPI_MSG_DBG, "SCOPE_RT: installed stream function\n");
+    return 0;
+
+fail:
+    rtapi_shmem_delete(stream_shm_id, comp_id);
+    stream_shm_id = -1;
+    return -1;
+}
+
@@ -52,6 +52,11 @@ typedef struct {
     char data_len[16];		/* data size for each channel */
     void *data_addr[16];	/* pointers to data for each channel */
     hal_type_t data_type[16];	/* data type for each channel */
+    scope_stream_control_t *stream;	/* ptr to stream control struct */
+    scope_stream_chan_t *stream_chan;	/* ptr to stream channel table */
+    scope_data_t *stream_buf;	/* ptr to stream ring (kernel mapping) */
+    void **stream_addr;		/* pointers to data for each stream chan */
+    int stream_mult_cntr;	/* used to divide by stream 'mult' */
 } scope_rt_control_t;
 
 /***********************************************************************
@@ -43,6 +43,9 @@
 
 #define SCOPE_SHM_KEY  0x130CF406
 #define SCOPE_NUM_SAMPLES_DEFAULT 16000
+#define SCOPE_STREAM_SHM_KEY  0x130CF407
+#define SCOPE_STREAM_CHANS_DEFAULT 64
+#define SCOPE_STREAM_LEN_DEFAULT 262144
 
 typedef enum {
     IDLE = 0,			/* waiting for run command */
@@ -93,4 +96,50 @@ typedef struct {
     char data_len[16];		/* U data size, 0 if not to be acquired */
 } scope_shm_control_t;
 
+/* states of the continuous (streaming) capture */
+
+typedef enum {
+    STREAM_IDLE = 0,		/* waiting for a writer */
+    STREAM_INIT,		/* writer has set up the channel table */
+    STREAM_RUN,			/* acquiring data into the ring */
+    STREAM_STOP			/* stop requested, writer drains the ring */
+} scope_stream_state_t;
+
+/* one entry in the streaming channel table */
+
+typedef struct {
+    int data_offset;		/* U data addr in shmem */
+    hal_type_t data_type;	/* U data type */
+    int data_len;		/* U data size */
+} scope_stream_chan_t;
+
+/** This struct controls the continuous capture mode.  It lives at the
+    start of a second shared memory block, followed by the channel table
+    ('max_chans' entries) and the sample ring ('buf_len' words).  The
+    ring has a single producer (the realtime 'scope.stream' function)
+    and a single consumer (halscope-stream), and is lock free: the
+    producer only moves 'in' and the consumer only moves 'out'.  Each
+    slot in the ring holds a sample number followed by one word for
+    each channel, so the consumer can detect samples lost to overruns.
+    Field codes are the same as for scope_shm_control_t.
+*/
+
+typedef struct {
+    unsigned long shm_size;	/* Actual size of SHM area */
+    int max_chans;		/* I size of channel table */
+    int buf_len;		/* I length of ring, in words */
+    int chan_offset;		/* I offset of channel table in block */
+    int buf_offset;		/* I offset of ring in block */
+    int watchdog;		/* RU rt sets to zero, user incs */
+    char thread_name[HAL_NAME_LEN + 1];	/* U thread used for sampling */
+    int mult;			/* U sample period multiplier */
+    int num_chans;		/* U channels in each sample */
+    int depth;			/* R number of slots in the ring */
+    volatile unsigned int in;	/* R next slot to be written */
+    volatile unsigned int out;	/* U next slot to be read */
+    unsigned int sample_num;	/* R number of the last sample taken */
+    unsigned long overruns;	/* R samples lost because ring was full */
+    scope_stream_state_t state;	/* RU current state */
+} scope_stream_control_t;
+
 #endif /* HALSC_SHM_H */
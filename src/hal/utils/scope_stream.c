@@ -0,0 +1,766 @@
+/** This file, 'scope_stream.c', is a user space program that works
+    with the 'scope.stream' function of 'scope_rt' to capture HAL
+    pins, signals, and parameters continuously, without the GUI.
+    Samples are drained from a lock-free ring in shared memory and
+    written to a compact columnar file: samples are grouped into
+    blocks, and within a block each channel is stored as a run of
+    delta (or XOR, for floats) encoded variable length integers.
+
+    Usage:
+      halscope-stream start -o FILE [-t THREAD] [-m MULT] [-b BLOCK]
+                            [-n COUNT] NAME...
+      halscope-stream stop
+      halscope-stream status
+      halscope-stream dump FILE
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+
+    This code was written as part of the EMC HAL project.  For more
+    information, go to www.linuxcnc.org.
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "../hal_priv.h"	/* HAL private API decls */
+#include "rtapi_atomic.h"
+#include "scope_shm.h"		/* scope shared declarations */
+
+/***********************************************************************
+*                         TYPEDEFS AND DEFINES                         *
+************************************************************************/
+
+#define STREAM_FILE_MAGIC "HALSCSTR"
+#define STREAM_FILE_VERSION 1
+#define STREAM_BLOCK_DEFAULT 1000
+/* longest varint needed for a 64 bit value */
+#define VARINT_MAX 10
+/* polling interval while the ring is empty, in usec */
+#define POLL_USEC 10000
+/* number of empty polls before the realtime function is presumed dead */
+#define WATCHDOG_LIMIT 100
+
+/***********************************************************************
+*                         GLOBAL VARIABLES                             *
+************************************************************************/
+
+static int comp_id = -1;	/* -1 means hal_init() not called yet */
+static int shm_id = -1;		/* stream shared memory ID */
+static scope_stream_control_t *ctrl;	/* stream control struct */
+static scope_stream_chan_t *chans;	/* stream channel table */
+static scope_data_t *ring;	/* stream ring */
+static sig_atomic_t stop;	/* set by signal handler */
+
+/***********************************************************************
+*                  LOCAL FUNCTION DECLARATIONS                         *
+************************************************************************/
+
+static int do_start(int argc, char **argv);
+static int do_stop(void);
+static int do_status(void);
+static int do_dump(const char *fname);
+
+/***********************************************************************
+*                            MAIN PROGRAM                              *
+************************************************************************/
+
+static void usage(void)
+{
+    fprintf(stderr,
+	"Usage:\n"
+	"  halscope-stream start -o FILE [-t THREAD] [-m MULT] [-b BLOCK]\n"
+	"                        [-n COUNT] NAME...\n"
+	"  halscope-stream stop\n"
+	"  halscope-stream status\n"
+	"  halscope-stream dump FILE\n");
+}
+
+static void quit(int sig)
+{
+    stop = 1;
+}
+
+static void exit_from_hal(void)
+{
+    if (shm_id >= 0) {
+	rtapi_shmem_delete(shm_id, comp_id);
+	shm_id = -1;
+    }
+    if (comp_id >= 0) {
+	hal_exit(comp_id);
+	comp_id = -1;
+    }
+}
+
+/* connect to the HAL and map the stream control block, loading
+   scope_rt first if 'load' is set and it is not there yet */
+static int connect_stream(int load)
+{
+    char name[HAL_NAME_LEN + 1];
+    unsigned long size;
+    void *shm_base;
+    int retval;
+
+    snprintf(name, sizeof(name), "halscope-stream%d", getpid());
+    comp_id = hal_init(name);
+    if (comp_id < 0) {
+	fprintf(stderr, "ERROR: hal_init() failed: %d\n", comp_id);
+	return -1;
+    }
+    hal_ready(comp_id);
+    atexit(exit_from_hal);
+    if (!halpr_find_funct_by_name("scope.stream")) {
+	if (!load) {
+	    fprintf(stderr, "ERROR: scope.stream not found, "
+		"is scope_rt loaded?\n");
+	    return -1;
+	}
+	if (halpr_find_funct_by_name("scope.sample")) {
+	    fprintf(stderr, "ERROR: scope_rt was loaded with "
+		"stream_chans=0\n");
+	    return -1;
+	}
+	if (system(EMC2_BIN_DIR "/halcmd loadrt scope_rt") != 0) {
+	    fprintf(stderr, "ERROR: loadrt scope_rt failed\n");
+	    return -1;
+	}
+    }
+    /* map the control struct to find out the real size */
+    shm_id = rtapi_shmem_new(SCOPE_STREAM_SHM_KEY, comp_id,
+	sizeof(scope_stream_control_t));
+    if (shm_id < 0) {
+	fprintf(stderr, "ERROR: failed to get stream shared memory\n");
+	return -1;
+    }
+    retval = rtapi_shmem_getptr(shm_id, &shm_base);
+    if (retval < 0) {
+	fprintf(stderr, "ERROR: failed to map stream shared memory\n");
+	return -1;
+    }
+    size = ((scope_stream_control_t *) shm_base)->shm_size;
+    /* close shmem, re-open with proper size */
+    rtapi_shmem_delete(shm_id, comp_id);
+    shm_id = rtapi_shmem_new(SCOPE_STREAM_SHM_KEY, comp_id, size);
+    if (shm_id < 0) {
+	fprintf(stderr, "ERROR: failed to get stream shared memory\n");
+	return -1;
+    }
+    retval = rtapi_shmem_getptr(shm_id, &shm_base);
+    if (retval < 0) {
+	fprintf(stderr, "ERROR: failed to map stream shared memory\n");
+	return -1;
+    }
+    ctrl = shm_base;
+    chans = (scope_stream_chan_t *) ((char *) shm_base + ctrl->chan_offset);
+    ring = (scope_data_t *) ((char *) shm_base + ctrl->buf_offset);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+	usage();
+	return 1;
+    }
+    if (strcmp(argv[1], "start") == 0) {
+	return do_start(argc - 1, argv + 1);
+    } else if (strcmp(argv[1], "stop") == 0 && argc == 2) {
+	return do_stop();
+    } else if (strcmp(argv[1], "status") == 0 && argc == 2) {
+	return do_status();
+    } else if (strcmp(argv[1], "dump") == 0 && argc == 3) {
+	return do_dump(argv[2]);
+    }
+    usage();
+    return 1;
+}
+
+/***********************************************************************
+*                        FILE ENCODING                                 *
+************************************************************************/
+
+static void put_u32(FILE *f, uint32_t v)
+{
+    unsigned char b[4];
+    int n;
+
+    for (n = 0; n < 4; n++) {
+	b[n] = v >> (8 * n);
+    }
+    fwrite(b, 1, 4, f);
+}
+
+static void put_u64(FILE *f, uint64_t v)
+{
+    put_u32(f, v);
+    put_u32(f, v >> 32);
+}
+
+static int get_u32(FILE *f, uint32_t *v)
+{
+    unsigned char b[4];
+
+    if (fread(b, 1, 4, f) != 4) {
+	return -1;
+    }
+    *v = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+    return 0;
+}
+
+static int get_u64(FILE *f, uint64_t *v)
+{
+    uint32_t lo, hi;
+
+    if (get_u32(f, &lo) || get_u32(f, &hi)) {
+	return -1;
+    }
+    *v = lo | ((uint64_t) hi << 32);
+    return 0;
+}
+
+static unsigned char *put_varint(unsigned char *p, uint64_t v)
+{
+    while (v >= 0x80) {
+	*p++ = (v & 0x7f) | 0x80;
+	v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static const unsigned char *get_varint(const unsigned char *p,
+    const unsigned char *end, uint64_t *v)
+{
+    int shift = 0;
+
+    *v = 0;
+    while (p < end && shift < 64) {
+	*v |= (uint64_t) (*p & 0x7f) << shift;
+	if (!(*p++ & 0x80)) {
+	    return p;
+	}
+	shift += 7;
+    }
+    return NULL;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+/* raw value of one sample, widened to 64 bits */
+static uint64_t raw_value(scope_data_t *d, hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:
+	return d->d_u8 ? 1 : 0;
+    case HAL_FLOAT:
+	return d->d_ireal;
+    case HAL_S32:
+	return (uint64_t) (int64_t) d->d_s32;
+    case HAL_U32:
+	return d->d_u32;
+    default:
+	return 0;
+    }
+}
+
+/* floats are XORed with the previous value, so that slowly changing
+   values leave only low-order mantissa bits set; everything else is
+   stored as a zigzag encoded difference */
+static uint64_t encode_delta(uint64_t v, uint64_t prev, hal_type_t type)
+{
+    if (type == HAL_FLOAT) {
+	return v ^ prev;
+    }
+    return zigzag((int64_t) (v - prev));
+}
+
+static uint64_t decode_delta(uint64_t d, uint64_t prev, hal_type_t type)
+{
+    if (type == HAL_FLOAT) {
+	return d ^ prev;
+    }
+    return prev + (uint64_t) unzigzag(d);
+}
+
+/***********************************************************************
+*                           CAPTURE                                    *
+************************************************************************/
+
+typedef struct {
+    FILE *f;
+    int num_chans;
+    int block_len;		/* max samples in a block */
+    int samples;		/* samples in current block */
+    unsigned int first;		/* sample number of first sample */
+    uint64_t *values;		/* block_len values for each channel */
+    unsigned char *payload;	/* encoded block */
+} block_t;
+
+static void flush_block(block_t *b)
+{
+    unsigned char *p;
+    uint64_t *v, prev;
+    int c, n;
+
+    if (b->samples == 0) {
+	return;
+    }
+    p = b->payload;
+    for (c = 0; c < b->num_chans; c++) {
+	v = b->values + c * b->block_len;
+	/* each block starts from zero so it can be decoded on its own */
+	prev = 0;
+	for (n = 0; n < b->samples; n++) {
+	    p = put_varint(p, encode_delta(v[n], prev, chans[c].data_type));
+	    prev = v[n];
+	}
+    }
+    put_u32(b->f, b->samples);
+    put_u32(b->f, b->first);
+    put_u32(b->f, p - b->payload);
+    fwrite(b->payload, 1, p - b->payload, b->f);
+    b->samples = 0;
+}
+
+static int lookup_channel(const char *name, scope_stream_chan_t *chan)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+
+    if ((pin = halpr_find_pin_by_name(name)) != NULL) {
+	if (pin->signal == 0) {
+	    /* pin is unlinked, get data from dummysig */
+	    chan->data_offset = SHMOFF(&(pin->dummysig));
+	} else {
+	    sig = SHMPTR(pin->signal);
+	    chan->data_offset = sig->data_ptr;
+	}
+	chan->data_type = pin->type;
+    } else if ((sig = halpr_find_sig_by_name(name)) != NULL) {
+	chan->data_offset = sig->data_ptr;
+	chan->data_type = sig->type;
+    } else if ((param = halpr_find_param_by_name(name)) != NULL) {
+	chan->data_offset = param->data_ptr;
+	chan->data_type = param->type;
+    } else {
+	return -1;
+    }
+    switch (chan->data_type) {
+    case HAL_BIT:
+	chan->data_len = sizeof(hal_bit_t);
+	break;
+    case HAL_FLOAT:
+	chan->data_len = sizeof(hal_float_t);
+	break;
+    case HAL_S32:
+	chan->data_len = sizeof(hal_s32_t);
+	break;
+    case HAL_U32:
+	chan->data_len = sizeof(hal_u32_t);
+	break;
+    default:
+	return -1;
+    }
+    return 0;
+}
+
+static int do_start(int argc, char **argv)
+{
+    char *thread_name = NULL, *ofilename = NULL;
+    hal_thread_t *thread;
+    block_t blk;
+    long count = -1;
+    int mult = 1, block_len = STREAM_BLOCK_DEFAULT;
+    int c, n, num_chans, stride, retval;
+    unsigned int in, out, expected = 0;
+    scope_data_t *slot;
+
+    while ((c = getopt(argc, argv, "o:t:m:b:n:")) != -1) {
+	switch (c) {
+	case 'o':
+	    ofilename = optarg;
+	    break;
+	case 't':
+	    thread_name = optarg;
+	    break;
+	case 'm':
+	    mult = atoi(optarg);
+	    break;
+	case 'b':
+	    block_len = atoi(optarg);
+	    break;
+	case 'n':
+	    count = atol(optarg);
+	    break;
+	default:
+	    usage();
+	    return 1;
+	}
+    }
+    num_chans = argc - optind;
+    if (ofilename == NULL || num_chans < 1 || mult < 1 || block_len < 1) {
+	usage();
+	return 1;
+    }
+    if (connect_stream(1) < 0) {
+	return 1;
+    }
+    if (ctrl->state != STREAM_IDLE) {
+	fprintf(stderr, "ERROR: a capture is already running\n");
+	return 1;
+    }
+    if (num_chans > ctrl->max_chans) {
+	fprintf(stderr, "ERROR: %d channels requested, scope_rt was loaded "
+	    "with stream_chans=%d\n", num_chans, ctrl->max_chans);
+	return 1;
+    }
+    if (ctrl->buf_len / (num_chans + 1) < 2) {
+	fprintf(stderr, "ERROR: stream_len=%d is too small for %d "
+	    "channels\n", ctrl->buf_len, num_chans);
+	return 1;
+    }
+    /* resolve names and fill in channel table */
+    rtapi_mutex_get(&(hal_data->mutex));
+    if (thread_name == NULL) {
+	/* default to the fastest thread */
+	thread = NULL;
+	if (hal_data->thread_list_ptr != 0) {
+	    thread = SHMPTR(hal_data->thread_list_ptr);
+	}
+    } else {
+	thread = halpr_find_thread_by_name(thread_name);
+    }
+    if (thread == NULL) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	fprintf(stderr, "ERROR: thread '%s' not found\n",
+	    thread_name ? thread_name : "");
+	return 1;
+    }
+    strncpy(ctrl->thread_name, thread->name, HAL_NAME_LEN);
+    ctrl->thread_name[HAL_NAME_LEN] = '\0';
+    for (n = 0; n < num_chans; n++) {
+	if (lookup_channel(argv[optind + n], &chans[n]) < 0) {
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    fprintf(stderr, "ERROR: pin, signal or parameter '%s' not "
+		"found\n", argv[optind + n]);
+	    ctrl->thread_name[0] = '\0';
+	    return 1;
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+
+    blk.f = fopen(ofilename, "wb");
+    if (blk.f == NULL) {
+	perror(ofilename);
+	ctrl->thread_name[0] = '\0';
+	return 1;
+    }
+    blk.num_chans = num_chans;
+    blk.block_len = block_len;
+    blk.samples = 0;
+    blk.first = 0;
+    blk.values = malloc(sizeof(uint64_t) * num_chans * block_len);
+    blk.payload = malloc(VARINT_MAX * num_chans * block_len);
+    if (blk.values == NULL || blk.payload == NULL) {
+	fprintf(stderr, "ERROR: out of memory\n");
+	fclose(blk.f);
+	ctrl->thread_name[0] = '\0';
+	return 1;
+    }
+    /* file header */
+    fwrite(STREAM_FILE_MAGIC, 1, 8, blk.f);
+    put_u32(blk.f, STREAM_FILE_VERSION);
+    put_u32(blk.f, num_chans);
+    put_u32(blk.f, mult);
+    put_u64(blk.f, (uint64_t) thread->period * mult);
+    for (n = 0; n < num_chans; n++) {
+	const char *name = argv[optind + n];
+	size_t len = strlen(name);
+	fputc(chans[n].data_type, blk.f);
+	fputc(len, blk.f);
+	fwrite(name, 1, len, blk.f);
+    }
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    signal(SIGPIPE, quit);
+
+    /* start the realtime side */
+    ctrl->mult = mult;
+    ctrl->num_chans = num_chans;
+    atomic_store_explicit(&ctrl->out, 0, memory_order_release);
+    ctrl->state = STREAM_INIT;
+    ctrl->watchdog = 0;
+    retval = hal_add_funct_to_thread("scope.stream", ctrl->thread_name, -1);
+    if (retval < 0) {
+	fprintf(stderr, "ERROR: could not add scope.stream to thread "
+	    "'%s'\n", ctrl->thread_name);
+	ctrl->state = STREAM_IDLE;
+	ctrl->thread_name[0] = '\0';
+	fclose(blk.f);
+	return 1;
+    }
+    stride = num_chans + 1;
+    while (1) {
+	if ((stop || count == 0) && ctrl->state == STREAM_RUN) {
+	    ctrl->state = STREAM_STOP;
+	}
+	if (ctrl->state == STREAM_INIT || ctrl->state == STREAM_IDLE) {
+	    if (ctrl->state == STREAM_IDLE || stop) {
+		/* realtime side rejected the setup, or never ran */
+		break;
+	    }
+	    usleep(POLL_USEC);
+	    continue;
+	}
+	in = atomic_load_explicit(&ctrl->in, memory_order_acquire);
+	out = ctrl->out;
+	if (in == out) {
+	    if (ctrl->state == STREAM_STOP) {
+		break;
+	    }
+	    /* the realtime side zeroes the watchdog every period */
+	    if (++ctrl->watchdog == WATCHDOG_LIMIT) {
+		fprintf(stderr, "WARNING: scope.stream is not running, "
+		    "is thread '%s' running?\n", ctrl->thread_name);
+	    }
+	    usleep(POLL_USEC);
+	    continue;
+	}
+	while (in != out && count != 0) {
+	    slot = ring + out * stride;
+	    if (blk.samples > 0 && slot->d_u32 != expected) {
+		/* samples were lost, start a new block */
+		flush_block(&blk);
+	    }
+	    if (blk.samples == 0) {
+		blk.first = slot->d_u32;
+	    }
+	    expected = slot->d_u32 + 1;
+	    for (n = 0; n < num_chans; n++) {
+		blk.values[n * block_len + blk.samples] =
+		    raw_value(&slot[n + 1], chans[n].data_type);
+	    }
+	    if (++blk.samples == block_len) {
+		flush_block(&blk);
+	    }
+	    if (++out >= ctrl->depth) {
+		out = 0;
+	    }
+	    if (count > 0) {
+		count--;
+	    }
+	}
+	if (count == 0) {
+	    /* got them all, drop what is left in the ring */
+	    ctrl->state = STREAM_STOP;
+	    atomic_store_explicit(&ctrl->out, in, memory_order_release);
+	    break;
+	}
+	/* release the slots back to the realtime side */
+	atomic_store_explicit(&ctrl->out, out, memory_order_release);
+    }
+    hal_del_funct_from_thread("scope.stream", ctrl->thread_name);
+    flush_block(&blk);
+    /* end of data marker, followed by the number of lost samples */
+    put_u32(blk.f, 0);
+    put_u64(blk.f, ctrl->overruns);
+    if (ctrl->overruns) {
+	fprintf(stderr, "WARNING: %lu samples lost to overruns\n",
+	    ctrl->overruns);
+    }
+    ctrl->thread_name[0] = '\0';
+    ctrl->state = STREAM_IDLE;
+    free(blk.values);
+    free(blk.payload);
+    if (fclose(blk.f) != 0) {
+	perror(ofilename);
+	return 1;
+    }
+    return 0;
+}
+
+static int do_stop(void)
+{
+    if (connect_stream(0) < 0) {
+	return 1;
+    }
+    if (ctrl->state == STREAM_STOP) {
+	/* stop was already requested, and the writer never finished -
+	   it must have died, so clean up after it */
+	if (ctrl->thread_name[0] != '\0') {
+	    hal_del_funct_from_thread("scope.stream", ctrl->thread_name);
+	    ctrl->thread_name[0] = '\0';
+	}
+	ctrl->state = STREAM_IDLE;
+	return 0;
+    }
+    if (ctrl->state != STREAM_RUN) {
+	fprintf(stderr, "ERROR: no capture is running\n");
+	return 1;
+    }
+    ctrl->state = STREAM_STOP;
+    return 0;
+}
+
+static int do_status(void)
+{
+    static const char *states[] = { "idle", "init", "run", "stop" };
+    int fill;
+
+    if (connect_stream(0) < 0) {
+	return 1;
+    }
+    printf("state:     %s\n",
+	ctrl->state <= STREAM_STOP ? states[ctrl->state] : "unknown");
+    printf("thread:    %s\n", ctrl->thread_name);
+    printf("channels:  %d (max %d)\n", ctrl->num_chans, ctrl->max_chans);
+    if (ctrl->state == STREAM_RUN || ctrl->state == STREAM_STOP) {
+	fill = (int) ctrl->in - (int) ctrl->out;
+	if (fill < 0) {
+	    fill += ctrl->depth;
+	}
+	printf("ring:      %d of %d samples\n", fill, ctrl->depth);
+	printf("samples:   %u\n", ctrl->sample_num);
+	printf("overruns:  %lu\n", ctrl->overruns);
+    }
+    return 0;
+}
+
+/***********************************************************************
+*                           DECODING                                   *
+************************************************************************/
+
+static int do_dump(const char *fname)
+{
+    char magic[8], name[256];
+    uint32_t version, num_chans, mult, samples, first, len;
+    uint64_t period, lost, *prev;
+    const unsigned char *p, *end;
+    unsigned char *payload = NULL;
+    uint64_t **values;
+    hal_type_t *types;
+    FILE *f;
+    int c, n, ch;
+
+    f = fopen(fname, "rb");
+    if (f == NULL) {
+	perror(fname);
+	return 1;
+    }
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, STREAM_FILE_MAGIC, 8)
+	|| get_u32(f, &version) || version != STREAM_FILE_VERSION
+	|| get_u32(f, &num_chans) || get_u32(f, &mult)
+	|| get_u64(f, &period)) {
+	fprintf(stderr, "ERROR: %s is not a halscope-stream file\n", fname);
+	fclose(f);
+	return 1;
+    }
+    types = calloc(num_chans, sizeof(hal_type_t));
+    values = calloc(num_chans, sizeof(uint64_t *));
+    prev = calloc(num_chans, sizeof(uint64_t));
+    if (types == NULL || values == NULL || prev == NULL) {
+	fprintf(stderr, "ERROR: out of memory\n");
+	return 1;
+    }
+    printf("# period %llu ns\n# sample", (unsigned long long) period);
+    for (c = 0; c < num_chans; c++) {
+	types[c] = fgetc(f);
+	len = fgetc(f);
+	if (len == (uint32_t) EOF || fread(name, 1, len, f) != len) {
+	    fprintf(stderr, "ERROR: %s: truncated header\n", fname);
+	    return 1;
+	}
+	name[len] = '\0';
+	printf(" %s", name);
+    }
+    printf("\n");
+    while (get_u32(f, &samples) == 0 && samples != 0) {
+	if (get_u32(f, &first) || get_u32(f, &len)) {
+	    break;
+	}
+	payload = realloc(payload, len);
+	if (payload == NULL || fread(payload, 1, len, f) != len) {
+	    fprintf(stderr, "ERROR: %s: truncated block\n", fname);
+	    return 1;
+	}
+	p = payload;
+	end = payload + len;
+	for (c = 0; c < num_chans; c++) {
+	    values[c] = realloc(values[c], samples * sizeof(uint64_t));
+	    prev[c] = 0;
+	    for (n = 0; n < samples; n++) {
+		uint64_t d;
+		if (values[c] == NULL || (p = get_varint(p, end, &d)) == NULL) {
+		    fprintf(stderr, "ERROR: %s: corrupt block\n", fname);
+		    return 1;
+		}
+		prev[c] = decode_delta(d, prev[c], types[c]);
+		values[c][n] = prev[c];
+	    }
+	}
+	for (n = 0; n < samples; n++) {
+	    printf("%u", first + n);
+	    for (ch = 0; ch < num_chans; ch++) {
+		uint64_t v = values[ch][n];
+		switch (types[ch]) {
+		case HAL_FLOAT:
+		    {
+			union { uint64_t u; double d; } cv;
+			cv.u = v;
+			printf(" %.15g", cv.d);
+		    }
+		    break;
+		case HAL_S32:
+		    printf(" %ld", (long) (int32_t) v);
+		    break;
+		default:
+		    printf(" %lu", (unsigned long) v);
+		    break;
+		}
+	    }
+	    printf("\n");
+	}
+    }
+    if (get_u64(f, &lost) == 0 && lost != 0) {
+	printf("# %llu samples lost to overruns\n", (unsigned long long) lost);
+    }
+    fclose(f);
+    return 0;
+}
@@ -198,6 +198,15 @@ enum CMS_REMOTE_SUBSCRIPTION_REQUEST_TYPE {
     CMS_VARIABLE_SUBSCRIPTION
 };
 
+/* Or'ed into the subscription type by TCP clients that want delta
+   updates, and into the success word of the reply by servers that will
+   send them. */
+#define CMS_DELTA_SUBSCRIPTION_FLAG 0x100
+
+/* Or'ed into the was_read word of a subscription update that holds only
+   the byte ranges changed since the previous update. */
+#define CMS_DELTA_UPDATE_FLAG 0x100
+
 struct REMOTE_SET_SUBSCRIPTION_REQUEST:public REMOTE_CMS_REQUEST {
     REMOTE_SET_SUBSCRIPTION_REQUEST():REMOTE_CMS_REQUEST
 	(REMOTE_CMS_SET_SUBSCRIPTION_REQUEST_TYPE) {
@@ -39,10 +39,37 @@ extern "C" {
 //#include "sem.hh"             /* class RCS_SEMAPHORE */
 #include "memsem.hh"		/* mem_get_access(), mem_release_access() */
 #include "timer.hh"		/* etime(), esleep() */
+#include "notify.hh"		/* rcs_notify_post(), rcs_notify_wait() */
+#include "cms_tap.hh"		/* cms_tap_put() */
 /* Common Definitions. */
 //#include "autokey.h"
 /* rw-rw-r-- permissions */
 #define MODE (0700)
+
+/* Layout of a ZEROCOPY buffer: a control block followed by two message
+   slots.  The writer fills the slot that is not active and then makes it
+   the active one, so readers never take the semaphore and never wait for
+   the writer.  The sequence number of a slot is odd while it is being
+   written; a reader that sees it change retries, like a seqlock. */
+#define SHMEM_ZC_ALIGN 64
+
+/* NOTIFY buffers have an RCS_NOTIFY block in this many bytes appended to
+   the segment, aligned and outside of the part CMS manages. */
+#define SHMEM_NOTIFY_SIZE 64
+
+struct SHMEM_ZC_CONTROL {
+    volatile long write_id;	/* id of the newest message */
+    volatile long read_id;	/* id of the newest message read() */
+    volatile int active;	/* slot holding the newest message */
+    char pad[SHMEM_ZC_ALIGN - 2 * sizeof(long) - sizeof(int)];
+};
+
+struct SHMEM_ZC_SLOT {
+    volatile unsigned long seq;
+    CMS_HEADER header;
+    /* message data starts SHMEM_ZC_ALIGN bytes into the slot */
+};
+
 static double last_non_zero_x;
 static double last_x;
 
@@ -60,6 +87,12 @@ static int not_zero(volatile double x)
     return 0;
 }
 
+/* blocking_read() waits forever on any negative timeout, as bsem does. */
+static double notify_timeout(double blocking_timeout)
+{
+    return blocking_timeout < 0 ? RCS_NOTIFY_FOREVER : blocking_timeout;
+}
+
 /* SHMEM Member Functions. */
 
 /* Constructor for hard coded tests. */
@@ -171,11 +204,27 @@ SHMEM::~SHMEM()
   */
 int SHMEM::open()
 {
+    long segment_size = size;
+    long notify_offset =
+	(size + SHMEM_NOTIFY_SIZE - 1) & ~(SHMEM_NOTIFY_SIZE - 1L);
+    long notify_size = notify_writes ?
+	notify_offset - size + SHMEM_NOTIFY_SIZE : 0;
+    /* The TAP ring comes after the notify block, aligned like it. */
+    long tap_offset = (size + notify_size + SHMEM_NOTIFY_SIZE - 1) &
+	~(SHMEM_NOTIFY_SIZE - 1L);
+    long tap_size = tap_messages ?
+	tap_offset - size - notify_size + cms_tap_size(size) : 0;
+
     /* Set pointers to NULL incase error occurs. */
     sem = NULL;
     shm = NULL;
     bsem = NULL;
+    notify = NULL;
+    notify_seen = 0;
+    tap = NULL;
     shm_addr_offset = NULL;
+    zc_control = NULL;
+    view_id = 0;
     second_read = 0;
     autokey_table_size = 0;
 /*! \todo Another #if 0 */
@@ -186,7 +235,8 @@ int SHMEM::open()
 #endif
     /* set up the shared memory address and semaphore, in given state */
     if (master) {
-	shm = new RCS_SHAREDMEM(key, size, RCS_SHAREDMEM_CREATE, (int) MODE);
+	shm = new RCS_SHAREDMEM(key, size + notify_size + tap_size,
+	    RCS_SHAREDMEM_CREATE, (int) MODE);
 	if (shm->addr == NULL) {
 	    switch (shm->create_errno) {
 	    case EACCES:
@@ -242,7 +292,8 @@ int SHMEM::open()
 	}
 	in_buffer_id = 0;
     } else {
-	shm = new RCS_SHAREDMEM(key, size, RCS_SHAREDMEM_NOCREATE);
+	shm = new RCS_SHAREDMEM(key, size + notify_size + tap_size,
+	    RCS_SHAREDMEM_NOCREATE);
 	if (NULL == shm) {
 	    rcs_print_error
 		("CMS: couldn't create RCS_SHAREDMEM(%d(0x%X), %ld(0x%lX), RCS_SHAREDMEM_NOCREATE).\n",
@@ -307,6 +358,26 @@ int SHMEM::open()
 	}
     }
 
+    if (notify_writes) {
+	notify = (RCS_NOTIFY *) ((char *) shm->addr + notify_offset);
+	if (master) {
+	    memset(notify, 0, sizeof(RCS_NOTIFY));
+	}
+	notify_seen = notify->seq;
+    }
+
+    if (tap_messages) {
+	tap = (CMS_TAP *) ((char *) shm->addr + tap_offset);
+	if (master) {
+	    cms_tap_init(tap, size);
+	} else if (tap->slots != CMS_TAP_SLOTS || (long) tap->slot_size != size) {
+	    rcs_print_error("SHMEM: %s: the tap ring does not match.\n",
+		BufferName);
+	    status = CMS_MISC_ERROR;
+	    return -1;
+	}
+    }
+
     if (min_compatible_version < 3.44 && min_compatible_version > 0) {
 	total_subdivisions = 1;
     }
@@ -399,9 +470,350 @@ int SHMEM::open()
 	status = CMS_MISC_ERROR;
 	return -1;
     }
+    if (zero_copy) {
+	return zc_open(segment_size);
+    }
+    return 0;
+}
+
+/* Lay out the control block and the two slots of a ZEROCOPY buffer in
+   the part of the segment after the name and connection table. */
+int SHMEM::zc_open(long segment_size)
+{
+    if (mutex_type != OS_SEM_MUTEX && mutex_type != NO_MUTEX) {
+	rcs_print_error
+	    ("SHMEM: %s: zerocopy needs mutex=os_sem or mutex=none.\n",
+	    BufferName);
+	status = CMS_CONFIG_ERROR;
+	return -1;
+    }
+    char *start = (char *) shm->addr + skip_area;
+    start += (SHMEM_ZC_ALIGN - (start - (char *) shm->addr) % SHMEM_ZC_ALIGN)
+	% SHMEM_ZC_ALIGN;
+    long avail = (char *) shm->addr + segment_size - start
+	- (long) sizeof(SHMEM_ZC_CONTROL);
+    zc_slot_size = (avail / 2) & ~((long) SHMEM_ZC_ALIGN - 1);
+    if (zc_slot_size <= SHMEM_ZC_ALIGN) {
+	rcs_print_error("SHMEM: %s: buffer too small for zerocopy.\n",
+	    BufferName);
+	status = CMS_CONFIG_ERROR;
+	return -1;
+    }
+    zc_control = (SHMEM_ZC_CONTROL *) start;
+    if (master) {
+	memset(start, 0, sizeof(SHMEM_ZC_CONTROL) + 2 * SHMEM_ZC_ALIGN);
+	memset(zc_slot(1), 0, SHMEM_ZC_ALIGN);
+    }
+    /* Each message must fit in one slot. */
+    max_message_size = zc_slot_size - SHMEM_ZC_ALIGN;
+    if (guaranteed_message_space > max_message_size) {
+	guaranteed_message_space = max_message_size;
+    }
+    return 0;
+}
+
+SHMEM_ZC_SLOT *SHMEM::zc_slot(int i)
+{
+    return (SHMEM_ZC_SLOT *) ((char *) zc_control + sizeof(SHMEM_ZC_CONTROL)
+	+ i * zc_slot_size);
+}
+
+/* Take the writer side lock of a ZEROCOPY buffer.  Readers never do. */
+static int zc_lock(RCS_SEMAPHORE * sem, const char *name, double timeout)
+{
+    if (NULL == sem) {
+	return 0;
+    }
+    switch (sem->wait()) {
+    case -1:
+	rcs_print_error("SHMEM: Can't take semaphore\n");
+	return -1;
+    case -2:
+	if (timeout > 0) {
+	    rcs_print_error("SHMEM: Timed out waiting for semaphore.\n");
+	    rcs_print_error("buffer = %s, timeout = %lf sec.\n",
+		name, timeout);
+	}
+	return -2;
+    }
     return 0;
 }
 
+/* Copy the newest message, or with CMS_PEEK_VIEW_ACCESS only its header,
+   without taking the semaphore. */
+CMS_STATUS SHMEM::zc_read()
+{
+    SHMEM_ZC_SLOT *slot;
+    unsigned long seq;
+    int i;
+    int view = (internal_access_type == CMS_PEEK_VIEW_ACCESS);
+
+    if (!read_permission_flag) {
+	rcs_print_error("CMS: %s was not configured to read %s\n",
+	    ProcessName, BufferName);
+	return (status = CMS_PERMISSIONS_ERROR);
+    }
+
+    for (int tries = 0;; tries++) {
+	if (tries > 0 && tries % 100 == 0) {
+	    /* The writer is in the middle of this slot; let it finish. */
+	    esleep(sem_delay);
+	}
+	i = zc_control->active;
+	__sync_synchronize();
+	if (i != 0 && i != 1) {
+	    rcs_print_error("SHMEM: %s: corrupt zerocopy slot index %d.\n",
+		BufferName, i);
+	    return (status = CMS_INTERNAL_ACCESS_ERROR);
+	}
+	slot = zc_slot(i);
+	seq = slot->seq;
+	__sync_synchronize();
+	if (seq & 1) {
+	    continue;
+	}
+	memcpy(&header, (void *) &slot->header, sizeof(CMS_HEADER));
+	if (!view && header.write_id != in_buffer_id
+	    && header.in_buffer_size > 0
+	    && header.in_buffer_size <= max_message_size) {
+	    memcpy(subdiv_data, (char *) slot + SHMEM_ZC_ALIGN,
+		header.in_buffer_size);
+	}
+	__sync_synchronize();
+	if (slot->seq == seq) {
+	    break;
+	}
+    }
+
+    if (header.in_buffer_size > max_message_size) {
+	rcs_print_error("CMS:(%s) Message size of %ld exceeds maximum of %ld\n",
+	    BufferName, header.in_buffer_size, max_message_size);
+	return (status = CMS_INTERNAL_ACCESS_ERROR);
+    }
+
+    if (view) {
+	/* Keep the view separate from in_buffer_id so that a later read()
+	   still copies this message. */
+	if (header.write_id != 0 && header.write_id != view_id) {
+	    status = CMS_READ_OK;
+	} else {
+	    status = CMS_READ_OLD;
+	}
+	view_id = header.write_id;
+	view_data = (char *) slot + SHMEM_ZC_ALIGN;
+	view_slot = i;
+	view_seq = seq;
+	return (status);
+    }
+
+    check_id(header.write_id);
+    if (internal_access_type == CMS_READ_ACCESS && header.write_id != 0) {
+	zc_control->read_id = header.write_id;
+	header.was_read = 1;
+    }
+    return (status);
+}
+
+/* Copy a message into the inactive slot and publish it. */
+CMS_STATUS SHMEM::zc_write(void *_local, int *serial_number)
+{
+    if (!write_permission_flag) {
+	rcs_print_error("CMS: %s was not configured to write to %s\n",
+	    ProcessName, BufferName);
+	return (status = CMS_PERMISSIONS_ERROR);
+    }
+    if (header.in_buffer_size > max_message_size) {
+	rcs_print_error
+	    ("CMS:(%s) Message size %ld exceeds maximum for this buffer of %ld.\n",
+	    BufferName, header.in_buffer_size, max_message_size);
+	return (status = CMS_INSUFFICIENT_SPACE_ERROR);
+    }
+
+    switch (zc_lock(sem, BufferName, timeout)) {
+    case -1:
+	return (status = CMS_MISC_ERROR);
+    case -2:
+	return (status = CMS_TIMED_OUT);
+    }
+
+    if (internal_access_type == CMS_WRITE_IF_READ_ACCESS
+	&& zc_control->write_id != 0
+	&& zc_control->read_id != zc_control->write_id) {
+	header.was_read = 0;
+	status = CMS_WRITE_WAS_BLOCKED;
+    } else {
+	int i = !zc_control->active;
+	SHMEM_ZC_SLOT *slot = zc_slot(i);
+	long id = zc_control->write_id + 1;
+
+	slot->seq++;
+	__sync_synchronize();
+	slot->header.was_read = 0;
+	slot->header.write_id = id;
+	slot->header.in_buffer_size = header.in_buffer_size;
+	memcpy((char *) slot + SHMEM_ZC_ALIGN, _local, header.in_buffer_size);
+	__sync_synchronize();
+	slot->seq++;
+	zc_control->write_id = id;
+	__sync_synchronize();
+	zc_control->active = i;
+	if (NULL != tap) {
+	    cms_tap_put(tap, _local, header.in_buffer_size, id);
+	}
+
+	header.write_id = id;
+	if (NULL != serial_number) {
+	    *serial_number = (int) id;
+	}
+	status = CMS_WRITE_OK;
+    }
+
+    if (NULL != sem) {
+	sem->post();
+    }
+    return (status);
+}
+
+/* main_access() for ZEROCOPY buffers. */
+CMS_STATUS SHMEM::zc_access(void *_local, int *serial_number)
+{
+    switch (internal_access_type) {
+    case CMS_READ_ACCESS:
+    case CMS_PEEK_ACCESS:
+    case CMS_PEEK_VIEW_ACCESS:
+	zc_read();
+	while (internal_access_type == CMS_READ_ACCESS
+	    && status == CMS_READ_OLD && (NULL != bsem || NULL != notify)
+	    && not_zero(blocking_timeout)) {
+	    if (second_read > 10) {
+		rcs_print_error
+		    ("CMS: Blocking semaphore error. The semaphore wait has returned %d times but there is still no new data.\n",
+		    second_read);
+		status = CMS_MISC_ERROR;
+		break;
+	    }
+	    second_read++;
+	    int bsem_ret;
+	    if (NULL != notify) {
+		bsem_ret = rcs_notify_wait(notify, notify_seen,
+		    notify_timeout(blocking_timeout));
+	    } else {
+		bsem->timeout = blocking_timeout;
+		bsem_ret = bsem->wait();
+	    }
+	    if (bsem_ret == -2) {
+		status = CMS_TIMED_OUT;
+		break;
+	    }
+	    if (bsem_ret == -1) {
+		rcs_print_error("CMS: Blocking semaphore error.\n");
+		status = CMS_MISC_ERROR;
+		break;
+	    }
+	    if (NULL != notify) {
+		notify_seen = notify->seq;
+	    }
+	    zc_read();
+	}
+	break;
+
+    case CMS_CHECK_IF_READ_ACCESS:
+	header.was_read = (zc_control->read_id == zc_control->write_id);
+	break;
+
+    case CMS_GET_MSG_COUNT_ACCESS:
+	header.write_id = zc_control->write_id;
+	break;
+
+    case CMS_WRITE_ACCESS:
+    case CMS_WRITE_IF_READ_ACCESS:
+	zc_write(_local, serial_number);
+	if (NULL != notify && status == CMS_WRITE_OK) {
+	    rcs_notify_post(notify);
+	}
+	if (NULL != bsem && status == CMS_WRITE_OK) {
+	    bsem->flush();
+	}
+	break;
+
+    case CMS_CLEAR_ACCESS:
+	switch (zc_lock(sem, BufferName, timeout)) {
+	case -1:
+	    second_read = 0;
+	    return (status = CMS_MISC_ERROR);
+	case -2:
+	    second_read = 0;
+	    return (status = CMS_TIMED_OUT);
+	}
+	for (int i = 0; i < 2; i++) {
+	    SHMEM_ZC_SLOT *slot = zc_slot(i);
+	    slot->seq++;
+	    __sync_synchronize();
+	    memset((void *) &slot->header, 0, sizeof(CMS_HEADER));
+	    __sync_synchronize();
+	    slot->seq++;
+	}
+	zc_control->write_id = 0;
+	zc_control->read_id = 0;
+	if (NULL != sem) {
+	    sem->post();
+	}
+	status = CMS_CLEAR_OK;
+	break;
+
+    default:
+	rcs_print_error("SHMEM: %s: access type %d not supported with zerocopy.\n",
+	    BufferName, (int) internal_access_type);
+	status = CMS_MISC_ERROR;
+	break;
+    }
+    second_read = 0;
+    return (status);
+}
+
+/* Has the message seen by the last peek_view() been overwritten since? */
+int SHMEM::view_valid()
+{
+    if (NULL == zc_control) {
+	return 1;
+    }
+    if (NULL == view_data) {
+	return 0;
+    }
+    __sync_synchronize();
+    return zc_slot(view_slot)->seq == view_seq;
+}
+
+/* Wait for a write to a NOTIFY buffer since the last access through this
+   object. */
+int SHMEM::wait_for_write(double _timeout)
+{
+    if (NULL == notify) {
+	return CMS::wait_for_write(_timeout);
+    }
+    switch (rcs_notify_wait(notify, notify_seen, _timeout)) {
+    case 0:
+	return 1;
+    case -2:
+	return 0;
+    default:
+	return -1;
+    }
+}
+
+RCS_NOTIFY *SHMEM::get_notify(unsigned int *seen)
+{
+    if (NULL != notify && NULL != seen) {
+	*seen = notify_seen;
+    }
+    return notify;
+}
+
+CMS_TAP *SHMEM::get_tap()
+{
+    return tap;
+}
+
 /* Closes the  shared memory and mutual exclusion semaphore  descriptors. */
 int SHMEM::close()
 {
@@ -422,6 +834,8 @@ int SHMEM::close()
 	shm->delete_totally = delete_totally;
 	delete shm;
 	shm = NULL;
+	notify = NULL;
+	tap = NULL;
     }
     if (NULL != sem) {
 	/* if we're the last one, then make us the master so that the
@@ -460,7 +874,7 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	return (status = CMS_MISC_ERROR);
     }
 
-    if (bsem == NULL && not_zero(blocking_timeout)) {
+    if (bsem == NULL && notify == NULL && not_zero(blocking_timeout)) {
 	rcs_print_error
 	    ("No blocking semaphore available. Can not call blocking_read(%f).\n",
 	    blocking_timeout);
@@ -468,6 +882,15 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	return (status = CMS_NO_BLOCKING_SEM_ERROR);
     }
 
+    /* A write after this makes a blocking_read() stop waiting. */
+    if (NULL != notify) {
+	notify_seen = notify->seq;
+    }
+
+    if (NULL != zc_control) {
+	return zc_access(_local, serial_number);
+    }
+
     mao.read_only = ((internal_access_type == CMS_CHECK_IF_READ_ACCESS) ||
 	(internal_access_type == CMS_PEEK_ACCESS) ||
 	(internal_access_type == CMS_READ_ACCESS));
@@ -545,6 +968,13 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
     /* Perform access function. */
     internal_access(shm->addr, size, _local, serial_number);
 
+    /* Still under the lock, so the ring is in the order of the buffer. */
+    if (NULL != tap && status == CMS_WRITE_OK &&
+	(internal_access_type == CMS_WRITE_ACCESS
+	    || internal_access_type == CMS_WRITE_IF_READ_ACCESS)) {
+	cms_tap_put(tap, _local, header.in_buffer_size, header.write_id);
+    }
+
     disable_diag_store = 0;
 
     if (NULL != bsem &&
@@ -573,10 +1003,40 @@ CMS_STATUS SHMEM::main_access(void *_local, int *serial_number)
 	break;
     }
 
+    if (NULL != notify && status == CMS_WRITE_OK &&
+	(internal_access_type == CMS_WRITE_ACCESS
+	    || internal_access_type == CMS_WRITE_IF_READ_ACCESS)) {
+	rcs_notify_post(notify);
+    }
+
     switch (internal_access_type) {
 
     case CMS_READ_ACCESS:
-	if (NULL != bsem && status == CMS_READ_OLD &&
+	if (NULL != notify && status == CMS_READ_OLD &&
+	    (blocking_timeout > 1e-6 || blocking_timeout < -1E-6)) {
+	    if (second_read > 10 && total_subdivisions <= 1) {
+		status = CMS_MISC_ERROR;
+		rcs_print_error
+		    ("CMS: Blocking wait error. The wait has returned %d times but there is still no new data.\n",
+		    second_read);
+		second_read = 0;
+		return (status);
+	    }
+	    second_read++;
+	    switch (rcs_notify_wait(notify, notify_seen,
+			notify_timeout(blocking_timeout))) {
+	    case -2:
+		status = CMS_TIMED_OUT;
+		second_read = 0;
+		return (status);
+	    case -1:
+		rcs_print_error("CMS: Blocking wait error.\n");
+		status = CMS_MISC_ERROR;
+		second_read = 0;
+		return (status);
+	    }
+	    main_access(_local, serial_number);
+	} else if (NULL != bsem && status == CMS_READ_OLD &&
 	    (blocking_timeout > 1e-6 || blocking_timeout < -1E-6)) {
 	    if (second_read > 10 && total_subdivisions <= 1) {
 		status = CMS_MISC_ERROR;
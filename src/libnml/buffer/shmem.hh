@@ -42,6 +42,10 @@ class SHMEM:public CMS {
     virtual ~ SHMEM();
 
     CMS_STATUS main_access(void *_local, int *serial_number);
+    int view_valid();
+    int wait_for_write(double _timeout);
+    RCS_NOTIFY *get_notify(unsigned int *seen);
+    CMS_TAP *get_tap();
 
   private:
 
@@ -76,8 +80,23 @@ class SHMEM:public CMS {
     void *shm_addr_offset;
 
     RCS_SEMAPHORE *bsem;	// blocking semaphore
+    RCS_NOTIFY *notify;		/* write notification, after the buffer */
+    unsigned int notify_seen;	/* notify->seq at the last access */
+    CMS_TAP *tap;		/* last messages written, after notify */
     int autokey_table_size;
 
+    /* zerocopy: a control block and two message slots */
+    struct SHMEM_ZC_CONTROL *zc_control;
+    long zc_slot_size;
+    int view_slot;		/* slot, sequence number and message id */
+    unsigned long view_seq;	/* seen by the last peek_view() */
+    CMSID view_id;
+    int zc_open(long segment_size);
+    struct SHMEM_ZC_SLOT *zc_slot(int i);
+    CMS_STATUS zc_access(void *_local, int *serial_number);
+    CMS_STATUS zc_read();
+    CMS_STATUS zc_write(void *_local, int *serial_number);
+
 };
 
 #endif /* !SHMEM_HH */
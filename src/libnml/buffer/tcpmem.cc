@@ -100,6 +100,28 @@ TCPMEM::TCPMEM(const char *_bufline, const char *_procline):CMS(_bufline, _procl
     if (NULL != strstr(ProcessLine, "noreconnect")) {
 	autoreconnect = 0;
     }
+    delta_requested = 0;
+    /* options follow the nine or ten words CMS::CMS() reads, the first
+       of which are names that may be "delta" themselves */
+    int word_number = 0;
+    for (const char *token = ProcessLine; *token; word_number++) {
+	const char *end;
+
+	while (isspace((unsigned char) *token)) {
+	    token++;
+	}
+	for (end = token; *end && !isspace((unsigned char) *end); end++) {
+	}
+	if (word_number >= 9 && end - token == 5 &&
+	    !strncmp(token, "delta", 5)) {
+	    delta_requested = 1;
+	}
+	token = end;
+    }
+    delta_subscription = 0;
+    receiving_delta = 0;
+    delta_base = NULL;
+    delta_base_size = 0;
     server_host_entry = NULL;
 
     /* Set up the socket address stucture. */
@@ -514,6 +536,14 @@ void TCPMEM::reconnect()
 	subscription_type = CMS_NO_SUBSCRIPTION;
     }
 
+    delta_subscription = 0;
+    receiving_delta = 0;
+    delta_base_size = 0;
+    int sub_request = subscription_type;
+    if (delta_requested) {
+	sub_request |= CMS_DELTA_SUBSCRIPTION_FLAG;
+    }
+  subscribe:
     if (subscription_type != CMS_NO_SUBSCRIPTION) {
 	verify_bufname();
 	if (status < 0) {
@@ -523,7 +553,7 @@ void TCPMEM::reconnect()
 	putbe32(temp_buffer, (uint32_t) serial_number);
 	putbe32(temp_buffer + 4, REMOTE_CMS_SET_SUBSCRIPTION_REQUEST_TYPE);
 	putbe32(temp_buffer + 8, (uint32_t) buffer_number);
-	putbe32(temp_buffer + 12, (uint32_t) subscription_type);
+	putbe32(temp_buffer + 12, (uint32_t) sub_request);
 	putbe32(temp_buffer + 16, (uint32_t) poll_interval_millis);
 	if (sendn(socket_fd, temp_buffer, 20, 0, 30) < 0) {
 	    rcs_print_error("Can`t setup subscription.\n");
@@ -543,6 +573,8 @@ void TCPMEM::reconnect()
 	    if (!getbe32(temp_buffer+4)) {
 		rcs_print_error("Can`t setup subscription.\n");
 		subscription_type = CMS_NO_SUBSCRIPTION;
+	    } else if (getbe32(temp_buffer+4) & CMS_DELTA_SUBSCRIPTION_FLAG) {
+		delta_subscription = 1;
 	    }
 
 	    bytes_to_throw_away = 8 - recvd_bytes;
@@ -552,6 +584,16 @@ void TCPMEM::reconnect()
 	    recvd_bytes = 0;
 	}
 	memset(temp_buffer, 0, 20);
+	if (subscription_type != CMS_NO_SUBSCRIPTION && !delta_subscription
+	    && (sub_request & CMS_DELTA_SUBSCRIPTION_FLAG)) {
+	    /* Older servers accept but ignore the delta flag, so ask again
+	       for a plain subscription. */
+	    rcs_print_debug(PRINT_CMS_CONFIG_INFO,
+		"TCPMEM: server does not send delta updates for %s.\n",
+		BufferName);
+	    sub_request &= ~CMS_DELTA_SUBSCRIPTION_FLAG;
+	    goto subscribe;
+	}
     }
     if (subscription_type != CMS_NO_SUBSCRIPTION) {
 	polling = 1;
@@ -631,6 +673,10 @@ void TCPMEM::reconnect()
 TCPMEM::~TCPMEM()
 {
     disconnect();
+    if (NULL != delta_base) {
+	free(delta_base);
+	delta_base = NULL;
+    }
 }
 
 void TCPMEM::disconnect()
@@ -662,6 +708,50 @@ void TCPMEM::disconnect()
     }
 }
 
+/* Rebuild the message in encoded_data from a delta subscription update.
+   A keyframe holds the whole message, a delta its size followed by
+   (offset, length, bytes) for each range changed since the last update. */
+CMS_STATUS TCPMEM::apply_delta(long delta_size)
+{
+    if (NULL == delta_base) {
+	delta_base = (char *) malloc(max_encoded_message_size);
+	if (NULL == delta_base) {
+	    rcs_print_error("TCPMEM: Can't allocate delta buffer.\n");
+	    return (status = CMS_CREATE_ERROR);
+	}
+    }
+    if (!receiving_delta) {
+	memcpy(delta_base, encoded_data, delta_size);
+	delta_base_size = delta_size;
+	return status;
+    }
+    receiving_delta = 0;
+    char *delta = (char *) encoded_data;
+    long new_size = getbe32(delta);
+    long used = 4;
+    if (delta_base_size < 1 || new_size < 0
+	|| new_size > max_encoded_message_size) {
+	rcs_print_error("TCPMEM: Bad delta update for %s.\n", BufferName);
+	return (status = CMS_MISC_ERROR);
+    }
+    while (used + 8 <= delta_size) {
+	long offset = getbe32(delta + used);
+	long length = getbe32(delta + used + 4);
+	used += 8;
+	if (offset < 0 || length < 0 || offset + length > new_size
+	    || used + length > delta_size) {
+	    rcs_print_error("TCPMEM: Bad delta update for %s.\n",
+		BufferName);
+	    return (status = CMS_MISC_ERROR);
+	}
+	memcpy(delta_base + offset, delta + used, length);
+	used += length;
+    }
+    delta_base_size = new_size;
+    memcpy(encoded_data, delta_base, delta_base_size);
+    return status;
+}
+
 CMS_STATUS TCPMEM::handle_old_replies()
 {
     long message_size;
@@ -691,6 +781,7 @@ CMS_STATUS TCPMEM::handle_old_replies()
 		} else {
 		    recvd_bytes = 0;
 		    fatal_error_occurred = 1;
+		    reconnect_needed = 1;
 		    return (status = CMS_MISC_ERROR);
 		}
 	    }
@@ -717,6 +808,9 @@ CMS_STATUS TCPMEM::handle_old_replies()
 		(CMS_STATUS) ntohl(*((uint32_t *) temp_buffer + 1));
 	    timedout_request_writeid = ntohl(*((uint32_t *) temp_buffer + 3));
 	    header.was_read = ntohl(*((uint32_t *) temp_buffer + 4));
+	    receiving_delta = delta_subscription &&
+		(header.was_read & CMS_DELTA_UPDATE_FLAG);
+	    header.was_read &= ~CMS_DELTA_UPDATE_FLAG;
 	    if (message_size > max_encoded_message_size) {
 		rcs_print_error("Received message is too big. (%ld > %ld)\n",
 		    message_size, max_encoded_message_size);
@@ -763,6 +857,12 @@ CMS_STATUS TCPMEM::handle_old_replies()
 	    if (waiting_for_message) {
 		timedout_request_writeid = waiting_message_id;
 	    }
+	    if (delta_subscription && apply_delta(message_size) < 0) {
+		timedout_request_writeid = 0;
+		fatal_error_occurred = 1;
+		reconnect_needed = 1;
+		return status;
+	    }
 	}
 	break;
 
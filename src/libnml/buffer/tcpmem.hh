@@ -81,6 +81,12 @@ class TCPMEM:public CMS {
     void reenable_sigpipe();
     void verify_bufname();
     int subscription_count;
+    int delta_requested;	/* "delta" given on the process line */
+    int delta_subscription;	/* Has the server agreed to send deltas? */
+    int receiving_delta;	/* Is the update being received a delta? */
+    char *delta_base;		/* The message as of the last update */
+    long delta_base_size;
+    CMS_STATUS apply_delta(long delta_size);
 };
 
 #endif
@@ -37,11 +37,20 @@ extern "C" {
 #include "cms_xup.hh"		/* class CMS_XDR_UPDATER */
 #include "cms_aup.hh"		/* class CMS_ASCII_UPDATER */
 #include "cms_dup.hh"		/* class CMS_DISPLAY_ASCII_UPDATER */
+#include "cms_pup.hh"		/* class CMS_PACKED_UPDATER */
 #include "rcs_print.hh"		/* rcs_print_error(), separate_words() */
+#include "_shm.h"		/* rcs_instance_number() */
 				/* rcs_print_debug() */
 #include "cmsdiag.hh"
 #include "linklist.hh"          /* LinkedList */
 #include "physmem.hh"
+#include "timer.hh"		/* esleep() */
+#include "cms_stats.hh"		/* cms_stats_channel() */
+#include "notify.hh"		/* RCS_NOTIFY_FOREVER */
+
+/* TCP/STCP/UDP ports of a buffer are moved up by this much for each
+   RTAPI_INSTANCE, so the servers of side by side machines don't clash */
+#define CMS_INSTANCE_PORT_STRIDE 16
 
 LinkedList *cmsHostAliases = NULL;
 CMS_CONNECTION_MODE cms_connection_mode = CMS_NORMAL_CONNECTION_MODE;
@@ -153,6 +162,15 @@ CMS::CMS(long s)
     read_permission_flag = 0;	/* Allow both read and write by default.  */
     write_permission_flag = 0;
     queuing_enabled = 0;
+    zero_copy = 0;
+    notify_writes = 0;
+    tap_messages = 0;
+    stats_enabled = 0;
+    stats = NULL;
+    stats_pending_id = 0;
+    stats_pending_ns = 0;
+    view_data = NULL;
+    schema_hash = 0;
     fatal_error_occurred = 0;
     write_just_completed = 0;
     neutral_encoding_method = CMS_XDR_ENCODING;
@@ -245,6 +263,15 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
     delete_totally = 0;
     queuing_enabled = 0;
     split_buffer = 0;
+    zero_copy = 0;
+    notify_writes = 0;
+    tap_messages = 0;
+    stats_enabled = 0;
+    stats = NULL;
+    stats_pending_id = 0;
+    stats_pending_ns = 0;
+    view_data = NULL;
+    schema_hash = 0;
     fatal_error_occurred = 0;
     consecutive_timeouts = 0;
     write_just_completed = 0;
@@ -367,6 +394,30 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	    split_buffer = 1;
 	    continue;
 	}
+	if (!strcmp(word[i], "ZEROCOPY")) {
+	    zero_copy = 1;
+	    continue;
+	}
+	if (!strcmp(word[i], "NOTIFY")) {
+	    notify_writes = 1;
+	    continue;
+	}
+	if (!strcmp(word[i], "TAP")) {
+	    tap_messages = 1;
+	    continue;
+	}
+	if (!strcmp(word[i], "STATS")) {
+	    stats_enabled = 1;
+	    continue;
+	}
+	if (!strcmp(word[i], "PACKED")) {
+	    neutral_encoding_method = CMS_PACKED_ENCODING;
+	    continue;
+	}
+	if (!strcmp(word[i], "SCHEMA_HASH")) {
+	    schema_hash = 1;
+	    continue;
+	}
 	if (!strcmp(word[i], "DISP")) {
 	    neutral_encoding_method = CMS_DISPLAY_ASCII_ENCODING;
 	    continue;
@@ -384,17 +435,20 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	if (NULL != (port_string = strstr(word[i], "STCP="))) {
 	    remote_port_type = CMS_STCP_REMOTE_PORT_TYPE;
 	    stcp_port_number =
-		(int) strtol(port_string + 5, (char **) NULL, 0);
+		(int) strtol(port_string + 5, (char **) NULL, 0)
+		+ CMS_INSTANCE_PORT_STRIDE * rcs_instance_number();
 	    continue;
 	} else if (NULL != (port_string = strstr(word[i], "TCP="))) {
 	    remote_port_type = CMS_TCP_REMOTE_PORT_TYPE;
 	    tcp_port_number =
-		(int) strtol(port_string + 4, (char **) NULL, 0);
+		(int) strtol(port_string + 4, (char **) NULL, 0)
+		+ CMS_INSTANCE_PORT_STRIDE * rcs_instance_number();
 	    continue;
 	} else if (NULL != (port_string = strstr(word[i], "UDP="))) {
 	    remote_port_type = CMS_UDP_REMOTE_PORT_TYPE;
 	    udp_port_number =
-		(int) strtol(port_string + 4, (char **) NULL, 0);
+		(int) strtol(port_string + 4, (char **) NULL, 0)
+		+ CMS_INSTANCE_PORT_STRIDE * rcs_instance_number();
 	    continue;
 	}
 
@@ -590,6 +644,28 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	status = CMS_CONFIG_ERROR;
 	return;
     }
+    if (zero_copy && (queuing_enabled || split_buffer || neutral
+	    || enable_diagnostics || total_subdivisions > 1)) {
+	rcs_print_error
+	    ("CMS: %s: zerocopy can not be used with queue, split, diag, subdiv or a neutral buffer.\n",
+	    BufferName);
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+    if (ProcessType != CMS_LOCAL_TYPE || BufferType != CMS_SHMEM_TYPE) {
+	/* Only local SHMEM connections see the double buffered layout. */
+	zero_copy = 0;
+    }
+    if (tap_messages && neutral) {
+	rcs_print_error("CMS: %s: tap can not be used with a neutral buffer.\n",
+	    BufferName);
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+    if (stats_enabled && ProcessType == CMS_LOCAL_TYPE) {
+	/* Remote connections are counted by the server. */
+	stats = cms_stats_channel(BufferName);
+    }
     if (min_compatible_version > 3.39 || min_compatible_version <= 0.0) {
 	if (neutral_encoding_method == CMS_ASCII_ENCODING) {
 	    neutral_encoding_method = CMS_DISPLAY_ASCII_ENCODING;
@@ -679,6 +755,10 @@ void CMS::open(void)
 	    updater = new CMS_DISPLAY_ASCII_UPDATER(this);
 	    break;
 
+	case CMS_PACKED_ENCODING:
+	    updater = new CMS_PACKED_UPDATER(this, schema_hash);
+	    break;
+
 	default:
 	    updater = (CMS_UPDATER *) NULL;
 	    status = CMS_UPDATE_ERROR;
@@ -878,6 +958,10 @@ CMS::~CMS()
 	    encoded_data = NULL;
 	}
     }
+    if (NULL != stats) {
+	cms_stats_release(stats);
+	stats = NULL;
+    }
     number_of_cms_objects--;
 
     if (NULL != dummy_handle) {
@@ -1004,6 +1088,9 @@ CMS_STATUS CMS::read()
     status = CMS_STATUS_NOT_SET;
     blocking_timeout = 0;
     main_access(data);
+    if (NULL != stats) {
+	record_stats();
+    }
     return (status);
 }
 
@@ -1013,6 +1100,9 @@ CMS_STATUS CMS::blocking_read(double _blocking_timeout)
     internal_access_type = CMS_READ_ACCESS;
     blocking_timeout = _blocking_timeout;
     main_access(data);
+    if (NULL != stats) {
+	record_stats();
+    }
     return (status);
 }
 
@@ -1030,14 +1120,68 @@ CMS_STATUS CMS::peek()
     status = CMS_STATUS_NOT_SET;
     blocking_timeout = 0;
     main_access(data);
+    if (NULL != stats) {
+	record_stats();
+    }
     return (status);
 }
 
+/* Like peek(), but a buffer with zero_copy set does not copy the message:
+   view_data is left pointing at it in the shared memory. The view stays
+   usable until the writer has written twice more, which view_valid()
+   checks. Other buffers copy as usual and view_data points at the copy. */
+CMS_STATUS CMS::peek_view()
+{
+    if (!zero_copy) {
+	peek();
+	view_data = subdiv_data;
+	return (status);
+    }
+    internal_access_type = CMS_PEEK_VIEW_ACCESS;
+    status = CMS_STATUS_NOT_SET;
+    blocking_timeout = 0;
+    main_access(data);
+    if (NULL != stats) {
+	record_stats();
+    }
+    return (status);
+}
+
+int CMS::view_valid()
+{
+    return 1;
+}
+
+/* Buffers without notification can only sleep. Returns 1 if the buffer
+   was written, 0 on timeout or if that is unknown, -1 on error, which
+   waiting RCS_NOTIFY_FOREVER for a write nobody can see would be. */
+int CMS::wait_for_write(double _timeout)
+{
+    if (_timeout == RCS_NOTIFY_FOREVER) {
+	return -1;
+    }
+    esleep(_timeout);
+    return 0;
+}
+
+RCS_NOTIFY *CMS::get_notify(unsigned int *seen)
+{
+    return NULL;
+}
+
+CMS_TAP *CMS::get_tap()
+{
+    return NULL;
+}
+
 CMS_STATUS CMS::write(void *user_data, int *serial_number)
 {
     internal_access_type = CMS_WRITE_ACCESS;
     status = CMS_STATUS_NOT_SET;
     main_access(user_data, serial_number);
+    if (NULL != stats) {
+	record_stats();
+    }
     return (status);
 }
 
@@ -1046,6 +1190,9 @@ CMS_STATUS CMS::write_if_read(void *user_data, int *serial_number)
     internal_access_type = CMS_WRITE_IF_READ_ACCESS;
     status = CMS_STATUS_NOT_SET;
     main_access(user_data, serial_number);
+    if (NULL != stats) {
+	record_stats();
+    }
     return (status);
 }
 
@@ -1123,6 +1270,10 @@ void CMS::set_temp_updater(CMS_NEUTRAL_ENCODING_METHOD temp_encoding_method)
 	    temp_updater = new CMS_DISPLAY_ASCII_UPDATER(this);
 	    break;
 
+	case CMS_PACKED_ENCODING:
+	    temp_updater = new CMS_PACKED_UPDATER(this, schema_hash);
+	    break;
+
 	default:
 	    temp_updater = (CMS_UPDATER *) NULL;
 	    status = CMS_UPDATE_ERROR;
@@ -1271,6 +1422,19 @@ int CMS::get_encoded_msg_size()
     return (header.in_buffer_size = updater->get_encoded_msg_size());
 }
 
+/* Called after a message has been decoded, to let the updater check
+   anything it appended to the message. */
+int CMS::check_decoded_msg()
+{
+    if (force_raw) {
+	return 0;
+    }
+    if (NULL == updater) {
+	return (-1);
+    }
+    return (updater->check_decoded_msg());
+}
+
 int CMS::check_pointer(char *ptr, long bytes)
 {
     if (force_raw) {
@@ -40,6 +40,9 @@ struct PM_ROTATION_VECTOR;
 struct PM_RPY;
 struct PM_SPHERICAL;
 class LinkedList;
+struct RCS_NOTIFY;
+struct CMS_STATS_CHANNEL;
+struct CMS_TAP;
 
 enum CMS_STATUS {
 /* ERROR conditions */
@@ -112,7 +115,8 @@ enum CMS_INTERNAL_ACCESS_TYPE {
     CMS_GET_MSG_COUNT_ACCESS,
     CMS_GET_DIAG_INFO_ACCESS,
     CMS_GET_QUEUE_LENGTH_ACCESS,
-    CMS_GET_SPACE_AVAILABLE_ACCESS
+    CMS_GET_SPACE_AVAILABLE_ACCESS,
+    CMS_PEEK_VIEW_ACCESS
 };
 
 /* What type of global memory buffer. */
@@ -163,7 +167,8 @@ enum CMS_NEUTRAL_ENCODING_METHOD {
     CMS_NO_ENCODING,
     CMS_XDR_ENCODING,
     CMS_ASCII_ENCODING,
-    CMS_DISPLAY_ASCII_ENCODING
+    CMS_DISPLAY_ASCII_ENCODING,
+    CMS_PACKED_ENCODING
 };
 
 /* CMS class declaration. */
@@ -193,6 +198,17 @@ class CMS {
 							   wait for new data. 
 							 */
     virtual CMS_STATUS peek();	/* Read without setting flag. */
+    CMS_STATUS peek_view();	/* Peek, leaving view_data pointing at the
+				   message in the buffer. (ZEROCOPY) */
+    virtual int view_valid();	/* Has view_data been overwritten since? */
+    virtual int wait_for_write(double _timeout);	/* Wait until written
+							   after the last
+							   read or peek. */
+    virtual RCS_NOTIFY *get_notify(unsigned int *seen);	/* NOTIFY block and
+							   its seq at the
+							   last access. */
+    virtual CMS_TAP *get_tap();	/* ring of the last messages written
+				   (TAP) */
     virtual CMS_STATUS write(void *user_data, int *serial_number = NULL);	/* Write to buffer. */
     virtual CMS_STATUS write_if_read(void *user_data, int *serial_number = NULL);	/* Write to buffer. */
     virtual int login(const char *name, const char *passwd);
@@ -207,6 +223,7 @@ class CMS {
     /* Neutrally Encoded Buffer positioning functions. */
     void rewind();		/* positions at beginning */
     int get_encoded_msg_size();	/* Store last position in header.size */
+    int check_decoded_msg();	/* Check the end of a decoded message */
 
     /* Buffer access control functions. */
     void set_mode(CMSMODE im);	/* Determine read/write mode.(check neutral) */
@@ -367,6 +384,21 @@ class CMS {
 				   that one area can be read while the other
 				   is written to ? */
     char toggle_bit;
+    int zero_copy;		/* Is the buffer double buffered, so that
+				   readers need no lock and can use
+				   peek_view() ? */
+    int notify_writes;		/* Do writers wake the readers waiting in
+				   blocking_read() ? (SHMEM) */
+    int tap_messages;		/* Keep the last messages written for
+				   nmlrecord ? (SHMEM) */
+    int stats_enabled;		/* Keep statistics in the stats page ? */
+    CMS_STATS_CHANNEL *stats;	/* this buffer in the stats page */
+    long stats_pending_id;	/* read before its write time was stored */
+    unsigned long long stats_pending_ns;
+    void record_stats();
+    void *view_data;		/* message found by the last peek_view() */
+    int schema_hash;		/* Does the PACKED encoding carry a hash of
+				   the message layout ? */
     int first_read_done;
     int first_write_done;
     int write_permission_flag;
@@ -30,6 +30,7 @@ extern "C" {
 #include <arpa/inet.h>		/* inet_ntoa */
 #include <netinet/in.h>		/* sockaddr_in */
 #include <stdlib.h>
+#include <sys/stat.h>		/* stat(), fstat() */
 
 #ifdef __cplusplus
 }
@@ -67,9 +68,30 @@ extern "C" {
 #include "rcs_print.hh"		/* rcs_print_error() */
 #include "linklist.hh"		/* LinkedList */
 
+/* Each configuration file is read once per process and kept as the list of
+   its lines plus hash tables of its buffer lines (keyed by buffer name) and
+   process lines (keyed by process and buffer name), so connecting to a
+   channel no longer rereads and scans the whole file.  The cached copy is
+   dropped and the file read again whenever its modification time, size or
+   inode changes. */
+struct CONFIG_LINE_INFO {
+    const char *line;		/* the line as stored in lines_list */
+    int line_number;
+    char *name;			/* buffer or process name */
+    char *bufname;		/* buffer name of a process line */
+};
+
 struct CONFIG_FILE_INFO {
     CONFIG_FILE_INFO() {
 	lines_list = NULL;
+	file_name = NULL;
+	lines = NULL;
+	num_lines = 0;
+	max_lines = 0;
+	buffer_table = NULL;
+	proc_table = NULL;
+	table_size = 0;
+	memset(&file_stat, 0, sizeof(file_stat));
     };
 
     ~CONFIG_FILE_INFO() {
@@ -77,78 +99,227 @@ struct CONFIG_FILE_INFO {
 	    delete lines_list;
 	    lines_list = NULL;
 	}
+	for (int i = 0; i < num_lines; i++) {
+	    free(lines[i].name);
+	    free(lines[i].bufname);
+	}
+	free(lines);
+	free(buffer_table);
+	free(proc_table);
+	free(file_name);
     };
 
     LinkedList *lines_list;
-    char file_name[80];
+    char *file_name;
+    struct stat file_stat;	/* when the file was read */
+    CONFIG_LINE_INFO *lines;	/* buffer and process lines */
+    int num_lines;
+    int max_lines;
+    int *buffer_table;		/* indexes into lines, -1 if empty */
+    int *proc_table;
+    int table_size;		/* a power of 2 */
 };
 
 static LinkedList *config_file_list = NULL;
 static int loading_config_file = 0;
 
-int load_nml_config_file(const char *file)
+static unsigned long config_hash(const char *name, const char *bufname)
 {
-    unload_nml_config_file(file);
-    if (loading_config_file) {
-	return -1;
+    unsigned long h = 2166136261UL;
+
+    while (*name) {
+	h = (h ^ (unsigned char) *name++) * 16777619UL;
     }
-    loading_config_file = 1;
-    if (NULL == file) {
-	loading_config_file = 0;
-	return -1;
+    if (NULL != bufname) {
+	h = (h ^ ' ') * 16777619UL;
+	while (*bufname) {
+	    h = (h ^ (unsigned char) *bufname++) * 16777619UL;
+	}
     }
-    if (NULL == config_file_list) {
-	config_file_list = new LinkedList();
+    return h;
+}
+
+/* Returns the slot holding name (and bufname for process lines), or the
+   empty slot where it belongs. */
+static int config_slot(CONFIG_FILE_INFO * info, int *table,
+    const char *name, const char *bufname)
+{
+    int mask = info->table_size - 1;
+    int i = config_hash(name, bufname) & mask;
+
+    while (table[i] >= 0) {
+	CONFIG_LINE_INFO *l = &info->lines[table[i]];
+	if (!strcmp(l->name, name) &&
+	    (NULL == bufname || !strcmp(l->bufname, bufname))) {
+	    break;
+	}
+	i = (i + 1) & mask;
     }
-    if (NULL == config_file_list) {
-	loading_config_file = 0;
+    return i;
+}
+
+static CONFIG_LINE_INFO *find_config_line(CONFIG_FILE_INFO * info,
+    int *table, const char *name, const char *bufname)
+{
+    int i = config_slot(info, table, name, bufname);
+
+    if (table[i] < 0) {
+	return NULL;
+    }
+    return &info->lines[table[i]];
+}
+
+static int add_config_line(CONFIG_FILE_INFO * info, const char *line,
+    int line_number, const char *name, const char *bufname)
+{
+    if (info->num_lines >= info->max_lines) {
+	int n = info->max_lines ? 2 * info->max_lines : 32;
+	CONFIG_LINE_INFO *l = (CONFIG_LINE_INFO *)
+	    realloc(info->lines, n * sizeof(CONFIG_LINE_INFO));
+	if (NULL == l) {
+	    return -1;
+	}
+	info->lines = l;
+	info->max_lines = n;
+    }
+    CONFIG_LINE_INFO *l = &info->lines[info->num_lines++];
+    l->line = line;
+    l->line_number = line_number;
+    l->name = strdup(name);
+    l->bufname = bufname ? strdup(bufname) : NULL;
+    return 0;
+}
+
+/* Build the hash tables. Only the first line for each key is entered,
+   since that is the one a sequential search of the file would find. */
+static int index_config_lines(CONFIG_FILE_INFO * info)
+{
+    int size = 16;
+    int i;
+
+    while (size < 2 * info->num_lines) {
+	size *= 2;
+    }
+    info->table_size = size;
+    info->buffer_table = (int *) malloc(size * sizeof(int));
+    info->proc_table = (int *) malloc(size * sizeof(int));
+    if (NULL == info->buffer_table || NULL == info->proc_table) {
 	return -1;
     }
+    for (i = 0; i < size; i++) {
+	info->buffer_table[i] = -1;
+	info->proc_table[i] = -1;
+    }
+    for (i = 0; i < info->num_lines; i++) {
+	CONFIG_LINE_INFO *l = &info->lines[i];
+	int *table = l->bufname ? info->proc_table : info->buffer_table;
+	int slot = config_slot(info, table, l->name, l->bufname);
+	if (table[slot] < 0) {
+	    table[slot] = i;
+	}
+    }
+    return 0;
+}
+
+static CONFIG_FILE_INFO *read_nml_config_file(const char *file)
+{
     char line[CMS_CONFIG_LINELEN];	/* Temporary buffer for line from
 					   file. */
-
-    CONFIG_FILE_INFO *info = new CONFIG_FILE_INFO();
-    info->lines_list = new LinkedList();
-    strncpy(info->file_name, file, 80);
+    char *word[4];		/* array of pointers to words from line */
+    int line_len, line_number;
     FILE *fp;
+
     fp = fopen(file, "r");
     if (fp == NULL) {
 	rcs_print_error("cms_config: can't open '%s'. Error = %d -- %s\n",
 	    file, errno, strerror(errno));
-	if (NULL != info) {
-	    delete info;
-	}
-	loading_config_file = 0;
-	return -1;
+	return NULL;
     }
+    CONFIG_FILE_INFO *info = new CONFIG_FILE_INFO();
+    info->lines_list = new LinkedList();
+    info->file_name = strdup(file);
+    fstat(fileno(fp), &info->file_stat);
+
+    line_number = 0;
     while (!feof(fp)) {
 	if ((fgets(line, CMS_CONFIG_LINELEN, fp)) == NULL) {
 	    break;
 	}
-	int linelen = strlen(line);
-	if (linelen < 3) {
+	line_number++;
+	line_len = strlen(line);
+	if (line_len < 3) {
 	    continue;
 	}
-	while (line[linelen - 1] == '\\') {
-	    int pos = linelen - 2;
+	while (line[line_len - 1] == '\\') {
+	    int pos = line_len - 2;
 	    if ((fgets(line + pos, CMS_CONFIG_LINELEN - pos, fp)) == NULL) {
 		break;
 	    }
-	    linelen = strlen(line);
-	    if (linelen > CMS_CONFIG_LINELEN - 2) {
+	    line_len = strlen(line);
+	    if (line_len > CMS_CONFIG_LINELEN - 2) {
 		break;
 	    }
+	    line_number++;
+	}
+	if (line_len > CMS_CONFIG_LINELEN) {
+	    rcs_print_error
+		("cms_cfg: Line length of line number %d in %s exceeds max length of %d",
+		line_number, file, CMS_CONFIG_LINELEN);
+	}
+
+	if (line[0] == CMS_CONFIG_COMMENTCHAR) {
+	    continue;
 	}
+	info->lines_list->store_at_tail(line, line_len + 1, 1);
 
-	if (line[0] == '#') {
+	/* Lines starting with white space are skipped too. */
+	if (strchr(" \t\n\r\0", line[0]) != NULL ||
+	    (line[0] != 'B' && line[0] != 'P')) {
 	    continue;
 	}
-	info->lines_list->store_at_tail(line, linelen + 1, 1);
+
+	/* Separate out the first four strings in the line. */
+	if (separate_words(word, 4, line) != 4) {
+	    continue;
+	}
+	if (add_config_line(info, (char *) info->lines_list->get_tail(),
+		line_number, word[1], line[0] == 'P' ? word[2] : NULL) < 0) {
+	    break;
+	}
     }
+    fclose(fp);
 
-    if (NULL != fp) {
-	fclose(fp);
-	fp = NULL;
+    if (index_config_lines(info) < 0) {
+	rcs_print_error("cms_config: out of memory reading '%s'.\n", file);
+	delete info;
+	return NULL;
+    }
+    return info;
+}
+
+int load_nml_config_file(const char *file)
+{
+    unload_nml_config_file(file);
+    if (loading_config_file) {
+	return -1;
+    }
+    loading_config_file = 1;
+    if (NULL == file) {
+	loading_config_file = 0;
+	return -1;
+    }
+    if (NULL == config_file_list) {
+	config_file_list = new LinkedList();
+    }
+    if (NULL == config_file_list) {
+	loading_config_file = 0;
+	return -1;
+    }
+
+    CONFIG_FILE_INFO *info = read_nml_config_file(file);
+    if (NULL == info) {
+	loading_config_file = 0;
+	return -1;
     }
     config_file_list->store_at_tail(info, sizeof(info), 0);
     loading_config_file = 0;
@@ -169,7 +340,7 @@ int unload_nml_config_file(const char *file)
     CONFIG_FILE_INFO *info =
 	(CONFIG_FILE_INFO *) config_file_list->get_head();
     while (NULL != info) {
-	if (!strncmp(info->file_name, file, 80)) {
+	if (!strcmp(info->file_name, file)) {
 	    config_file_list->delete_current_node();
 	    delete info;
 	    return 0;
@@ -190,7 +361,7 @@ CONFIG_FILE_INFO *get_loaded_nml_config_file(const char *file)
     CONFIG_FILE_INFO *info =
 	(CONFIG_FILE_INFO *) config_file_list->get_head();
     while (NULL != info) {
-	if (!strncmp(info->file_name, file, 80)) {
+	if (!strcmp(info->file_name, file)) {
 	    return info;
 	}
 	info = (CONFIG_FILE_INFO *) config_file_list->get_next();
@@ -198,6 +369,31 @@ CONFIG_FILE_INFO *get_loaded_nml_config_file(const char *file)
     return NULL;
 }
 
+/* Returns the cached copy of file, reading it first if it was never read
+   or has changed since. */
+static CONFIG_FILE_INFO *get_nml_config_file_index(const char *file)
+{
+    struct stat st;
+    CONFIG_FILE_INFO *info = get_loaded_nml_config_file(file);
+
+    if (NULL != info) {
+	if (stat(file, &st) == 0 &&
+	    st.st_mtim.tv_sec == info->file_stat.st_mtim.tv_sec &&
+	    st.st_mtim.tv_nsec == info->file_stat.st_mtim.tv_nsec &&
+	    st.st_size == info->file_stat.st_size &&
+	    st.st_ino == info->file_stat.st_ino &&
+	    st.st_dev == info->file_stat.st_dev) {
+	    return info;
+	}
+	rcs_print_debug(PRINT_CMS_CONFIG_INFO,
+	    "cms_config: %s changed, reading it again\n", file);
+    }
+    if (load_nml_config_file(file) < 0) {
+	return NULL;
+    }
+    return get_loaded_nml_config_file(file);
+}
+
 /*! \todo Another #if 0 */
 #if 0
 int print_loaded_nml_config_file(const char *file)
@@ -303,91 +499,16 @@ int cms_copy(CMS ** dest, CMS * src, int set_to_server, int set_to_master)
 
 extern char *get_buffer_line(const char *bufname, const char *filename)
 {
-    int line_len, line_number;
-    char linebuf[CMS_CONFIG_LINELEN];	/* Temporary buffer for line from
-					   file. */
-    char *line = linebuf;
-    FILE *fp = NULL;		/* FILE ptr to config file.  */
-    char *word[4];		/* array of pointers to words from line */
-
-    /* Open the configuration file. */
-    LinkedList *lines_list = NULL;
-    CONFIG_FILE_INFO *info = get_loaded_nml_config_file(filename);
-    if (NULL != info) {
-	lines_list = info->lines_list;
-	line = (char *) lines_list->get_head();
-    }
-
-    if (NULL == lines_list) {
-	fp = fopen(filename, "r");
-	if (fp == NULL) {
-	    rcs_print_error("cms_config: can't open '%s'. Error = %d -- %s\n",
-		filename, errno, strerror(errno));
-	    loading_config_file = 0;
-	    return NULL;
-	}
+    CONFIG_FILE_INFO *info = get_nml_config_file_index(filename);
+    if (NULL == info) {
+	return NULL;
     }
-
-    /* Read the configuration file line by line until the lines matching */
-    /* bufname and procname are found.  */
-    line_number = 0;
-    int first_line = 1;
-
-    while (1) {
-	if (NULL != lines_list) {
-	    if (!first_line) {
-		line = (char *) lines_list->get_next();
-	    }
-	    first_line = 0;
-	    if (NULL == line) {
-		break;
-	    }
-	} else {
-	    if (feof(fp)) {
-		break;
-	    }
-	    if ((fgets(line, CMS_CONFIG_LINELEN, fp)) == NULL) {
-		break;
-	    }
-	}
-
-	line_number++;
-	line_len = strlen(line);
-	while (line[line_len - 1] == '\\') {
-	    int pos = line_len - 2;
-	    if ((fgets(line + pos, CMS_CONFIG_LINELEN - pos, fp)) == NULL) {
-		break;
-	    }
-	    line_len = strlen(line);
-	    if (line_len > CMS_CONFIG_LINELEN - 2) {
-		break;
-	    }
-	    line_number++;
-	}
-	if (line_len > CMS_CONFIG_LINELEN) {
-	    rcs_print_error
-		("cms_cfg: Line length of line number %d in %s exceeds max length of %d",
-		line_number, filename, CMS_CONFIG_LINELEN);
-	}
-
-	/* Skip comment lines and lines starting with white space. */
-	if (line[0] == CMS_CONFIG_COMMENTCHAR ||
-	    strchr(" \t\n\r\0", line[0]) != NULL) {
-	    continue;
-	}
-
-	/* Separate out the first four strings in the line. */
-	if (separate_words(word, 4, line) != 4) {
-	    continue;
-	}
-
-	if (!strcmp(word[1], bufname) && line[0] == 'B') {
-	    /* Buffer line found, store the line and type. */
-	    return line;
-	}
+    CONFIG_LINE_INFO *b =
+	find_config_line(info, info->buffer_table, bufname, NULL);
+    if (NULL == b) {
+	return NULL;
     }
-    fclose(fp);
-    return NULL;
+    return (char *) b->line;
 }
 
 enum CONFIG_SEARCH_ERROR_TYPE {
@@ -599,156 +720,69 @@ void find_proc_and_buffer_lines(CONFIG_SEARCH_STRUCT * s)
 	return;
     }
 
-    loading_config_file = 1;
-    FILE *fp = NULL;		/* FILE ptr to config file.  */
-    char linebuf[CMS_CONFIG_LINELEN];	/* Temporary buffer for line from
-					   file. */
-    char *line = linebuf;
-    int line_len, line_number;
     char *word[4];		/* array of pointers to words from line */
+    int had_bufline = s->bufline_found;
 
-    int first_line = 1;
-
-    /* Open the configuration file. */
-    LinkedList *lines_list = NULL;
-    CONFIG_FILE_INFO *info = get_loaded_nml_config_file(s->filename);
-    if (NULL != info) {
-	lines_list = info->lines_list;
-	line = (char *) lines_list->get_head();
-    }
-
-    if (NULL == lines_list) {
-	fp = fopen(s->filename, "r");
-	if (fp == NULL) {
-	    rcs_print_error("cms_config: can't open '%s'. Error = %d -- %s\n",
-		s->filename, errno, strerror(errno));
-	    loading_config_file = 0;
-	    s->error_type = BAD_CONFIG_FILE;
-	    return;
-	}
+    CONFIG_FILE_INFO *info = get_nml_config_file_index(s->filename);
+    if (NULL == info) {
+	s->error_type = BAD_CONFIG_FILE;
+	return;
     }
 
-    /* Read the configuration file line by line until the lines matching */
-    /* bufname and procname are found.  */
-    line_number = 0;
-
-    while (1) {
-	if (NULL != lines_list) {
-	    if (!first_line) {
-		line = (char *) lines_list->get_next();
-	    }
-	    first_line = 0;
-	    if (NULL == line) {
-		break;
-	    }
-	} else {
-	    if (feof(fp)) {
-		break;
-	    }
-	    if ((fgets(line, CMS_CONFIG_LINELEN, fp)) == NULL) {
-		break;
-	    }
-	}
-
-	line_number++;
-	line_len = strlen(line);
-	if (line_len < 3) {
-	    continue;
-	}
-	while (line[line_len - 1] == '\\') {
-	    int pos = line_len - 2;
-	    if ((fgets(line + pos, CMS_CONFIG_LINELEN - pos, fp)) == NULL) {
-		break;
-	    }
-	    line_len = strlen(line);
-	    if (line_len > CMS_CONFIG_LINELEN) {
-		break;
-	    }
-	    line_number++;
-	}
-	if (line_len > CMS_CONFIG_LINELEN) {
-	    rcs_print_error
-		("cms_cfg: Line length of line number %d in %s exceeds max length of %d",
-		line_number, s->filename, CMS_CONFIG_LINELEN);
-	}
-
-	/* Skip comment lines and lines starting with white space. */
-	if (line[0] == CMS_CONFIG_COMMENTCHAR ||
-	    strchr(" \t\n\r\0", line[0]) != NULL) {
-	    continue;
-	}
-
-	/* Separate out the first four strings in the line. */
-	if (separate_words(word, 4, line) != 4) {
-	    continue;
-	}
-
-	if (!s->bufline_found && !strcmp(word[1], s->bufname) &&
-	    line[0] == 'B') {
-	    /* Buffer line found, store the line and type. */
-	    strncpy(s->buffer_line, line, CMS_CONFIG_LINELEN);
-	    convert2upper(s->buffer_type, word[2], CMS_CONFIG_LINELEN);
-	    s->bufline_found = 1;
-	    s->bufline_number = line_number;
-	    rcs_print_debug(PRINT_CMS_CONFIG_INFO,
-		"cms_config found buffer line on line %d\n", line_number);
-	} else if (!s->procline_found && !strcmp(word[1], s->procname) &&
-	    line[0] == 'P' && !strcmp(word[2], s->bufname_for_procline)) {
-	    /* Procedure line found, store the line and type. */
-	    strncpy(s->proc_line, line, CMS_CONFIG_LINELEN);
-	    switch (cms_connection_mode) {
-	    case CMS_NORMAL_CONNECTION_MODE:
-		convert2upper(s->proc_type, word[3], CMS_CONFIG_LINELEN);
-		if (!strncmp(s->proc_type, "AUTO", 4)) {
-		    if (!s->bufline_found) {
-			rcs_print_error
-			    ("Can't use process type AUTO unless the buffer line for %s is found earlier in the config file.\n",
-			    s->bufname);
-			rcs_print_error("Bad line:\n%s:%d %s\n", s->filename,
-			    line_number, line);
-			s->error_type = MISC_CONFIG_SEARCH_ERROR;
-			return;
-		    }
-		    if (hostname_matches_bufferline(s->buffer_line)) {
-			strcpy(s->proc_type, "LOCAL");
-		    } else {
-			strcpy(s->proc_type, "REMOTE");
-		    }
+    CONFIG_LINE_INFO *b =
+	find_config_line(info, info->buffer_table, s->bufname, NULL);
+    CONFIG_LINE_INFO *p = find_config_line(info, info->proc_table,
+	s->procname, s->bufname_for_procline);
+
+    if (!s->bufline_found && NULL != b) {
+	/* Buffer line found, store the line and type. */
+	separate_words(word, 4, (char *) b->line);
+	strncpy(s->buffer_line, b->line, CMS_CONFIG_LINELEN);
+	convert2upper(s->buffer_type, word[2], CMS_CONFIG_LINELEN);
+	s->bufline_found = 1;
+	s->bufline_number = b->line_number;
+	rcs_print_debug(PRINT_CMS_CONFIG_INFO,
+	    "cms_config found buffer line on line %d\n", b->line_number);
+    }
+    if (!s->procline_found && NULL != p) {
+	/* Procedure line found, store the line and type. */
+	separate_words(word, 4, (char *) p->line);
+	strncpy(s->proc_line, p->line, CMS_CONFIG_LINELEN);
+	switch (cms_connection_mode) {
+	case CMS_NORMAL_CONNECTION_MODE:
+	    convert2upper(s->proc_type, word[3], CMS_CONFIG_LINELEN);
+	    if (!strncmp(s->proc_type, "AUTO", 4)) {
+		if (!had_bufline &&
+		    (NULL == b || b->line_number > p->line_number)) {
+		    rcs_print_error
+			("Can't use process type AUTO unless the buffer line for %s is found earlier in the config file.\n",
+			s->bufname);
+		    rcs_print_error("Bad line:\n%s:%d %s\n", s->filename,
+			p->line_number, p->line);
+		    s->error_type = MISC_CONFIG_SEARCH_ERROR;
+		    return;
+		}
+		if (hostname_matches_bufferline(s->buffer_line)) {
+		    strcpy(s->proc_type, "LOCAL");
+		} else {
+		    strcpy(s->proc_type, "REMOTE");
 		}
-		break;
-
-	    case CMS_FORCE_LOCAL_CONNECTION_MODE:
-		strcpy(s->proc_type, "LOCAL");
-		break;
-
-	    case CMS_FORCE_REMOTE_CONNECTION_MODE:
-		strcpy(s->proc_type, "REMOTE");
-		break;
 	    }
-	    s->procline_found = 1;
-	    s->procline_number = line_number;
-	    rcs_print_debug(PRINT_CMS_CONFIG_INFO,
-		"cms_config found process line on line %d\n", line_number);
-	}
+	    break;
 
-	if (s->procline_found && s->bufline_found) {
-	    /* Close the configuration file. */
-	    if (NULL != fp) {
-		fclose(fp);
-		fp = NULL;
-	    }
-	    loading_config_file = 0;
-	    s->error_type = CONFIG_SEARCH_OK;
-	    return;
-	}
-    }
+	case CMS_FORCE_LOCAL_CONNECTION_MODE:
+	    strcpy(s->proc_type, "LOCAL");
+	    break;
 
-    /* Close the configuration file. */
-    if (NULL != fp) {
-	fclose(fp);
-	fp = NULL;
+	case CMS_FORCE_REMOTE_CONNECTION_MODE:
+	    strcpy(s->proc_type, "REMOTE");
+	    break;
+	}
+	s->procline_found = 1;
+	s->procline_number = p->line_number;
+	rcs_print_debug(PRINT_CMS_CONFIG_INFO,
+	    "cms_config found process line on line %d\n", p->line_number);
     }
-    loading_config_file = 0;
 
     /* Missing either procname or bufname or both. */
     if (!s->bufline_found) {
@@ -759,7 +793,7 @@ void find_proc_and_buffer_lines(CONFIG_SEARCH_STRUCT * s)
 	s->error_type = NO_PROCESS_LINE;
 	return;
     }
-    return;
+    s->error_type = CONFIG_SEARCH_OK;
 }
 
 int
@@ -0,0 +1,458 @@
+/********************************************************************
+* Description: cms_pup.cc
+*   Provides the interface to CMS used by NML update functions
+*   including a CMS update function for all the basic C data types
+*   to convert NMLmsgs to a packed little-endian format.
+*   NOTES: Every value is stored with a fixed size: 1 byte for bool and
+*   char, 2 for short, 4 for int and float, 8 for long, double and long
+*   double.  On little-endian hosts arrays whose host and wire sizes
+*   agree are copied in one piece, so encoding is little more than a
+*   memcpy() of each field.  With "schema_hash" on the buffer line a
+*   32-bit hash of the sequence of field types and array lengths is
+*   appended to each message and checked by the reader, to catch peers
+*   built with different message definitions.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>		/* memcpy() */
+#include <stdlib.h>		/* malloc(), free() */
+
+#ifdef __cplusplus
+}
+#endif
+#include "cms.hh"		/* class CMS */
+#include "cms_pup.hh"		/* class CMS_PACKED_UPDATER */
+#include "rcs_print.hh"		/* rcs_print_error() */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PACKED_HOST_IS_LE 1
+#else
+#define PACKED_HOST_IS_LE 0
+#endif
+
+#define FNV_OFFSET 2166136261UL
+#define FNV_PRIME 16777619UL
+
+static unsigned long hash_bytes(unsigned long h, const void *p, int n)
+{
+    const unsigned char *c = (const unsigned char *) p;
+    while (n-- > 0) {
+	h = ((h ^ *c++) * FNV_PRIME) & 0xffffffffUL;
+    }
+    return h;
+}
+
+/* Hash a field's type code and array length.  The length is hashed as 4
+   little-endian bytes, like an int on the wire, so that peers of either
+   byte order agree. */
+static unsigned long hash_field(unsigned long h, char type_code,
+    unsigned int len)
+{
+    unsigned char le[4];
+    le[0] = len & 0xff;
+    le[1] = (len >> 8) & 0xff;
+    le[2] = (len >> 16) & 0xff;
+    le[3] = (len >> 24) & 0xff;
+    h = hash_bytes(h, &type_code, 1);
+    return hash_bytes(h, le, 4);
+}
+
+/* Member functions for CMS_PACKED_UPDATER Class */
+CMS_PACKED_UPDATER::CMS_PACKED_UPDATER(CMS * _cms_parent, int _schema_hash):
+CMS_UPDATER(_cms_parent, 1, 2)
+{
+    begin = (unsigned char *) NULL;
+    pos = 0;
+    max_length = 0;
+    schema_hash = _schema_hash;
+    hash = FNV_OFFSET;
+    hash_written = 0;
+    data_pos = 0;
+    data_hash = FNV_OFFSET;
+
+    /* Store and validate constructors arguments. */
+    cms_parent = _cms_parent;
+    if (NULL == cms_parent) {
+	rcs_print_error("CMS parent for updater is NULL.\n");
+	return;
+    }
+
+    encoded_header = malloc(neutral_size_factor * sizeof(CMS_HEADER));
+    if (encoded_header == NULL) {
+	rcs_print_error("CMS:can't malloc encoded_header");
+	status = CMS_CREATE_ERROR;
+	return;
+    }
+    if (cms_parent->queuing_enabled) {
+	encoded_queuing_header =
+	    malloc(neutral_size_factor * sizeof(CMS_QUEUING_HEADER));
+	if (encoded_queuing_header == NULL) {
+	    rcs_print_error("CMS:can't malloc encoded_queuing_header");
+	    status = CMS_CREATE_ERROR;
+	    return;
+	}
+    }
+}
+
+CMS_PACKED_UPDATER::~CMS_PACKED_UPDATER()
+{
+    if (NULL != encoded_data && !using_external_encoded_data) {
+	free(encoded_data);
+	encoded_data = NULL;
+    }
+    if (NULL != encoded_header) {
+	free(encoded_header);
+	encoded_header = NULL;
+    }
+    if (NULL != encoded_queuing_header) {
+	free(encoded_queuing_header);
+	encoded_queuing_header = NULL;
+    }
+}
+
+int CMS_PACKED_UPDATER::set_mode(CMS_UPDATER_MODE _mode)
+{
+    /* Like the separate XDR streams, the data buffer keeps its position
+       while the headers are encoded or decoded in between. */
+    if (mode == CMS_ENCODE_DATA || mode == CMS_DECODE_DATA) {
+	data_pos = pos;
+	data_hash = hash;
+    }
+    if (-1 == CMS_UPDATER::set_mode(_mode)) {
+	return (-1);
+    }
+    pos = 0;
+    hash = FNV_OFFSET;
+    switch (mode) {
+    case CMS_NO_UPDATE:
+	begin = (unsigned char *) NULL;
+	max_length = 0;
+	break;
+
+    case CMS_ENCODE_DATA:
+    case CMS_DECODE_DATA:
+	begin = (unsigned char *) encoded_data;
+	max_length = encoded_data_size;
+	if (max_length > cms_parent->max_encoded_message_size
+	    && cms_parent->max_encoded_message_size > 0) {
+	    max_length = cms_parent->max_encoded_message_size;
+	}
+	pos = data_pos;
+	hash = data_hash;
+	break;
+
+    case CMS_ENCODE_HEADER:
+    case CMS_DECODE_HEADER:
+	begin = (unsigned char *) encoded_header;
+	max_length = neutral_size_factor * sizeof(CMS_HEADER);
+	break;
+
+    case CMS_ENCODE_QUEUING_HEADER:
+    case CMS_DECODE_QUEUING_HEADER:
+	begin = (unsigned char *) encoded_queuing_header;
+	max_length = neutral_size_factor * sizeof(CMS_QUEUING_HEADER);
+	break;
+    }
+    return (0);
+}
+
+int CMS_PACKED_UPDATER::check_pointer(char *_pointer, long _bytes)
+{
+    return reserve(_pointer, _bytes, _bytes);
+}
+
+/* Repositions the data buffer to the very beginning */
+void CMS_PACKED_UPDATER::rewind()
+{
+    CMS_UPDATER::rewind();
+    pos = 0;
+    hash = FNV_OFFSET;
+    hash_written = 0;
+    if (mode == CMS_ENCODE_DATA || mode == CMS_DECODE_DATA) {
+	data_pos = 0;
+	data_hash = FNV_OFFSET;
+    }
+    if (NULL != cms_parent) {
+	cms_parent->format_size = 0;
+    }
+}
+
+/* Called once a message has been encoded: appends the schema hash. */
+int CMS_PACKED_UPDATER::get_encoded_msg_size()
+{
+    if (schema_hash && mode == CMS_ENCODE_DATA && !hash_written
+	&& NULL != begin) {
+	if (pos + 4 > max_length) {
+	    rcs_print_error
+		("CMS_PACKED_UPDATER: No room for the schema hash.\n");
+	    status = CMS_UPDATE_ERROR;
+	    return (-1);
+	}
+	for (int i = 0; i < 4; i++) {
+	    begin[pos++] = (unsigned char) (hash >> (8 * i));
+	}
+	hash_written = 1;
+    }
+    return (pos);
+}
+
+/* Called once a message has been decoded: checks the schema hash. */
+int CMS_PACKED_UPDATER::check_decoded_msg()
+{
+    if (!schema_hash || mode != CMS_DECODE_DATA || NULL == begin) {
+	return (0);
+    }
+    unsigned long sent = 0;
+    if (pos + 4 <= max_length) {
+	for (int i = 0; i < 4; i++) {
+	    sent |= (unsigned long) begin[pos + i] << (8 * i);
+	}
+    }
+    if (sent != hash) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: %s: schema hash %08lX of the received message does not match %08lX.\n",
+	    cms_parent->BufferName, sent, hash);
+	rcs_print_error
+	    ("Check that both ends were built with the same message definitions.\n");
+	status = CMS_UPDATE_ERROR;
+	return (-1);
+    }
+    return (0);
+}
+
+/* Make room for wire_bytes more bytes, and check that the host_bytes at x
+   are inside the message being formatted. */
+int CMS_PACKED_UPDATER::reserve(void *x, long host_bytes, long wire_bytes)
+{
+    if (NULL == cms_parent || NULL == begin) {
+	rcs_print_error("CMS_PACKED_UPDATER: Required pointer is NULL.\n");
+	return (-1);
+    }
+    if (pos + wire_bytes > max_length) {
+	rcs_print_error
+	    ("CMS_PACKED_UPDATER: Encoded message buffer full. (pos=%ld, bytes=%ld, size=%ld)\n",
+	    pos, wire_bytes, max_length);
+	return (-1);
+    }
+    return (cms_parent->check_pointer((char *) x, host_bytes));
+}
+
+void CMS_PACKED_UPDATER::move(void *x, unsigned int len, int host_size,
+    int wire_size, int is_signed)
+{
+    unsigned char *w = begin + pos;
+    pos += (long) len * wire_size;
+
+    if (PACKED_HOST_IS_LE && host_size == wire_size) {
+	if (encoding) {
+	    memcpy(w, x, (size_t) len * wire_size);
+	} else {
+	    memcpy(x, w, (size_t) len * wire_size);
+	}
+	return;
+    }
+
+    unsigned char *h = (unsigned char *) x;
+    for (unsigned int n = 0; n < len; n++, h += host_size, w += wire_size) {
+	unsigned long long v = 0;
+	int i;
+	if (encoding) {
+	    switch (host_size) {
+	    case 1:
+		v = is_signed ? (unsigned long long) *(signed char *) h : *h;
+		break;
+	    case 2:
+		v = is_signed ? (unsigned long long) *(short *) h
+		    : *(unsigned short *) h;
+		break;
+	    case 4:
+		v = is_signed ? (unsigned long long) *(int *) h
+		    : *(unsigned int *) h;
+		break;
+	    default:
+		v = *(unsigned long long *) h;
+		break;
+	    }
+	    for (i = 0; i < wire_size; i++) {
+		w[i] = (unsigned char) (v >> (8 * i));
+	    }
+	} else {
+	    for (i = 0; i < wire_size; i++) {
+		v |= (unsigned long long) w[i] << (8 * i);
+	    }
+	    if (is_signed && wire_size < 8 && (v >> (8 * wire_size - 1)) & 1) {
+		v |= ~0ULL << (8 * wire_size);
+	    }
+	    switch (host_size) {
+	    case 1:
+		*h = (unsigned char) v;
+		break;
+	    case 2:
+		*(unsigned short *) h = (unsigned short) v;
+		break;
+	    case 4:
+		*(unsigned int *) h = (unsigned int) v;
+		break;
+	    default:
+		*(unsigned long long *) h = v;
+		break;
+	    }
+	}
+    }
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::code(void *x, unsigned int len, int host_size,
+    int wire_size, int is_signed, char type_code)
+{
+    if (-1 == reserve(x, (long) len * host_size, (long) len * wire_size)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    if (schema_hash) {
+	hash = hash_field(hash, type_code, len);
+    }
+    move(x, len, host_size, wire_size, is_signed);
+    return (status);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(bool &x)
+{
+    return code(&x, 1, sizeof(bool), 1, 0, 'b');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(char &x)
+{
+    return code(&x, 1, 1, 1, 0, 'c');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(char *x, unsigned int len)
+{
+    return code(x, len, 1, 1, 0, 'c');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned char &x)
+{
+    return code(&x, 1, 1, 1, 0, 'C');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned char *x, unsigned int len)
+{
+    return code(x, len, 1, 1, 0, 'C');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(short int &x)
+{
+    return code(&x, 1, sizeof(short), 2, 1, 's');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(short *x, unsigned int len)
+{
+    return code(x, len, sizeof(short), 2, 1, 's');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned short int &x)
+{
+    return code(&x, 1, sizeof(short), 2, 0, 'S');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned short *x, unsigned int len)
+{
+    return code(x, len, sizeof(short), 2, 0, 'S');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(int &x)
+{
+    return code(&x, 1, sizeof(int), 4, 1, 'i');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(int *x, unsigned int len)
+{
+    return code(x, len, sizeof(int), 4, 1, 'i');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned int &x)
+{
+    return code(&x, 1, sizeof(int), 4, 0, 'I');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned int *x, unsigned int len)
+{
+    return code(x, len, sizeof(int), 4, 0, 'I');
+}
+
+/* Longs are always sent as 8 bytes so 32 and 64 bit hosts can talk. */
+CMS_STATUS CMS_PACKED_UPDATER::update(long int &x)
+{
+    return code(&x, 1, sizeof(long), 8, 1, 'l');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long *x, unsigned int len)
+{
+    return code(x, len, sizeof(long), 8, 1, 'l');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned long int &x)
+{
+    return code(&x, 1, sizeof(long), 8, 0, 'L');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(unsigned long *x, unsigned int len)
+{
+    return code(x, len, sizeof(long), 8, 0, 'L');
+}
+
+/* Floats and doubles are moved as their IEEE 754 bit patterns. */
+CMS_STATUS CMS_PACKED_UPDATER::update(float &x)
+{
+    return code(&x, 1, sizeof(float), 4, 0, 'f');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(float *x, unsigned int len)
+{
+    return code(x, len, sizeof(float), 4, 0, 'f');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(double &x)
+{
+    return code(&x, 1, sizeof(double), 8, 0, 'd');
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(double *x, unsigned int len)
+{
+    return code(x, len, sizeof(double), 8, 0, 'd');
+}
+
+/* Long doubles are sent as doubles, as with XDR. */
+CMS_STATUS CMS_PACKED_UPDATER::update(long double &x)
+{
+    return update(&x, 1);
+}
+
+CMS_STATUS CMS_PACKED_UPDATER::update(long double *x, unsigned int len)
+{
+    if (-1 == reserve(x, (long) len * sizeof(long double), (long) len * 8)) {
+	return (status = CMS_UPDATE_ERROR);
+    }
+    if (schema_hash) {
+	hash = hash_field(hash, 'D', len);
+    }
+    for (unsigned int i = 0; i < len; i++) {
+	double y = (double) x[i];
+	move(&y, 1, sizeof(double), 8, 0);
+	/* only a decode may change the message */
+	if (mode == CMS_DECODE_DATA) {
+	    x[i] = (long double) y;
+	}
+    }
+    return (status);
+}
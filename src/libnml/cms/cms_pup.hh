@@ -0,0 +1,72 @@
+/********************************************************************
+* Description: cms_pup.hh
+*   Packed little-endian encoding of NML messages, an alternative to
+*   XDR selected with "packed" on the buffer line.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+#ifndef CMS_PUP_HH
+#define CMS_PUP_HH
+
+#include "cms_up.hh"		/* class CMS_UPDATER */
+
+class CMS_PACKED_UPDATER:public CMS_UPDATER {
+  public:
+    CMS_STATUS update(bool &x);
+    CMS_STATUS update(char &x);
+    CMS_STATUS update(unsigned char &x);
+    CMS_STATUS update(short int &x);
+    CMS_STATUS update(unsigned short int &x);
+    CMS_STATUS update(int &x);
+    CMS_STATUS update(unsigned int &x);
+    CMS_STATUS update(long int &x);
+    CMS_STATUS update(unsigned long int &x);
+    CMS_STATUS update(float &x);
+    CMS_STATUS update(double &x);
+    CMS_STATUS update(long double &x);
+    CMS_STATUS update(char *x, unsigned int len);
+    CMS_STATUS update(unsigned char *x, unsigned int len);
+    CMS_STATUS update(short *x, unsigned int len);
+    CMS_STATUS update(unsigned short *x, unsigned int len);
+    CMS_STATUS update(int *x, unsigned int len);
+    CMS_STATUS update(unsigned int *x, unsigned int len);
+    CMS_STATUS update(long *x, unsigned int len);
+    CMS_STATUS update(unsigned long *x, unsigned int len);
+    CMS_STATUS update(float *x, unsigned int len);
+    CMS_STATUS update(double *x, unsigned int len);
+    CMS_STATUS update(long double *x, unsigned int len);
+    int set_mode(CMS_UPDATER_MODE);
+    void rewind();
+    int get_encoded_msg_size();
+    int check_decoded_msg();
+  protected:
+    int check_pointer(char *, long);
+      CMS_PACKED_UPDATER(CMS *, int _schema_hash);
+      virtual ~ CMS_PACKED_UPDATER();
+    friend class CMS;
+
+    int reserve(void *x, long host_bytes, long wire_bytes);
+    /* Move len values of host_size bytes each to or from wire_size
+       little-endian bytes, sign extending if is_signed. */
+    void move(void *x, unsigned int len, int host_size, int wire_size,
+	int is_signed);
+    CMS_STATUS code(void *x, unsigned int len, int host_size, int wire_size,
+	int is_signed, char type_code);
+
+    unsigned char *begin;	/* start of the current buffer */
+    long pos;			/* bytes encoded or decoded so far */
+    long max_length;		/* size of the current buffer */
+    int schema_hash;		/* append/check a hash of the field layout */
+    unsigned long hash;		/* hash of the fields seen since rewind() */
+    int hash_written;		/* was the hash appended already? */
+    long data_pos;		/* pos and hash of the data buffer, kept */
+    unsigned long data_hash;	/* while a header is being formatted */
+};
+
+#endif
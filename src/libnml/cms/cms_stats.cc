@@ -0,0 +1,269 @@
+/********************************************************************
+* Description: cms_stats.cc
+*   Per channel latency and throughput statistics, kept in a shared
+*   memory page for buffers with "stats" on their buffer line.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include "cms.hh"		/* class CMS */
+#include "cms_stats.hh"
+#include "shm.hh"		/* class RCS_SHAREDMEM */
+#include "rcs_print.hh"		/* rcs_print_error() */
+#include <string.h>		/* strncpy(), strncmp(), memset() */
+#include <stddef.h>		/* offsetof() */
+#include <time.h>		/* clock_gettime() */
+#include <sched.h>		/* sched_yield() */
+
+static RCS_SHAREDMEM *stats_shm = NULL;
+static int stats_users = 0;
+
+/* How long to wait for another process to fill in the page header or
+   claim a channel, after which it is presumed to have died doing so. */
+#define CMS_STATS_CLAIM_NS 1000000000ULL
+
+unsigned long long cms_stats_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void stats_max(volatile unsigned long long *max,
+    unsigned long long value)
+{
+    unsigned long long old = *max;
+    while (value > old) {
+	unsigned long long prev =
+	    __sync_val_compare_and_swap(max, old, value);
+	if (prev == old) {
+	    break;
+	}
+	old = prev;
+    }
+}
+
+void cms_stats_add_time(volatile unsigned long long *count,
+    volatile unsigned long long *sum, volatile unsigned long long *max,
+    unsigned long long ns)
+{
+    __sync_fetch_and_add(count, 1);
+    __sync_fetch_and_add(sum, ns);
+    stats_max(max, ns);
+}
+
+void cms_stats_zero(CMS_STATS_CHANNEL * channel)
+{
+    memset((char *) channel + offsetof(CMS_STATS_CHANNEL, writes), 0,
+	offsetof(CMS_STATS_CHANNEL, write_times) -
+	offsetof(CMS_STATS_CHANNEL, writes));
+    channel->start_ns = cms_stats_now();
+}
+
+/* Waits while *state is 1. Returns 0 once it is not, -1 if it still is
+   after CMS_STATS_CLAIM_NS. */
+static int stats_wait_claim(volatile unsigned int *state)
+{
+    unsigned long long deadline = 0;
+
+    while (*state == 1) {
+	if (0 == deadline) {
+	    deadline = cms_stats_now() + CMS_STATS_CLAIM_NS;
+	} else if (cms_stats_now() > deadline) {
+	    return -1;
+	}
+	sched_yield();
+    }
+    return 0;
+}
+
+CMS_STATS_CHANNEL *cms_stats_channel(const char *name)
+{
+    CMS_STATS_PAGE *page;
+    int i;
+
+    if (NULL == stats_shm) {
+	stats_shm = new RCS_SHAREDMEM(CMS_STATS_KEY, sizeof(CMS_STATS_PAGE),
+	    RCS_SHAREDMEM_CREATE, 0700);
+	if (NULL == stats_shm->addr) {
+	    rcs_print_error("CMS: can't attach to the stats page.\n");
+	    delete stats_shm;
+	    stats_shm = NULL;
+	    return NULL;
+	}
+    }
+    page = (CMS_STATS_PAGE *) stats_shm->addr;
+
+    /* The page is zero filled when it is created. The first user fills in
+       the header, anyone else waits until it has. */
+    if (__sync_bool_compare_and_swap(&page->magic, 0, 1)) {
+	page->version = CMS_STATS_VERSION;
+	page->num_channels = CMS_STATS_CHANNELS;
+	__sync_synchronize();
+	page->magic = CMS_STATS_MAGIC;
+    }
+    if (stats_wait_claim(&page->magic) < 0) {
+	/* the header is the same for everyone, so fill it in again */
+	rcs_print_error("CMS: the stats page was left half made, "
+	    "making it again.\n");
+	page->version = CMS_STATS_VERSION;
+	page->num_channels = CMS_STATS_CHANNELS;
+	__sync_synchronize();
+	__sync_bool_compare_and_swap(&page->magic, 1, CMS_STATS_MAGIC);
+    }
+    if (page->magic != CMS_STATS_MAGIC || page->version != CMS_STATS_VERSION
+	|| page->num_channels != CMS_STATS_CHANNELS) {
+	rcs_print_error("CMS: the stats page has an incompatible version.\n");
+	if (stats_users <= 0) {
+	    delete stats_shm;
+	    stats_shm = NULL;
+	}
+	return NULL;
+    }
+
+    for (i = 0; i < CMS_STATS_CHANNELS; i++) {
+	CMS_STATS_CHANNEL *c = &page->channel[i];
+	if (c->state == 0 && __sync_bool_compare_and_swap(&c->state, 0, 1)) {
+	    strncpy(c->name, name, sizeof(c->name) - 1);
+	    cms_stats_zero(c);
+	    __sync_synchronize();
+	    c->state = 2;
+	}
+	if (stats_wait_claim((volatile unsigned int *) &c->state) < 0) {
+	    /* its claimer died, the channel is lost */
+	    continue;
+	}
+	if (!strncmp(c->name, name, sizeof(c->name) - 1)) {
+	    stats_users++;
+	    return c;
+	}
+    }
+    rcs_print_error("CMS: no room for %s in the stats page.\n", name);
+    if (stats_users <= 0) {
+	delete stats_shm;
+	stats_shm = NULL;
+    }
+    return NULL;
+}
+
+void cms_stats_release(CMS_STATS_CHANNEL * channel)
+{
+    if (NULL == channel || stats_users <= 0) {
+	return;
+    }
+    if (--stats_users == 0) {
+	/* Removes the page once no process is attached. */
+	delete stats_shm;
+	stats_shm = NULL;
+    }
+}
+
+CMS_STATS_TIMER::~CMS_STATS_TIMER()
+{
+    if (NULL == channel) {
+	return;
+    }
+    unsigned long long ns = cms_stats_now() - start;
+    if (decode) {
+	cms_stats_add_time(&channel->decode_count, &channel->decode_sum_ns,
+	    &channel->decode_max_ns, ns);
+    } else {
+	cms_stats_add_time(&channel->encode_count, &channel->encode_sum_ns,
+	    &channel->encode_max_ns, ns);
+    }
+}
+
+/* Adds the latency of message id, read at read_ns. Returns 0 if its writer
+   has not stored the write time yet, 1 otherwise. */
+static int stats_latency(CMS_STATS_CHANNEL * stats, unsigned long long id,
+    unsigned long long read_ns)
+{
+    CMS_STATS_WRITE_TIME *wt = &stats->write_times[id % CMS_STATS_IDS];
+    unsigned long long wid = wt->id;
+    __sync_synchronize();
+    unsigned long long ns = wt->ns;
+    __sync_synchronize();
+
+    if (wid < id) {
+	return 0;
+    }
+    if (wid != id || wt->id != wid || ns > read_ns) {
+	/* Written before stats were kept, or overwritten since. */
+	return 1;
+    }
+    unsigned long long us = (read_ns - ns) / 1000;
+    int bucket = 0;
+    while (us > 0 && bucket < CMS_STATS_BUCKETS - 1) {
+	us >>= 1;
+	bucket++;
+    }
+    __sync_fetch_and_add(&stats->latency_hist[bucket], 1);
+    cms_stats_add_time(&stats->latency_count, &stats->latency_sum_ns,
+	&stats->latency_max_ns, read_ns - ns);
+    return 1;
+}
+
+/* Called after each read, peek and write of a buffer with stats. Writers
+   note when each message was written, readers of a new message look the
+   time up by its write_id to get the write to read latency. A reader woken
+   by the write can get there before the writer has stored the time, so
+   the lookup is then retried on the next access. */
+void CMS::record_stats()
+{
+    unsigned long long now = cms_stats_now();
+
+    if (0 != stats_pending_id) {
+	stats_latency(stats, stats_pending_id, stats_pending_ns);
+	stats_pending_id = 0;
+    }
+
+    switch (internal_access_type) {
+    case CMS_WRITE_ACCESS:
+    case CMS_WRITE_IF_READ_ACCESS:
+	if (status != CMS_WRITE_OK) {
+	    break;
+	}
+	__sync_fetch_and_add(&stats->writes, 1);
+	__sync_fetch_and_add(&stats->write_bytes, header.in_buffer_size);
+	if (queuing_enabled) {
+	    stats_max(&stats->queue_max, queuing_header.queue_length);
+	}
+	{
+	    CMS_STATS_WRITE_TIME *wt =
+		&stats->write_times[header.write_id % CMS_STATS_IDS];
+	    wt->id = 0;
+	    __sync_synchronize();
+	    wt->ns = now;
+	    __sync_synchronize();
+	    wt->id = header.write_id;
+	}
+	break;
+
+    case CMS_READ_ACCESS:
+    case CMS_PEEK_ACCESS:
+    case CMS_PEEK_VIEW_ACCESS:
+	if (status == CMS_READ_OLD) {
+	    __sync_fetch_and_add(&stats->old_reads, 1);
+	    break;
+	}
+	if (status != CMS_READ_OK) {
+	    break;
+	}
+	__sync_fetch_and_add(&stats->reads, 1);
+	__sync_fetch_and_add(&stats->read_bytes, header.in_buffer_size);
+	if (header.write_id > 0 && !stats_latency(stats, header.write_id, now)) {
+	    stats_pending_id = header.write_id;
+	    stats_pending_ns = now;
+	}
+	break;
+
+    default:
+	break;
+    }
+}
@@ -0,0 +1,97 @@
+/********************************************************************
+* Description: cms_stats.hh
+*   Per channel latency and throughput statistics, kept in a shared
+*   memory page for buffers with "stats" on their buffer line and
+*   displayed by nmlstat.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+#ifndef CMS_STATS_HH
+#define CMS_STATS_HH
+
+#define CMS_STATS_KEY 0x4E4D4C53	/* "NMLS", shared memory key */
+#define CMS_STATS_MAGIC 0x4E4D4C53
+#define CMS_STATS_VERSION 1
+#define CMS_STATS_CHANNELS 32	/* channels in the page */
+#define CMS_STATS_BUCKETS 24	/* latency histogram: bucket 0 is below
+				   1 us, bucket i from 2^(i-1) to 2^i us, the
+				   last one everything longer */
+#define CMS_STATS_IDS 64	/* write times kept, for queued buffers */
+
+/* All times are CLOCK_MONOTONIC nanoseconds, so they can be compared
+   between processes. */
+struct CMS_STATS_WRITE_TIME {
+    volatile unsigned long long id;	/* write_id of the message */
+    volatile unsigned long long ns;	/* when it was written */
+};
+
+struct CMS_STATS_CHANNEL {
+    volatile int state;		/* 0 free, 1 being claimed, 2 in use */
+    int pad;
+    char name[32];		/* buffer name */
+    unsigned long long start_ns;	/* when the counters were zeroed */
+    /* Counters, zeroed together by nmlstat -z. */
+    volatile unsigned long long writes;
+    volatile unsigned long long write_bytes;
+    volatile unsigned long long reads;	/* reads and peeks of new data */
+    volatile unsigned long long read_bytes;
+    volatile unsigned long long old_reads;	/* reads of no new data */
+    volatile unsigned long long queue_max;	/* queue length high water */
+    volatile unsigned long long latency_count;	/* write to read */
+    volatile unsigned long long latency_sum_ns;
+    volatile unsigned long long latency_max_ns;
+    volatile unsigned long long latency_hist[CMS_STATS_BUCKETS];
+    volatile unsigned long long encode_count;	/* NML format_input() */
+    volatile unsigned long long encode_sum_ns;
+    volatile unsigned long long encode_max_ns;
+    volatile unsigned long long decode_count;	/* NML format_output() */
+    volatile unsigned long long decode_sum_ns;
+    volatile unsigned long long decode_max_ns;
+    CMS_STATS_WRITE_TIME write_times[CMS_STATS_IDS];
+};
+
+struct CMS_STATS_PAGE {
+    volatile unsigned int magic;
+    unsigned int version;
+    unsigned int num_channels;
+    unsigned int pad;
+    CMS_STATS_CHANNEL channel[CMS_STATS_CHANNELS];
+};
+
+extern unsigned long long cms_stats_now();
+
+/* Attach to (creating if needed) the stats page and return the channel
+   for name, or NULL if the page is full or unavailable. Each call must be
+   matched by cms_stats_release(). */
+extern CMS_STATS_CHANNEL *cms_stats_channel(const char *name);
+extern void cms_stats_release(CMS_STATS_CHANNEL * channel);
+
+extern void cms_stats_zero(CMS_STATS_CHANNEL * channel);
+extern void cms_stats_add_time(volatile unsigned long long *count,
+    volatile unsigned long long *sum, volatile unsigned long long *max,
+    unsigned long long ns);
+
+/* Adds the time between its construction and destruction to the encode or
+   decode time of a channel. */
+class CMS_STATS_TIMER {
+  public:
+    CMS_STATS_TIMER(CMS_STATS_CHANNEL * _channel, int _decode) {
+	channel = _channel;
+	decode = _decode;
+	start = channel ? cms_stats_now() : 0;
+    };
+    ~CMS_STATS_TIMER();
+
+  private:
+    CMS_STATS_CHANNEL * channel;
+    int decode;
+    unsigned long long start;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/********************************************************************
+* Description: cms_tap.cc
+*   Ring of the last messages written to a buffer with "tap" on its
+*   buffer line.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include "cms_tap.hh"
+#include "cms_stats.hh"		/* cms_stats_now() */
+#include <string.h>		/* memcpy(), memset() */
+
+#define CMS_TAP_ALIGN 64
+
+static long tap_stride(long slot_size)
+{
+    return (sizeof(CMS_TAP_SLOT) + slot_size + CMS_TAP_ALIGN - 1) &
+	~(CMS_TAP_ALIGN - 1L);
+}
+
+static CMS_TAP_SLOT *tap_slot(CMS_TAP * tap, unsigned long long n)
+{
+    return (CMS_TAP_SLOT *) ((char *) tap + CMS_TAP_ALIGN +
+	(n % tap->slots) * tap_stride(tap->slot_size));
+}
+
+long cms_tap_size(long slot_size)
+{
+    return CMS_TAP_ALIGN + CMS_TAP_SLOTS * tap_stride(slot_size);
+}
+
+void cms_tap_init(CMS_TAP * tap, long slot_size)
+{
+    memset(tap, 0, cms_tap_size(slot_size));
+    tap->slots = CMS_TAP_SLOTS;
+    tap->slot_size = slot_size;
+}
+
+void cms_tap_put(CMS_TAP * tap, const void *msg, long size,
+    unsigned long long write_id)
+{
+    unsigned long long n = __sync_fetch_and_add(&tap->next, 1);
+    CMS_TAP_SLOT *slot = tap_slot(tap, n);
+
+    if (size > (long) tap->slot_size) {
+	size = tap->slot_size;
+    }
+    slot->seq = 0;
+    __sync_synchronize();
+    slot->write_id = write_id;
+    slot->ns = cms_stats_now();
+    slot->size = size;
+    memcpy(slot + 1, msg, size);
+    __sync_synchronize();
+    slot->seq = n + 1;
+}
+
+long cms_tap_get(CMS_TAP * tap, unsigned long long *pos, void *msg,
+    long max_size, CMS_TAP_SLOT * info, unsigned long long *lost)
+{
+    for (;;) {
+	unsigned long long next = tap->next;
+	if (*pos >= next) {
+	    return 0;
+	}
+	if (next - *pos > tap->slots) {
+	    *lost += next - tap->slots - *pos;
+	    *pos = next - tap->slots;
+	}
+	CMS_TAP_SLOT *slot = tap_slot(tap, *pos);
+	unsigned long long seq = slot->seq;
+	__sync_synchronize();
+	if (seq < *pos + 1) {
+	    /* still being written */
+	    return 0;
+	}
+	long size = slot->size;
+	if (size > max_size) {
+	    size = max_size;
+	}
+	if (NULL != info) {
+	    info->write_id = slot->write_id;
+	    info->ns = slot->ns;
+	    info->size = size;
+	}
+	memcpy(msg, slot + 1, size);
+	__sync_synchronize();
+	if (seq == *pos + 1 && slot->seq == seq) {
+	    (*pos)++;
+	    return size;
+	}
+	/* overwritten while it was copied */
+	(*lost)++;
+	(*pos)++;
+    }
+}
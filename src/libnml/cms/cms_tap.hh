@@ -0,0 +1,49 @@
+/********************************************************************
+* Description: cms_tap.hh
+*   Ring of the last messages written to a buffer with "tap" on its
+*   buffer line, so that a recorder sees every message even when the
+*   readers of a queue take them before it can peek.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+#ifndef CMS_TAP_HH
+#define CMS_TAP_HH
+
+#define CMS_TAP_SLOTS 32	/* messages kept */
+
+/* Lives in shared memory after the buffer it belongs to. Message n goes
+   in slot n % slots, whose seq is n + 1 once the message is complete and
+   0 while it is written. */
+struct CMS_TAP {
+    volatile unsigned long long next;	/* number of the next message */
+    unsigned int slots;
+    unsigned int slot_size;	/* bytes of message a slot holds */
+};
+
+struct CMS_TAP_SLOT {
+    volatile unsigned long long seq;
+    unsigned long long write_id;	/* of the message in the buffer */
+    unsigned long long ns;	/* when it was written, CLOCK_MONOTONIC */
+    long size;
+    /* followed by slot_size bytes of message */
+};
+
+/* Bytes of shared memory needed for messages of up to slot_size bytes. */
+extern long cms_tap_size(long slot_size);
+extern void cms_tap_init(CMS_TAP * tap, long slot_size);
+extern void cms_tap_put(CMS_TAP * tap, const void *msg, long size,
+    unsigned long long write_id);
+
+/* Copies message *pos into msg and advances *pos. Returns its size, or 0
+   if it has not been written yet. Messages overwritten before they could
+   be copied are skipped, and counted in *lost. */
+extern long cms_tap_get(CMS_TAP * tap, unsigned long long *pos, void *msg,
+    long max_size, CMS_TAP_SLOT * info, unsigned long long *lost);
+
+#endif
@@ -108,6 +108,11 @@ int CMS_UPDATER::set_mode(CMS_UPDATER_MODE _mode)
     return (0);
 }
 
+int CMS_UPDATER::check_decoded_msg()
+{
+    return (0);
+}
+
 CMS_UPDATER_MODE CMS_UPDATER::get_mode()
 {
     return mode;
@@ -30,7 +30,10 @@ extern "C" {
 #include <stdlib.h>		// malloc(), free()
 #include <unistd.h>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
+#include <sys/epoll.h>		/* epoll_create1(), epoll_wait() */
+#include <sys/timerfd.h>	/* timerfd_create() */
+#include <sys/eventfd.h>	/* eventfd() */
+#include <sys/uio.h>		/* writev() */
 #include <errno.h>		/* errno */
 #include <signal.h>		// SIGPIPE, signal()
 
@@ -39,7 +42,6 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
-#include <sys/wait.h>		// waitpid
 
 #include <arpa/inet.h>		/* inet_ntoa */
 #include "cms.hh"		/* class CMS */
@@ -51,17 +53,8 @@ extern "C" {
 #include "timer.hh"		// esleep()
 #include "_timer.h"
 #include "cmsdiag.hh"		// class CMS_DIAGNOSTICS_INFO
-extern "C" {
-#include "recvn.h"		/* recvn() */
-#include "sendn.h"		/* sendn() */
-}
 #include "physmem.hh"           // PHYSMEM_HANDLE
 
-int tcpsvr_threads_created = 0;
-int tcpsvr_threads_killed = 0;
-int tcpsvr_threads_exited = 0;
-int tcpsvr_threads_returned_early = 0;
-
 TCPSVR_BLOCKING_READ_REQUEST::TCPSVR_BLOCKING_READ_REQUEST()
 {
     access_type = CMS_READ_ACCESS;	/* read or just peek */
@@ -133,7 +126,22 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
     client_ports = (LinkedList *) NULL;
     connection_socket = 0;
     connection_port = 0;
-    maxfdpl = 0;
+    epoll_fd = -1;
+    blocking_timer_fd = -1;
+    blocking_timer_armed = 0;
+    blocking_timer_deadline = -1.0;
+    blocking_reads_pending = 0;
+    check_blocking = 0;
+    watch_fd = -1;
+    watch_started = 0;
+    watch_failed = 0;
+    watch_stop = 0;
+    watch_signalled = 0;
+    pthread_mutex_init(&watch_mutex, NULL);
+    watch_control.seq = 0;
+    watch_control.waiters = 0;
+    watch_len = 0;
+    clients_closing = 0;
     dtimeout = 20.0;
 
     memset(&server_socket_address, 0, sizeof(server_socket_address));
@@ -152,8 +160,6 @@ CMS_SERVER_REMOTE_PORT(_cms_server)
     select_timeout.tv_usec = 30;
     subscription_buffers = NULL;
     current_poll_interval_millis = 30000;
-    memset(&read_fd_set, 0, sizeof(read_fd_set));
-    memset(&write_fd_set, 0, sizeof(write_fd_set));
 }
 
 CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
@@ -166,23 +172,6 @@ CMS_SERVER_REMOTE_TCP_PORT::~CMS_SERVER_REMOTE_TCP_PORT()
     }
 }
 
-void blocking_thread_kill(long int id)
-{
-
-    if (id <= 0) {
-	return;
-    }
-#ifdef POSIX_THREADS
-    pthread_kill(id, SIGINT);
-    pthread_join(id, NULL);
-#endif
-#ifdef NO_THREADS
-    kill(id, SIGINT);
-    waitpid(id, NULL, 0);
-#endif
-    tcpsvr_threads_killed++;
-}
-
 void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
 {
     CLIENT_TCP_PORT *client;
@@ -219,6 +208,15 @@ void CMS_SERVER_REMOTE_TCP_PORT::unregister_port()
 	close(connection_socket);
 	connection_socket = 0;
     }
+    stop_write_watch();
+    if (blocking_timer_fd >= 0) {
+	close(blocking_timer_fd);
+	blocking_timer_fd = -1;
+    }
+    if (epoll_fd >= 0) {
+	close(epoll_fd);
+	epoll_fd = -1;
+    }
 }
 
 int CMS_SERVER_REMOTE_TCP_PORT::accept_local_port_cms(CMS * _cms)
@@ -301,350 +299,821 @@ static void handle_pipe_error(int signum)
     rcs_print_error("SIGPIPE intercepted.\n");
 }
 
+static void putbe32(char *addr, uint32_t val) {
+    val = htonl(val);
+    memcpy(addr, &val, sizeof(val));
+}
+
+static uint32_t getbe32(char *addr) {
+    uint32_t val;
+    memcpy(&val, addr, sizeof(val));
+    return ntohl(val);
+}
+
+#define TCP_SRV_MAX_EVENTS 64
+#define TCP_SRV_INITIAL_IN_SIZE 0x2000
+
+/* All clients are served from this one loop. Sockets are non-blocking:
+   requests are gathered in each client's in_buf until complete, and the
+   part of a reply the socket can not take is kept in out_buf and sent
+   when epoll says the socket is writable, so a slow client never holds
+   up the others. */
 void CMS_SERVER_REMOTE_TCP_PORT::run()
 {
-    int bytes_ready;
+    struct epoll_event ev;
+    struct epoll_event events[TCP_SRV_MAX_EVENTS];
     int ready_descriptors;
+    int timeout_millis;
+    int i;
     if (NULL == client_ports) {
 	rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
 	return;
     }
-    CLIENT_TCP_PORT *new_client_port, *client_port_to_check;
-    FD_ZERO(&read_fd_set);
-    FD_ZERO(&write_fd_set);
-    FD_SET(connection_socket, &read_fd_set);
-    maxfdpl = connection_socket + 1;
+    CLIENT_TCP_PORT *client_port_to_check;
     signal(SIGPIPE, handle_pipe_error);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+	rcs_print_error("server: epoll_create error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return;
+    }
+    make_tcp_socket_nonblocking(connection_socket);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;		/* NULL marks the connection socket */
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection_socket, &ev) < 0) {
+	rcs_print_error("server: epoll_ctl error.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return;
+    }
+    blocking_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+	TFD_NONBLOCK | TFD_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = this;		/* and this the blocking read timer */
+    if (blocking_timer_fd < 0
+	|| epoll_ctl(epoll_fd, EPOLL_CTL_ADD, blocking_timer_fd, &ev) < 0) {
+	rcs_print_error("server: can not create timer.(errno = %d | %s)\n",
+	    errno, strerror(errno));
+	return;
+    }
+    start_write_watch();
     rcs_print_debug(PRINT_CMS_CONFIG_INFO,
 	"running server for TCP port %d (connection_socket = %d).\n",
 	ntohs(server_socket_address.sin_port), connection_socket);
 
     cms_server_count++;
-    fd_set read_fd_set_copy, write_fd_set_copy;
-    FD_ZERO(&read_fd_set_copy);
-    FD_ZERO(&write_fd_set_copy);
-    FD_SET(connection_socket, &read_fd_set_copy);
 
     while (1) {
 	if (polling_enabled) {
-	    memcpy(&read_fd_set_copy, &read_fd_set, sizeof(fd_set));
-	    memcpy(&write_fd_set_copy, &write_fd_set, sizeof(fd_set));
-	    select_timeout.tv_sec = current_poll_interval_millis / 1000;
-	    select_timeout.tv_usec =
-		(current_poll_interval_millis % 1000) * 1000;
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) & select_timeout);
-	    if (ready_descriptors == 0) {
-		update_subscriptions();
-		memcpy(&read_fd_set, &read_fd_set_copy, sizeof(fd_set));
-		memcpy(&write_fd_set, &write_fd_set_copy, sizeof(fd_set));
-		continue;
-	    }
+	    timeout_millis = current_poll_interval_millis;
 	} else {
-	    ready_descriptors =
-		select(maxfdpl, &read_fd_set, &write_fd_set,
-		(fd_set *) NULL, (timeval *) NULL);
-
+	    timeout_millis = -1;
 	}
+	arm_blocking_wakeups();
+	ready_descriptors =
+	    epoll_wait(epoll_fd, events, TCP_SRV_MAX_EVENTS, timeout_millis);
 	if (ready_descriptors < 0) {
-	    rcs_print_error("server: select error.(errno = %d | %s)\n",
-		errno, strerror(errno));
-	}
-	if (NULL == client_ports) {
-	    rcs_print_error("CMS_SERVER: List of client ports is NULL.\n");
-	    return;
+	    if (errno != EINTR) {
+		rcs_print_error("server: epoll_wait error.(errno = %d | %s)\n",
+		    errno, strerror(errno));
+	    }
+	    ready_descriptors = 0;
 	}
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (FD_ISSET(client_port_to_check->socket_fd, &read_fd_set)) {
-		ioctl(client_port_to_check->socket_fd, FIONREAD,
-		    (caddr_t) & bytes_ready);
-		if (bytes_ready <= 0) {
-		    rcs_print_debug(PRINT_SOCKET_CONNECT,
-			"Socket closed by host with IP address %s.\n",
-			inet_ntoa(client_port_to_check->address.sin_addr));
-		    if (NULL != client_port_to_check->subscriptions) {
-			TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
-			    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-			    client_port_to_check->subscriptions->get_head();
-			while (NULL != clnt_sub_info) {
-			    if (NULL != clnt_sub_info->sub_buf_info &&
-				clnt_sub_info->subscription_list_id >= 0) {
-				if (NULL !=
-				    clnt_sub_info->sub_buf_info->
-				    sub_clnt_info) {
-				    clnt_sub_info->sub_buf_info->
-					sub_clnt_info->
-					delete_node(clnt_sub_info->
-					subscription_list_id);
-				    if (clnt_sub_info->sub_buf_info->
-					sub_clnt_info->list_size < 1) {
-					delete clnt_sub_info->sub_buf_info->
-					    sub_clnt_info;
-					clnt_sub_info->sub_buf_info->
-					    sub_clnt_info = NULL;
-					if (NULL != subscription_buffers
-					    && clnt_sub_info->sub_buf_info->
-					    list_id >= 0) {
-					    subscription_buffers->
-						delete_node(clnt_sub_info->
-						sub_buf_info->list_id);
-					    delete clnt_sub_info->
-						sub_buf_info;
-					    clnt_sub_info->sub_buf_info =
-						NULL;
-					}
-				    }
-				    clnt_sub_info->sub_buf_info = NULL;
-				}
-				delete clnt_sub_info;
-				clnt_sub_info =
-				    (TCP_CLIENT_SUBSCRIPTION_INFO *)
-				    client_port_to_check->subscriptions->
-				    get_next();
-			    }
-			    delete client_port_to_check->subscriptions;
-			    client_port_to_check->subscriptions = NULL;
-			    recalculate_polling_interval();
-			}
-		    }
-		    if (client_port_to_check->threadId > 0
-			&& client_port_to_check->blocking) {
-			blocking_thread_kill(client_port_to_check->threadId);
-		    }
-		    close(client_port_to_check->socket_fd);
-		    FD_CLR(client_port_to_check->socket_fd, &read_fd_set);
-		    client_port_to_check->socket_fd = -1;
-		    delete client_port_to_check;
-		    client_ports->delete_current_node();
-		} else {
-		    if (client_port_to_check->blocking) {
-			if (client_port_to_check->threadId > 0) {
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Data received from %s:%d when it should be blocking (bytes_ready=%d).\n",
-				inet_ntoa
-				(client_port_to_check->address.
-				    sin_addr),
-				client_port_to_check->socket_fd, bytes_ready);
-			    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
-				"Killing handler %d.\n",
-				client_port_to_check->threadId);
-
-			    blocking_thread_kill
-				(client_port_to_check->threadId);
-#if 0
-			    *((uint32_t *) temp_buffer) =
-				htonl(client_port_to_check->serial_number);
-			    *((uint32_t *) temp_buffer + 1) =
-				htonl((unsigned long)
-				CMS_SERVER_SIDE_ERROR);
-			    putbe32(temp_buffer + 8, 0);	/* size
-									 */
-			    putbe32(temp_buffer + 12, 0);	/* write_id
-									 */
-			    putbe32(temp_buffer + 16, 0);	/* was_read
-									 */
-			    sendn(client_port_to_check->socket_fd,
-				temp_buffer, 20, 0, dtimeout);
-#endif
-			    client_port_to_check->threadId = 0;
-			    client_port_to_check->blocking = 0;
-			}
-		    }
-		    handle_request(client_port_to_check);
+	for (i = 0; i < ready_descriptors; i++) {
+	    client_port_to_check = (CLIENT_TCP_PORT *) events[i].data.ptr;
+	    if (NULL == client_port_to_check) {
+		accept_clients();
+		continue;
+	    }
+	    if ((void *) client_port_to_check == (void *) this) {
+		uint64_t expirations;
+		if (read(blocking_timer_fd, &expirations,
+			sizeof(expirations)) < 0) {
+		    /* Nothing to do, the timer only wakes epoll_wait(). */
 		}
-		ready_descriptors--;
-	    } else {
-		FD_SET(client_port_to_check->socket_fd, &read_fd_set);
+		if (blocking_timer_armed == 2) {
+		    blocking_timer_armed = 0;
+		}
+		check_blocking = 1;
+		continue;
+	    }
+	    if ((void *) client_port_to_check == (void *) &watch_fd) {
+		uint64_t writes;
+		if (read(watch_fd, &writes, sizeof(writes)) < 0) {
+		    /* Nothing to do, it only wakes epoll_wait(). */
+		}
+		watch_signalled = 1;
+		check_blocking = 1;
+		continue;
+	    }
+	    if (client_port_to_check->closing) {
+		continue;
+	    }
+	    if (events[i].events & EPOLLOUT) {
+		flush_client(client_port_to_check);
+	    }
+	    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+		read_client(client_port_to_check);
 	    }
+	}
+	if (check_blocking && blocking_reads_pending > 0) {
+	    check_blocking_reads();
+	}
+	check_blocking = 0;
+	update_subscriptions();
+
+	/* Clients are only deleted here, where nothing else can still
+	   refer to them. */
+	if (clients_closing) {
+	    clients_closing = 0;
 	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	if (FD_ISSET(connection_socket, &read_fd_set)
-	    && ready_descriptors > 0) {
-	    ready_descriptors--;
-	    socklen_t client_address_length;
-	    new_client_port = new CLIENT_TCP_PORT();
-	    client_address_length = sizeof(new_client_port->address);
-	    new_client_port->socket_fd = accept(connection_socket,
-		(struct sockaddr *)
-		&new_client_port->address, &client_address_length);
-	    current_clients++;
-	    if (current_clients > max_clients) {
-		max_clients = current_clients;
+		(CLIENT_TCP_PORT *) client_ports->get_head();
+	    while (NULL != client_port_to_check) {
+		if (client_port_to_check->closing) {
+		    remove_client(client_port_to_check);
+		    client_ports->delete_current_node();
+		}
+		client_port_to_check =
+		    (CLIENT_TCP_PORT *) client_ports->get_next();
 	    }
-	    if (new_client_port->socket_fd < 0) {
+	}
+    }
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::accept_clients()
+{
+    struct epoll_event ev;
+    socklen_t client_address_length;
+    CLIENT_TCP_PORT *new_client_port;
+    int fd;
+
+    while (1) {
+	struct sockaddr_in address;
+	client_address_length = sizeof(address);
+	fd = accept(connection_socket, (struct sockaddr *) &address,
+	    &client_address_length);
+	if (fd < 0) {
+	    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
 		rcs_print_error("server: accept error -- %d %s \n", errno,
 		    strerror(errno));
-		continue;
 	    }
-	    rcs_print_debug(PRINT_SOCKET_CONNECT,
-		"Socket opened by host with IP address %s.\n",
-		inet_ntoa(new_client_port->address.sin_addr));
-	    new_client_port->serial_number = 0;
-	    new_client_port->blocking = 0;
-	    if (NULL != client_ports) {
-		client_ports->store_at_tail(new_client_port,
-		    sizeof(new_client_port), 0);
+	    return;
+	}
+	rcs_print_debug(PRINT_SOCKET_CONNECT,
+	    "Socket opened by host with IP address %s.\n",
+	    inet_ntoa(address.sin_addr));
+	set_tcp_socket_options(fd);
+	make_tcp_socket_nonblocking(fd);
+	new_client_port = new CLIENT_TCP_PORT();
+	new_client_port->socket_fd = fd;
+	new_client_port->address = address;
+	new_client_port->serial_number = 0;
+	new_client_port->blocking = 0;
+	new_client_port->in_size = TCP_SRV_INITIAL_IN_SIZE;
+	new_client_port->in_buf = (char *) malloc(new_client_port->in_size);
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = new_client_port;
+	if (NULL == new_client_port->in_buf
+	    || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+	    rcs_print_error("server: can not add client %s.\n",
+		inet_ntoa(address.sin_addr));
+	    delete new_client_port;
+	    continue;
+	}
+	current_clients++;
+	if (current_clients > max_clients) {
+	    max_clients = current_clients;
+	}
+	client_ports->store_at_tail(new_client_port,
+	    sizeof(new_client_port), 0);
+    }
+}
+
+/* Remove clnt_sub_info from the list of subscribers of its buffer, and
+   forget the buffer once nobody subscribes to it. */
+static void drop_subscription(LinkedList * subscription_buffers,
+    TCP_CLIENT_SUBSCRIPTION_INFO * clnt_sub_info)
+{
+    TCP_BUFFER_SUBSCRIPTION_INFO *buf_info = clnt_sub_info->sub_buf_info;
+    if (NULL != buf_info && NULL != buf_info->sub_clnt_info) {
+	TCP_CLIENT_SUBSCRIPTION_INFO *other =
+	    (TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
+	    get_head();
+	while (NULL != other) {
+	    if (other == clnt_sub_info) {
+		buf_info->sub_clnt_info->delete_current_node();
+		break;
+	    }
+	    other = (TCP_CLIENT_SUBSCRIPTION_INFO *)
+		buf_info->sub_clnt_info->get_next();
+	}
+	if (buf_info->sub_clnt_info->list_size < 1) {
+	    if (NULL != subscription_buffers && buf_info->list_id >= 0) {
+		subscription_buffers->delete_node(buf_info->list_id);
+	    }
+	    delete buf_info;
+	}
+    }
+    clnt_sub_info->sub_buf_info = NULL;
+    delete clnt_sub_info;
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::remove_client(CLIENT_TCP_PORT * client)
+{
+    rcs_print_debug(PRINT_SOCKET_CONNECT,
+	"Socket closed by host with IP address %s.\n",
+	inet_ntoa(client->address.sin_addr));
+    if (NULL != client->subscriptions) {
+	TCP_CLIENT_SUBSCRIPTION_INFO *clnt_sub_info =
+	    (TCP_CLIENT_SUBSCRIPTION_INFO *) client->subscriptions->get_head();
+	while (NULL != clnt_sub_info) {
+	    drop_subscription(subscription_buffers, clnt_sub_info);
+	    client->subscriptions->delete_current_node();
+	    clnt_sub_info = (TCP_CLIENT_SUBSCRIPTION_INFO *)
+		client->subscriptions->get_next();
+	}
+	delete client->subscriptions;
+	client->subscriptions = NULL;
+	recalculate_polling_interval();
+    }
+    if (client->blocking) {
+	client->blocking = 0;
+	blocking_reads_pending--;
+    }
+    if (client->socket_fd >= 0) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->socket_fd, NULL);
+	close(client->socket_fd);
+	client->socket_fd = -1;
+    }
+    current_clients--;
+    delete client;
+}
+
+void CMS_SERVER_REMOTE_TCP_PORT::read_client(CLIENT_TCP_PORT * client)
+{
+    int bytes_read;
+    int size;
+    int end_of_file = 0;
+    CMS_SERVER *server = find_server(getpid(), 0);
+
+    /* Take everything the socket has. */
+    while (1) {
+	if (client->in_end == client->in_size) {
+	    if (client->in_start > 0) {
+		memmove(client->in_buf, client->in_buf + client->in_start,
+		    client->in_end - client->in_start);
+		client->in_end -= client->in_start;
+		client->in_start = 0;
+	    } else {
+		char *new_buf =
+		    (char *) realloc(client->in_buf, client->in_size * 2);
+		if (NULL == new_buf) {
+		    rcs_print_error("server: out of memory for client %s.\n",
+			inet_ntoa(client->address.sin_addr));
+		    client->closing = 1;
+		    clients_closing = 1;
+		    return;
+		}
+		client->in_buf = new_buf;
+		client->in_size *= 2;
 	    }
-	    if (maxfdpl < new_client_port->socket_fd + 1) {
-		maxfdpl = new_client_port->socket_fd + 1;
+	}
+	bytes_read = recv(client->socket_fd, client->in_buf + client->in_end,
+	    client->in_size - client->in_end, 0);
+	if (bytes_read > 0) {
+	    client->in_end += bytes_read;
+	    continue;
+	}
+	if (bytes_read == 0) {
+	    end_of_file = 1;
+	    break;
+	}
+	if (errno == EINTR) {
+	    continue;
+	}
+	if (errno != EAGAIN && errno != EWOULDBLOCK) {
+	    rcs_print_debug(PRINT_SOCKET_CONNECT,
+		"recv from %s failed: %d %s\n",
+		inet_ntoa(client->address.sin_addr), errno, strerror(errno));
+	    end_of_file = 1;
+	}
+	break;
+    }
+
+    /* Handle each complete request. Replies to all but the last one are
+       queued and go out together. */
+    while (!client->closing) {
+	size = request_size(client, server);
+	if (size < 0) {
+	    client->closing = 1;
+	    clients_closing = 1;
+	    break;
+	}
+	if (client->in_end - client->in_start < size) {
+	    break;
+	}
+	if (client->blocking) {
+	    /* A new request cancels the blocking read, as it did when
+	       blocking reads were handled in a separate process. */
+	    rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
+		"Data received from %s:%d when it should be blocking.\n",
+		inet_ntoa(client->address.sin_addr), client->socket_fd);
+	    client->blocking = 0;
+	    blocking_reads_pending--;
+	}
+	int request_end = client->in_start + size;
+	client->corked = (client->in_end > request_end);
+	handle_request(client);
+	client->in_start = request_end;
+    }
+    client->corked = 0;
+    if (client->in_start == client->in_end) {
+	client->in_start = client->in_end = 0;
+    }
+    if (!client->closing) {
+	flush_client(client);
+    }
+    if (end_of_file) {
+	client->closing = 1;
+	clients_closing = 1;
+    }
+}
+
+/* Returns how many bytes the request at the start of in_buf takes, or -1
+   if it can not be valid. */
+int CMS_SERVER_REMOTE_TCP_PORT::request_size(CLIENT_TCP_PORT * client,
+    CMS_SERVER * server)
+{
+    char *header = client->in_buf + client->in_start;
+    int total_subdivisions = 1;
+    long size = 20;
+    long write_size;
+
+    if (client->in_end - client->in_start < 20) {
+	return 20;
+    }
+    long request_type = getbe32(header + 4);
+    long buffer_number = getbe32(header + 8);
+    if (max_total_subdivisions > 1 && NULL != server) {
+	total_subdivisions = server->get_total_subdivisions(buffer_number);
+    }
+    switch (request_type) {
+    case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
+	size += 68;
+	break;
+
+    case REMOTE_CMS_BLOCKING_READ_REQUEST_TYPE:
+	size += (total_subdivisions > 1) ? 8 : 4;
+	break;
+
+    case REMOTE_CMS_READ_REQUEST_TYPE:
+	if (total_subdivisions > 1) {
+	    size += 4;
+	}
+	break;
+
+    case REMOTE_CMS_WRITE_REQUEST_TYPE:
+	if (total_subdivisions > 1) {
+	    size += 4;
+	}
+	write_size = getbe32(header + 16);
+	if (NULL != server && write_size > server->maximum_cms_size) {
+	    rcs_print_error
+		("server: %s sent a write of %ld bytes, larger than any buffer.\n",
+		inet_ntoa(client->address.sin_addr), write_size);
+	    return -1;
+	}
+	size += write_size;
+	break;
+
+    case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
+	size += 16;
+	break;
+
+    case REMOTE_CMS_LOGIN_REQUEST_TYPE:
+	size += 32;
+	break;
+
+    default:
+	break;
+    }
+    return (int) size;
+}
+
+/* Takes the next n bytes of the current request from the client's
+   in_buf, which read_client() made sure holds all of it. */
+int CMS_SERVER_REMOTE_TCP_PORT::read_request_bytes(CLIENT_TCP_PORT *
+    client, char *buf, int n)
+{
+    if (client->in_end - client->in_start < n) {
+	rcs_print_error("server: request from %s is shorter than expected.\n",
+	    inet_ntoa(client->address.sin_addr));
+	return -1;
+    }
+    memcpy(buf, client->in_buf + client->in_start, n);
+    client->in_start += n;
+    return n;
+}
+
+static int append_output(CLIENT_TCP_PORT * client, const char *data, int n)
+{
+    if (n <= 0) {
+	return 0;
+    }
+    if (client->out_end - client->out_start + n > TCP_SRV_MAX_BACKLOG) {
+	rcs_print_error
+	    ("server: %s is not reading its replies, closing the connection.\n",
+	    inet_ntoa(client->address.sin_addr));
+	return -1;
+    }
+    if (client->out_end + n > client->out_size && client->out_start > 0) {
+	memmove(client->out_buf, client->out_buf + client->out_start,
+	    client->out_end - client->out_start);
+	client->out_end -= client->out_start;
+	client->out_start = 0;
+    }
+    if (client->out_end + n > client->out_size) {
+	int new_size = client->out_size * 2;
+	if (new_size < client->out_end + n) {
+	    new_size = client->out_end + n;
+	}
+	char *new_buf = (char *) realloc(client->out_buf, new_size);
+	if (NULL == new_buf) {
+	    rcs_print_error("server: out of memory for client %s.\n",
+		inet_ntoa(client->address.sin_addr));
+	    return -1;
+	}
+	client->out_buf = new_buf;
+	client->out_size = new_size;
+    }
+    memcpy(client->out_buf + client->out_end, data, n);
+    client->out_end += n;
+    return 0;
+}
+
+/* Sends a reply made of header and data with a single writev(), after
+   anything still queued for the client. While the client is corked, or
+   whatever the socket does not take, is queued instead. */
+int CMS_SERVER_REMOTE_TCP_PORT::send_reply(CLIENT_TCP_PORT * client,
+    const void *header, int header_size, const void *data, int data_size)
+{
+    struct iovec iov[3];
+    int iovcnt = 0;
+    long sent = 0;
+    int queued;
+
+    if (client->closing || client->socket_fd < 0) {
+	return -1;
+    }
+    if (NULL == data || data_size < 0) {
+	data_size = 0;
+    }
+    if (!client->corked) {
+	queued = client->out_end - client->out_start;
+	if (queued > 0) {
+	    iov[iovcnt].iov_base = client->out_buf + client->out_start;
+	    iov[iovcnt].iov_len = queued;
+	    iovcnt++;
+	}
+	iov[iovcnt].iov_base = (void *) header;
+	iov[iovcnt].iov_len = header_size;
+	iovcnt++;
+	if (data_size > 0) {
+	    iov[iovcnt].iov_base = (void *) data;
+	    iov[iovcnt].iov_len = data_size;
+	    iovcnt++;
+	}
+	do {
+	    sent = writev(client->socket_fd, iov, iovcnt);
+	} while (sent < 0 && errno == EINTR);
+	if (sent < 0) {
+	    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+		rcs_print_debug(PRINT_SOCKET_CONNECT,
+		    "send to %s failed: %d %s\n",
+		    inet_ntoa(client->address.sin_addr), errno,
+		    strerror(errno));
+		client->closing = 1;
+		clients_closing = 1;
+		return -1;
 	    }
-	    FD_SET(new_client_port->socket_fd, &read_fd_set);
+	    sent = 0;
+	}
+	if (sent >= queued) {
+	    sent -= queued;
+	    client->out_start = client->out_end = 0;
 	} else {
-	    FD_SET(connection_socket, &read_fd_set);
+	    client->out_start += sent;
+	    sent = 0;
+	}
+    }
+    if (sent < header_size) {
+	if (append_output(client, (const char *) header + sent,
+		header_size - sent) < 0
+	    || append_output(client, (const char *) data, data_size) < 0) {
+	    client->closing = 1;
+	    clients_closing = 1;
+	    return -1;
 	}
-	if (0 != ready_descriptors) {
-	    rcs_print_error("%d descriptors ready but not serviced.\n",
-		ready_descriptors);
+    } else if (sent < header_size + data_size) {
+	if (append_output(client, (const char *) data + sent - header_size,
+		header_size + data_size - sent) < 0) {
+	    client->closing = 1;
+	    clients_closing = 1;
+	    return -1;
 	}
-	update_subscriptions();
     }
+    if (!client->corked) {
+	watch_client_output(client, client->out_end > client->out_start);
+    }
+    return header_size + data_size;
 }
 
-static int tcpsvr_handle_blocking_request_sigint_count = 0;
-static int tcpsvr_last_sig = 0;
+int CMS_SERVER_REMOTE_TCP_PORT::flush_client(CLIENT_TCP_PORT * client)
+{
+    int sent;
+    while (client->out_end > client->out_start) {
+	sent = send(client->socket_fd, client->out_buf + client->out_start,
+	    client->out_end - client->out_start, 0);
+	if (sent < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		watch_client_output(client, 1);
+		return 0;
+	    }
+	    client->closing = 1;
+	    clients_closing = 1;
+	    return -1;
+	}
+	client->out_start += sent;
+    }
+    client->out_start = client->out_end = 0;
+    watch_client_output(client, 0);
+    return 0;
+}
 
-void tcpsvr_handle_blocking_request_sigint_handler(int sig)
+void CMS_SERVER_REMOTE_TCP_PORT::watch_client_output(CLIENT_TCP_PORT *
+    client, int watch)
 {
-    tcpsvr_last_sig = sig;
-    tcpsvr_handle_blocking_request_sigint_count++;
+    struct epoll_event ev;
+    if (watch == client->watching_output) {
+	return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (watch ? EPOLLOUT : 0);
+    ev.data.ptr = client;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->socket_fd, &ev) == 0) {
+	client->watching_output = watch;
+    }
 }
 
-static void putbe32(char *addr, uint32_t val) {
-    val = htonl(val);
-    memcpy(addr, &val, sizeof(val));
+/* Starts the write watcher thread. Without it, every blocking read is
+   polled. */
+void CMS_SERVER_REMOTE_TCP_PORT::start_write_watch()
+{
+    struct epoll_event ev;
+
+    watch_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &watch_fd;	/* marks the write watcher */
+    if (watch_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watch_fd, &ev) < 0
+	|| pthread_create(&watch_thread, NULL, write_watch, this) != 0) {
+	rcs_print_debug(PRINT_SERVER_THREAD_ACTIVITY,
+	    "server: no write watcher, polling blocking reads.\n");
+	watch_failed = 1;
+	return;
+    }
+    watch_started = 1;
 }
 
-static uint32_t getbe32(char *addr) {
-    uint32_t val;
-    memcpy(&val, addr, sizeof(val));
-    return ntohl(val);
+void CMS_SERVER_REMOTE_TCP_PORT::stop_write_watch()
+{
+    if (watch_started) {
+	watch_stop = 1;
+	rcs_notify_post(&watch_control);
+	pthread_join(watch_thread, NULL);
+	watch_started = 0;
+    }
+    if (watch_fd >= 0) {
+	close(watch_fd);
+	watch_fd = -1;
+    }
 }
 
-#if defined(POSIX_THREADS) || defined(NO_THREADS)
-void *tcpsvr_handle_blocking_request(void *_req)
+/* The write watcher: waits until a buffer of the list is written, tells
+   run() through watch_fd, and then waits for run() to hand it a new
+   list, which run() does once it has looked at the reads again. */
+void *CMS_SERVER_REMOTE_TCP_PORT::write_watch(void *arg)
 {
-    signal(SIGINT, tcpsvr_handle_blocking_request_sigint_handler);
-    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req =
-	(TCPSVR_BLOCKING_READ_REQUEST *) _req;
-    char temp_buffer[0x2000];
-    if (_req == NULL) {
-	tcpsvr_threads_returned_early++;
-	return 0;
+    CMS_SERVER_REMOTE_TCP_PORT *port = (CMS_SERVER_REMOTE_TCP_PORT *) arg;
+    RCS_NOTIFY *notify[TCP_SRV_MAX_WATCHED + 1];
+    unsigned int seen[TCP_SRV_MAX_WATCHED + 1];
+    uint64_t one = 1;
+    int n, ret;
+
+    while (!port->watch_stop) {
+	pthread_mutex_lock(&port->watch_mutex);
+	notify[0] = &port->watch_control;
+	seen[0] = port->watch_control.seq;
+	n = port->watch_len;
+	memcpy(notify + 1, port->watch_notify, n * sizeof(RCS_NOTIFY *));
+	memcpy(seen + 1, port->watch_seen, n * sizeof(unsigned int));
+	pthread_mutex_unlock(&port->watch_mutex);
+
+	ret = rcs_notify_wait_any(notify, seen, n + 1, RCS_NOTIFY_FOREVER);
+	if (ret == 0 || ret == -2) {
+	    continue;		/* a new list, or a signal */
+	}
+	if (ret < 0) {
+	    /* the kernel can not wait on several futexes */
+	    port->watch_failed = 1;
+	}
+	if (write(port->watch_fd, &one, sizeof(one)) < 0) {
+	    /* it is still woken by an earlier write */
+	}
+	if (ret < 0) {
+	    break;
+	}
+	rcs_notify_wait(&port->watch_control, seen[0], RCS_NOTIFY_FOREVER);
     }
-    double dtimeout =
-	((double) (blocking_read_req->timeout_millis + 10)) / 1000.0;
-    if (dtimeout < 0) {
-	dtimeout = 600.0;
+    return NULL;
+}
+
+/* Sets up what wakes run() for the pending blocking reads: the write
+   watcher for reads of buffers with "notify", the timer ticking every
+   TCP_SRV_BLOCKING_POLL_USEC for any others, or else the timer going off
+   at the earliest deadline. */
+void CMS_SERVER_REMOTE_TCP_PORT::arm_blocking_wakeups()
+{
+    RCS_NOTIFY *notify[TCP_SRV_MAX_WATCHED];
+    unsigned int seen[TCP_SRV_MAX_WATCHED];
+    int n = 0, poll = 0, i;
+    double deadline = -1.0;
+    CLIENT_TCP_PORT *client;
+
+    client = (CLIENT_TCP_PORT *) client_ports->get_head();
+    while (NULL != client && blocking_reads_pending > 0) {
+	if (client->blocking && !client->closing) {
+	    if (client->blocking_deadline >= 0.0 && (deadline < 0.0
+		    || client->blocking_deadline < deadline)) {
+		deadline = client->blocking_deadline;
+	    }
+	    /* The same buffer seen at two seq values was written since
+	       one of the checks, so both go in and the wait ends at once. */
+	    for (i = 0; i < n; i++) {
+		if (notify[i] == client->blocking_notify
+		    && seen[i] == client->blocking_seen) {
+		    break;
+		}
+	    }
+	    if (NULL == client->blocking_notify || watch_failed) {
+		poll = 1;
+	    } else if (i == n && n < TCP_SRV_MAX_WATCHED) {
+		notify[n] = client->blocking_notify;
+		seen[n++] = client->blocking_seen;
+	    } else if (i == n) {
+		poll = 1;
+	    }
+	}
+	client = (CLIENT_TCP_PORT *) client_ports->get_next();
     }
-    if (dtimeout < 0.5) {
-	dtimeout = 0.5;
+    if (watch_started && !watch_failed && (watch_signalled
+	    || n != watch_len
+	    || memcmp(notify, watch_notify, n * sizeof(RCS_NOTIFY *))
+	    || memcmp(seen, watch_seen, n * sizeof(unsigned int)))) {
+	pthread_mutex_lock(&watch_mutex);
+	memcpy(watch_notify, notify, n * sizeof(RCS_NOTIFY *));
+	memcpy(watch_seen, seen, n * sizeof(unsigned int));
+	watch_len = n;
+	pthread_mutex_unlock(&watch_mutex);
+	rcs_notify_post(&watch_control);
+	watch_signalled = 0;
     }
-    if (dtimeout > 600.0) {
-	dtimeout = 600.0;
+    arm_blocking_timer(poll, deadline);
+}
+
+/* Ticks every TCP_SRV_BLOCKING_POLL_USEC if poll is set, or else goes
+   off once at deadline, an etime(), unless that is negative. */
+void CMS_SERVER_REMOTE_TCP_PORT::arm_blocking_timer(int poll,
+    double deadline)
+{
+    struct itimerspec its;
+    int arm = poll ? 1 : (deadline >= 0.0 ? 2 : 0);
+
+    if (arm == blocking_timer_armed
+	&& (arm != 2 || deadline == blocking_timer_deadline)) {
+	return;
+    }
+    memset(&its, 0, sizeof(its));
+    if (arm == 1) {
+	its.it_value.tv_nsec = TCP_SRV_BLOCKING_POLL_USEC * 1000;
+	its.it_interval.tv_nsec = TCP_SRV_BLOCKING_POLL_USEC * 1000;
+    } else if (arm == 2) {
+	double left = deadline - etime();
+	if (left < 1e-6) {
+	    left = 1e-6;
+	}
+	its.it_value.tv_sec = (time_t) left;
+	its.it_value.tv_nsec = (long) ((left - its.it_value.tv_sec) * 1e9);
+    }
+    if (timerfd_settime(blocking_timer_fd, 0, &its, NULL) == 0) {
+	blocking_timer_armed = arm;
+	blocking_timer_deadline = deadline;
     }
-    CLIENT_TCP_PORT *_client_tcp_port = blocking_read_req->_client_tcp_port;
-    CMS_SERVER *server = blocking_read_req->server;
+}
 
-    if (NULL == server || NULL == _client_tcp_port) {
-	tcpsvr_threads_returned_early++;
-	return 0;
+void CMS_SERVER_REMOTE_TCP_PORT::check_blocking_reads()
+{
+    CMS_SERVER *server = find_server(getpid(), 0);
+    if (NULL == server) {
+	return;
     }
-    memset(temp_buffer, 0, 0x2000);
-    REMOTE_BLOCKING_READ_REPLY *read_reply;
+    CLIENT_TCP_PORT *client = (CLIENT_TCP_PORT *) client_ports->get_head();
+    while (NULL != client && blocking_reads_pending > 0) {
+	if (client->blocking && !client->closing) {
+	    check_blocking_read(client, server);
+	}
+	client = (CLIENT_TCP_PORT *) client_ports->get_next();
+    }
+}
 
-    if (NULL != _client_tcp_port->diag_info) {
-	_client_tcp_port->diag_info->buffer_number =
-	    blocking_read_req->buffer_number;
-	server->set_diag_info(_client_tcp_port->diag_info);
+/* Answers the client's blocking read if there is new data or it timed
+   out. Returns 1 if it was answered. */
+int CMS_SERVER_REMOTE_TCP_PORT::check_blocking_read(CLIENT_TCP_PORT *
+    client, CMS_SERVER * server)
+{
+    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req =
+	client->blocking_read_req;
+    CMS_SERVER_LOCAL_PORT *local_port;
+    char reply_header[20];
+    int timed_out;
+
+    if (server->using_passwd_file) {
+	current_user_info = get_connected_user(client->socket_fd);
+    }
+    if (NULL != client->diag_info) {
+	client->diag_info->buffer_number = blocking_read_req->buffer_number;
+	server->set_diag_info(client->diag_info);
     } else if (server->diag_enabled) {
 	server->reset_diag_info(blocking_read_req->buffer_number);
     }
+    server->read_req.buffer_number = blocking_read_req->buffer_number;
+    server->read_req.access_type = blocking_read_req->access_type;
+    server->read_req.last_id_read = blocking_read_req->last_id_read;
+    server->read_req.subdiv = blocking_read_req->subdiv;
+    server->read_reply =
+	(REMOTE_READ_REPLY *) server->process_request(&server->read_req);
+    /* The seq the buffer had when it was read, so that the write watcher
+       notices any write since. */
+    local_port = server->find_local_port(blocking_read_req->buffer_number);
+    client->blocking_notify = NULL;
+    if (NULL != local_port && NULL != local_port->cms) {
+	client->blocking_notify =
+	    local_port->cms->get_notify(&client->blocking_seen);
+    }
+    timed_out = (client->blocking_deadline >= 0.0
+	&& etime() >= client->blocking_deadline);
+    if (NULL != server->read_reply
+	&& server->read_reply->status == CMS_READ_OLD && !timed_out) {
+	return 0;
+    }
+    client->blocking = 0;
+    blocking_reads_pending--;
 
-    read_reply = (REMOTE_BLOCKING_READ_REPLY *)
-	server->process_request(blocking_read_req);
-    blocking_read_req->read_reply = read_reply;
-    if (NULL == read_reply) {
-	_client_tcp_port->blocking = 0;
+    putbe32(reply_header, client->serial_number);
+    if (NULL == server->read_reply) {
 	rcs_print_error("Server could not process request.\n");
-	putbe32(temp_buffer, _client_tcp_port->serial_number);
-	putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-	putbe32(temp_buffer + 8, 0);	/* size */
-	putbe32(temp_buffer + 12, 0)	/* write_id */;
-	putbe32(temp_buffer + 16, 0)	/* was_read */;
-	sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
-	_client_tcp_port->errors++;
-	_client_tcp_port->blocking_read_req = NULL;
-	delete blocking_read_req;
-	_client_tcp_port->threadId = 0;
-	tcpsvr_threads_returned_early++;
-	return 0;
+	putbe32(reply_header + 4, CMS_SERVER_SIDE_ERROR);
+	putbe32(reply_header + 8, 0);	/* size */
+	putbe32(reply_header + 12, 0);	/* write_id */
+	putbe32(reply_header + 16, 0);	/* was_read */
+	send_reply(client, reply_header, 20);
+	client->errors++;
+	return 1;
     }
-    putbe32(temp_buffer, _client_tcp_port->serial_number);
-    putbe32(temp_buffer + 4, read_reply->status);
-    putbe32(temp_buffer + 8, read_reply->size);
-    putbe32(temp_buffer + 12, read_reply->write_id);
-    putbe32(temp_buffer + 16, read_reply->was_read);
-    if (read_reply->size < (0x2000 - 20) && read_reply->size > 0) {
-	memcpy(temp_buffer + 20, read_reply->data, read_reply->size);
-	_client_tcp_port->blocking = 0;
-	if (sendn
-	    (_client_tcp_port->socket_fd, temp_buffer, 20 + read_reply->size,
-		0, dtimeout) < 0) {
-	    _client_tcp_port->blocking = 0;
-	    _client_tcp_port->errors++;
-	    _client_tcp_port->blocking_read_req = NULL;
-	    delete blocking_read_req;
-	    _client_tcp_port->threadId = 0;
-	    tcpsvr_threads_returned_early++;
-	    return 0;
-	}
+    if (server->read_reply->status == CMS_READ_OLD) {
+	putbe32(reply_header + 4, CMS_TIMED_OUT);
+	putbe32(reply_header + 8, 0);	/* size */
     } else {
-	_client_tcp_port->blocking = 0;
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout) <
-	    0) {
-	    _client_tcp_port->blocking = 0;
-	    _client_tcp_port->errors++;
-	    _client_tcp_port->blocking_read_req = NULL;
-	    delete blocking_read_req;
-	    _client_tcp_port->threadId = 0;
-	    tcpsvr_threads_returned_early++;
-	    return 0;
-	}
-	if (read_reply->size > 0) {
-	    if (sendn
-		(_client_tcp_port->socket_fd, read_reply->data,
-		    read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->blocking = 0;
-		_client_tcp_port->errors++;
-		_client_tcp_port->blocking_read_req = NULL;
-		delete blocking_read_req;
-		_client_tcp_port->threadId = 0;
-		tcpsvr_threads_returned_early++;
-		return 0;
-	    }
-	}
+	putbe32(reply_header + 4, server->read_reply->status);
+	putbe32(reply_header + 8, server->read_reply->size);
     }
-    _client_tcp_port->blocking_read_req = NULL;
-    delete blocking_read_req;
-    _client_tcp_port->threadId = 0;
-    tcpsvr_threads_exited++;
-#ifdef POSIX_THREADS
-    pthread_exit(0);
-#endif
-#ifdef NO_THREADS
-    exit(0);
-#endif
+    putbe32(reply_header + 12, server->read_reply->write_id);
+    putbe32(reply_header + 16, server->read_reply->was_read);
+    if (send_reply(client, reply_header, 20,
+	    (server->read_reply->status == CMS_READ_OLD) ? NULL :
+	    server->read_reply->data, server->read_reply->size) < 0) {
+	client->errors++;
+    }
+    return 1;
 }
 
-#endif
-
 void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     _client_tcp_port)
 {
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
     pid_t pid = getpid();
     pid_t tid = 0;
     CMS_SERVER *server;
@@ -663,23 +1132,12 @@ void CMS_SERVER_REMOTE_TCP_PORT::handle_request(CLIENT_TCP_PORT *
     if (_client_tcp_port->errors >= _client_tcp_port->max_errors) {
 	rcs_print_error("Too many errors - closing connection(%d)\n",
 	    _client_tcp_port->socket_fd);
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		delete client_port_to_check;
-		client_ports->delete_current_node();
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	_client_tcp_port->socket_fd = -1;
+	_client_tcp_port->closing = 1;
+	clients_closing = 1;
+	return;
     }
 
-    if (recvn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, -1, NULL) < 0) {
+    if (read_request_bytes(_client_tcp_port, temp_buffer, 20) < 0) {
 	rcs_print_error("Can not read from client port (%d) from %s\n",
 	    _client_tcp_port->socket_fd,
 	    inet_ntoa(_client_tcp_port->address.sin_addr));
@@ -733,7 +1191,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
     long request_type, long buffer_number, long received_serial_number)
 {
     int total_subdivisions = 1;
-    CLIENT_TCP_PORT *client_port_to_check = NULL;
+    int delta = 0;
     switch (request_type) {
     case REMOTE_CMS_SET_DIAG_INFO_REQUEST_TYPE:
 	{
@@ -741,9 +1199,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		_client_tcp_port->diag_info =
 		    new REMOTE_SET_DIAG_INFO_REQUEST();
 	    }
-	    if (recvn
-		(_client_tcp_port->socket_fd, server->set_diag_info_buf, 68,
-		    0, -1, NULL) < 0) {
+	    if (read_request_bytes(_client_tcp_port,
+		    server->set_diag_info_buf, 68) < 0) {
 		rcs_print_error
 		    ("Can not read from client port (%d) from %s\n",
 		    _client_tcp_port->socket_fd,
@@ -784,9 +1241,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    if (NULL == diagreply) {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer+4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 24, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 24) < 0) {
 		    _client_tcp_port->errors++;
 		}
 		return;
@@ -794,9 +1249,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    if (NULL == diagreply->cdi) {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 24, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 24) < 0) {
 		    _client_tcp_port->errors++;
 		}
 		return;
@@ -943,9 +1396,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    }
 	    *((uint32_t *) temp_buffer + 6) = htonl(dpi_count);
 	    *((uint32_t *) temp_buffer + 7) = htonl(dpi_offset);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, dpi_offset, 0,
-		    dtimeout) < 0) {
+	    if (send_reply(_client_tcp_port, temp_buffer, dpi_offset) < 0) {
 		_client_tcp_port->errors++;
 		return;
 	    }
@@ -965,18 +1416,14 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, namereply->status);
 		strncpy(temp_buffer + 8, namereply->name, 31);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 40, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 40) < 0) {
 		    _client_tcp_port->errors++;
 		    return;
 		}
 	    } else {
 		putbe32(temp_buffer, _client_tcp_port->serial_number);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		if (sendn
-		    (_client_tcp_port->socket_fd, temp_buffer, 40, 0,
-			dtimeout) < 0) {
+		if (send_reply(_client_tcp_port, temp_buffer, 40) < 0) {
 		    _client_tcp_port->errors++;
 		    return;
 		}
@@ -988,16 +1435,11 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	{
 	    TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req;
 
-#ifdef NO_THREADS
 	    if (NULL == _client_tcp_port->blocking_read_req) {
 		_client_tcp_port->blocking_read_req =
 		    new TCPSVR_BLOCKING_READ_REQUEST();
 	    }
 	    blocking_read_req = _client_tcp_port->blocking_read_req;
-#else
-	    blocking_read_req;
-	    = new TCPSVR_BLOCKING_READ_REQUEST();
-#endif
 	    blocking_read_req->buffer_number = buffer_number;
 	    blocking_read_req->access_type =
 		ntohl(*((uint32_t *) temp_buffer + 3));
@@ -1009,10 +1451,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		    server->get_total_subdivisions(buffer_number);
 	    }
 	    if (total_subdivisions > 1) {
-		if (recvn
-		    (_client_tcp_port->socket_fd,
-			(char *) (((uint32_t *) temp_buffer) + 5), 8, 0, -1,
-			NULL) < 0) {
+		if (read_request_bytes(_client_tcp_port,
+			(char *) (((uint32_t *) temp_buffer) + 5), 8) < 0) {
 		    rcs_print_error
 			("Can not read from client port (%d) from %s\n",
 			_client_tcp_port->socket_fd,
@@ -1023,10 +1463,9 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		blocking_read_req->subdiv =
 		    ntohl(*((uint32_t *) temp_buffer + 6));
 	    } else {
-		if (recvn
-		    (_client_tcp_port->socket_fd,
-			(char *) (((uint32_t *) temp_buffer) + 5), 4, 0, -1,
-			NULL) < 0) {
+		blocking_read_req->subdiv = 0;
+		if (read_request_bytes(_client_tcp_port,
+			(char *) (((uint32_t *) temp_buffer) + 5), 4) < 0) {
 		    rcs_print_error
 			("Can not read from client port (%d) from %s\n",
 			_client_tcp_port->socket_fd,
@@ -1036,77 +1475,21 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		}
 	    }
 	    blocking_read_req->timeout_millis =
-		ntohl(*((uint32_t *) temp_buffer + 5));
+		(int32_t) ntohl(*((uint32_t *) temp_buffer + 5));
 	    blocking_read_req->server = server;
 	    blocking_read_req->remport = this;
-	    _client_tcp_port->blocking = 1;
 	    blocking_read_req->_client_tcp_port = _client_tcp_port;
-#ifdef POSIX_THREADS
-	    int thr_retval = pthread_create(&(_client_tcp_port->threadId),	/* ptr to new-thread-id */
-		NULL,		// pthread_attr_t *, ptr to attributes
-		tcpsvr_handle_blocking_request,	// start_func
-		blocking_read_req	// arg for start_func
-		);
-	    if (thr_retval != 0) {
-		_client_tcp_port->blocking = 0;
-		rcs_print_error("pthread_create error: thr_retval = %d\n",
-		    thr_retval);
-		rcs_print_error("pthread_create error: %d %s\n", errno,
-		    strerror(errno));
-		*((uint32_t *) temp_buffer) =
-		    htonl(_client_tcp_port->serial_number);
-		*((uint32_t *) temp_buffer + 1) =
-		    htonl((unsigned long) CMS_SERVER_SIDE_ERROR);
-		putbe32(temp_buffer + 8, 0);	/* size */
-		putbe32(temp_buffer + 12, 0);	/* write_id */
-		putbe32(temp_buffer + 16, 0);	/* was_read */
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout);
-		return;
-	    }
-#else
-#ifdef NO_THREADS
-	    int fork_ret = fork();
-	    switch (fork_ret) {
-	    case 0:		// child
-		_client_tcp_port->threadId = getpid();
-		tcpsvr_handle_blocking_request(blocking_read_req);
-		exit(0);
-		break;
-
-	    case -1:		// Error
-		rcs_print_error("fork error: %d %s\n", errno,
-		    strerror(errno));
-		_client_tcp_port->blocking = 0;
-		putbe32(temp_buffer, _client_tcp_port->serial_number);
-		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-		putbe32(temp_buffer + 8, 0);
-		putbe32(temp_buffer + 12, 0);
-		putbe32(temp_buffer + 16, 0);
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout);
-		break;
 
-	    default:		// parent;
-		_client_tcp_port->threadId = fork_ret;
-		break;
+	    /* Answered from run() once there is new data or the timeout
+	       expires, so blocking reads need no thread or process. */
+	    _client_tcp_port->blocking_deadline = -1.0;
+	    if (blocking_read_req->timeout_millis >= 0) {
+		_client_tcp_port->blocking_deadline = etime() +
+		    blocking_read_req->timeout_millis / 1000.0;
 	    }
-#else
-	    rcs_print_error
-		("Blocking read not supported on this platform.\n");
-	    *((uint32_t *) temp_buffer) =
-		htonl(_client_tcp_port->serial_number);
-	    *((uint32_t *) temp_buffer + 1) =
-		htonl((unsigned long) CMS_SERVER_SIDE_ERROR);
-	    putbe32(temp_buffer + 8, 0);	/* size */
-	    putbe32(temp_buffer + 12, 0);	/* write_id */
-	    putbe32(temp_buffer + 16, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
-	    return;
-
-#endif
-#endif
-	    tcpsvr_threads_created++;
+	    _client_tcp_port->blocking = 1;
+	    blocking_reads_pending++;
+	    check_blocking_read(_client_tcp_port, server);
 	}
 	break;
 
@@ -1121,10 +1504,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		server->get_total_subdivisions(buffer_number);
 	}
 	if (total_subdivisions > 1) {
-	    if (recvn
-		(_client_tcp_port->socket_fd,
-		    (char *) (((uint32_t *) temp_buffer) + 5), 4, 0, -1,
-		    NULL) < 0) {
+	    if (read_request_bytes(_client_tcp_port,
+		    (char *) (((uint32_t *) temp_buffer) + 5), 4) < 0) {
 		rcs_print_error
 		    ("Can not read from client port (%d) from %s\n",
 		    _client_tcp_port->socket_fd,
@@ -1143,7 +1524,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer + 8, 0);
 	    putbe32(temp_buffer + 12, 0);
 	    putbe32(temp_buffer + 16, 0);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 20);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1151,31 +1532,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	putbe32(temp_buffer + 8, server->read_reply->size);
 	putbe32(temp_buffer + 12, server->read_reply->write_id);
 	putbe32(temp_buffer + 16, server->read_reply->was_read);
-	if (server->read_reply->size < (0x2000 - 20)
-	    && server->read_reply->size > 0) {
-	    memcpy(temp_buffer + 20, server->read_reply->data,
-		server->read_reply->size);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer,
-		    20 + server->read_reply->size, 0, dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	} else {
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 20, 0,
-		    dtimeout) < 0) {
-		_client_tcp_port->errors++;
-		return;
-	    }
-	    if (server->read_reply->size > 0) {
-		if (sendn
-		    (_client_tcp_port->socket_fd, server->read_reply->data,
-			server->read_reply->size, 0, dtimeout) < 0) {
-		    _client_tcp_port->errors++;
-		    return;
-		}
-	    }
+	if (send_reply(_client_tcp_port, temp_buffer, 20,
+		server->read_reply->data, server->read_reply->size) < 0) {
+	    _client_tcp_port->errors++;
+	    return;
 	}
 	break;
 
@@ -1189,10 +1549,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		server->get_total_subdivisions(buffer_number);
 	}
 	if (total_subdivisions > 1) {
-	    if (recvn
-		(_client_tcp_port->socket_fd,
-		    (char *) (((uint32_t *) temp_buffer) + 5), 4, 0, -1,
-		    NULL) < 0) {
+	    if (read_request_bytes(_client_tcp_port,
+		    (char *) (((uint32_t *) temp_buffer) + 5), 4) < 0) {
 		rcs_print_error
 		    ("Can not read from client port (%d) from %s\n",
 		    _client_tcp_port->socket_fd,
@@ -1205,9 +1563,9 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    server->write_req.subdiv = 0;
 	}
 	if (server->write_req.size > 0) {
-	    if (recvn
-		(_client_tcp_port->socket_fd, server->write_req.data,
-		    server->write_req.size, 0, -1, NULL) < 0) {
+	    if (read_request_bytes(_client_tcp_port,
+		    (char *) server->write_req.data,
+		    server->write_req.size) < 0) {
 		_client_tcp_port->errors++;
 		return;
 	    }
@@ -1222,16 +1580,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	        putbe32(temp_buffer, reply->write_id);
 		putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 		putbe32(temp_buffer + 8, 0);	/* was_read */
-		sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0,
-		    dtimeout);
+		send_reply(_client_tcp_port, temp_buffer, 12);
 		return;
 	    }
 	    putbe32(temp_buffer, reply->write_id);
 	    putbe32(temp_buffer + 4, reply->status);
 	    putbe32(temp_buffer + 8, reply->was_read);
-	    if (sendn
-		(_client_tcp_port->socket_fd, temp_buffer, 12, 0,
-		    dtimeout) < 0) {
+	    if (send_reply(_client_tcp_port, temp_buffer, 12) < 0) {
 		_client_tcp_port->errors++;
 	    }
 	} else {
@@ -1253,7 +1608,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1261,8 +1616,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->check_if_read_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->check_if_read_reply->was_read);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
-	    0) {
+	if (send_reply(_client_tcp_port, temp_buffer, 12) < 0) {
 	    _client_tcp_port->errors++;
 	}
 	break;
@@ -1279,7 +1633,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1287,8 +1641,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->get_msg_count_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->get_msg_count_reply->count);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
-	    0) {
+	if (send_reply(_client_tcp_port, temp_buffer, 12) < 0) {
 	    _client_tcp_port->errors++;
 	}
 	break;
@@ -1305,7 +1658,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1313,8 +1666,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->get_queue_length_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->get_queue_length_reply->queue_length);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
-	    0) {
+	if (send_reply(_client_tcp_port, temp_buffer, 12) < 0) {
 	    _client_tcp_port->errors++;
 	}
 	break;
@@ -1331,7 +1683,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
 	    putbe32(temp_buffer + 8, 0);	/* was_read */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 12);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1339,8 +1691,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    htonl(server->get_space_available_reply->status);
 	*((uint32_t *) temp_buffer + 2) =
 	    htonl(server->get_space_available_reply->space_available);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 12, 0, dtimeout) <
-	    0) {
+	if (send_reply(_client_tcp_port, temp_buffer, 12) < 0) {
 	    _client_tcp_port->errors++;
 	}
 	break;
@@ -1355,13 +1706,12 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, CMS_SERVER_SIDE_ERROR);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	}
 	putbe32(temp_buffer, _client_tcp_port->serial_number);
 	putbe32(temp_buffer + 4, server->clear_reply->status);
-	if (sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout) <
-	    0) {
+	if (send_reply(_client_tcp_port, temp_buffer, 8) < 0) {
 	    _client_tcp_port->errors++;
 	}
 	break;
@@ -1372,30 +1722,15 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	break;
 
     case REMOTE_CMS_CLOSE_CHANNEL_REQUEST_TYPE:
-	client_port_to_check = (CLIENT_TCP_PORT *) client_ports->get_head();
-	while (NULL != client_port_to_check) {
-	    if (client_port_to_check->socket_fd ==
-		_client_tcp_port->socket_fd) {
-		break;
-	    }
-	    client_port_to_check =
-		(CLIENT_TCP_PORT *) client_ports->get_next();
-	}
-	FD_CLR(_client_tcp_port->socket_fd, &read_fd_set);
-	close(_client_tcp_port->socket_fd);
-	current_clients--;
-	if (NULL != _client_tcp_port->subscriptions) {
-	    remove_subscription_client(_client_tcp_port, buffer_number);
-	}
-	_client_tcp_port->socket_fd = -1;
-	delete _client_tcp_port;
-	client_ports->delete_current_node();
+	/* run() drops the client and its subscriptions. */
+	_client_tcp_port->closing = 1;
+	clients_closing = 1;
 	break;
 
     case REMOTE_CMS_GET_KEYS_REQUEST_TYPE:
 	server->get_keys_req.buffer_number = buffer_number;
-	if (recvn(_client_tcp_port->socket_fd,
-		server->get_keys_req.name, 16, 0, -1, NULL) < 0) {
+	if (read_request_bytes(_client_tcp_port,
+		server->get_keys_req.name, 16) < 0) {
 	    _client_tcp_port->errors++;
 	    return;
 	}
@@ -1408,7 +1743,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    server->gen_random_key(((char *) temp_buffer) + 4, 2);
 	    server->gen_random_key(((char *) temp_buffer) + 12, 2);
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 20);
 	    return;
 	} else {
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
@@ -1417,20 +1752,20 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    memcpy(((char *) temp_buffer) + 12, server->get_keys_reply->key2,
 		8);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 20, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 20);
 	    return;
 	}
 	break;
 
     case REMOTE_CMS_LOGIN_REQUEST_TYPE:
 	server->login_req.buffer_number = buffer_number;
-	if (recvn(_client_tcp_port->socket_fd,
-		server->login_req.name, 16, 0, -1, NULL) < 0) {
+	if (read_request_bytes(_client_tcp_port,
+		server->login_req.name, 16) < 0) {
 	    _client_tcp_port->errors++;
 	    return;
 	}
-	if (recvn(_client_tcp_port->socket_fd,
-		server->login_req.passwd, 16, 0, -1, NULL) < 0) {
+	if (read_request_bytes(_client_tcp_port,
+		server->login_req.passwd, 16) < 0) {
 	    _client_tcp_port->errors++;
 	    return;
 	}
@@ -1441,13 +1776,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, 0);	/* not successful */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	} else {
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, server->login_reply->success);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	}
 	break;
@@ -1456,6 +1791,10 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	server->set_subscription_req.buffer_number = buffer_number;
 	server->set_subscription_req.subscription_type =
 	    ntohl(*((uint32_t *) temp_buffer + 3));
+	delta = server->set_subscription_req.subscription_type &
+	    CMS_DELTA_SUBSCRIPTION_FLAG;
+	server->set_subscription_req.subscription_type &=
+	    ~CMS_DELTA_SUBSCRIPTION_FLAG;
 	server->set_subscription_req.poll_interval_millis =
 	    ntohl(*((uint32_t *) temp_buffer + 4));
 	server->set_subscription_reply =
@@ -1465,7 +1804,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 	    rcs_print_error("Server could not process request.\n");
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
 	    putbe32(temp_buffer + 4, 0);	/* not successful */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	} else {
 	    if (server->set_subscription_reply->success) {
@@ -1477,7 +1816,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 			server->set_subscription_req.
 			subscription_type,
 			server->set_subscription_req.
-			poll_interval_millis, _client_tcp_port);
+			poll_interval_millis, _client_tcp_port, delta);
 		}
 		if (server->set_subscription_req.subscription_type ==
 		    CMS_NO_SUBSCRIPTION) {
@@ -1486,10 +1825,13 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 		}
 	    }
 	    putbe32(temp_buffer, _client_tcp_port->serial_number);
-	    *((uint32_t *) temp_buffer + 1) =
-		htonl(server->set_subscription_reply->success);
+	    if (!server->set_subscription_reply->success) {
+		delta = 0;
+	    }
+	    putbe32(temp_buffer + 4,
+		server->set_subscription_reply->success | delta);
 	    /* successful ? */
-	    sendn(_client_tcp_port->socket_fd, temp_buffer, 8, 0, dtimeout);
+	    send_reply(_client_tcp_port, temp_buffer, 8);
 	    return;
 	}
 	break;
@@ -1503,7 +1845,8 @@ void CMS_SERVER_REMOTE_TCP_PORT::switch_function(CLIENT_TCP_PORT *
 }
 
 void CMS_SERVER_REMOTE_TCP_PORT::add_subscription_client(int buffer_number,
-    int subscription_type, int poll_interval_millis, CLIENT_TCP_PORT * clnt)
+    int subscription_type, int poll_interval_millis, CLIENT_TCP_PORT * clnt,
+    int delta)
 {
     if (NULL == subscription_buffers) {
 	subscription_buffers = new LinkedList();
@@ -1559,33 +1902,23 @@ void CMS_SERVER_REMOTE_TCP_PORT::add_subscription_client(int buffer_number,
     }
     temp_clnt_info->subscription_type = subscription_type;
     temp_clnt_info->poll_interval_millis = poll_interval_millis;
+    temp_clnt_info->delta = (delta != 0);
+    temp_clnt_info->delta_base_size = 0;	/* Start with a keyframe */
     recalculate_polling_interval();
 }
 
 void CMS_SERVER_REMOTE_TCP_PORT::remove_subscription_client(CLIENT_TCP_PORT *
     clnt, int buffer_number)
 {
+    if (NULL == clnt->subscriptions) {
+	return;
+    }
     TCP_CLIENT_SUBSCRIPTION_INFO *temp_clnt_info =
 	(TCP_CLIENT_SUBSCRIPTION_INFO *) clnt->subscriptions->get_head();
     while (temp_clnt_info != NULL) {
 	if (temp_clnt_info->buffer_number == buffer_number) {
-	    if (NULL != temp_clnt_info->sub_buf_info) {
-		if (NULL != temp_clnt_info->sub_buf_info->sub_clnt_info) {
-		    temp_clnt_info->sub_buf_info->sub_clnt_info->
-			delete_node(temp_clnt_info->subscription_list_id);
-		    if (temp_clnt_info->sub_buf_info->sub_clnt_info->
-			list_size == 0) {
-			subscription_buffers->delete_node(temp_clnt_info->
-			    sub_buf_info->list_id);
-			delete temp_clnt_info->sub_buf_info->sub_clnt_info;
-			temp_clnt_info->sub_buf_info->sub_clnt_info = NULL;
-			delete temp_clnt_info->sub_buf_info;
-			temp_clnt_info->sub_buf_info = NULL;
-		    }
-		}
-	    }
-	    delete temp_clnt_info;
-	    temp_clnt_info = NULL;
+	    drop_subscription(subscription_buffers, temp_clnt_info);
+	    clnt->subscriptions->delete_current_node();
 	    break;
 	}
 	temp_clnt_info =
@@ -1632,6 +1965,93 @@ void CMS_SERVER_REMOTE_TCP_PORT::recalculate_polling_interval()
     }
 }
 
+/* Encode the changes from base to cur into out as the size of cur
+   followed by (offset, length, bytes) for each changed range. Ranges
+   closer than the 8 byte range header are merged. Returns the number of
+   bytes used, or -1 if that would be more than out_max. */
+static int make_delta(const char *base, int base_size, const char *cur,
+    int cur_size, char *out, int out_max)
+{
+    int common = base_size < cur_size ? base_size : cur_size;
+    int used = 4;
+    int start, end;
+    int i = 0;
+
+    if (out_max < used) {
+	return -1;
+    }
+    putbe32(out, cur_size);
+    while (i < cur_size) {
+	while (i + 4 <= common && !memcmp(base + i, cur + i, 4)) {
+	    i += 4;
+	}
+	if (i >= cur_size) {
+	    break;
+	}
+	start = i;
+	end = i + 4;
+	while (end < cur_size &&
+	    (end + 8 > common || memcmp(base + end, cur + end, 8))) {
+	    end += 4;
+	}
+	if (end > cur_size) {
+	    end = cur_size;
+	}
+	if (used + 8 + end - start > out_max) {
+	    return -1;
+	}
+	putbe32(out + used, start);
+	putbe32(out + used + 4, end - start);
+	memcpy(out + used + 8, cur + start, end - start);
+	used += 8 + end - start;
+	i = end;
+    }
+    return used;
+}
+
+/* Subscribers that were sent the same update share the delta to the
+   current one, so it is only computed once per buffer and update. */
+static int subscription_delta(TCP_BUFFER_SUBSCRIPTION_INFO * buf_info,
+    TCP_CLIENT_SUBSCRIPTION_INFO * clnt_info, const char *data, int size)
+{
+    if (buf_info->delta_valid
+	&& buf_info->delta_from_id == clnt_info->last_id_read) {
+	return buf_info->delta_size;
+    }
+    if (buf_info->delta_buf_size < size) {
+	char *new_buf = (char *) realloc(buf_info->delta_buf, size);
+	if (NULL == new_buf) {
+	    return -1;
+	}
+	buf_info->delta_buf = new_buf;
+	buf_info->delta_buf_size = size;
+    }
+    buf_info->delta_size = make_delta(clnt_info->delta_base,
+	clnt_info->delta_base_size, data, size, buf_info->delta_buf,
+	size - 1);
+    buf_info->delta_from_id = clnt_info->last_id_read;
+    buf_info->delta_valid = 1;
+    return buf_info->delta_size;
+}
+
+/* Remember what a delta subscriber was sent, as the base of its next
+   delta. */
+static void save_delta_base(TCP_CLIENT_SUBSCRIPTION_INFO * clnt_info,
+    const char *data, int size)
+{
+    if (clnt_info->delta_base_alloc < size) {
+	char *new_base = (char *) realloc(clnt_info->delta_base, size);
+	if (NULL == new_base) {
+	    clnt_info->delta_base_size = 0;
+	    return;
+	}
+	clnt_info->delta_base = new_base;
+	clnt_info->delta_base_alloc = size;
+    }
+    memcpy(clnt_info->delta_base, data, size);
+    clnt_info->delta_base_size = size;
+}
+
 void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 {
     pid_t pid = getpid();
@@ -1677,6 +2097,7 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 	    (TCP_CLIENT_SUBSCRIPTION_INFO *) buf_info->sub_clnt_info->
 	    get_head();
 	buf_info->min_last_id = server->read_reply->write_id;
+	buf_info->delta_valid = 0;
 	while (temp_clnt_info != NULL) {
 	    double time_diff = cur_time - temp_clnt_info->last_sub_sent_time;
 	    int time_diff_millis = (int) ((double) time_diff * 1000.0);
@@ -1688,35 +2109,43 @@ void CMS_SERVER_REMOTE_TCP_PORT::update_subscriptions()
 		    || temp_clnt_info->subscription_type ==
 		    CMS_VARIABLE_SUBSCRIPTION)
 		&& temp_clnt_info->last_id_read !=
-		server->read_reply->write_id) {
+		server->read_reply->write_id
+		&& !temp_clnt_info->clnt_port->closing
+		&& temp_clnt_info->clnt_port->out_end ==
+		temp_clnt_info->clnt_port->out_start) {
+		/* A client still sending an earlier update gets the
+		   newest one once it catches up. */
+		const char *data = (const char *) server->read_reply->data;
+		int size = server->read_reply->size;
+		int delta_size = -1;
+		if (temp_clnt_info->delta
+		    && temp_clnt_info->delta_base_size > 0
+		    && temp_clnt_info->updates_since_keyframe <
+		    TCP_SRV_DELTA_KEYFRAME_INTERVAL) {
+		    delta_size = subscription_delta(buf_info, temp_clnt_info,
+			data, size);
+		}
 		temp_clnt_info->last_id_read = server->read_reply->write_id;
 		temp_clnt_info->last_sub_sent_time = cur_time;
 		temp_clnt_info->clnt_port->serial_number++;
 		putbe32(temp_buffer, temp_clnt_info->clnt_port->serial_number);
-		if (server->read_reply->size < 0x2000 - 20
-		    && server->read_reply->size > 0) {
-		    memcpy(temp_buffer + 20, server->read_reply->data,
-			server->read_reply->size);
-		    if (sendn
-			(temp_clnt_info->clnt_port->socket_fd, temp_buffer,
-			    20 + server->read_reply->size, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
+		if (delta_size > 0) {
+		    putbe32(temp_buffer + 8, delta_size);
+		    putbe32(temp_buffer + 16, server->read_reply->was_read |
+			CMS_DELTA_UPDATE_FLAG);
+		    temp_clnt_info->updates_since_keyframe++;
 		} else {
-		    if (sendn(temp_clnt_info->clnt_port->socket_fd,
-			    temp_buffer, 20, 0, dtimeout) < 0) {
-			temp_clnt_info->clnt_port->errors++;
-			return;
-		    }
-		    if (server->read_reply->size > 0) {
-			if (sendn(temp_clnt_info->clnt_port->socket_fd,
-				server->read_reply->data,
-				server->read_reply->size, 0, dtimeout) < 0) {
-			    temp_clnt_info->clnt_port->errors++;
-			    return;
-			}
-		    }
+		    putbe32(temp_buffer + 8, size);
+		    putbe32(temp_buffer + 16, server->read_reply->was_read);
+		    temp_clnt_info->updates_since_keyframe = 0;
+		}
+		if (send_reply(temp_clnt_info->clnt_port, temp_buffer, 20,
+			delta_size > 0 ? buf_info->delta_buf : data,
+			delta_size > 0 ? delta_size : size) < 0) {
+		    temp_clnt_info->clnt_port->errors++;
+		}
+		if (temp_clnt_info->delta) {
+		    save_delta_base(temp_clnt_info, data, size);
 		}
 	    }
 	    if (temp_clnt_info->last_id_read < buf_info->min_last_id) {
@@ -1736,6 +2165,11 @@ TCP_BUFFER_SUBSCRIPTION_INFO::TCP_BUFFER_SUBSCRIPTION_INFO()
     min_last_id = 0;
     list_id = -1;
     sub_clnt_info = NULL;
+    delta_buf = NULL;
+    delta_buf_size = 0;
+    delta_size = -1;
+    delta_from_id = 0;
+    delta_valid = 0;
 }
 
 TCP_BUFFER_SUBSCRIPTION_INFO::~TCP_BUFFER_SUBSCRIPTION_INFO()
@@ -1747,6 +2181,10 @@ TCP_BUFFER_SUBSCRIPTION_INFO::~TCP_BUFFER_SUBSCRIPTION_INFO()
 	delete sub_clnt_info;
 	sub_clnt_info = NULL;
     }
+    if (NULL != delta_buf) {
+	free(delta_buf);
+	delta_buf = NULL;
+    }
 }
 
 TCP_CLIENT_SUBSCRIPTION_INFO::TCP_CLIENT_SUBSCRIPTION_INFO()
@@ -1758,6 +2196,11 @@ TCP_CLIENT_SUBSCRIPTION_INFO::TCP_CLIENT_SUBSCRIPTION_INFO()
     buffer_number = -1;
     subscription_paused = 0;
     last_id_read = 0;
+    delta = 0;
+    delta_base = NULL;
+    delta_base_size = 0;
+    delta_base_alloc = 0;
+    updates_since_keyframe = 0;
     sub_buf_info = NULL;
     clnt_port = NULL;
 }
@@ -1771,6 +2214,10 @@ TCP_CLIENT_SUBSCRIPTION_INFO::~TCP_CLIENT_SUBSCRIPTION_INFO()
     buffer_number = -1;
     subscription_paused = 0;
     last_id_read = 0;
+    if (NULL != delta_base) {
+	free(delta_base);
+	delta_base = NULL;
+    }
     sub_buf_info = NULL;
     clnt_port = NULL;
 }
@@ -1787,9 +2234,19 @@ CLIENT_TCP_PORT::CLIENT_TCP_PORT()
     subscriptions = NULL;
     tid = -1;
     pid = -1;
+    blocking = 0;
+    blocking_deadline = -1.0;
+    blocking_notify = NULL;
+    blocking_seen = 0;
     blocking_read_req = NULL;
-    threadId = 0;
     diag_info = NULL;
+    in_buf = NULL;
+    in_size = in_start = in_end = 0;
+    out_buf = NULL;
+    out_size = out_start = out_end = 0;
+    corked = 0;
+    watching_output = 0;
+    closing = 0;
 }
 
 CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
@@ -1809,14 +2266,20 @@ CLIENT_TCP_PORT::~CLIENT_TCP_PORT()
 	delete subscriptions;
 	subscriptions = NULL;
     }
-#ifdef NO_THREADS
     if (NULL != blocking_read_req) {
 	delete blocking_read_req;
 	blocking_read_req = NULL;
     }
-#endif
     if (NULL != diag_info) {
 	delete diag_info;
 	diag_info = NULL;
     }
+    if (NULL != in_buf) {
+	free(in_buf);
+	in_buf = NULL;
+    }
+    if (NULL != out_buf) {
+	free(out_buf);
+	out_buf = NULL;
+    }
 }
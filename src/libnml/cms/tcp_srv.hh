@@ -18,6 +18,7 @@
 #include "cms_srv.hh"		/* class CMS_SERVER_REMOTE_PORT */
 #include "linklist.hh"		/* class LinkedList */
 #include "rem_msg.hh"
+#include "notify.hh"		/* struct RCS_NOTIFY */
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,20 +29,30 @@ extern "C" {
 #include <errno.h>		/* errno */
 #include <signal.h>		// SIGPIPE, signal()
 #include <sys/time.h>           /* struct timeval */
+#include <sys/uio.h>		/* struct iovec */
+#include <pthread.h>		/* pthread_t */
 
 #ifdef __cplusplus
 }
 #endif
 
-#ifndef NO_THREADS
-#define NO_THREADS
+#define MAX_TCP_BUFFER_SIZE 16
 
-#ifdef POSIX_THREADS
-#include <pthread.h>
-#endif
-#endif
+/* Replies queued for a client that is not reading them are dropped, and
+   the client disconnected, past this many bytes. */
+#define TCP_SRV_MAX_BACKLOG (4*1024*1024)
+
+/* How often pending blocking reads look for new data, in microseconds,
+   when their buffer has no "notify" to wake them. */
+#define TCP_SRV_BLOCKING_POLL_USEC 200
+
+/* Most buffers whose writes the write watcher waits for at once; reads
+   on any more are polled. */
+#define TCP_SRV_MAX_WATCHED 63
+
+/* Delta subscribers get the whole message at least this often. */
+#define TCP_SRV_DELTA_KEYFRAME_INTERVAL 100
 
-#define MAX_TCP_BUFFER_SIZE 16
 class CLIENT_TCP_PORT;
 
 class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
@@ -54,9 +65,28 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     void unregister_port();
     double dtimeout;
   protected:
-      fd_set read_fd_set, write_fd_set;
     void handle_request(CLIENT_TCP_PORT *);
-    int maxfdpl;
+    int epoll_fd;
+    int blocking_timer_fd;	/* Polls or times out blocking reads */
+    int blocking_timer_armed;	/* 0 off, 1 polling, 2 at the deadline */
+    double blocking_timer_deadline;
+    int blocking_reads_pending;
+    int check_blocking;		/* Look at the blocking reads again? */
+    /* The write watcher thread waits on the RCS_NOTIFY blocks of the
+       buffers with pending blocking reads, and writes to watch_fd when
+       one of them is written.  It only waits; run() does the reading. */
+    int watch_fd;
+    pthread_t watch_thread;
+    int watch_started;
+    volatile int watch_failed;	/* Can it not wait, so reads are polled? */
+    volatile int watch_stop;
+    int watch_signalled;	/* It is waiting for a new list */
+    pthread_mutex_t watch_mutex;
+    RCS_NOTIFY watch_control;	/* Posted when the list below changes */
+    RCS_NOTIFY *watch_notify[TCP_SRV_MAX_WATCHED];
+    unsigned int watch_seen[TCP_SRV_MAX_WATCHED];
+    int watch_len;
+    int clients_closing;	/* Has any client been marked closing? */
     LinkedList *client_ports;
     LinkedList *subscription_buffers;
     int connection_socket;
@@ -69,10 +99,26 @@ class CMS_SERVER_REMOTE_TCP_PORT:public CMS_SERVER_REMOTE_PORT {
     struct timeval select_timeout;
     void update_subscriptions();
     void add_subscription_client(int buffer_number, int subscription_type,
-	int poll_interval_millis, CLIENT_TCP_PORT * clnt);
+	int poll_interval_millis, CLIENT_TCP_PORT * clnt, int delta = 0);
     void remove_subscription_client(CLIENT_TCP_PORT * clnt,
 	int buffer_number);
     void recalculate_polling_interval();
+    void accept_clients();
+    void remove_client(CLIENT_TCP_PORT *);
+    void read_client(CLIENT_TCP_PORT *);
+    int request_size(CLIENT_TCP_PORT *, CMS_SERVER *);
+    int read_request_bytes(CLIENT_TCP_PORT *, char *, int);
+    int send_reply(CLIENT_TCP_PORT *, const void *header, int header_size,
+	const void *data = NULL, int data_size = 0);
+    int flush_client(CLIENT_TCP_PORT *);
+    void watch_client_output(CLIENT_TCP_PORT *, int);
+    void start_write_watch();
+    void stop_write_watch();
+    static void *write_watch(void *);
+    void arm_blocking_wakeups();
+    void arm_blocking_timer(int poll, double deadline);
+    void check_blocking_reads();
+    int check_blocking_read(CLIENT_TCP_PORT *, CMS_SERVER *);
     void switch_function(CLIENT_TCP_PORT *
 	_client_tcp_port,
 	CMS_SERVER * server, long request_type, long buffer_number, long
@@ -87,6 +133,11 @@ class TCP_BUFFER_SUBSCRIPTION_INFO {
     int min_last_id;
     int list_id;
     LinkedList *sub_clnt_info;
+    char *delta_buf;		/* Delta computed during this update */
+    int delta_buf_size;
+    int delta_size;		/* or -1 if a keyframe is smaller */
+    int delta_from_id;		/* write_id the delta is relative to */
+    int delta_valid;
 };
 
 class TCP_CLIENT_SUBSCRIPTION_INFO {
@@ -100,6 +151,10 @@ class TCP_CLIENT_SUBSCRIPTION_INFO {
     int buffer_number;
     int subscription_paused;
     int last_id_read;
+    int delta;			/* Send only the changed byte ranges? */
+    char *delta_base;		/* Copy of the update last sent */
+    int delta_base_size, delta_base_alloc;
+    int updates_since_keyframe;
     TCP_BUFFER_SUBSCRIPTION_INFO *sub_buf_info;
     CLIENT_TCP_PORT *clnt_port;
 };
@@ -117,14 +172,19 @@ class CLIENT_TCP_PORT {
     LinkedList *subscriptions;
     pid_t tid;
     pid_t pid;
-    int blocking;
-#ifdef POSIX_THREADS
-    pthread_t threadId;
-#else
-    int threadId;
-#endif
+    int blocking;		/* Is blocking_read_req waiting for data? */
+    double blocking_deadline;	/* etime() to give up at, or -1 */
+    RCS_NOTIFY *blocking_notify;	/* of its buffer, or NULL */
+    unsigned int blocking_seen;	/* blocking_notify->seq at the last check */
     TCPSVR_BLOCKING_READ_REQUEST *blocking_read_req;
     REMOTE_SET_DIAG_INFO_REQUEST *diag_info;
+    char *in_buf;		/* Bytes received but not yet handled */
+    int in_size, in_start, in_end;
+    char *out_buf;		/* Replies the socket could not take yet */
+    int out_size, out_start, out_end;
+    int corked;			/* Queue replies until the batch is done */
+    int watching_output;	/* Is EPOLLOUT enabled? */
+    int closing;		/* Remove once the current event is done */
 
 };
 
@@ -39,6 +39,8 @@ extern "C" {
 #include "linklist.hh"		/* class LinkedList */
 #include "rcs_print.hh"		/* rcs_print_error() */
 #include "physmem.hh"
+#include "notify.hh"		/* rcs_notify_wait_any(), RCS_NOTIFY_FOREVER */
+#include "cms_stats.hh"		/* CMS_STATS_TIMER */
 #ifndef MAXHOSTNAMELEN
 #define MAXHOSTNAMELEN 64
 #endif
@@ -1385,6 +1387,84 @@ NMLTYPE NML::peek()
 
 }
 
+/***********************************************************
+* NML Member Function: peek_view()
+* Purpose: Like peek(), but for a buffer marked "zerocopy" in the
+* config file the message is not copied: get_view() returns its
+* address in the shared memory buffer, which must not be written to.
+* The writer may reuse that memory after two more writes, so callers
+* should copy what they need and then check view_valid(), trying
+* again if it returns 0.  For other buffers this is peek(), and
+* get_view() returns get_address().
+* Returns:
+*  0 The message at get_view() was already seen.
+*  -1 The buffer could not be read.
+*  o.w. The type of the new NMLmsg.
+***********************************************************/
+NMLTYPE NML::peek_view()
+{
+    error_type = NML_NO_ERROR;
+    if (NULL == cms) {
+	if (error_type != NML_INVALID_CONFIGURATION) {
+	    error_type = NML_INVALID_CONFIGURATION;
+	    rcs_print_error("NML::peek_view: CMS not configured.\n");
+	}
+	return (-1);
+    }
+    if (!cms->zero_copy) {
+	NMLTYPE type = peek();
+	cms->view_data = cms->subdiv_data;
+	return type;
+    }
+
+    cms->peek_view();
+    switch (cms->status) {
+    case CMS_READ_OLD:
+	return (0);
+    case CMS_READ_OK:
+	if (((NMLmsg *) cms->view_data)->type <= 0) {
+	    rcs_print_error
+		("NML: New data received but type of %d is invalid.\n",
+		(int)((NMLmsg *) cms->view_data)->type);
+	    return -1;
+	}
+	return (((NMLmsg *) cms->view_data)->type);
+
+    default:
+	set_error();
+	return -1;
+    }
+}
+
+NMLmsg *NML::get_view()
+{
+    if (NULL == cms) {
+	error_type = NML_INVALID_CONFIGURATION;
+	return ((NMLmsg *) NULL);
+    }
+    return ((NMLmsg *) cms->view_data);
+}
+
+int NML::view_valid()
+{
+    if (NULL == cms) {
+	return 0;
+    }
+    return cms->view_valid();
+}
+
+/* Wait for timeout seconds, or until the buffer is written. Only local
+   buffers with "notify" wake early, and only they can wait
+   RCS_NOTIFY_FOREVER. A negative timeout is 0 otherwise. Returns 1 if
+   the buffer was written, 0 on timeout, or -1 on error. */
+int NML::wait_for_write(double timeout)
+{
+    if (NULL == cms) {
+	return -1;
+    }
+    return cms->wait_for_write(timeout);
+}
+
 /***********************************************************
 * NML Member Function: format_output()
 * Purpose: Formats the data read from a CMS buffer as required
@@ -1430,6 +1510,10 @@ int NML::format_output()
 	new_type = forced_type;
     }
 
+    /* Time the decoding of buffers with stats. */
+    CMS_STATS_TIMER stats_timer(cms->mode == CMS_DECODE ? cms->stats : NULL,
+	1);
+
     switch (cms->mode) {
     case CMS_RAW_OUT:
 	break;
@@ -1484,6 +1568,9 @@ int NML::format_output()
 		    }
 		    return (-1);
 		}
+		if (-1 == cms->check_decoded_msg()) {
+		    return (-1);
+		}
 	    }
 	}
 	break;
@@ -1842,6 +1929,10 @@ int NML::format_input(NMLmsg * nml_msg)
 	cms->mode = CMS_RAW_IN;
     }
 
+    /* Time the encoding of buffers with stats. */
+    CMS_STATS_TIMER stats_timer(cms->mode == CMS_ENCODE ? cms->stats : NULL,
+	0);
+
     switch (cms->mode) {
     case CMS_RAW_IN:
 	/* Make sure the message size is not larger than the buffer size. */
@@ -1927,6 +2018,9 @@ int NML::format_input(NMLmsg * nml_msg)
 		    cms->BufferName, cms->ProcessName);
 		return (-1);
 	    }
+	    if (-1 == cms->check_decoded_msg()) {
+		return (-1);
+	    }
 	}
 	/* Choose a size that will ensure the entire message will be read
 	   out. */
@@ -2090,6 +2184,102 @@ NMLTYPE NML::str2msg(const char *string)
 
 }
 
+/* Returns the CMS used to pack messages for msg2bin() and bin2msg(), big
+   enough for messages of up to length bytes. Unlike msg2str() this never
+   uses the channel's own CMS, which is raw for local buffers. */
+CMS *NML::get_bin_conversion_cms(long length)
+{
+    if (NULL != cms_for_msg_string_conversions &&
+	cms_for_msg_string_conversions->size < 4 * length) {
+	delete cms_for_msg_string_conversions;
+	cms_for_msg_string_conversions = 0;
+    }
+    if (NULL == cms_for_msg_string_conversions) {
+	cms_for_msg_string_conversions =
+	    new CMS(length * 4 + 16 + (16 - (length % 16)));
+    }
+    /* Packed messages carry a hash of their layout, so a log replayed by
+       a build with other message definitions is rejected. */
+    cms_for_msg_string_conversions->schema_hash = 1;
+    return cms_for_msg_string_conversions;
+}
+
+/**************************************************************************
+* NML member function: msg2bin
+* Parameter: NMLmsg *msg -- Pointer to message to be packed.
+* Parameter: long *size -- Set to the size of the packed message.
+* Returns: Returns a pointer to the packed message, valid until the next
+* conversion, or NULL if there was an error.
+***************************************************************************/
+const void *NML::msg2bin(NMLmsg * nml_msg, long *size)
+{
+    CMS *orig_cms = cms;
+    if (NULL == nml_msg) {
+	return NULL;
+    }
+    long length = nml_msg->size;
+    if (NULL != cms && cms->max_message_size > length) {
+	length = cms->max_message_size;
+    }
+    cms = get_bin_conversion_cms(length);
+    cms->set_temp_updater(CMS_PACKED_ENCODING);
+    cms->set_mode(CMS_ENCODE);
+    if (-1 == format_input(nml_msg)) {
+	cms->restore_normal_updater();
+	error_type = NML_FORMAT_ERROR;
+	cms = orig_cms;
+	return NULL;
+    }
+    cms->restore_normal_updater();
+    if (NULL != size) {
+	*size = cms->header.in_buffer_size;
+    }
+    const void *data = cms->encoded_data;
+    cms = orig_cms;
+    return data;
+}
+
+/**************************************************************************
+* NML member function: bin2msg
+* Parameter: const void *data -- A message packed by msg2bin().
+* Parameter: long size -- Size of the packed message.
+* Returns: Returns a pointer to the unpacked message, valid until the next
+* conversion, or NULL if there was an error.
+***************************************************************************/
+NMLmsg *NML::bin2msg(const void *data, long size)
+{
+    CMS *orig_cms = cms;
+    if (NULL == data || size <= 0) {
+	return NULL;
+    }
+    long length = size;
+    if (NULL != cms && cms->max_message_size > length) {
+	length = cms->max_message_size;
+    }
+    cms = get_bin_conversion_cms(length);
+    if (size > cms->max_encoded_message_size) {
+	error_type = NML_FORMAT_ERROR;
+	cms = orig_cms;
+	return NULL;
+    }
+    cms->set_temp_updater(CMS_PACKED_ENCODING);
+    cms->set_mode(CMS_DECODE);
+    memcpy(cms->encoded_data, data, size);
+    cms->header.in_buffer_size = size;
+    cms->status = CMS_READ_OK;
+    if (-1 == format_output() || cms->status != CMS_READ_OK) {
+	cms->restore_normal_updater();
+	error_type = NML_FORMAT_ERROR;
+	cms = orig_cms;
+	return NULL;
+    }
+    cms->restore_normal_updater();
+    NMLmsg *msg = (NMLmsg *) cms->subdiv_data;
+    cms = orig_cms;
+    error_type = NML_NO_ERROR;
+    return msg;
+}
+
 static int info_message_printed = 0;
 char cwd_buf[256];
 char host_name_buf[MAXHOSTNAMELEN];
@@ -2442,6 +2632,50 @@ NML_DIAGNOSTICS_INFO *NML::get_diagnostics_info()
     return (NML_DIAGNOSTICS_INFO *) cms->get_diagnostics_info();
 }
 
+/* Most channels waited on at once by nmlWaitAny(). */
+#define NML_WAIT_ANY_MAX 64
+
+/* How long nmlWaitAny() sleeps when it can not wait on every channel. */
+#define NML_WAIT_ANY_POLL_INTERVAL 0.01
+
+/* Wait until any of the n channels is written after its last read or
+   peek, or for timeout seconds (or RCS_NOTIFY_FOREVER). Returns the index
+   of a channel that was written, or -1 otherwise. If any channel has no
+   "notify", or the kernel lacks futex_waitv(), this sleeps for at most
+   NML_WAIT_ANY_POLL_INTERVAL and returns -1, so callers must still check
+   every channel. */
+int nmlWaitAny(NML ** channels, int n, double timeout)
+{
+    RCS_NOTIFY *notify[NML_WAIT_ANY_MAX];
+    unsigned int seen[NML_WAIT_ANY_MAX];
+    int i;
+
+    for (i = 0; i < n && i < NML_WAIT_ANY_MAX; i++) {
+	if (NULL == channels[i] || NULL == channels[i]->cms) {
+	    break;
+	}
+	notify[i] = channels[i]->cms->get_notify(&seen[i]);
+	if (NULL == notify[i]) {
+	    break;
+	}
+    }
+    if (n == 1 && i == n) {
+	return rcs_notify_wait(notify[0], seen[0], timeout) == 0 ? 0 : -1;
+    }
+    if (n > 0 && i == n) {
+	int ret = rcs_notify_wait_any(notify, seen, n, timeout);
+	if (ret != -3) {
+	    return ret >= 0 ? ret : -1;
+	}
+    }
+    if (timeout == RCS_NOTIFY_FOREVER
+	|| timeout > NML_WAIT_ANY_POLL_INTERVAL) {
+	timeout = NML_WAIT_ANY_POLL_INTERVAL;
+    }
+    esleep(timeout);
+    return -1;
+}
+
 void nmlSetHostAlias(const char *hostName, const char *hostAlias)
 {
     if (NULL == cmsHostAliases) {
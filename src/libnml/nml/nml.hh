@@ -97,6 +97,13 @@ class NML:public virtual CMS_USER {
     NMLTYPE peek();		/* Read buffer without changing was_read */
     NMLTYPE read(void *, long);
     NMLTYPE peek(void *, long);
+    NMLTYPE peek_view();	/* Peek without copying from a zerocopy
+				   buffer; the message is at get_view(). */
+    NMLmsg *get_view();
+    int view_valid();		/* Is the message at get_view() still
+				   intact? */
+    int wait_for_write(double timeout);	/* Wait until written after the
+					   last read or peek. */
     int write(NMLmsg & nml_msg, int *serial_number = NULL);	/* Write a message. (Use reference) */
     int write(NMLmsg * nml_msg, int *serial_number = NULL);	/* Write a message. (Use pointer) */
     int write_if_read(NMLmsg & nml_msg, int *serial_number = NULL);	/* Write only if buffer
@@ -139,6 +146,8 @@ class NML:public virtual CMS_USER {
     const char *msg2str(NMLmsg & nml_msg);
     const char *msg2str(NMLmsg * nml_msg);
     NMLTYPE str2msg(const char *);
+    const void *msg2bin(NMLmsg * nml_msg, long *size);
+    NMLmsg *bin2msg(const void *data, long size);
     int login(const char *name, const char *passwd);
     void reconnect();
     void disconnect();
@@ -205,6 +214,7 @@ class NML:public virtual CMS_USER {
     char cfgfilename[160];
     double blocking_read_poll_interval;
     CMS *cms_for_msg_string_conversions;
+    CMS *get_bin_conversion_cms(long length);
     int registered_with_server;
 
       NML(NML & nml);		// Don't copy me.
@@ -225,7 +235,9 @@ extern "C" {
     extern void nmlAllowNormalConnection();
     extern void nmlForceRemoteConnection();
     extern void nmlForceLocalConnection();
-} extern int verbose_nml_error_messages;
+}
+extern int nmlWaitAny(NML ** channels, int n, double timeout);
+extern int verbose_nml_error_messages;
 extern int nml_print_hostname_on_error;
 extern int nml_reset_errors_printed;
 
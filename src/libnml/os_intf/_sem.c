@@ -39,6 +39,7 @@ typedef int rcs_sem_t;
 #define rcs_sem_t_defined
 
 #include "_sem.h"
+#include "_shm.h"		/* rcs_instance_key() */
 #include "_timer.h"		/* etime() */
 #include "rcs_print.hh"
 
@@ -116,6 +117,7 @@ rcs_sem_t *rcs_sem_open(key_t name, int oflag, /* int mode */ ...)
 	rcs_print_error("rcs_sem_open: invalid key %jd\n", (intmax_t)key);
 	return NULL;
     }
+    key = rcs_instance_key(key);
 
     if ((semid = (rcs_sem_t) semget((key_t) key, 1, semflg)) == -1) {
 	rcs_print_error("semget");
@@ -33,6 +33,7 @@
 #include <sys/mman.h>
 #else
 #include <sys/shm.h>
+#include "rtapi_shmpages.h"	/* RTAPI_HUGEPAGES */
 #endif
 
 #include <string.h>
@@ -40,6 +41,30 @@
 static int shmems_created_list[100];
 static int shmems_created_list_initialized = 0;
 
+/* Several simulated machines can run side by side if each one sets
+   RTAPI_INSTANCE to a different number (1-255).  The instance number is
+   folded into the top byte of every key, so the buffers of one machine
+   never collide with those of another.  Instance 0 (the default) leaves
+   the keys unchanged. */
+int rcs_instance_number(void)
+{
+    static int instance = -1;
+    if (instance < 0) {
+	const char *s = getenv("RTAPI_INSTANCE");
+	instance = s ? atoi(s) : 0;
+	if (instance < 0 || instance > 255) {
+	    rcs_print_error("RTAPI_INSTANCE must be between 0 and 255\n");
+	    instance = 0;
+	}
+    }
+    return instance;
+}
+
+key_t rcs_instance_key(key_t key)
+{
+    return key ^ (rcs_instance_number() << 24);
+}
+
 shm_t *rcs_shm_open(key_t key, size_t size, int oflag, /* int mode */ ...)
 {
     va_list ap;
@@ -56,6 +81,7 @@ shm_t *rcs_shm_open(key_t key, size_t size, int oflag, /* int mode */ ...)
 
     int pid;
     int i;
+    int hugeerr;
 #endif
 
     va_start(ap, oflag);
@@ -200,7 +226,13 @@ shm_t *rcs_shm_open(key_t key, size_t size, int oflag, /* int mode */ ...)
 
     shm->size = size;
 
-    if ((shm->id = shmget(key, (int) size, shmflg)) == -1) {
+    shm->id = rtapi_shm_get(rcs_instance_key(key), size, shmflg, &hugeerr);
+    if (hugeerr) {
+	rcs_print_debug(PRINT_SHARED_MEMORY_ACTIVITY,
+	    "no huge pages for key %d(0x%X): %s\n", key, key,
+	    strerror(hugeerr));
+    }
+    if (shm->id == -1) {
 	shm->create_errno = errno;
 	rcs_print_error("shmget(%d(0x%X),%zd,%d) failed: (errno = %d): %s\n",
 	    key, key, size, shmflg, errno, strerror(errno));
@@ -239,6 +271,8 @@ shm_t *rcs_shm_open(key_t key, size_t size, int oflag, /* int mode */ ...)
 	shm->addr = NULL;
 	return (shm);
     }
+    /* fault the whole buffer in now rather than on first use */
+    rtapi_shm_prefault(shm->addr, size, rtapi_shm_pagesize(shm->addr));
 
     /* Check to see if I am the creator of this shared memory buffer. */
     if (shmctl(shm->id, IPC_STAT, &shared_mem_info) < 0) {
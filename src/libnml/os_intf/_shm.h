@@ -44,6 +44,10 @@ extern "C" {
     extern int rcs_shm_close(shm_t * shm);
     extern int rcs_shm_delete(shm_t * shm);
     extern int rcs_shm_nattch(shm_t * shm);
+    /* RTAPI_INSTANCE namespacing, shared with the semaphores and the
+       TCP server ports */
+    extern int rcs_instance_number(void);
+    extern key_t rcs_instance_key(key_t key);
 
 #ifdef __cplusplus
 }
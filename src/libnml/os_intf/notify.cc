@@ -0,0 +1,142 @@
+/********************************************************************
+* Description: notify.cc
+*   Futex based notification of writes to shared memory buffers.
+*
+*   A waiter counts itself in waiters before checking seq, and a writer
+*   bumps seq before looking at waiters, so either the writer sees the
+*   waiter and wakes it or the waiter sees the new seq. Writers make no
+*   system call while nobody waits.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+extern "C" {
+#include <errno.h>		/* errno */
+#include <limits.h>		/* INT_MAX */
+#include <stdint.h>		/* uintptr_t */
+#include <time.h>		/* clock_gettime() */
+#include <unistd.h>		/* syscall() */
+#include <sys/syscall.h>	/* SYS_futex */
+#include <linux/futex.h>	/* FUTEX_WAIT, FUTEX_WAKE */
+}
+#include "notify.hh"
+
+static double monotonic_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void to_timespec(double t, struct timespec *ts)
+{
+    ts->tv_sec = (time_t) t;
+    ts->tv_nsec = (long) ((t - ts->tv_sec) * 1e9);
+}
+
+void rcs_notify_post(RCS_NOTIFY * notify)
+{
+    __sync_fetch_and_add(&notify->seq, 1);
+    if (notify->waiters) {
+	syscall(SYS_futex, &notify->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+static int forever(double timeout)
+{
+    return timeout == RCS_NOTIFY_FOREVER;
+}
+
+int rcs_notify_wait(RCS_NOTIFY * notify, unsigned int seen, double timeout)
+{
+    double deadline = monotonic_now() + (timeout > 0 ? timeout : 0);
+    struct timespec ts;
+    int retval = 0;
+
+    __sync_fetch_and_add(&notify->waiters, 1);
+    while (notify->seq == seen) {
+	struct timespec *tsp = NULL;
+	if (!forever(timeout)) {
+	    double left = deadline - monotonic_now();
+	    if (left <= 0) {
+		retval = -2;
+		break;
+	    }
+	    to_timespec(left, &ts);
+	    tsp = &ts;
+	}
+	/* After EINTR the loop waits again for whatever time is left. */
+	if (syscall(SYS_futex, &notify->seq, FUTEX_WAIT, seen, tsp, NULL,
+		0) < 0) {
+	    if (errno != EAGAIN && errno != ETIMEDOUT && errno != EINTR) {
+		retval = -1;
+		break;
+	    }
+	}
+    }
+    __sync_fetch_and_sub(&notify->waiters, 1);
+    return retval;
+}
+
+int rcs_notify_wait_any(RCS_NOTIFY ** notify, const unsigned int *seen,
+    int n, double timeout)
+{
+#if defined(SYS_futex_waitv) && defined(FUTEX_32)
+    struct futex_waitv waiters[FUTEX_WAITV_MAX];
+    struct timespec ts;
+    int retval = -2;
+    int i;
+
+    if (n < 1 || n > FUTEX_WAITV_MAX) {
+	return -1;
+    }
+    for (i = 0; i < n; i++) {
+	waiters[i].val = seen[i];
+	waiters[i].uaddr = (uintptr_t) & notify[i]->seq;
+	waiters[i].flags = FUTEX_32;
+	waiters[i].__reserved = 0;
+	__sync_fetch_and_add(&notify[i]->waiters, 1);
+    }
+    /* futex_waitv() takes an absolute CLOCK_MONOTONIC timeout, so after
+       EINTR the same one still holds. */
+    to_timespec(monotonic_now() + (timeout > 0 ? timeout : 0), &ts);
+    while (1) {
+	for (i = 0; i < n; i++) {
+	    if (notify[i]->seq != seen[i]) {
+		break;
+	    }
+	}
+	if (i < n) {
+	    retval = i;
+	    break;
+	}
+	if (syscall(SYS_futex_waitv, waiters, n, 0,
+		forever(timeout) ? NULL : &ts, CLOCK_MONOTONIC) < 0) {
+	    if (errno == ENOSYS) {
+		retval = -3;
+		break;
+	    }
+	    if (errno == ETIMEDOUT) {
+		retval = -2;
+		break;
+	    }
+	    if (errno != EAGAIN && errno != EINTR) {
+		retval = -1;
+		break;
+	    }
+	}
+    }
+    for (i = 0; i < n; i++) {
+	__sync_fetch_and_sub(&notify[i]->waiters, 1);
+    }
+    return retval;
+#else
+    return -3;
+#endif
+}
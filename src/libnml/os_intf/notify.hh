@@ -0,0 +1,40 @@
+/********************************************************************
+* Description: notify.hh
+*   Futex based notification of writes to shared memory buffers.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2004 All rights reserved.
+*
+* Last change:
+********************************************************************/
+#ifndef NOTIFY_HH
+#define NOTIFY_HH
+
+/* Lives in shared memory next to the buffer it belongs to. Writers bump
+   seq, and wake the processes waiting on it if there are any. */
+struct RCS_NOTIFY {
+    volatile unsigned int seq;
+    volatile unsigned int waiters;
+};
+
+/* The timeout that never expires. Any other negative timeout is 0. */
+#define RCS_NOTIFY_FOREVER (-1.0)
+
+extern void rcs_notify_post(RCS_NOTIFY * notify);
+
+/* Wait until notify->seq differs from seen, or for timeout seconds.
+   Signals do not end the wait early. Returns 0 once seq changed, -2 on
+   timeout, or -1 on error. */
+extern int rcs_notify_wait(RCS_NOTIFY * notify, unsigned int seen,
+    double timeout);
+
+/* Wait on n blocks at once. Returns the index of one whose seq differs
+   from seen[], -2 on timeout, -1 on error, or -3 if the kernel can not
+   wait on several futexes. */
+extern int rcs_notify_wait_any(RCS_NOTIFY ** notify,
+    const unsigned int *seen, int n, double timeout);
+
+#endif /* NOTIFY_HH */
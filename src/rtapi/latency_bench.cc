@@ -0,0 +1,592 @@
+/* Copyright (C) 2019 the LinuxCNC developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* latency-bench: reproducible wakeup latency benchmark for uspace realtime.
+ *
+ * Runs a set of periodic threads, each woken by one of the timer strategies
+ * below, optionally while synthetic load threads keep the machine busy, and
+ * records a histogram of how late each thread woke up.  At the end a report
+ * is written in JSON so that runs on different machines, kernels or BIOS
+ * settings can be compared by a script.
+ *
+ * Unlike latency-test, this does not need HAL or a running realtime
+ * environment; the "abs" strategy waits exactly the way rtapi_app's
+ * Posix::wait() does.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define BENCH_CLOCK (CLOCK_MONOTONIC)
+#define REPORT_VERSION 1
+
+namespace
+{
+
+enum strategy_t { STRAT_ABS, STRAT_REL, STRAT_TIMERFD, STRAT_SPIN };
+const char *strategy_names[] = { "abs", "rel", "timerfd", "spin" };
+
+enum load_t { LOAD_CACHE, LOAD_FP, LOAD_IO };
+const char *load_names[] = { "cache", "fp", "io" };
+
+struct bench_thread
+{
+    std::string name;
+    long period;                /* nanoseconds */
+    strategy_t strategy;
+    int prio;
+    int cpu;
+    pthread_t thr;
+    int policy;                 /* policy actually obtained */
+
+    /* results, only touched by the thread until it is joined */
+    long long samples, missed;
+    long long min, max;
+    double sum, sumsq;
+    std::vector<long long> hist;
+    long long overflow;
+};
+
+struct bench_load
+{
+    load_t kind;
+    int count;
+};
+
+volatile sig_atomic_t stop;
+long bin_width = 1000;          /* histogram bin width, ns */
+int num_bins = 1000;
+const char *io_dir = "/tmp";
+
+void quit(int)
+{
+    stop = 1;
+}
+
+long long ts_to_ns(const struct timespec &ts)
+{
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct timespec ns_to_ts(long long ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    return ts;
+}
+
+long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(BENCH_CLOCK, &ts);
+    return ts_to_ns(ts);
+}
+
+void record(bench_thread *t, long long latency)
+{
+    t->samples++;
+    if(latency < t->min) t->min = latency;
+    if(latency > t->max) t->max = latency;
+    t->sum += latency;
+    t->sumsq += (double)latency * latency;
+    long long bin = latency < 0 ? 0 : latency / bin_width;
+    if(bin < num_bins) t->hist[bin]++;
+    else t->overflow++;
+}
+
+void *bench_main(void *arg)
+{
+    bench_thread *t = reinterpret_cast<bench_thread*>(arg);
+    int tfd = -1;
+    long long target = now_ns() + t->period;
+
+#ifdef __linux__
+    if(t->strategy == STRAT_TIMERFD) {
+        struct itimerspec its;
+        tfd = timerfd_create(BENCH_CLOCK, 0);
+        if(tfd < 0) { perror("timerfd_create"); stop = 1; return NULL; }
+        its.it_value = ns_to_ts(target);
+        its.it_interval = ns_to_ts(t->period);
+        if(timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+            perror("timerfd_settime"); stop = 1; return NULL;
+        }
+    }
+#endif
+
+    while(!stop) {
+        switch(t->strategy) {
+        case STRAT_ABS: {
+            struct timespec ts = ns_to_ts(target);
+            while(clock_nanosleep(BENCH_CLOCK, TIMER_ABSTIME, &ts, NULL) == EINTR
+                    && !stop) {}
+            break;
+        }
+        case STRAT_REL: {
+            long long delta = target - now_ns();
+            if(delta > 0) {
+                struct timespec ts = ns_to_ts(delta);
+                clock_nanosleep(BENCH_CLOCK, 0, &ts, NULL);
+            }
+            break;
+        }
+        case STRAT_TIMERFD: {
+            uint64_t expirations;
+            if(read(tfd, &expirations, sizeof(expirations)) < 0
+                    && errno != EINTR) {
+                perror("read timerfd");
+                stop = 1;
+            }
+            break;
+        }
+        case STRAT_SPIN:
+            while(now_ns() < target && !stop) {}
+            break;
+        }
+        long long latency = now_ns() - target;
+        record(t, latency);
+        target += t->period;
+        /* like rtapi_app, a wakeup that is a whole period late has missed
+           a deadline; keep the original phase instead of catching up */
+        if(latency >= t->period) {
+            long long skip = latency / t->period;
+            t->missed += skip;
+            target += skip * t->period;
+        }
+    }
+    if(tfd >= 0) close(tfd);
+    return NULL;
+}
+
+/* the loads run with normal priority and never stop to look at the clock */
+
+void *load_cache(void *)
+{
+    /* bigger than any last level cache, touched one line at a time */
+    size_t size = 64 << 20;
+    volatile char *buf = reinterpret_cast<volatile char*>(malloc(size));
+    if(!buf) return NULL;
+    unsigned x = 1;
+    while(!stop) {
+        for(size_t i = 0; i < size && !stop; i += 64) {
+            x = x * 1103515245 + 12345;
+            buf[(i + (x & 0xfc0)) % size] += 1;
+        }
+    }
+    free((void*)buf);
+    return NULL;
+}
+
+void *load_fp(void *)
+{
+    volatile double acc = 0;
+    double x = 0;
+    while(!stop) {
+        for(int i = 0; i < 100000; i++) {
+            x += 1e-6;
+            acc += sin(x) * sqrt(x) / (1.0 + cos(x) * cos(x));
+        }
+    }
+    return NULL;
+}
+
+void *load_io(void *)
+{
+    std::string tmpl = std::string(io_dir) + "/latency-bench.XXXXXX";
+    std::vector<char> name(tmpl.begin(), tmpl.end());
+    name.push_back('\0');
+    int fd = mkstemp(&name[0]);
+    if(fd < 0) { perror(tmpl.c_str()); return NULL; }
+    unlink(&name[0]);
+    std::vector<char> block(1 << 20, 'x');
+    while(!stop) {
+        for(int i = 0; i < 16 && !stop; i++) {
+            if(write(fd, &block[0], block.size()) < 0) break;
+        }
+        fsync(fd);
+        if(lseek(fd, 0, SEEK_SET) < 0) break;
+    }
+    close(fd);
+    return NULL;
+}
+
+void *(*load_funcs[])(void *) = { load_cache, load_fp, load_io };
+
+/* same choice of CPU as rtapi_app: RTAPI_CPU_NUMBER, else the last one
+   we are allowed to run on (the one most likely to be isolated) */
+int default_cpu()
+{
+    if(getenv("RTAPI_CPU_NUMBER")) return atoi(getenv("RTAPI_CPU_NUMBER"));
+#ifdef __linux__
+    cpu_set_t cpuset;
+    if(sched_getaffinity(0, sizeof(cpuset), &cpuset) < 0) return -1;
+    for(int i = CPU_SETSIZE - 1; i >= 0; i--)
+        if(CPU_ISSET(i, &cpuset)) return i;
+#endif
+    return -1;
+}
+
+int start_thread(pthread_t *thr, void *(*func)(void *), void *arg,
+        int policy, int prio, int cpu)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if(policy != SCHED_OTHER) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = prio;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, policy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+#ifdef __linux__
+    if(cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+#endif
+    int res = pthread_create(thr, &attr, func, arg);
+    pthread_attr_destroy(&attr);
+    return -res;
+}
+
+std::string read_line(const char *path, const char *prefix)
+{
+    FILE *f = fopen(path, "r");
+    if(!f) return "";
+    char buf[4096];
+    std::string result;
+    while(fgets(buf, sizeof(buf), f)) {
+        if(prefix && strncmp(buf, prefix, strlen(prefix))) continue;
+        char *cp = buf;
+        if(prefix) {
+            cp = strchr(buf, ':');
+            if(!cp) continue;
+            cp++;
+            while(*cp == ' ' || *cp == '\t') cp++;
+        }
+        result = cp;
+        break;
+    }
+    fclose(f);
+    while(!result.empty() && (result.back() == '\n' || result.back() == ' '))
+        result.erase(result.size() - 1);
+    return result;
+}
+
+std::string json_str(const std::string &s)
+{
+    std::string r = "\"";
+    for(char c : s) {
+        if(c == '"' || c == '\\') { r += '\\'; r += c; }
+        else if((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            r += buf;
+        } else r += c;
+    }
+    return r + "\"";
+}
+
+void write_report(FILE *f, double duration, const char *policy,
+        const std::vector<bench_thread*> &threads,
+        const std::vector<bench_load> &loads)
+{
+    struct utsname u;
+    uname(&u);
+    struct stat st;
+    bool preempt_rt = stat("/sys/kernel/realtime", &st) == 0;
+    time_t t = time(NULL);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": %d,\n", REPORT_VERSION);
+    fprintf(f, "  \"date\": %s,\n", json_str(date).c_str());
+    fprintf(f, "  \"host\": {\n");
+    fprintf(f, "    \"hostname\": %s,\n", json_str(u.nodename).c_str());
+    fprintf(f, "    \"sysname\": %s,\n", json_str(u.sysname).c_str());
+    fprintf(f, "    \"release\": %s,\n", json_str(u.release).c_str());
+    fprintf(f, "    \"kernel_version\": %s,\n", json_str(u.version).c_str());
+    fprintf(f, "    \"machine\": %s,\n", json_str(u.machine).c_str());
+    fprintf(f, "    \"preempt_rt\": %s,\n", preempt_rt ? "true" : "false");
+    fprintf(f, "    \"cpu_model\": %s,\n",
+            json_str(read_line("/proc/cpuinfo", "model name")).c_str());
+    fprintf(f, "    \"cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(f, "    \"cmdline\": %s,\n",
+            json_str(read_line("/proc/cmdline", NULL)).c_str());
+    fprintf(f, "    \"bios_version\": %s,\n",
+            json_str(read_line("/sys/class/dmi/id/bios_version", NULL)).c_str());
+    fprintf(f, "    \"board_name\": %s\n",
+            json_str(read_line("/sys/class/dmi/id/board_name", NULL)).c_str());
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"duration\": %.3f,\n", duration);
+    fprintf(f, "  \"policy\": %s,\n", json_str(policy).c_str());
+    fprintf(f, "  \"loads\": [");
+    for(size_t i = 0; i < loads.size(); i++)
+        fprintf(f, "%s{\"type\": \"%s\", \"count\": %d}", i ? ", " : "",
+                load_names[loads[i].kind], loads[i].count);
+    fprintf(f, "],\n");
+    fprintf(f, "  \"threads\": [\n");
+    for(size_t i = 0; i < threads.size(); i++) {
+        bench_thread *t = threads[i];
+        double mean = t->samples ? t->sum / t->samples : 0;
+        double var = t->samples ? t->sumsq / t->samples - mean * mean : 0;
+        int last = num_bins;
+        while(last > 0 && t->hist[last-1] == 0) last--;
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"name\": %s,\n", json_str(t->name).c_str());
+        fprintf(f, "      \"period_ns\": %ld,\n", t->period);
+        fprintf(f, "      \"strategy\": \"%s\",\n", strategy_names[t->strategy]);
+        fprintf(f, "      \"priority\": %d,\n", t->policy == SCHED_OTHER ? 0 : t->prio);
+        fprintf(f, "      \"cpu\": %d,\n", t->cpu);
+        fprintf(f, "      \"samples\": %lld,\n", t->samples);
+        fprintf(f, "      \"missed\": %lld,\n", t->missed);
+        fprintf(f, "      \"min_ns\": %lld,\n", t->samples ? t->min : 0);
+        fprintf(f, "      \"max_ns\": %lld,\n", t->samples ? t->max : 0);
+        fprintf(f, "      \"mean_ns\": %.1f,\n", mean);
+        fprintf(f, "      \"stddev_ns\": %.1f,\n", var > 0 ? sqrt(var) : 0.);
+        fprintf(f, "      \"histogram\": {\n");
+        fprintf(f, "        \"bin_ns\": %ld,\n", bin_width);
+        fprintf(f, "        \"counts\": [");
+        for(int j = 0; j < last; j++)
+            fprintf(f, "%s%lld", j ? ", " : "", t->hist[j]);
+        fprintf(f, "],\n");
+        fprintf(f, "        \"overflow\": %lld\n", t->overflow);
+        fprintf(f, "      }\n");
+        fprintf(f, "    }%s\n", i + 1 < threads.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+}
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+"Usage: %s [options]\n"
+"  -t NAME:PERIOD[:STRATEGY[:CPU]]  add a measured thread (PERIOD in ns)\n"
+"                 STRATEGY is abs (default), rel, timerfd or spin\n"
+"  -l LOAD[:COUNT]  add COUNT (default: one per cpu) load threads,\n"
+"                 LOAD is cache, fp or io\n"
+"  -d SECONDS     run time (default 60)\n"
+"  -b NS          histogram bin width (default 1000)\n"
+"  -n BINS        number of histogram bins (default 1000)\n"
+"  -D DIR         directory for the io load (default /tmp)\n"
+"  -o FILE        write the report to FILE instead of stdout\n"
+"  -q             do not print the summary on stderr\n"
+"Default threads are base:25000 and servo:1000000, like latency-test.\n",
+        argv0);
+}
+
+template<size_t N>
+int lookup(const char *(&names)[N], const std::string &s)
+{
+    for(size_t i = 0; i < N; i++)
+        if(s == names[i]) return i;
+    return -1;
+}
+
+std::vector<std::string> split(const char *arg)
+{
+    std::vector<std::string> r;
+    std::string cur;
+    for(const char *cp = arg; *cp; cp++) {
+        if(*cp == ':') { r.push_back(cur); cur.clear(); }
+        else cur += *cp;
+    }
+    r.push_back(cur);
+    return r;
+}
+
+bool by_period(const bench_thread *a, const bench_thread *b)
+{
+    return a->period < b->period;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<bench_thread*> threads;
+    std::vector<bench_load> loads;
+    double duration = 60;
+    const char *outfile = NULL;
+    bool quiet = false;
+    int rt_cpu = default_cpu();
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:l:d:b:n:D:o:qh")) != -1) {
+        switch(opt) {
+        case 't': {
+            std::vector<std::string> f = split(optarg);
+            bench_thread *t = new bench_thread();
+            t->name = f[0];
+            t->period = f.size() > 1 ? atol(f[1].c_str()) : 0;
+            int s = f.size() > 2 ? lookup(strategy_names, f[2]) : 0;
+            t->cpu = f.size() > 3 ? atoi(f[3].c_str()) : rt_cpu;
+            if(t->name.empty() || t->period <= 0 || s < 0) {
+                fprintf(stderr, "invalid thread '%s'\n", optarg);
+                return 1;
+            }
+            t->strategy = static_cast<strategy_t>(s);
+            threads.push_back(t);
+            break;
+        }
+        case 'l': {
+            std::vector<std::string> f = split(optarg);
+            bench_load l;
+            int k = lookup(load_names, f[0]);
+            l.count = f.size() > 1 ? atoi(f[1].c_str())
+                : (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if(k < 0 || l.count <= 0) {
+                fprintf(stderr, "invalid load '%s'\n", optarg);
+                return 1;
+            }
+            l.kind = static_cast<load_t>(k);
+            loads.push_back(l);
+            break;
+        }
+        case 'd': duration = atof(optarg); break;
+        case 'b': bin_width = atol(optarg); break;
+        case 'n': num_bins = atoi(optarg); break;
+        case 'D': io_dir = optarg; break;
+        case 'o': outfile = optarg; break;
+        case 'q': quiet = true; break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(optind != argc || duration <= 0 || bin_width <= 0 || num_bins <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if(threads.empty()) {
+        const char *names[] = { "base", "servo" };
+        long periods[] = { 25000, 1000000 };
+        for(int i = 0; i < 2; i++) {
+            bench_thread *t = new bench_thread();
+            t->name = names[i];
+            t->period = periods[i];
+            t->strategy = STRAT_ABS;
+            t->cpu = rt_cpu;
+            threads.push_back(t);
+        }
+    }
+
+    /* rate monotonic, as in rtapi_app: the fastest thread gets the
+       highest priority */
+    std::vector<bench_thread*> order(threads);
+    std::stable_sort(order.begin(), order.end(), by_period);
+    int prio = sched_get_priority_max(SCHED_FIFO);
+    for(bench_thread *t : order) {
+        t->prio = prio--;
+        t->hist.assign(num_bins, 0);
+        t->min = LLONG_MAX;
+        t->max = LLONG_MIN;
+    }
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        perror("mlockall");
+
+    const char *policy = "SCHED_FIFO";
+    for(bench_thread *t : order) {
+        t->policy = SCHED_FIFO;
+        int res = start_thread(&t->thr, bench_main, t, SCHED_FIFO, t->prio, t->cpu);
+        if(res == -EPERM) {
+            if(strcmp(policy, "SCHED_OTHER")) fprintf(stderr,
+                "latency-bench: no permission for realtime scheduling, "
+                "results will not be meaningful\n");
+            policy = "SCHED_OTHER";
+            t->policy = SCHED_OTHER;
+            res = start_thread(&t->thr, bench_main, t, SCHED_OTHER, 0, t->cpu);
+        }
+        if(res < 0) {
+            errno = -res;
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    std::vector<pthread_t> load_threads;
+    for(const bench_load &l : loads) {
+        for(int i = 0; i < l.count; i++) {
+            pthread_t thr;
+            if(start_thread(&thr, load_funcs[l.kind], NULL, SCHED_OTHER, 0, -1) == 0)
+                load_threads.push_back(thr);
+        }
+    }
+
+    long long start = now_ns(), end = start + (long long)(duration * 1e9);
+    while(!stop) {
+        long long left = end - now_ns();
+        if(left <= 0) break;
+        struct timespec ts = ns_to_ts(std::min(left, 100000000LL));
+        nanosleep(&ts, NULL);
+    }
+    stop = 1;
+    for(bench_thread *t : threads) pthread_join(t->thr, NULL);
+    for(pthread_t thr : load_threads) pthread_join(thr, NULL);
+    double elapsed = (now_ns() - start) * 1e-9;
+
+    FILE *f = stdout;
+    if(outfile) {
+        f = fopen(outfile, "w");
+        if(!f) { perror(outfile); return 1; }
+    }
+    write_report(f, elapsed, policy, threads, loads);
+    if(f != stdout && fclose(f) != 0) { perror(outfile); return 1; }
+
+    if(!quiet) {
+        fprintf(stderr, "%-12s %10s %-8s %10s %10s %10s %8s\n",
+                "thread", "period", "timer", "max", "mean", "stddev", "missed");
+        for(bench_thread *t : threads) {
+            double mean = t->samples ? t->sum / t->samples : 0;
+            double var = t->samples ? t->sumsq / t->samples - mean * mean : 0;
+            fprintf(stderr, "%-12s %10ld %-8s %10lld %10.0f %10.0f %8lld\n",
+                    t->name.c_str(), t->period, strategy_names[t->strategy],
+                    t->samples ? t->max : 0, mean, var > 0 ? sqrt(var) : 0.,
+                    t->missed);
+        }
+    }
+    for(bench_thread *t : threads) delete t;
+    return 0;
+}
@@ -0,0 +1,143 @@
+//    Copyright 2006-2014, various authors
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#ifndef RTAPI_SHMPAGES_H
+#define RTAPI_SHMPAGES_H
+
+/* Page backing of the uspace SysV shared memory segments, shared by
+   rtapi_shmem_new (HAL, motion) and rcs_shm_open (NML SHMEM buffers). */
+
+#include <sys/types.h>
+#include <sys/ipc.h>		/* IPC_* */
+#include <sys/shm.h>		/* shmget() */
+#include <sys/mman.h>		/* madvise() */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* RTAPI_HUGEPAGES selects how shared memory is backed:
+     unset, "0" or "no": ordinary pages
+     "thp":              ordinary segment, transparent huge pages requested
+                         with madvise (needs shmem_enabled=advise or better)
+     anything else:      hugetlbfs pages (SHM_HUGETLB), falling back to
+                         ordinary pages if none are available
+   Huge pages keep the HAL and motion working set within a handful of TLB
+   entries, so a servo cycle does not start with a round of TLB misses. */
+enum { SHM_PAGES_NORMAL, SHM_PAGES_THP, SHM_PAGES_HUGETLB };
+
+static inline int rtapi_shm_page_mode(void)
+{
+  static int mode = -1;
+  if(mode < 0) {
+    const char *s = getenv("RTAPI_HUGEPAGES");
+    if(!s || !*s || !strcmp(s, "0") || !strcmp(s, "no"))
+      mode = SHM_PAGES_NORMAL;
+    else if(!strcmp(s, "thp"))
+      mode = SHM_PAGES_THP;
+    else
+      mode = SHM_PAGES_HUGETLB;
+  }
+  return mode;
+}
+
+static inline long rtapi_shm_hugepage_size(void)
+{
+  static long hugepagesize = -1;
+  if(hugepagesize < 0) {
+    char line[128];
+    FILE *f = fopen("/proc/meminfo", "r");
+    hugepagesize = 0;
+    if(!f) return 0;
+    while(fgets(line, sizeof(line), f)) {
+      long kb;
+      if(sscanf(line, "Hugepagesize: %ld kB", &kb) == 1) {
+        hugepagesize = kb * 1024;
+        break;
+      }
+    }
+    fclose(f);
+  }
+  return hugepagesize;
+}
+
+/* shmget(), except that in hugetlb mode a segment created by this call is
+   given huge pages, its size rounded up to whole ones.  IPC_EXCL tells such
+   a segment from one that already exists; that one is attached with
+   whatever pages it has.  *hugeerr is the errno of a failed attempt at huge
+   pages, or 0. */
+static inline int rtapi_shm_get(key_t key, size_t size, int shmflg,
+    int *hugeerr)
+{
+  *hugeerr = 0;
+#ifdef SHM_HUGETLB
+  if((shmflg & IPC_CREAT) && rtapi_shm_page_mode() == SHM_PAGES_HUGETLB
+      && rtapi_shm_hugepage_size()) {
+    long hps = rtapi_shm_hugepage_size();
+    int id = shmget(key, (size + hps - 1) / hps * hps,
+        shmflg | IPC_EXCL | SHM_HUGETLB);
+    if(id != -1) return id;
+    if(errno != EEXIST) *hugeerr = errno;
+  }
+#endif
+  return shmget(key, size, shmflg);
+}
+
+/* The size of the pages of the mapping at addr, as /proc/self/smaps has it,
+   or the ordinary page size if it cannot be told. */
+static inline long rtapi_shm_pagesize(const void *addr)
+{
+  long pagesize = sysconf(_SC_PAGESIZE);
+  char line[256];
+  int in_range = 0;
+  FILE *f = fopen("/proc/self/smaps", "r");
+  if(!f) return pagesize;
+  while(fgets(line, sizeof(line), f)) {
+    unsigned long start, end;
+    long kb;
+    if(sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+      in_range = start <= (unsigned long)addr && (unsigned long)addr < end;
+      continue;
+    }
+    if(in_range && sscanf(line, "KernelPageSize: %ld kB", &kb) == 1) {
+      pagesize = kb * 1024;
+      break;
+    }
+  }
+  fclose(f);
+  return pagesize;
+}
+
+/* In thp mode ask for transparent huge pages on an ordinary mapping, then
+   touch every page so that none faults later in a realtime thread.
+   Returns -1 with errno set if madvise failed, else 0. */
+static inline int rtapi_shm_prefault(void *addr, size_t size, long pagesize)
+{
+  int res = 0;
+  size_t off;
+#ifdef MADV_HUGEPAGE
+  if(rtapi_shm_page_mode() == SHM_PAGES_THP
+      && pagesize == sysconf(_SC_PAGESIZE))
+    res = madvise(addr, size, MADV_HUGEPAGE);
+#endif
+  for(off = 0; off < size; off += pagesize) {
+    volatile char c = ((char*)addr)[off];
+    (void)c;
+  }
+  return res;
+}
+
+#endif
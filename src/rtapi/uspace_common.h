@@ -28,6 +28,8 @@ static int msg_level = RTAPI_MSG_ERR;	/* message printing level */
 
 #include <sys/ipc.h>		/* IPC_* */
 #include <sys/shm.h>		/* shmget() */
+#include "rtapi_shmpages.h"
+#include <stdlib.h>
 /* These structs hold data associated with objects like tasks, etc. */
 /* Task handles are pointers to these structs.                      */
 
@@ -44,6 +46,7 @@ typedef struct {
   int count;                    /* count of maps in this process */
   unsigned long int size;	/* size of shared memory area */
   void *mem;			/* pointer to the memory */
+  long pagesize;		/* size of the pages backing it */
 } rtapi_shmem_handle;
 
 #define MAX_SHM 64
@@ -52,6 +55,30 @@ typedef struct {
 
 static rtapi_shmem_handle shmem_array[MAX_SHM] = {{0},};
 
+/* RTAPI_INSTANCE (1-255) namespaces a simulated machine, so that several
+   can run side by side: the instance number is folded into the top byte
+   of every shared memory key (libnml does the same for its buffers), and
+   rtapi_app uses its own fifo.  Instance 0, the default, changes nothing. */
+static int rtapi_instance(void)
+{
+  static int instance = -1;
+  if(instance < 0) {
+    const char *s = getenv("RTAPI_INSTANCE");
+    instance = s ? atoi(s) : 0;
+    if(instance < 0 || instance > 255) {
+      rtapi_print_msg(RTAPI_MSG_ERR,
+          "RTAPI_INSTANCE must be between 0 and 255, using 0\n");
+      instance = 0;
+    }
+  }
+  return instance;
+}
+
+static key_t rtapi_instance_key(int key)
+{
+  return (key_t)(key ^ (rtapi_instance() << 24));
+}
+
 int rtapi_shmem_new(int key, int module_id, unsigned long int size)
 {
 #ifdef RTAPI
@@ -75,7 +102,13 @@ int rtapi_shmem_new(int key, int module_id, unsigned long int size)
   shmem = &shmem_array[i];
 
   /* now get shared memory block from OS */
-  shmem->id = shmget((key_t) key, (int) size, IPC_CREAT | 0600);
+  int hugeerr;
+  shmem->id = rtapi_shm_get(rtapi_instance_key(key), size, IPC_CREAT | 0600,
+      &hugeerr);
+  if(hugeerr)
+    rtapi_print_msg(RTAPI_MSG_WARN,
+        "rtapi_shmem_new: no huge pages for key 0x%08x (%s), "
+        "using ordinary pages\n", key, strerror(hugeerr));
   if (shmem->id == -1) {
     rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_shmem_new failed due to shmget(key=0x%08x): %s\n", key, strerror(errno));
     return -errno;
@@ -116,13 +149,17 @@ int rtapi_shmem_new(int key, int module_id, unsigned long int size)
     return -errno;
   }
 
-  long pagesize = sysconf(_SC_PAGESIZE);
-  /* touch every page */
-  for(size_t off = 0; off < size; off += pagesize)
-  {
-      volatile char i = ((char*)shmem->mem)[off];
-      (void)i;
-  }
+  /* touch every page, so that no page fault happens in a realtime thread */
+  shmem->pagesize = rtapi_shm_pagesize(shmem->mem);
+  if(rtapi_shm_prefault(shmem->mem, size, shmem->pagesize) < 0)
+    rtapi_print_msg(RTAPI_MSG_WARN,
+        "rtapi_shmem_new: madvise(MADV_HUGEPAGE) for key 0x%08x: %s\n",
+        key, strerror(errno));
+
+  rtapi_print_msg(RTAPI_MSG_INFO,
+      "rtapi_shmem_new: key 0x%08x, %lu bytes in %lu pages of %ld bytes\n",
+      key, size, (size + shmem->pagesize - 1) / shmem->pagesize,
+      shmem->pagesize);
 
   /* label as a valid shmem structure */
   shmem->magic = SHMEM_MAGIC;
@@ -197,6 +234,51 @@ int rtapi_shmem_delete(int handle, int module_id)
 
 
 
+#ifdef RTAPI
+/* Print to out, for each shared memory segment mapped by this process, how
+   many pages (and so TLB entries) it takes, and how much of it the kernel
+   has actually mapped with huge pages according to /proc/self/smaps. */
+static void rtapi_shmem_report(FILE *out)
+{
+  int i;
+  fprintf(out, "%-10s %10s %8s %8s %10s %10s\n",
+      "key", "size", "pagesize", "pages", "huge kB", "locked kB");
+  for(i = 0; i < MAX_SHM; i++) {
+    rtapi_shmem_handle *shmem = &shmem_array[i];
+    long huge_kb = 0, locked_kb = 0;
+    if(shmem->magic != SHMEM_MAGIC) continue;
+
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if(f) {
+      char line[256];
+      int in_range = 0;
+      while(fgets(line, sizeof(line), f)) {
+        unsigned long start, end;
+        long kb;
+        if(sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+          in_range = start <= (unsigned long)shmem->mem
+              && (unsigned long)shmem->mem < end;
+          continue;
+        }
+        if(!in_range) continue;
+        if(sscanf(line, "ShmemPmdMapped: %ld kB", &kb) == 1)
+          huge_kb += kb;
+        else if(sscanf(line, "Locked: %ld kB", &kb) == 1)
+          locked_kb += kb;
+        else if(shmem->pagesize != sysconf(_SC_PAGESIZE)
+            && sscanf(line, "Rss: %ld kB", &kb) == 1)
+          huge_kb += kb;
+      }
+      fclose(f);
+    }
+    fprintf(out, "0x%08x %10lu %8ld %8lu %10ld %10ld\n",
+        shmem->key, shmem->size, shmem->pagesize,
+        (shmem->size + shmem->pagesize - 1) / shmem->pagesize,
+        huge_kb, locked_kb);
+  }
+}
+#endif
+
 void default_rtapi_msg_handler(msg_level_t level, const char *fmt, va_list ap);
 
 static rtapi_msg_handler_t rtapi_msg_handler = default_rtapi_msg_handler;
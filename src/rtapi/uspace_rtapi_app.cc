@@ -317,6 +317,84 @@ static int do_unload_cmd(string name) {
     return 0;
 }
 
+/* Read a module file once so that the dlopen() that follows finds it in
+   the page cache.  dlopen() itself holds the dynamic loader's lock, so
+   the file I/O is the only part of loading that can overlap. */
+struct prefetch_job {
+    vector<string> paths;
+    std::atomic<size_t> next;
+};
+
+static void *prefetch_function(void *arg) {
+    prefetch_job *job = reinterpret_cast<prefetch_job*>(arg);
+    char buf[65536];
+    size_t i;
+    while((i = job->next++) < job->paths.size()) {
+        int fd = open(job->paths[i].c_str(), O_RDONLY);
+        if(fd < 0) continue;
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+        while(read(fd, buf, sizeof(buf)) > 0) {}
+        close(fd);
+    }
+    return nullptr;
+}
+
+/* batch: a list of load and newinst commands sent in one round trip, each
+   preceded by its own word count:
+       batch 2 load mod1 3 load mod2 arg=1 ...
+   The module files are read ahead in parallel, then the commands are run
+   in the order given, which is the order their dependencies were written
+   in the .hal file.  Returns 0, or k+1 if command k failed, in which case
+   the commands after it are not run. */
+static int handle_command(vector<string> args);
+
+static int do_batch_cmd(vector<string> args) {
+    vector<vector<string> > cmds;
+    for(size_t i = 1; i < args.size(); ) {
+        char *end;
+        long n = strtol(args[i].c_str(), &end, 10);
+        if(*end || n <= 0 || i + 1 + n > args.size()) {
+            rtapi_print_msg(RTAPI_MSG_ERR, "batch: malformed command list\n");
+            return -1;
+        }
+        cmds.push_back(vector<string>(args.begin() + i + 1,
+                    args.begin() + i + 1 + n));
+        i += 1 + n;
+    }
+
+    prefetch_job job;
+    job.next = 0;
+    for(size_t i = 0; i < cmds.size(); i++) {
+        if(cmds[i][0] == "load" && cmds[i].size() >= 2
+                && modules.find(cmds[i][1]) == modules.end())
+            job.paths.push_back(string(EMC2_RTLIB_DIR) + "/" + cmds[i][1]
+                    + ".so");
+    }
+    vector<pthread_t> threads;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(nthreads > (long)job.paths.size()) nthreads = job.paths.size();
+    for(long i = 0; i < nthreads; i++) {
+        pthread_t thr;
+        if(pthread_create(&thr, nullptr, prefetch_function, &job) == 0)
+            threads.push_back(thr);
+    }
+    for(size_t i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], nullptr);
+
+    for(size_t i = 0; i < cmds.size(); i++) {
+        if(cmds[i][0] != "load" && cmds[i][0] != "newinst") {
+            rtapi_print_msg(RTAPI_MSG_ERR,
+                    "batch: command %s not allowed\n", cmds[i][0].c_str());
+            return i + 1;
+        }
+        if(handle_command(cmds[i]) != 0)
+            return i + 1;
+    }
+    return 0;
+}
+
 struct ReadError : std::exception {};
 struct WriteError : std::exception {};
 
@@ -384,6 +462,8 @@ static int handle_command(vector<string> args) {
         return do_newinst_cmd(args[1], args[2], "");
     } else if(args.size() == 4 && args[0] == "newinst") {
         return do_newinst_cmd(args[1], args[2], args[3]);
+    } else if(args.size() >= 1 && args[0] == "batch") {
+        return do_batch_cmd(args);
     } else {
         rtapi_print_msg(RTAPI_MSG_ERR,
                 "Unrecognized command starting with %s\n",
@@ -405,6 +485,19 @@ static int slave(int fd, vector<string> args) {
     return result;
 }
 
+/* The shared memory report of this process, which is the master */
+static string shmem_report() {
+    char *text = nullptr;
+    size_t len = 0;
+    FILE *f = open_memstream(&text, &len);
+    if(!f) return string();
+    rtapi_shmem_report(f);
+    fclose(f);
+    string result(text, len);
+    free(text);
+    return result;
+}
+
 static int callback(int fd)
 {
     struct sockaddr_un client_addr;
@@ -416,9 +509,9 @@ static int callback(int fd)
             "rtapi_app: failed to accept connection from slave: %s\n", strerror(errno));
         return -1;
     } else {
-        int result;
+        vector<string> args;
         try {
-            result = handle_command(read_strings(fd1));
+            args = read_strings(fd1);
         } catch (ReadError &e) {
             rtapi_print_msg(RTAPI_MSG_ERR,
                 "rtapi_app: failed to read from slave: %s\n", strerror(errno));
@@ -426,7 +519,13 @@ static int callback(int fd)
             return -1;
         }
         string buf;
-        write_number(buf, result);
+        if(args.size() == 1 && args[0] == "shmstats") {
+            // the report goes back to the slave to print
+            write_number(buf, 0);
+            write_string(buf, shmem_report());
+        } else {
+            write_number(buf, handle_command(args));
+        }
         if(write(fd1, buf.data(), buf.size()) != (ssize_t)buf.size()) {
             rtapi_print_msg(RTAPI_MSG_ERR,
                 "rtapi_app: failed to write to slave: %s\n", strerror(errno));
@@ -467,9 +566,11 @@ _get_fifo_path() {
     std::string s;
     if(getenv("RTAPI_FIFO_PATH"))
        s = getenv("RTAPI_FIFO_PATH");
-    else if(getenv("HOME"))
+    else if(getenv("HOME")) {
        s = std::string(getenv("HOME")) + "/.rtapi_fifo";
-    else {
+       if(rtapi_instance())
+           s += "." + std::to_string(rtapi_instance());
+    } else {
        rtapi_print_msg(RTAPI_MSG_ERR,
            "rtapi_app: RTAPI_FIFO_PATH and HOME are unset.  rtapi fifo creation is unsafe.");
        return NULL;
@@ -523,6 +624,42 @@ int main(int argc, char **argv) {
     vector<string> args;
     for(int i=1; i<argc; i++) { args.push_back(string(argv[i])); }
 
+    if(args.size() == 1 && args[0] == "status") {
+        /* succeed if a master is running for this instance; never
+           become the master */
+        int fd = socket(PF_UNIX, SOCK_STREAM, 0);
+        if(fd == -1) { perror("socket"); exit(1); }
+        struct sockaddr_un addr;
+        addr.sun_family = AF_UNIX;
+        if(get_fifo_path(addr.sun_path, sizeof(addr.sun_path)) < 0)
+           exit(1);
+        if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) return 1;
+        return slave(fd, vector<string>()) != 0;
+    }
+
+    if(args.size() == 1 && args[0] == "shmstats") {
+        /* report on the shared memory of the running master; a new
+           master would have none */
+        int fd = socket(PF_UNIX, SOCK_STREAM, 0);
+        if(fd == -1) { perror("socket"); exit(1); }
+        struct sockaddr_un addr;
+        addr.sun_family = AF_UNIX;
+        if(get_fifo_path(addr.sun_path, sizeof(addr.sun_path)) < 0)
+           exit(1);
+        if(connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            fprintf(stderr, "rtapi_app: shmstats: no realtime master is running\n");
+            return 1;
+        }
+        if(slave(fd, args) != 0) return 1;
+        try {
+            fputs(read_string(fd).c_str(), stdout);
+        } catch (ReadError &e) {
+            fprintf(stderr, "rtapi_app: failed to read from master: %s\n", strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+
 become_master:
     int fd = socket(PF_UNIX, SOCK_STREAM, 0);
     if(fd == -1) { perror("socket"); exit(1); }
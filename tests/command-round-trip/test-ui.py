@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+
+import linuxcnc
+import linuxcnc_util
+
+import time
+import sys
+
+
+# [TASK] IDLE_CYCLE_TIME in test.ini is 2 seconds; a round trip that
+# waits for the next status write task makes regardless of changes takes
+# about that long.
+MAX_ROUND_TRIP = 0.5
+ROUND_TRIPS = 20
+
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+
+l = linuxcnc_util.LinuxCNC(command=c, status=s)
+# Wait for LinuxCNC to initialize itself so the Status buffer stabilizes.
+l.wait_for_linuxcnc_startup()
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.wait_complete()
+
+# let task go idle
+time.sleep(1)
+
+failed = False
+times = []
+for i in range(ROUND_TRIPS):
+    if i % 2:
+        mode = linuxcnc.MODE_MDI
+    else:
+        mode = linuxcnc.MODE_MANUAL
+    start = time.time()
+    c.mode(mode)
+    r = c.wait_complete(5)
+    t = time.time() - start
+    times.append(t)
+    if r != linuxcnc.RCS_DONE:
+        print "round trip %d: wait_complete() returned %d" % (i, r)
+        failed = True
+    s.poll()
+    if s.task_mode != mode:
+        print "round trip %d: mode %d, expected %d" % (i, s.task_mode, mode)
+        failed = True
+    # idle again before the next one
+    time.sleep(0.2)
+
+print "round trips: mean %.1f ms, max %.1f ms" % (
+    1000 * sum(times) / len(times), 1000 * max(times))
+if max(times) > MAX_ROUND_TRIP:
+    print "round trip took longer than %.1f s" % MAX_ROUND_TRIP
+    failed = True
+
+# wait_complete(0) checks once and must not wait at all
+start = time.time()
+c.wait_complete(0)
+t = time.time() - start
+if t > 0.1:
+    print "wait_complete(0) took %.3f s" % t
+    failed = True
+
+c.state(linuxcnc.STATE_ESTOP)
+c.wait_complete()
+
+sys.exit(1 if failed else 0)
@@ -0,0 +1,17 @@
+#!/bin/sh
+TMPDIR=`mktemp -d /tmp/snapshot.XXXXXX`
+trap "rm -rf $TMPDIR" 0 1 2 3 9 15
+
+realtime start
+halcmd newsig a float
+halcmd newsig b s32
+halcmd sets a 1.5
+halcmd snapshot $TMPDIR/1.snap
+halcmd sets a 2.25
+halcmd newsig c bit
+halcmd snapshot $TMPDIR/2.snap
+halcmd -s diff $TMPDIR/1.snap $TMPDIR/2.snap
+halcmd sets b -3
+halcmd -s diff $TMPDIR/2.snap
+halcmd unload all
+realtime stop
@@ -0,0 +1,20 @@
+#!/bin/sh
+TMPDIR=`mktemp -d /tmp/halscope-stream.XXXXXX`
+trap "rm -rf $TMPDIR" 0 1 2 3 9 15
+
+realtime start
+halcmd loadrt threads name1=fast period1=100000
+halcmd loadrt threadtest count=1
+halcmd loadrt scope_rt stream_chans=4 stream_len=8192
+halcmd net count threadtest.0.count
+halcmd addf threadtest.0.increment fast
+halcmd start
+halscope-stream start -t fast -n 5000 -b 300 -o $TMPDIR/capture.hst \
+    threadtest.0.count count
+STATUS=$?
+halcmd stop
+halcmd unload all
+realtime stop
+if [ $STATUS -ne 0 ]; then exit $STATUS; fi
+
+halscope-stream dump $TMPDIR/capture.hst
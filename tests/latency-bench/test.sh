@@ -0,0 +1,12 @@
+#!/bin/bash
+. rtapi.conf
+
+if [ "$RTPREFIX" != uspace ]; then
+    echo "test only meaningful on uspace"
+    exit 0
+fi
+
+latency-bench -q -d 1 -b 10000 -n 100 \
+    -t abs:1000000 -t rel:1000000:rel \
+    -t timerfd:2000000:timerfd -t spin:5000000:spin \
+    -l fp:1
@@ -0,0 +1,91 @@
+#!/usr/bin/env python
+
+import linuxcnc
+import hal
+
+import time
+import sys
+import subprocess
+import os
+
+comp = hal.component("test-ui")
+comp.newpin("reopen-log", hal.HAL_BIT, hal.HAL_IO)
+comp.ready()
+
+os.system("halcmd net reopen-log test-ui.reopen-log motion-logger.reopen-log")
+
+# This will be the return value of this program.
+# Any failure sets it to 1.
+retval = 0
+
+
+def wait_for_idle():
+    c.wait_complete()
+    start_time = time.time()
+    while (time.time() - start_time) < 10.0:
+        s.poll()
+        if s.interp_state == linuxcnc.INTERP_IDLE:
+            return
+        time.sleep(0.01)
+    print "timed out waiting for the program to end"
+    sys.exit(1)
+
+
+def end_log(logfile_name):
+    wait_for_idle()
+    comp['reopen-log'] = True
+    while comp['reopen-log']: time.sleep(.01)
+    os.rename("out.motion-logger", 'result.%s' % logfile_name)
+
+
+#
+# connect to LinuxCNC
+#
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+
+#
+# Come out of E-stop, turn the machine on, and switch to Auto mode.
+#
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.mode(linuxcnc.MODE_AUTO)
+
+end_log('startup')
+
+
+#
+# A run from the start leaves checkpoints of test.ngc, which a run from
+# a line then starts from.  Giving the file a new mtime drops them, so
+# the same run then reads through all the lines before the start line.
+# The motion commands of the two must be the same.
+#
+
+c.program_open('test.ngc')
+c.auto(linuxcnc.AUTO_RUN, 0)
+end_log('full')
+
+for line in (20, 31, 38):
+    c.auto(linuxcnc.AUTO_RUN, line)
+    end_log('checkpoint-%d' % line)
+
+    st = os.stat('test.ngc')
+    os.utime('test.ngc', (st.st_atime, st.st_mtime + 1))
+    c.auto(linuxcnc.AUTO_RUN, line)
+    end_log('read-through-%d' % line)
+
+    status = subprocess.call(['diff', '-u', 'result.read-through-%d' % line, 'result.checkpoint-%d' % line], shell=False)
+    if status == 0 and os.path.getsize('result.checkpoint-%d' % line) > 0:
+        print "sub-test run from line %d ok" % line
+    else:
+        print "run from line %d differs from a read-through" % line
+        retval = 1
+    sys.stdout.flush()
+
+
+print >>sys.stderr, "trying to exit"
+sys.exit(retval)
@@ -0,0 +1,5 @@
+#!/bin/bash
+
+rm -f out.motion-logger* result.*
+
+linuxcnc -r test.ini
@@ -0,0 +1,159 @@
+// Checks that a delta subscriber ends up with exactly the message that was
+// written, across keyframes and after the server it subscribed to is
+// restarted.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <netinet/in.h>		// tcpmem.hh needs sockaddr_in
+#include "nml.hh"
+#include "nmlmsg.hh"
+#include "nml_srv.hh"
+#include "cms.hh"
+#include "tcpmem.hh"
+#include "timer.hh"
+#include "rcs_print.hh"
+
+#define DELTA_TEST_MSG_TYPE 4242
+#define UPDATES 250			// over two keyframe intervals
+
+struct DELTA_TEST_MSG : public NMLmsg {
+    DELTA_TEST_MSG() : NMLmsg(DELTA_TEST_MSG_TYPE, sizeof(DELTA_TEST_MSG)) {}
+    void update(CMS *cms) {
+        cms->update(seq);
+        cms->update(d, 1000);
+        cms->update(i, 200);
+        cms->update(c, 256);
+    }
+    long seq;
+    double d[1000];
+    int i[200];
+    char c[256];
+};
+
+// Everything past the NMLmsg header, which the subscriber does not get as is.
+#define PAYLOAD(msg) (&(msg)->seq)
+#define PAYLOAD_SIZE(msg) ((char *) ((msg) + 1) - (char *) PAYLOAD(msg))
+
+static int format(NMLTYPE type, void *buffer, CMS *cms) {
+    if(type != DELTA_TEST_MSG_TYPE) return 0;
+    ((DELTA_TEST_MSG *) buffer)->update(cms);
+    return 1;
+}
+
+// Whether the server agreed to send deltas, which is only recorded inside
+// TCPMEM.
+struct delta_probe : public TCPMEM {
+    static int active(NML *nml) {
+        TCPMEM *tcpmem = dynamic_cast<TCPMEM *>(nml->cms);
+        return tcpmem && tcpmem->*(&delta_probe::delta_subscription);
+    }
+};
+
+static pid_t start_server() {
+    pid_t pid = fork();
+    if(pid == 0) {
+        NML xdr(format, "xdrbuf", "srv", "test.nml");
+        NML packed(format, "packedbuf", "srv", "test.nml");
+        run_nml_servers();
+        _exit(1);
+    }
+    return pid;
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+static NML *subscribe(const char *buffer) {
+    double start = etime();
+    while(etime() - start < 10) {
+        NML *sub = new NML(format, buffer, "sub", "test.nml");
+        if(sub->valid()) return sub;
+        delete sub;
+        esleep(0.05);
+    }
+    return NULL;
+}
+
+// Write UPDATES messages, each changing a few fields or, now and then,
+// nearly all of them, and compare what the subscriber gets with each.
+// Returns the number of updates that differed or did not arrive.
+static int run_updates(NML *writer, NML *sub, DELTA_TEST_MSG *msg) {
+    int bad = 0;
+    for(int k = 0; k < UPDATES; k++) {
+        msg->seq++;
+        if(k % 7 == 0) {
+            for(int j = 0; j < 1000; j++) msg->d[j] = msg->seq * 0.5 + j;
+        } else {
+            msg->d[(msg->seq * 37) % 1000] = msg->seq;
+            msg->i[msg->seq % 200] = (int) msg->seq * 3;
+            msg->c[msg->seq % 256] = (char) msg->seq;
+        }
+        writer->write(msg);
+
+        double start = etime();
+        DELTA_TEST_MSG *got = NULL;
+        while(etime() - start < 10) {
+            if(sub->read() == DELTA_TEST_MSG_TYPE) {
+                got = (DELTA_TEST_MSG *) sub->get_address();
+                if(got->seq == msg->seq) break;
+                got = NULL;
+            }
+            esleep(0.001);
+        }
+        if(!got) {
+            // nothing more is coming through; the rest fail too
+            bad += UPDATES - k;
+            break;
+        }
+        if(memcmp(PAYLOAD(got), PAYLOAD(msg), PAYLOAD_SIZE(msg))) bad++;
+    }
+    return bad;
+}
+
+int main() {
+    set_rcs_print_destination(RCS_PRINT_TO_STDERR);
+    const char *buffers[] = { "xdrbuf", "packedbuf" };
+    NML *writers[2];
+    for(int b = 0; b < 2; b++) {
+        writers[b] = new NML(format, buffers[b], "wr", "test.nml");
+        if(!writers[b]->valid()) {
+            printf("%s: can not open the buffer\n", buffers[b]);
+            return 1;
+        }
+    }
+
+    pid_t server = start_server();
+    int failed = 0;
+    for(int b = 0; b < 2; b++) {
+        DELTA_TEST_MSG *msg = new DELTA_TEST_MSG;
+        memset(PAYLOAD(msg), 0, PAYLOAD_SIZE(msg));
+        NML *sub = subscribe(buffers[b]);
+        if(!sub) {
+            printf("%s: can not subscribe\n", buffers[b]);
+            failed = 1;
+            continue;
+        }
+
+        int bad = run_updates(writers[b], sub, msg);
+        printf("%s: %d of %d updates differed, deltas %s\n", buffers[b],
+            bad, UPDATES, delta_probe::active(sub) ? "on" : "off");
+
+        stop_server(server);
+        server = start_server();
+        bad += run_updates(writers[b], sub, msg);
+        printf("%s: after a reconnect %d differed, deltas %s\n", buffers[b],
+            bad, delta_probe::active(sub) ? "on" : "off");
+
+        failed |= bad != 0;
+        delete sub;
+        delete msg;
+    }
+    stop_server(server);
+    for(int b = 0; b < 2; b++) delete writers[b];
+    return failed;
+}
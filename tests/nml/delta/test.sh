@@ -0,0 +1,11 @@
+#!/bin/sh
+set -xe
+
+TOPDIR=`readlink -f ../../..`
+INCLUDE=$TOPDIR/include
+LIB=$TOPDIR/lib
+
+g++ -o nmldelta nmldelta.cc \
+    -Wall -Wextra -Wno-unused-parameter \
+    -I $INCLUDE -L $LIB -Wl,-rpath,$LIB -lnml
+./nmldelta
@@ -0,0 +1,27 @@
+#!/bin/bash
+TMPDIR=`mktemp -d /tmp/sampler-binary.XXXXXX`
+trap "rm -rf $TMPDIR" 0 1 2 3 9 15
+
+python -c '
+import struct, sys
+for i in range(8):
+    sys.stdout.write(struct.pack("<di4xI4x", i * 0.5, -i, i * 1000))
+' > $TMPDIR/in.bin
+
+halrun -f > $TMPDIR/out.txt <<EOT
+loadrt threads name1=slow period1=1000000
+loadrt streamer depth=100 cfg=fsu
+loadrt sampler depth=100 cfg=fsu readers=2
+addf streamer.0 slow
+addf sampler.0 slow
+net f streamer.0.pin.0 sampler.0.pin.0
+net s streamer.0.pin.1 sampler.0.pin.1
+net u streamer.0.pin.2 sampler.0.pin.2
+loadusr -w halstreamer -b $TMPDIR/in.bin
+start
+loadusr -w halsampler -r 1 -b -n 8 $TMPDIR/out.bin
+loadusr -w halsampler -r 0 -n 8
+EOT
+
+cat $TMPDIR/out.txt
+cmp $TMPDIR/in.bin $TMPDIR/out.bin && echo binary ok